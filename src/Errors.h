@@ -85,6 +85,24 @@
 #define RERR_COMMAND_FAILED                         (-124)
 /** Invalid parameter to a command. */
 #define RERR_INVALID_COMMAND_PARAMETER              (-125)
+/** Range used where a single number is expected. */
+#define RERR_RANGE_UNEXPECTED                       (-126)
+/** Invalid range, zero step or no items where some are required. */
+#define RERR_RANGE_INVALID                          (-127)
+/** User-defined Function calls nested too deeply. */
+#define RERR_FUNCTION_NESTING_TOO_DEEP              (-128)
+/** Evaluation exceeded its step budget. */
+#define RERR_STEP_BUDGET_EXCEEDED                   (-129)
+/** Evaluation exceeded its deadline. */
+#define RERR_DEADLINE_EXCEEDED                      (-130)
+/** Evaluation was cancelled. */
+#define RERR_CANCELLED                              (-131)
+/** No Variable with a constant value at or below the value. */
+#define RERR_SYMBOL_NOT_FOUND                       (-132)
+/** Expression of a lazily defined Variable failed to parse when first used. */
+#define RERR_VARIABLE_INVALID_DEFINITION            (-133)
+/** User-defined Function calls itself. */
+#define RERR_FUNCTION_RECURSIVE                     (-134)
 /** Operator on unitialized object. */
 #define RERR_NOT_INITIALIZED                        (-301)
 /** Magic mismatch. */
@@ -93,6 +111,20 @@
 #define RERR_NOT_SUPPORTED                          (-303)
 /** Not implemented. */
 #define RERR_NOT_IMPLEMENTED                        (-304)
+/** File could not be opened, read or written. */
+#define RERR_FILE_IO                                (-305)
+/** Socket could not be created, connected, read or written. */
+#define RERR_SOCKET_IO                              (-306)
+/** Address is already in use. */
+#define RERR_ADDRESS_IN_USE                         (-307)
+/** Malformed message from the other end of a connection. */
+#define RERR_PROTOCOL_ERROR                         (-308)
+/** Image is malformed or was written by an incompatible build. */
+#define RERR_IMAGE_INVALID                          (-309)
+/** Symbol file is malformed. */
+#define RERR_SYMBOL_FILE_INVALID                    (-310)
+/** Thread could not be created or synchronization failed. */
+#define RERR_THREAD_FAILED                          (-311)
 /** Undefined error. */
 #define RERR_UNDEFINED                              (-666)
 /** General failure, who is he? */
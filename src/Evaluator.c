@@ -23,51 +23,94 @@
 *   Header Files                                                               *
 *******************************************************************************/
 #include "InputOutput.h"
-#include "EvaluatorInternal.h"
+#include "EvaluatorCore.h"
 #include "EvaluatorFunctions.h"
 #include "EvaluatorCommands.h"
 #include "Stack.h"
 #include "Queue.h"
 #include "List.h"
+#include "SymbolTable.h"
 #include "Assert.h"
 #include "GenericDefs.h"
 #include "Errors.h"
 #include "Magics.h"
 #include "StringOps.h"
+#include "Timestamp.h"
+#include "FileMap.h"
+#include "SymbolImport.h"
+#include "Thread.h"
+#include "TaskPool.h"
+#include "Rcu.h"
 
 #include <errno.h>
+#include <signal.h>
 
 /*******************************************************************************
  *   Static functions                                                          *
  *******************************************************************************/
-static int OpAdd(PEVALUATOR, PTOKEN[]);
-static int OpSubtract(PEVALUATOR, PTOKEN[]);
-static int OpNegate(PEVALUATOR, PTOKEN[]);
-static int OpMultiply(PEVALUATOR, PTOKEN[]);
-static int OpDivide(PEVALUATOR, PTOKEN[]);
-static int OpIncrement(PEVALUATOR, PTOKEN[]);
-static int OpDecrement(PEVALUATOR, PTOKEN[]);
-static int OpShiftLeft(PEVALUATOR, PTOKEN[]);
-static int OpShiftRight(PEVALUATOR, PTOKEN[]);
-static int OpBitNegate(PEVALUATOR, PTOKEN[]);
-static int OpModulo(PEVALUATOR, PTOKEN[]);
-static int OpLessThan(PEVALUATOR, PTOKEN[]);
-static int OpGreaterThan(PEVALUATOR, PTOKEN[]);
-static int OpEqualTo(PEVALUATOR, PTOKEN[]);
-static int OpLessThanOrEqualTo(PEVALUATOR, PTOKEN[]);
-static int OpGreaterThanOrEqualTo(PEVALUATOR, PTOKEN[]);
-static int OpNotEqualTo(PEVALUATOR, PTOKEN[]);
-static int OpLogicalNot(PEVALUATOR, PTOKEN[]);
-static int OpBitwiseAnd(PEVALUATOR, PTOKEN[]);
-static int OpBitwiseXor(PEVALUATOR, PTOKEN[]);
-static int OpBitwiseOr(PEVALUATOR, PTOKEN[]);
-static int OpLogicalAnd(PEVALUATOR, PTOKEN[]);
-static int OpLogicalOr(PEVALUATOR, PTOKEN[]);
+static int OpAdd(PEVALUATOR, PTOKEN);
+static int OpSubtract(PEVALUATOR, PTOKEN);
+static int OpNegate(PEVALUATOR, PTOKEN);
+static int OpMultiply(PEVALUATOR, PTOKEN);
+static int OpDivide(PEVALUATOR, PTOKEN);
+static int OpIncrement(PEVALUATOR, PTOKEN);
+static int OpDecrement(PEVALUATOR, PTOKEN);
+static int OpShiftLeft(PEVALUATOR, PTOKEN);
+static int OpShiftRight(PEVALUATOR, PTOKEN);
+static int OpBitNegate(PEVALUATOR, PTOKEN);
+static int OpModulo(PEVALUATOR, PTOKEN);
+static int OpLessThan(PEVALUATOR, PTOKEN);
+static int OpGreaterThan(PEVALUATOR, PTOKEN);
+static int OpEqualTo(PEVALUATOR, PTOKEN);
+static int OpLessThanOrEqualTo(PEVALUATOR, PTOKEN);
+static int OpGreaterThanOrEqualTo(PEVALUATOR, PTOKEN);
+static int OpNotEqualTo(PEVALUATOR, PTOKEN);
+static int OpLogicalNot(PEVALUATOR, PTOKEN);
+static int OpBitwiseAnd(PEVALUATOR, PTOKEN);
+static int OpBitwiseXor(PEVALUATOR, PTOKEN);
+static int OpBitwiseOr(PEVALUATOR, PTOKEN);
+static int OpLogicalAnd(PEVALUATOR, PTOKEN);
+static int OpLogicalOr(PEVALUATOR, PTOKEN);
+static int EvaluatorExecProgram(PEVALUATOR pEval, PCPROGRAM pProgram, PCTOKEN paArgs, PTOKEN pResult);
+static void SymIndexNoteVariable(uint32_t uSymbol);
 
 
 /*******************************************************************************
  *   Globals, Typedefs & Defines                                               *
  *******************************************************************************/
+/** Number of value stack Tokens available without allocating, covers most expressions. */
+#define EVAL_VALUE_STACK_SMALL      16
+/** Number of steps between deadline checks, reading the clock on every step is too costly. */
+#define EVAL_DEADLINE_CHECK_STEPS   256
+/** Number of Variable frames available without allocating while resolving a Variable. */
+#define EVAL_VAR_FRAMES_SMALL       16
+/** Number of chained assignment links available without allocating while parsing. */
+#define EVAL_ASSIGN_LINKS_SMALL     4
+
+/**
+ * VARFRAME: A Variable being resolved, see EvaluatorEvaluateVariable().
+ */
+typedef struct VARFRAME
+{
+    PVARIABLE       pVariable;      /**< The Variable. */
+    PCQUEUEITEM     pNext;          /**< The next item of the Variable's RPN Queue to evaluate, NULL when done. */
+    uint32_t        iStackBase;     /**< Depth of the value stack when the Variable was entered. */
+} VARFRAME;
+/** Pointer to a Variable frame. */
+typedef VARFRAME *PVARFRAME;
+
+/**
+ * ASSIGNLINK: A link of a chained assignment (a=b=...) being parsed, see EvaluatorParse().
+ */
+typedef struct ASSIGNLINK
+{
+    PQUEUE          pQueue;         /**< The RPN Queue ending in the Variable being assigned. */
+    PTOKEN          pVarToken;      /**< The Variable Token being assigned, owned by @a pQueue. */
+    const char     *pszExpr;        /**< The right-hand side of the assignment. */
+} ASSIGNLINK;
+/** Pointer to a chained assignment link. */
+typedef ASSIGNLINK *PASSIGNLINK;
+
 PCOPERATOR g_pOperatorOpenParenthesis = NULL;
 PCOPERATOR g_pOperatorCloseParenthesis = NULL;
 
@@ -121,8 +164,116 @@ OPERATOR g_aOperators[] =
 
 const unsigned g_cOperators = R_ARRAY_ELEMENTS(g_aOperators);
 
-/** Global list of Variables. */
-static LIST g_VarList;
+/**
+ * SYMINDEXENTRY: A Variable with a constant value in the reverse lookup index.
+ */
+/** Maximum delta entries of the reverse lookup index before they're merged into its entries. */
+#define SYMINDEX_MAX_DELTA          1024
+
+typedef struct SYMINDEXENTRY
+{
+    uint64_t        uValue;         /**< The value of the Variable. */
+    uint32_t        uSymbol;        /**< Symbol Id of the name of the Variable. */
+} SYMINDEXENTRY;
+/** Pointer to a reverse lookup index entry. */
+typedef SYMINDEXENTRY *PSYMINDEXENTRY;
+/** Pointer to a const reverse lookup index entry. */
+typedef const SYMINDEXENTRY *PCSYMINDEXENTRY;
+
+/**
+ * SYMINDEX: The Variables of the global scope and the loaded image whose values
+ * are constants, sorted by value, see EvaluatorLookupSymbol(). It's built on the
+ * first lookup. After that, Variables assigned are noted and the next lookup
+ * merges them into a small delta, which is merged into the entries once it
+ * grows past SYMINDEX_MAX_DELTA. Entries of Variables reassigned since are
+ * stale and skipped, once too many are the index is built again.
+ */
+typedef struct SYMINDEX
+{
+    PSYMINDEXENTRY  paEntries;      /**< The entries sorted by value and then Symbol Id. */
+    uint32_t        cEntries;       /**< Number of entries. */
+    PSYMINDEXENTRY  paDelta;        /**< Entries added since the last merge, sorted like paEntries. */
+    uint32_t        cDelta;         /**< Number of delta entries. */
+    uint32_t       *pauPending;     /**< Symbol Ids of Variables assigned since the last lookup. */
+    uint32_t        cPending;       /**< Number of pending Symbol Ids. */
+    uint32_t        cPendingAlloc;  /**< Number of pending Symbol Ids allocated. */
+    uint32_t        cStale;         /**< Number of entries found to be stale. */
+    bool            fValid;         /**< Whether the index is built, if not the next lookup builds it. */
+} SYMINDEX;
+
+/** Maximum delta entries of the completion index before they're merged into its entries. */
+#define NAMEINDEX_MAX_DELTA         1024
+
+/**
+ * NAMEINDEX: Names for completion sorted so that those starting with a prefix
+ * are adjacent, see EvaluatorFindCompletion(). Names of built-in Functions and
+ * Commands never change and are sorted once. Interned names are sorted by
+ * Symbol Id, names interned since the last completion are merged into a small
+ * delta first, which is merged into the entries once it grows past
+ * NAMEINDEX_MAX_DELTA. Names are interned for good, so whether a name is still
+ * a Variable or user-defined Function is checked as matches are returned.
+ */
+typedef struct NAMEINDEX
+{
+    const char    **papszBuiltins;  /**< Names of the built-in Functions and Commands, sorted. */
+    uint32_t        cBuiltins;      /**< Number of built-in names. */
+    uint32_t       *pauEntries;     /**< Symbol Ids sorted by name. */
+    uint32_t        cEntries;       /**< Number of entries. */
+    uint32_t       *pauDelta;       /**< Symbol Ids interned since the last merge, sorted by name. */
+    uint32_t        cDelta;         /**< Number of delta entries. */
+    uint32_t        cIndexed;       /**< Symbol Ids below this are in the entries or the delta. */
+} NAMEINDEX;
+
+/** Global scope, holds the predefined Variables and everything defined outside a nested scope. */
+VARSCOPE g_GlobalScope;
+
+/** Scope the calling thread assigns Variables and defines Functions in, lookups fall back to the global scope. */
+static R_THREAD_LOCAL PVARSCOPE g_pScope = &g_GlobalScope;
+
+/** Global table of interned names, shared by all scopes. */
+SYMTABLE g_SymTable;
+
+/** Reverse lookup index of the Variables of the global scope and the loaded image. */
+static SYMINDEX g_SymIndex;
+
+/** Completion index of the names of Functions, Commands and Variables. */
+static NAMEINDEX g_NameIndex;
+
+/** Execution profile of outermost Variable resolutions. */
+static PROFILE g_VarProfile;
+
+/** Set asynchronously (e.g. from a signal handler or another thread) to cancel the evaluation in progress. */
+volatile sig_atomic_t g_fCancelEvaluation = 0;
+
+/** Version of the Variables published to readers, advanced by each batch of assignments. */
+static uint64_t g_uVarVersion = 1;
+
+/** Variables assigned by the batch of assignments in progress, see EvaluatorWriteEnd(). */
+static PVARIABLE *g_papVarsAssigned = NULL;
+
+/** Number of entries used in @a g_papVarsAssigned. */
+static uint32_t g_cVarsAssigned = 0;
+
+/** Number of entries allocated in @a g_papVarsAssigned. */
+static uint32_t g_cVarsAssignedAlloc = 0;
+
+/** Nesting depth of the calling thread's batches of assignments, see EvaluatorWriteBegin(). */
+static R_THREAD_LOCAL uint32_t g_cWriteNesting = 0;
+
+/** Nesting depth of the calling thread's read-side sections, see EvaluatorReadBegin(). */
+static R_THREAD_LOCAL uint32_t g_cReadNesting = 0;
+
+/** Version of the Variables the calling thread's outermost read-side section sees. */
+static R_THREAD_LOCAL uint64_t g_uReadVersion = 0;
+
+/** Pool evaluating arguments of reduction Functions in parallel, created when first needed. */
+static PTASKPOOL g_pArgPool = NULL;
+
+/** Evaluators of the workers of @a g_pArgPool. */
+static PEVALUATOR g_paArgEvals = NULL;
+
+/** Whether creating @a g_pArgPool was tried, it's not retried if there's a single CPU. */
+static bool g_fArgPoolTried = false;
 
 /** Alphabetically sorted array of Functions */
 PFUNCTION g_paSortedFunctions = NULL;
@@ -136,39 +287,37 @@ static inline bool CanCastToken(PCTOKEN pToken, long double MinValue, long doubl
     return (DefinitelyLessThan(pToken->u.Number.dValue, MaxValue) && DefinitelyGreaterThan(pToken->u.Number.dValue, MinValue));
 }
 
-static inline void TokenInit(PTOKEN pToken)
-{
-    pToken->Type = enmTokenEmpty;
-    pToken->Position = 0;
-}
-
-static PTOKEN TokenDup(PCTOKEN pSrcToken)
+static inline bool CanCastTokens(PCTOKEN paTokens, uint32_t cTokens, long double MinValue, long double MaxValue)
 {
-    PTOKEN pDstToken = MemAlloc(sizeof(TOKEN));
-    if (pDstToken)
+    for (uint32_t i = 0; i < cTokens; i++)
     {
-        pDstToken->Type            = pSrcToken->Type;
-        pDstToken->Position        = pSrcToken->Position;
-        pDstToken->cFunctionParams = pSrcToken->cFunctionParams;
-        StrCopy(pDstToken->szVariable, sizeof(pDstToken->szVariable), pSrcToken->szVariable);
-        pDstToken->u               = pSrcToken->u; /* yeah implicit memcpy */
+        /* Range items are always integers. */
+        if (   !TokenIsRange(&paTokens[i])
+            && !CanCastToken(&paTokens[i], MinValue, MaxValue))
+            return false;
     }
-    return pDstToken;
+    return true;
 }
 
-static inline bool TokenIsOperator(PCTOKEN pToken)
+static inline bool TokensHaveRange(PCTOKEN paTokens, uint32_t cTokens)
 {
-    return (pToken && pToken->Type == enmTokenOperator);
+    for (uint32_t i = 0; i < cTokens; i++)
+    {
+        if (TokenIsRange(&paTokens[i]))
+            return true;
+    }
+    return false;
 }
 
-static inline bool TokenIsFunction(PCTOKEN pToken)
+static inline void TokenInit(PTOKEN pToken)
 {
-    return (pToken && pToken->Type == enmTokenFunction);
+    pToken->Type = enmTokenEmpty;
+    pToken->Position = 0;
 }
 
-static inline bool TokenIsVariable(PCTOKEN pToken)
+static inline bool TokenIsOperator(PCTOKEN pToken)
 {
-    return (pToken && pToken->Type == enmTokenVariable);
+    return (pToken && pToken->Type == enmTokenOperator);
 }
 
 static inline bool OperatorIsOpenParenthesis(PCOPERATOR pOperator)
@@ -236,177 +385,641 @@ static inline bool TokenIsParenthesis(PCTOKEN pToken)
     return (TokenIsOpenParenthesis(pToken) || TokenIsCloseParenthesis(pToken));
 }
 
-static void EvaluatorInvertTokenArray(PTOKEN apTokens[], uint32_t cTokens)
+/**
+ * Returns the name of a Variable Token.
+ *
+ * @return  The name of the variable.
+ * @param   pToken      The Variable Token.
+ */
+static inline const char *TokenVariableName(PCTOKEN pToken)
+{
+    return SymTableName(&g_SymTable, pToken->uSymbol);
+}
+
+
+/**
+ * Returns the assignment of a Variable the calling thread sees: the one of its
+ * batch of assignments while writing, otherwise the latest one published before
+ * its outermost read-side section began, or simply the latest one published.
+ *
+ * @return  The assignment, NULL if the Variable isn't visible to the calling thread.
+ * @param   pVariable   The Variable.
+ */
+PVARDEF VariableDef(PCVARIABLE pVariable)
 {
-    if (cTokens < 2)
-        return;
+    uint64_t uVersion = UINT64_MAX;
+    if (!g_cWriteNesting)
+        uVersion = g_cReadNesting ? g_uReadVersion : RCU_LOAD(&g_uVarVersion);
+    PVARDEF pDef = RCU_LOAD(&pVariable->pDef);
+    while (   pDef
+           && pDef->uVersion > uVersion)
+        pDef = pDef->pPrev;
+    return pDef;
+}
+
+
+/**
+ * Gets the first entry a Symbol Id probes in a hashed Variable table.
+ *
+ * @return  Index of the entry.
+ * @param   pTable      The Variable table.
+ * @param   uSymbol     The Symbol Id.
+ */
+static inline uint32_t VarTableHash(PCVARTABLE pTable, uint32_t uSymbol)
+{
+    uSymbol ^= uSymbol >> 16;
+    uSymbol *= UINT32_C(0x45d9f3b);
+    uSymbol ^= uSymbol >> 16;
+    return uSymbol & (pTable->cVars - 1);
+}
 
-    uint32_t i = 0;
-    PTOKEN pUnstableToken = NULL;
-    for (i = 0; i < cTokens / 2; i++)
+
+/**
+ * Looks up a Variable in a Variable table.
+ *
+ * @return  Pointer to the Variable or NULL if @a uSymbol is not in @a pTable.
+ * @param   pTable      The Variable table.
+ * @param   uSymbol     Symbol Id of the name of the variable to find.
+ */
+static inline PVARIABLE VarTableLookup(PCVARTABLE pTable, uint32_t uSymbol)
+{
+    if (!pTable->fHashed)
+        return uSymbol < pTable->cVars ? RCU_LOAD(&pTable->apVars[uSymbol]) : NULL;
+
+    /* Entries are only ever filled in, an empty one ends the probe sequence. */
+    for (uint32_t i = VarTableHash(pTable, uSymbol);; i = (i + 1) & (pTable->cVars - 1))
     {
-        --cTokens;
-        pUnstableToken = apTokens[i];
-        apTokens[i] = apTokens[cTokens];
-        apTokens[cTokens] = pUnstableToken;
+        PVARIABLE pVariable = RCU_LOAD(&pTable->apVars[i]);
+        if (   !pVariable
+            || pVariable->uSymbol == uSymbol)
+            return pVariable;
     }
 }
 
 
 /**
- * Searches for a variable and returns a Variable Token if found.
+ * Puts a Variable into a Variable table that has room for it.
  *
- * @return  Pointer to an allocated Variable Token or NULL if @a pszVariable could
- *          not be found.
- * @param   pszVariable     Name of the variable to find.
+ * @param   pTable      The Variable table.
+ * @param   pVariable   The Variable, its name must not already be in @a pTable.
  */
-static PVARIABLE EvaluatorFindVariable(const char *pszVariable, PLIST pVarList)
+static void VarTableInsert(PVARTABLE pTable, PVARIABLE pVariable)
 {
-    for (uint32_t i = 0; i < ListSize(pVarList); i++)
+    uint32_t i = pVariable->uSymbol;
+    if (pTable->fHashed)
     {
-        PVARIABLE pVariable = ListItemAt(pVarList, i);
-        AssertReturn(pVariable, NULL);
-        DEBUGPRINTF(("EvaluatorFindVariable szVar=%s pszVar=%s\n", pVariable->szVariable, pszVariable));
-        if (!StrCmp(pVariable->szVariable, pszVariable))
-            return pVariable;
+        Assert(pTable->cHashed < pTable->cVars);
+        i = VarTableHash(pTable, i);
+        while (pTable->apVars[i])
+            i = (i + 1) & (pTable->cVars - 1);
+        ++pTable->cHashed;
     }
-    return NULL;
+    RCU_STORE(&pTable->apVars[i], pVariable);
 }
 
 
 /**
- * Destroys a variable.
+ * Searches for a Variable in a scope.
  *
- * @param   pVariable   The Variable to destroy.
+ * @return  Pointer to the Variable or NULL if @a uSymbol is not a Variable in @a pScope
+ *          visible to the calling thread, see VariableDef().
+ * @param   pScope          The scope.
+ * @param   uSymbol         Symbol Id of the name of the variable to find.
  */
-static void EvaluatorDestroyVariable(PVARIABLE pVariable)
+PVARIABLE ScopeFindVariable(PCVARSCOPE pScope, uint32_t uSymbol)
 {
-    if (pVariable)
+    PCVARTABLE pTable = RCU_LOAD(&pScope->pVarTable);
+    if (!pTable)
+        return NULL;
+    PVARIABLE pVariable = VarTableLookup(pTable, uSymbol);
+    return pVariable && VariableDef(pVariable) ? pVariable : NULL;
+}
+
+
+/**
+ * Searches for a variable in the current scope, then the global scope and then
+ * the loaded image.
+ *
+ * @return  Pointer to the Variable or NULL if @a uSymbol is not a Variable.
+ * @param   uSymbol         Symbol Id of the name of the variable to find.
+ */
+PVARIABLE EvaluatorFindVariable(uint32_t uSymbol)
+{
+    PVARIABLE pVariable = ScopeFindVariable(g_pScope, uSymbol);
+    if (   !pVariable
+        && g_pScope != &g_GlobalScope)
+        pVariable = ScopeFindVariable(&g_GlobalScope, uSymbol);
+    if (   !pVariable
+        && g_Image.pHdr)
+        pVariable = ImageFindVariable(uSymbol);
+    return pVariable;
+}
+
+
+/**
+ * Adds a variable to a scope.
+ *
+ * @return  Status code.
+ * @param   pScope      The scope.
+ * @param   pVariable   The Variable to add, its name must not already be a Variable
+ *                      in @a pScope.
+ */
+int ScopeAddVariable(PVARSCOPE pScope, PVARIABLE pVariable)
+{
+    Assert(g_cWriteNesting);
+    Assert(!ScopeFindVariable(pScope, pVariable->uSymbol));
+
+    /*
+     * Hashed tables are kept at most half full so probe sequences stay short.
+     */
+    bool const fHashed = pScope != &g_GlobalScope;
+    PVARTABLE pTable = pScope->pVarTable;
+    uint32_t const cOldVars = pTable ? pTable->cVars : 0;
+    if (  fHashed
+        ? (pTable ? pTable->cHashed : 0) + 1 > cOldVars / 2
+        : pVariable->uSymbol >= cOldVars)
     {
-        if (pVariable->pvRPNQueue)
+        uint32_t cVars = R_MAX(cOldVars * 2, fHashed ? 16 : 64);
+        while (   !fHashed
+               && cVars <= pVariable->uSymbol)
+            cVars *= 2;
+        PVARTABLE pNewTable = MemAllocZTag(sizeof(VARTABLE) + (cVars - 1) * sizeof(PVARIABLE), enmMemTagVariable);
+        if (!pNewTable)
+            return RERR_NO_MEMORY;
+        pNewTable->cVars   = cVars;
+        pNewTable->fHashed = fHashed;
+        if (fHashed)
         {
-            PTOKEN pToken = NULL;
-            while ((pToken = (PTOKEN)QueueRemove(pVariable->pvRPNQueue)) != NULL)
-                MemFree(pToken);
+            for (uint32_t i = 0; i < cOldVars; i++)
+                if (pTable->apVars[i])
+                    VarTableInsert(pNewTable, pTable->apVars[i]);
         }
-        MemFree(pVariable->pvRPNQueue);
+        else if (cOldVars)
+            MemCpy(pNewTable->apVars, pTable->apVars, cOldVars * sizeof(PVARIABLE));
+        RCU_STORE(&pScope->pVarTable, pNewTable);
+        if (pTable)
+            RcuRetire(pTable, MemFree);
+        pTable = pNewTable;
+    }
+
+    int rc = ListAdd(&pScope->VarList, pVariable);
+    if (RC_SUCCESS(rc))
+    {
+        VarTableInsert(pTable, pVariable);
+        if (pScope == &g_GlobalScope)
+            SymIndexNoteVariable(pVariable->uSymbol);
+    }
+    return rc;
+}
 
-        if (pVariable->pszExpr)
-            StrFree(pVariable->pszExpr);
 
-        MemFree(pVariable);
+/**
+ * Destroys an RPN Queue along with its Tokens.
+ *
+ * @param   pQueue      The Queue to destroy, can be NULL.
+ */
+void EvaluatorDestroyQueue(PQUEUE pQueue)
+{
+    if (pQueue)
+    {
+        PTOKEN pToken = NULL;
+        while ((pToken = (PTOKEN)QueueRemove(pQueue)) != NULL)
+        {
+            if (pToken->Type == enmTokenCommand)
+                MemFree(pToken->u.Command.pParamToken);
+            MemFree(pToken);
+        }
+        MemFree(pQueue);
     }
 }
 
 
 /**
- * Cleans up the variable queue of unassigned Variables.
+ * Destroys an assignment of a Variable, not the ones it replaced.
+ *
+ * @param   pDef        The assignment to destroy.
  */
-static void EvaluatorCleanVariables(void)
+static void VarDefDestroy(PVARDEF pDef)
 {
-    PLIST pVarList = &g_VarList;
-    uint32_t i = 0;
-    for (;;)
+    EvaluatorDestroyQueue(pDef->pvRPNQueue);
+    if (pDef->pszExpr)
+        StrFree(pDef->pszExpr);
+    MemFree(pDef);
+}
+
+
+/**
+ * Destroys the assignments an assignment replaced, once no reader can see them.
+ *
+ * @param   pvDef       The assignment, see RcuRetire().
+ */
+static void VarDefTrim(void *pvDef)
+{
+    PVARDEF pDef = pvDef;
+    PVARDEF pOldDef = pDef->pPrev;
+    pDef->pPrev = NULL;
+    while (pOldDef)
     {
-        PVARIABLE pVariable = ListItemAt(pVarList, i);
-        if (!pVariable)
-            break;
+        PVARDEF pPrev = pOldDef->pPrev;
+        VarDefDestroy(pOldDef);
+        pOldDef = pPrev;
+    }
+}
 
-        ++i;
-        if (!pVariable->pvRPNQueue)
+
+/**
+ * Destroys a variable.
+ *
+ * @param   pVariable   The Variable to destroy.
+ */
+void EvaluatorDestroyVariable(PVARIABLE pVariable)
+{
+    if (pVariable)
+    {
+        if (pVariable->pDef)
         {
-            DEBUGPRINTF(("Destroying invalid variable '%s'\n", pVariable->szVariable));
-            ListRemove(pVarList, pVariable);
-            EvaluatorDestroyVariable(pVariable);
-            if (i > 0)
-                --i;
+            VarDefTrim(pVariable->pDef);
+            VarDefDestroy(pVariable->pDef);
         }
+        MemFree(pVariable);
     }
 }
 
 
-#ifdef _DEBUG
-static void EvaluatorPrintVarList(PLIST pList)
+/**
+ * Destroys a Variable once no reader can see it.
+ *
+ * @param   pvVariable  The Variable, see RcuRetire().
+ */
+static void EvaluatorRetiredVariable(void *pvVariable)
 {
-    for (uint32_t i = 0; i < ListSize(pList); i++)
+    EvaluatorDestroyVariable(pvVariable);
+}
+
+
+/**
+ * Begins a batch of assignments, or joins the one the calling thread has in progress.
+ * Parsing and everything else interning names or changing Variables is done in one,
+ * batches are serialized with each other but never keep readers waiting.
+ */
+void EvaluatorWriteBegin(void)
+{
+    if (!g_cWriteNesting++)
+        RcuWriteLock();
+}
+
+
+/**
+ * Ends a batch of assignments, publishing all of them to readers at once when the
+ * outermost one ends. The assignments they replaced are freed once no reader can
+ * see them anymore.
+ */
+void EvaluatorWriteEnd(void)
+{
+    Assert(g_cWriteNesting);
+    if (--g_cWriteNesting)
+        return;
+
+    if (g_cVarsAssigned)
     {
-        PVARIABLE pVariable = ListItemAt(pList, i);
-        if (!pVariable)
-            DEBUGPRINTF(("Huh i=%u!\n", i));
-        else
-            DEBUGPRINTF(("Var[%u]=%s\n", i, pVariable->szVariable));
+        RCU_STORE(&g_uVarVersion, g_uVarVersion + 1);
+        for (uint32_t i = 0; i < g_cVarsAssigned; i++)
+        {
+            /* Should retiring fail the replaced assignments stay, they're freed with the Variable. */
+            PVARDEF pDef = g_papVarsAssigned[i]->pDef;
+            if (pDef->pPrev)
+                RcuRetire(pDef, VarDefTrim);
+        }
+        g_cVarsAssigned = 0;
     }
+    RcuWriteUnlock();
+    RcuReclaim();
 }
-#endif
 
 
 /**
- * Parses a number and returns a Number Token.
+ * Begins a read-side section, the Variables are seen as they were published when
+ * the calling thread's outermost section began until it ends. Never waits for
+ * writers.
  *
- * @return  Pointer to an allocated Number Token or NULL if @a pszExpr is not a
- *          number.
- * @param   pszExpr     The whitespace skipped expression to parse.
- * @param   ppszEnd     Where to store till what point in pszExpr was scanned.
- * @param   prc         Where to store the status code while identifying the
- *                      number.
+ * @param   pEval       The Evaluator object.
  */
-static PTOKEN EvaluatorParseNumber(const char *pszExpr, const char **ppszEnd)
+void EvaluatorReadBegin(PEVALUATOR pEval)
 {
-    DEBUGPRINTF(("Parse Number:\n"));
+    RcuReadLock(&pEval->RcuReader);
+    if (!g_cReadNesting++)
+        g_uReadVersion = RCU_LOAD(&g_uVarVersion);
+}
 
-    /*
-     * UINT64_MAX is the maximum supported type which is:
-     *   In binary     :  1111111111111111111111111111111111111111111111111111111111111111 (64 digits)
-     *   In octal      :  1777777777777777777777                                           (22 digits)
-     *   In decimal    :  18446744073709551615                                             (20 digits)
-     *   In hexadecimal:  ffffffffffffffff                                                 (16 digits)
-     *
-     * We allow inputing numbers in binary, so the maximum digits we need to allow is 64.
-     */
-    char szNum[64 + 1];
-    int  iRadix = 0;
-    int  iNum   = 0;
-    bool fDecPt = false;
 
-    const char *pszStart = pszExpr;
-    while (*pszExpr)
+/**
+ * Ends a read-side section.
+ *
+ * @param   pEval       The Evaluator object.
+ */
+void EvaluatorReadEnd(PEVALUATOR pEval)
+{
+    Assert(g_cReadNesting);
+    --g_cReadNesting;
+    RcuReadUnlock(&pEval->RcuReader);
+}
+
+
+/**
+ * Assigns an expression to a Variable with the batch of assignments in progress,
+ * it's published to readers when the batch ends.
+ *
+ * @return  Status code.
+ * @param   pVariable   The Variable.
+ * @param   pszExpr     The expression, ownership is taken on success.
+ * @param   pQueue      The RPN Queue of @a pszExpr, NULL to parse @a pszExpr when the
+ *                      Variable is first used. Ownership is taken on success.
+ */
+static int VariableAssign(PVARIABLE pVariable, char *pszExpr, PQUEUE pQueue)
+{
+    Assert(g_cWriteNesting);
+    uint64_t const uVersion = g_uVarVersion + 1;
+    PVARDEF pOldDef = pVariable->pDef;
+    bool const fNewInBatch = !pOldDef || pOldDef->uVersion != uVersion;
+    if (   fNewInBatch
+        && g_cVarsAssigned == g_cVarsAssignedAlloc)
     {
-        bool fStopNumParse = false;
+        uint32_t const cAlloc = R_MAX(g_cVarsAssignedAlloc * 2, 64);
+        PVARIABLE *papVars = MemReallocTag(g_papVarsAssigned, cAlloc * sizeof(PVARIABLE), enmMemTagVariable);
+        if (!papVars)
+            return RERR_NO_MEMORY;
+        g_papVarsAssigned   = papVars;
+        g_cVarsAssignedAlloc = cAlloc;
+    }
 
-        /*
-         * Skip whitespace.
-         */
-        if (isspace(*pszExpr))
-        {
-            pszExpr++;
-            continue;
-        }
+    PVARDEF pDef = MemAllocTag(sizeof(VARDEF), enmMemTagVariable);
+    if (!pDef)
+        return RERR_NO_MEMORY;
+    pDef->pszExpr    = pszExpr;
+    pDef->pvRPNQueue = pQueue;
+    pDef->uVersion   = uVersion;
+    pDef->pPrev      = pOldDef;
+    if (fNewInBatch)
+    {
+        g_papVarsAssigned[g_cVarsAssigned++] = pVariable;
+        RCU_STORE(&pVariable->pDef, pDef);
+    }
+    else
+    {
+        /* Reassigned by the same batch, no reader has seen the previous assignment. */
+        pDef->pPrev = pOldDef->pPrev;
+        RCU_STORE(&pVariable->pDef, pDef);
+        VarDefDestroy(pOldDef);
+    }
+    return RINF_SUCCESS;
+}
 
-        /*
-         * Check for overflow of known radices.
-         */
-        if (   (iRadix == 16 && iNum == 16)
-            || (iRadix == 8  && iNum == 22)
-            || (iRadix == 2  && iNum == 64)
-            || ((iRadix == 0 || iRadix == 10) && iNum == 20))
+
+/**
+ * Adds a new Variable to a scope along with its first assignment, readers see both
+ * when the batch of assignments in progress is published.
+ *
+ * @return  Status code.
+ * @param   pScope      The scope.
+ * @param   pVariable   The Variable, its name must not already be a Variable in
+ *                      @a pScope. Ownership is taken on success.
+ * @param   pszExpr     The expression, ownership is taken on success.
+ * @param   pQueue      The RPN Queue of @a pszExpr, NULL to parse @a pszExpr when the
+ *                      Variable is first used. Ownership is taken on success.
+ */
+static int ScopeAssignVariable(PVARSCOPE pScope, PVARIABLE pVariable, char *pszExpr, PQUEUE pQueue)
+{
+    Assert(!pVariable->pDef);
+    int rc = VariableAssign(pVariable, pszExpr, pQueue);
+    if (RC_SUCCESS(rc))
+    {
+        rc = ScopeAddVariable(pScope, pVariable);
+        if (RC_FAILURE(rc))
         {
-            pszExpr = pszStart;
-            return NULL;
+            /* Unpublished and part of no scope, the batch forgets it. */
+            --g_cVarsAssigned;
+            MemFree(pVariable->pDef);
+            pVariable->pDef = NULL;
         }
+    }
+    return rc;
+}
 
-        Assert(iNum < sizeof(szNum));
 
-        /*
-         * Parse explicit prefixes.
-         */
-        if (iNum == 0)
-        {
-            switch (*pszExpr)
-            {
-                /* Binary. */
-                case 'n':
-                case 'N':
-                {
+/**
+ * Returns the length of an identifier, i.e. a name that is a stream of one or
+ * more contiguous "_[a-z][0-9]" not beginning with a digit.
+ *
+ * @return  Length of the identifier, 0 if @a pszExpr doesn't begin with one.
+ * @param   pszExpr     The expression to scan.
+ */
+static size_t EvaluatorIdentifierLength(const char *pszExpr)
+{
+    if (isdigit(*pszExpr))
+        return 0;
+
+    size_t cch = 0;
+    while (   pszExpr[cch] == '_'
+           || isalnum(pszExpr[cch]))
+        cch++;
+    return cch;
+}
+
+
+/**
+ * Finds a user-defined Function in a scope.
+ *
+ * @return  Pointer to the Function or NULL if not found.
+ * @param   pScope      The scope.
+ * @param   uSymbol     Symbol Id of the name of the function.
+ */
+PFUNCTION ScopeFindUserFunction(PCVARSCOPE pScope, uint32_t uSymbol)
+{
+    if (uSymbol == NIL_SYMBOL)
+        return NULL;
+
+    /*
+     * Names are interned, so the name pointers are unique per symbol.
+     */
+    const char *pszName = SymTableName(&g_SymTable, uSymbol);
+    for (PLISTITEM pNode = pScope->UserFuncList.pHead; pNode; pNode = pNode->pNext)
+    {
+        PFUNCTION pFunction = pNode->pvData;
+        AssertReturn(pFunction, NULL);
+        if (pFunction->pszFunction == pszName)
+            return pFunction;
+    }
+    return NULL;
+}
+
+
+/**
+ * Finds a user-defined Function in the current scope, then the global scope.
+ *
+ * @return  Pointer to the Function or NULL if not found.
+ * @param   uSymbol     Symbol Id of the name of the function.
+ */
+static PFUNCTION EvaluatorFindUserFunction(uint32_t uSymbol)
+{
+    PFUNCTION pFunction = ScopeFindUserFunction(g_pScope, uSymbol);
+    if (   !pFunction
+        && g_pScope != &g_GlobalScope)
+        pFunction = ScopeFindUserFunction(&g_GlobalScope, uSymbol);
+    return pFunction;
+}
+
+
+/**
+ * Destroys a compiled Program.
+ *
+ * @param   pProgram    The Program to destroy, can be NULL.
+ */
+void EvaluatorDestroyProgram(PPROGRAM pProgram)
+{
+    if (pProgram)
+    {
+        if (pProgram->paTokens)
+            MemFree(pProgram->paTokens);
+        if (pProgram->pszExpr)
+            StrFree(pProgram->pszExpr);
+        MemFree(pProgram);
+    }
+}
+
+
+/**
+ * Destroys a user-defined Function.
+ *
+ * @param   pFunction   The Function to destroy.
+ */
+static void EvaluatorDestroyUserFunction(PFUNCTION pFunction)
+{
+    if (pFunction)
+    {
+        EvaluatorDestroyProgram(pFunction->pProgram);
+        MemFree(pFunction);
+    }
+}
+
+
+/**
+ * Initializes an empty scope.
+ *
+ * @param   pScope      The scope.
+ */
+static void ScopeInit(PVARSCOPE pScope)
+{
+    pScope->u32Magic        = RMAG_VARSCOPE;
+    pScope->pVarTable       = NULL;
+    ListInit(&pScope->VarList);
+    ListInit(&pScope->UserFuncList);
+}
+
+
+/**
+ * Destroys the Variables and user-defined Functions of a scope, leaving it empty.
+ *
+ * @param   pScope      The scope.
+ */
+static void ScopeClear(PVARSCOPE pScope)
+{
+    /* Readers may still be evaluating them, the Variables are retired rather than destroyed. */
+    PVARTABLE pTable = pScope->pVarTable;
+    RCU_STORE(&pScope->pVarTable, (PVARTABLE)NULL);
+    if (pTable)
+        RcuRetire(pTable, MemFree);
+    PVARIABLE pVariable = NULL;
+    while ((pVariable = ListRemoveItemAt(&pScope->VarList, 0)) != NULL)
+        RcuRetire(pVariable, EvaluatorRetiredVariable);
+
+    PFUNCTION pFunction = NULL;
+    while ((pFunction = ListRemoveItemAt(&pScope->UserFuncList, 0)) != NULL)
+        EvaluatorDestroyUserFunction(pFunction);
+}
+
+
+#ifdef _DEBUG
+static void EvaluatorPrintVarList(PLIST pList)
+{
+    for (uint32_t i = 0; i < ListSize(pList); i++)
+    {
+        PVARIABLE pVariable = ListItemAt(pList, i);
+        if (!pVariable)
+            DEBUGPRINTF(("Huh i=%u!\n", i));
+        else
+            DEBUGPRINTF(("Var[%u]=%s\n", i, VariableName(pVariable)));
+    }
+}
+#endif
+
+
+/**
+ * Parses a number and returns a Number Token.
+ *
+ * @return  Pointer to an allocated Number Token or NULL if @a pszExpr is not a
+ *          number.
+ * @param   pszExpr     The whitespace skipped expression to parse.
+ * @param   ppszEnd     Where to store till what point in pszExpr was scanned.
+ * @param   prc         Where to store the status code while identifying the
+ *                      number.
+ */
+static PTOKEN EvaluatorParseNumber(const char *pszExpr, const char **ppszEnd)
+{
+    DEBUGPRINTF(("Parse Number:\n"));
+
+    /*
+     * UINT64_MAX is the maximum supported type which is:
+     *   In binary     :  1111111111111111111111111111111111111111111111111111111111111111 (64 digits)
+     *   In octal      :  1777777777777777777777                                           (22 digits)
+     *   In decimal    :  18446744073709551615                                             (20 digits)
+     *   In hexadecimal:  ffffffffffffffff                                                 (16 digits)
+     *
+     * We allow inputing numbers in binary, so the maximum digits we need to allow is 64.
+     */
+    char szNum[64 + 1];
+    int  iRadix = 0;
+    int  iNum   = 0;
+    bool fDecPt = false;
+
+    const char *pszStart = pszExpr;
+    while (*pszExpr)
+    {
+        bool fStopNumParse = false;
+
+        /*
+         * Skip whitespace.
+         */
+        if (isspace(*pszExpr))
+        {
+            pszExpr++;
+            continue;
+        }
+
+        /*
+         * Check for overflow of known radices.
+         */
+        if (   (iRadix == 16 && iNum == 16)
+            || (iRadix == 8  && iNum == 22)
+            || (iRadix == 2  && iNum == 64)
+            || ((iRadix == 0 || iRadix == 10) && iNum == 20))
+        {
+            pszExpr = pszStart;
+            return NULL;
+        }
+
+        Assert(iNum < sizeof(szNum));
+
+        /*
+         * Parse explicit prefixes.
+         */
+        if (iNum == 0)
+        {
+            switch (*pszExpr)
+            {
+                /* Binary. */
+                case 'n':
+                case 'N':
+                {
                     if (iRadix == 0)
                     {
                         iRadix = 2;
@@ -618,7 +1231,7 @@ static PTOKEN EvaluatorParseNumber(const char *pszExpr, const char **ppszEnd)
     /*
      * Create a new Number Token and store the numeric values.
      */
-    PTOKEN pToken = MemAlloc(sizeof(TOKEN));
+    PTOKEN pToken = MemAllocTag(sizeof(TOKEN), enmMemTagToken);
     if (!pToken)
         return NULL;
     pToken->Type = enmTokenNumber;
@@ -676,7 +1289,7 @@ static PTOKEN EvaluatorParseOperator(const char *pszExpr, const char **ppszEnd,
                     continue;
             }
 
-            PTOKEN pToken = MemAlloc(sizeof(TOKEN));
+            PTOKEN pToken = MemAllocTag(sizeof(TOKEN), enmMemTagToken);
             if (!pToken)
                 return NULL;
             pToken->Type = enmTokenOperator;
@@ -717,7 +1330,7 @@ static PTOKEN EvaluatorParseFunction(const char *pszExpr, const char **ppszEnd,
             if (!StrNCmp(pszExpr, g_pOperatorOpenParenthesis->pszOperator,
                             StrLen(g_pOperatorOpenParenthesis->pszOperator)))
             {
-                PTOKEN pToken = MemAlloc(sizeof(TOKEN));
+                PTOKEN pToken = MemAllocTag(sizeof(TOKEN), enmMemTagToken);
                 if (!pToken)
                     return NULL;
                 pToken->Type = enmTokenFunction;
@@ -728,6 +1341,69 @@ static PTOKEN EvaluatorParseFunction(const char *pszExpr, const char **ppszEnd,
             }
         }
     }
+
+    /*
+     * User-defined Functions, these must match the whole name.
+     */
+    size_t const cchName = EvaluatorIdentifierLength(pszExpr);
+    if (cchName)
+    {
+        PCFUNCTION pFunction = EvaluatorFindUserFunction(SymTableLookup(&g_SymTable, pszExpr, cchName));
+        if (pFunction)
+        {
+            pszExpr += cchName;
+            while (isspace(*pszExpr))
+                pszExpr++;
+
+            if (!StrNCmp(pszExpr, g_pOperatorOpenParenthesis->pszOperator,
+                            StrLen(g_pOperatorOpenParenthesis->pszOperator)))
+            {
+                PTOKEN pToken = MemAllocTag(sizeof(TOKEN), enmMemTagToken);
+                if (!pToken)
+                    return NULL;
+                pToken->Type = enmTokenFunction;
+                pToken->u.pFunction = pFunction;
+                pToken->cFunctionParams = 0;
+                *ppszEnd = pszExpr;
+                return pToken;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Parses a parameter of the user-defined Function whose body is being parsed
+ * and returns a Param Token.
+ *
+ * @return  Pointer to an allocated Param Token or NULL if @a pszExpr was not a
+ *          parameter.
+ * @param   pEval           The Evaluator object.
+ * @param   pszExpr         The whitespace skipped expression to parse.
+ * @param   ppszEnd         Where to store till what point in pszExpr was scanned.
+ */
+static PTOKEN EvaluatorParseParam(PEVALUATOR pEval, const char *pszExpr, const char **ppszEnd)
+{
+    size_t const cchName = EvaluatorIdentifierLength(pszExpr);
+    if (!cchName)
+        return NULL;
+
+    uint32_t const uSymbol = SymTableLookup(&g_SymTable, pszExpr, cchName);
+    for (uint32_t i = 0; i < pEval->cParams && uSymbol != NIL_SYMBOL; i++)
+    {
+        if (pEval->pauParams[i] == uSymbol)
+        {
+            PTOKEN pToken = MemAllocZTag(sizeof(TOKEN), enmMemTagToken);
+            if (!pToken)
+                return NULL;
+            pToken->Type = enmTokenParam;
+            pToken->uSymbol = uSymbol;
+            pToken->u.iParam = i;
+            *ppszEnd = pszExpr + cchName;
+            return pToken;
+        }
+    }
     return NULL;
 }
 
@@ -781,7 +1457,7 @@ static PTOKEN EvaluatorParseVariable(PEVALUATOR pEval, const char *pszExpr, cons
         return NULL;
     }
 
-    PTOKEN pToken = MemAlloc(sizeof(TOKEN));
+    PTOKEN pToken = MemAllocTag(sizeof(TOKEN), enmMemTagToken);
     if (!pToken)
     {
         *prc = RERR_NO_MEMORY;
@@ -790,11 +1466,17 @@ static PTOKEN EvaluatorParseVariable(PEVALUATOR pEval, const char *pszExpr, cons
     pToken->Type = enmTokenVariable;
 
     /*
-     * Associate the Token with a predefined Variable, if not just record the name.
-     * When we assign the Variable, we will create the actual Variable entry.
+     * Intern the name, associate the Token with a predefined Variable, if not just record
+     * the name. When we assign the Variable, we will create the actual Variable entry.
      */
-    pToken->u.pVariable = EvaluatorFindVariable(szBuf, &g_VarList);
-    StrCopy(pToken->szVariable, sizeof(pToken->szVariable), szBuf);
+    int rc = SymTableIntern(&g_SymTable, szBuf, iVar, &pToken->uSymbol);
+    if (RC_FAILURE(rc))
+    {
+        MemFree(pToken);
+        *prc = rc;
+        return NULL;
+    }
+    pToken->u.pVariable = EvaluatorFindVariable(pToken->uSymbol);
 
     /*
      * Determine error code. For variables too long we return a successful (name truncated) Variable Token
@@ -857,11 +1539,11 @@ static PTOKEN EvaluatorParseCommand(PEVALUATOR pEval, const char *pszExpr, const
                 while (isspace(*pszExpr))
                     pszExpr++;
 
-                PTOKEN pToken = MemAllocZ(sizeof(TOKEN));
+                PTOKEN pToken = MemAllocZTag(sizeof(TOKEN), enmMemTagToken);
                 if (!pToken)
                     return NULL;
                 pToken->Type = enmTokenCommand;
-                pToken->u.pCommand = &g_aCommands[i];
+                pToken->u.Command.pCommand = &g_aCommands[i];
                 *ppszEnd = pszExpr;
                 return pToken;
             }
@@ -906,11 +1588,23 @@ static PTOKEN EvaluatorParseToken(PEVALUATOR pEval, const char *pszExpr, const c
             break;
 
         /*
-         * Parse command.
+         * Parse parameter and don't allow commands inside user-defined Function bodies.
          */
-        pToken = EvaluatorParseCommand(pEval, pszExpr, ppszEnd, pPreviousToken, prc);
-        if (pToken)
-            break;
+        if (pEval->pauParams)
+        {
+            pToken = EvaluatorParseParam(pEval, pszExpr, ppszEnd);
+            if (pToken)
+                break;
+        }
+        else
+        {
+            /*
+             * Parse command.
+             */
+            pToken = EvaluatorParseCommand(pEval, pszExpr, ppszEnd, pPreviousToken, prc);
+            if (pToken)
+                break;
+        }
 
         /*
          * Parse number.
@@ -994,13 +1688,35 @@ static int AscendingFunctionSortCompare(const void *pvFunction1, const void *pvF
  *
  * @param   pEval   The Evaluator object, cannot be NULL.
  */
-static void EvaluatorInitInternal(PEVALUATOR pEval)
+void EvaluatorInitInternal(PEVALUATOR pEval)
 {
     pEval->pvRPNQueue = NULL;
     pEval->u32Magic = RMAG_EVALUATOR;
-    ListInit(&pEval->VarList);
     pEval->Result.fCommandEvaluated   = false;
     pEval->Result.fVariableAssignment = false;
+    pEval->Result.pszVariable         = "";
+    pEval->Result.pszCommand          = NULL;
+    pEval->Result.pszCommandResult    = NULL;
+    pEval->Result.fFunctionDefinition = false;
+    pEval->Result.pszFunction         = "";
+    pEval->pauParams  = NULL;
+    pEval->cParams    = 0;
+    pEval->cCallDepth = 0;
+    pEval->cMaxSteps     = 0;
+    pEval->cMaxMilliSecs = 0;
+    pEval->cSteps        = 0;
+    pEval->uDeadline     = 0;
+    pEval->paVarValues      = NULL;
+    pEval->pbmVarActive     = NULL;
+    pEval->pbmVarDone       = NULL;
+    pEval->cVarBitmapWords  = 0;
+    pEval->fVarBitmapsDirty = false;
+    pEval->cVarNesting      = 0;
+    pEval->pStats           = NULL;
+    pEval->fProfile         = false;
+    pEval->pTrace           = NULL;
+    pEval->fConcurrent      = false;
+    RcuReaderInit(&pEval->RcuReader);
 }
 
 
@@ -1025,13 +1741,6 @@ static void EvaluatorCleanUp(PEVALUATOR pEval, PSTACK pStack)
     }
     pEval->pvRPNQueue = NULL;
 
-    /*
-     * Only holds copies of PVARIABLE pointers, so nothing to free
-     * but empty the List's items.
-     */
-    while (ListRemoveItemAt(&pEval->VarList, 0))
-        ;
-
     if (pStack)
     {
         while ((pToken = StackPop(pStack)) != NULL)
@@ -1041,75 +1750,350 @@ static void EvaluatorCleanUp(PEVALUATOR pEval, PSTACK pStack)
 
 
 /**
- * Parses the expression into a modified reverse polish notation form. The logic
- * is mostly based on the shunting yard algorithm with modifications for extra
- * elements. This constitutes the first pass in evaluating an expression.
- * The @a pEval object is internally updated with the intermediate representation
- * which will be used in the next pass, which is evaluation.
+ * Compiles a parsed RPN Queue into a Program. The Tokens are moved out of the
+ * Queue leaving it empty.
  *
- * @return  Status code on result of the parsing pass.
- * @param   pEval   The Evaluator object.
+ * @return  Status code.
+ * @param   pQueue      The RPN Queue.
+ * @param   cParams     Number of argument slots the Program may refer to.
+ * @param   pszExpr     The source text of the definition.
+ * @param   ppProgram   Where to store the Program, caller destroys it with
+ *                      EvaluatorDestroyProgram().
  */
-int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
+int EvaluatorCompileProgram(PQUEUE pQueue, uint32_t cParams, const char *pszExpr, PPROGRAM *ppProgram)
 {
-    Assert(pEval);
-    AssertReturn(pEval->u32Magic == RMAG_EVALUATOR, RERR_BAD_MAGIC);
-
-    const char *pszEnd   = NULL;
-    PCTOKEN pPreviousToken = NULL;
-    PTOKEN pToken          = NULL;
-
-    STACK Stack;
-    StackInit(&Stack);
-
-    PQUEUE pQueue = MemAlloc(sizeof(QUEUE));
-    if (!pQueue)
+    PPROGRAM pProgram = MemAllocZTag(sizeof(PROGRAM), enmMemTagFunction);
+    if (!pProgram)
         return RERR_NO_MEMORY;
-    QueueInit(pQueue);
 
-    /*
-     * Assume this is not a variable assignment expression. If it is, the relevant
-     * parts will fill this information so the caller can handle it as an assignemnt.
-     */
-    pEval->Result.fVariableAssignment = false;
-    pEval->Result.fCommandEvaluated = false;
-    MemZero(pEval->Result.szVariable);
-    MemZero(pEval->Result.szCommandResult);
+    pProgram->cParams  = cParams;
+    pProgram->pszExpr  = StrDup(pszExpr);
+    pProgram->paTokens = MemAllocTag(QueueSize(pQueue) * sizeof(TOKEN), enmMemTagFunction);
+    int rc = (pProgram->pszExpr && pProgram->paTokens) ? RINF_SUCCESS : RERR_NO_MEMORY;
 
     /*
-     * Parse tokens onto the stack or queue.
+     * Copy the Tokens. What each Token does to the value stack is known up front, so work out
+     * the stack depth needed and reject malformed bodies here rather than on every call.
      */
-    int rc = RERR_UNDEFINED;
-    while ((pToken = EvaluatorParseToken(pEval, pszExpr, &pszEnd, pPreviousToken, &rc)) != NULL)
+    uint32_t cStack = 0;
+    PTOKEN pToken = NULL;
+    while ((pToken = QueueRemove(pQueue)) != NULL)
     {
-        if (TokenIsCloseParenthesis(pPreviousToken))
-        {
-            MemFree((void *)pPreviousToken);
-            pPreviousToken = NULL;
-        }
-
-        if (pToken->Type == enmTokenNumber)
-        {
-            DEBUGPRINTF(("Adding number (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ") to queue\n", pToken->u.Number.uValue,
-                         pToken->u.Number.dValue));
-            QueueAdd(pQueue, pToken);
-        }
-        else if (pToken->Type == enmTokenOperator)
+        if (RC_SUCCESS(rc))
         {
-            PCOPERATOR pOperator = pToken->u.pOperator;
-            if (OperatorIsOpenParenthesis(pOperator))
+            uint32_t cPop = 0;
+            switch (pToken->Type)
             {
-                /*
-                 * Open parenthesis.
-                 */
-                DEBUGPRINTF(("Parenthesis begin '%s' pushing to stack\n", pToken->u.pOperator->pszOperator));
-                StackPush(&Stack, pToken);
+                case enmTokenNumber:
+                case enmTokenParam:
+                case enmTokenVariable:  break;
+                case enmTokenOperator:  cPop = pToken->u.pOperator->cParams; break;
+                case enmTokenFunction:  cPop = pToken->cFunctionParams; break;
+                default:                rc = RERR_EXPRESSION_INVALID; break;
             }
-            else if (OperatorIsCloseParenthesis(pOperator))
+
+            if (   pToken->Type == enmTokenOperator
+                || pToken->Type == enmTokenFunction)
             {
-                /*
-                 * Close paranthesis.
-                 */
+                if (!cPop || cPop > cStack)
+                    rc = RERR_TOO_FEW_PARAMETERS;
+                else
+                    cStack -= cPop;
+            }
+
+            ++cStack;
+            pProgram->cMaxStack = R_MAX(pProgram->cMaxStack, cStack);
+            pProgram->paTokens[pProgram->cTokens++] = *pToken;
+        }
+        MemFree(pToken);
+    }
+
+    if (   RC_SUCCESS(rc)
+        && cStack != 1)
+        rc = RERR_EXPRESSION_INVALID;
+
+    if (RC_SUCCESS(rc))
+        *ppProgram = pProgram;
+    else
+        EvaluatorDestroyProgram(pProgram);
+    return rc;
+}
+
+
+/**
+ * Checks whether the body of a user-defined Function calls the Function itself.
+ * Done on the text as the Function isn't known to the parser while its first
+ * definition is parsed.
+ *
+ * @return  true if it does, false otherwise.
+ * @param   pszBody     The body of the definition.
+ * @param   pszName     The name of the Function, not terminated.
+ * @param   cchName     Length of @a pszName.
+ */
+static bool EvaluatorIsSelfCall(const char *pszBody, const char *pszName, size_t cchName)
+{
+    const char *psz = pszBody;
+    while (*psz)
+    {
+        if (   *psz != '_'
+            && !isalnum(*psz))
+        {
+            psz++;
+            continue;
+        }
+
+        /* Numbers like 0x1f are skipped whole so their digits aren't taken for names. */
+        size_t const cchIdent = EvaluatorIdentifierLength(psz);
+        size_t cchWord = 0;
+        while (   psz[cchWord] == '_'
+               || isalnum(psz[cchWord]))
+            cchWord++;
+        bool const fName =    cchIdent == cchName
+                           && !StrNCmp(psz, pszName, cchName);
+        psz += cchWord;
+        if (fName)
+        {
+            while (isspace(*psz))
+                psz++;
+            if (*psz == '(')
+                return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Defines a user-defined Function if the expression is a Function definition,
+ * e.g. "f(x, y) = x * PAGE_SIZE + y".
+ *
+ * The body is parsed once with the parameters as argument slots and compiled
+ * into a Program, calls never reparse or copy it.
+ *
+ * @return  Status code.
+ * @param   pEval           The Evaluator object.
+ * @param   pszExpr         The expression.
+ * @param   pfDefinition    Where to store whether @a pszExpr is a Function
+ *                          definition. If it's not, nothing is done.
+ */
+static int EvaluatorDefineFunction(PEVALUATOR pEval, const char *pszExpr, bool *pfDefinition)
+{
+    *pfDefinition = false;
+
+    /*
+     * Match "name(param1 [, param2...]) =", but not "==".
+     */
+    const char *psz = pszExpr;
+    while (isspace(*psz))
+        psz++;
+    const char *pszName = psz;
+    size_t const cchName = EvaluatorIdentifierLength(pszName);
+    if (!cchName)
+        return RINF_SUCCESS;
+
+    psz += cchName;
+    while (isspace(*psz))
+        psz++;
+    if (*psz != '(')
+        return RINF_SUCCESS;
+    psz++;
+
+    const char *apszParams[MAX_USER_FUNCTION_PARAMETERS + 1];
+    size_t      acchParams[MAX_USER_FUNCTION_PARAMETERS + 1];
+    uint32_t    cParams = 0;
+    for (;;)
+    {
+        while (isspace(*psz))
+            psz++;
+        size_t const cchParam = EvaluatorIdentifierLength(psz);
+        if (!cchParam)
+        {
+            /* "name() = ..." is a definition, just not a valid one. */
+            if (cParams || *psz != ')')
+                return RINF_SUCCESS;
+            break;
+        }
+        if (cParams < R_ARRAY_ELEMENTS(apszParams))
+        {
+            apszParams[cParams] = psz;
+            acchParams[cParams] = cchParam;
+        }
+        ++cParams;
+
+        psz += cchParam;
+        while (isspace(*psz))
+            psz++;
+        if (*psz == ')')
+            break;
+        if (*psz != ',')
+            return RINF_SUCCESS;
+        psz++;
+    }
+
+    psz++;
+    while (isspace(*psz))
+        psz++;
+    if (   psz[0] != '='
+        || psz[1] == '=')
+        return RINF_SUCCESS;
+    const char *pszBody = psz + 1;
+
+    /*
+     * It's a definition, from here on failures are errors.
+     */
+    *pfDefinition = true;
+    uint32_t uSymbol = NIL_SYMBOL;
+    int rc = SymTableIntern(&g_SymTable, pszName, cchName, &uSymbol);
+    if (RC_FAILURE(rc))
+        return rc;
+    pEval->Result.pszFunction = SymTableName(&g_SymTable, uSymbol);
+
+    for (unsigned i = 0; i < g_cFunctions; i++)
+    {
+        if (   StrLen(g_aFunctions[i].pszFunction) == cchName
+            && !StrNCmp(g_aFunctions[i].pszFunction, pszName, cchName))
+            return RERR_DUPLICATE_FUNCTION;
+    }
+
+    if (!cParams)
+        return RERR_INVALID_FUNCTION;
+    if (cParams > MAX_USER_FUNCTION_PARAMETERS)
+        return RERR_TOO_MANY_PARAMETERS;
+    if (EvaluatorIsSelfCall(pszBody, pszName, cchName))
+        return RERR_FUNCTION_RECURSIVE;
+
+    uint32_t auParams[MAX_USER_FUNCTION_PARAMETERS];
+    for (uint32_t i = 0; i < cParams; i++)
+    {
+        rc = SymTableIntern(&g_SymTable, apszParams[i], acchParams[i], &auParams[i]);
+        if (RC_FAILURE(rc))
+            return rc;
+        for (uint32_t k = 0; k < i; k++)
+        {
+            if (auParams[k] == auParams[i])
+                return RERR_INVALID_FUNCTION;
+        }
+    }
+
+    /*
+     * Parse the body with the parameters in scope and compile it.
+     */
+    EVALUATOR BodyEval;
+    EvaluatorInitInternal(&BodyEval);
+    BodyEval.pauParams = auParams;
+    BodyEval.cParams   = cParams;
+    DEBUGPRINTF(("Parsing body of function '%s': '%s'\n", pEval->Result.pszFunction, pszBody));
+    rc = EvaluatorParse(&BodyEval, pszBody);
+    PPROGRAM pProgram = NULL;
+    if (RC_SUCCESS(rc))
+        rc = EvaluatorCompileProgram(BodyEval.pvRPNQueue, cParams, pszExpr, &pProgram);
+    else
+        pEval->Result.pszVariable = BodyEval.Result.pszVariable;
+    EvaluatorDestroy(&BodyEval);
+    if (RC_FAILURE(rc))
+        return rc;
+
+    /*
+     * Register it, or replace the body of an existing one. Tokens hold on to the FUNCTION
+     * so it must stay put; calls parsed against the old definition check the parameter count.
+     * A Function of the global scope is shadowed rather than replaced from a nested scope.
+     */
+    PFUNCTION pFunction = ScopeFindUserFunction(g_pScope, uSymbol);
+    if (!pFunction)
+    {
+        pFunction = MemAllocZTag(sizeof(FUNCTION), enmMemTagFunction);
+        if (!pFunction)
+        {
+            EvaluatorDestroyProgram(pProgram);
+            return RERR_NO_MEMORY;
+        }
+        pFunction->pszFunction  = pEval->Result.pszFunction;
+        pFunction->fUIntParams  = false;
+        pFunction->fRangeParams = true;
+        pFunction->pszSyntax    = "";
+        ListAdd(&g_pScope->UserFuncList, pFunction);
+    }
+    else
+        EvaluatorDestroyProgram(pFunction->pProgram);
+
+    pFunction->cMinParams = cParams;
+    pFunction->cMaxParams = cParams;
+    pFunction->pszDesc    = pProgram->pszExpr;
+    pFunction->pProgram   = pProgram;
+    pEval->Result.fFunctionDefinition = true;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Parses an expression into the RPN Queue. The logic is mostly based on the
+ * shunting yard algorithm with modifications for extra elements. Parsing stops
+ * at an assignment Operator, the right-hand side is left to the caller.
+ *
+ * @return  Status code on result of the parsing.
+ * @param   pEval           The Evaluator object.
+ * @param   pszExpr         The expression to parse.
+ * @param   pQueue          The RPN Queue to add Tokens to.
+ * @param   ppAssignToken   Where to store the Variable Token being assigned, NULL
+ *                          if this isn't an assignment.
+ * @param   ppszAssignExpr  Where to store the right-hand side of the assignment.
+ * @param   ppszStop        Where to store the start of the Token being parsed when
+ *                          parsing stopped, used to locate errors.
+ */
+static int EvaluatorParseExpr(PEVALUATOR pEval, const char *pszExpr, PQUEUE pQueue, PTOKEN *ppAssignToken,
+                              const char **ppszAssignExpr, const char **ppszStop)
+{
+    const char *pszEnd     = NULL;
+    PCTOKEN pPreviousToken = NULL;
+    PTOKEN pToken          = NULL;
+
+    *ppAssignToken  = NULL;
+    *ppszAssignExpr = NULL;
+    *ppszStop       = pszExpr;
+
+    STACK Stack;
+    StackInit(&Stack);
+
+    /*
+     * Parse tokens onto the stack or queue.
+     */
+    int rc = RERR_UNDEFINED;
+    while ((pToken = EvaluatorParseToken(pEval, pszExpr, &pszEnd, pPreviousToken, &rc)) != NULL)
+    {
+        if (   TokenIsCloseParenthesis(pPreviousToken)
+            || TokenIsParamSeparator(pPreviousToken))
+        {
+            MemFree((void *)pPreviousToken);
+            pPreviousToken = NULL;
+        }
+
+        if (pToken->Type == enmTokenNumber)
+        {
+            DEBUGPRINTF(("Adding number (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ") to queue\n", pToken->u.Number.uValue,
+                         pToken->u.Number.dValue));
+            QueueAdd(pQueue, pToken);
+        }
+        else if (pToken->Type == enmTokenParam)
+        {
+            DEBUGPRINTF(("Adding parameter %u to queue\n", pToken->u.iParam));
+            QueueAdd(pQueue, pToken);
+        }
+        else if (pToken->Type == enmTokenOperator)
+        {
+            PCOPERATOR pOperator = pToken->u.pOperator;
+            if (OperatorIsOpenParenthesis(pOperator))
+            {
+                /*
+                 * Open parenthesis.
+                 */
+                DEBUGPRINTF(("Parenthesis begin '%s' pushing to stack\n", pToken->u.pOperator->pszOperator));
+                StackPush(&Stack, pToken);
+            }
+            else if (OperatorIsCloseParenthesis(pOperator))
+            {
+                /*
+                 * Close paranthesis.
+                 */
                 DEBUGPRINTF(("Parenthesis end '%s'\n", pToken->u.pOperator->pszOperator));
                 PTOKEN pStackToken = NULL;
                 while ((   pStackToken = StackPeek(&Stack)) != NULL
@@ -1210,6 +2194,9 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
                 if (!TokenIsFunction(pFunctionToken))
                 {
                     DEBUGPRINTF(("No function specified\n"));
+                    if (pFunctionToken)
+                        StackPush(&Stack, pFunctionToken);
+                    MemFree(pOpenParenthesisToken);
                     MemFree(pToken);
                     EvaluatorCleanUp(pEval, &Stack);
                     return RERR_PARANTHESIS_SEPARATOR_UNEXPECTED;
@@ -1240,101 +2227,22 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
             else if (OperatorIsAssignment(pOperator))
             {
                 /*
-                 * Variable assignment operator. This is going to be fun.
+                 * Variable assignment operator. The right-hand side is left to the caller so
+                 * that chained assignments don't recurse.
                  */
+                MemFree(pToken);
                 PTOKEN pVarToken = QueuePeekTail(pQueue);
                 if (   pVarToken
-                    && TokenIsVariable(pVarToken))
-                {
-                    EVALUATOR SubExprEval;
-                    EvaluatorInitInternal(&SubExprEval);
-                    const char *pszRightExpr = pszEnd;
-                    DEBUGPRINTF(("Parsing subexpression '%s'\n", pszRightExpr));
-                    int rc2 = EvaluatorParse(&SubExprEval, pszRightExpr);
-                    if (RC_SUCCESS(rc2))
-                    {
-                        DEBUGPRINTF(("-- Done subexpression assignment '%s'\n", pszRightExpr));
-
-                        if (!pVarToken->u.pVariable)
-                        {
-                            DEBUGPRINTF(("Creating global variable entry for '%s'\n", pVarToken->szVariable));
-
-                            /*
-                             * Create a variable entry for the Variable Token.
-                             */
-                            PVARIABLE pVariable = MemAlloc(sizeof(VARIABLE));
-                            if (!pVariable)
-                            {
-                                MemFree(pToken);
-                                EvaluatorCleanUp(pEval, &Stack);
-                                EvaluatorDestroy(&SubExprEval);
-                                return RERR_NO_MEMORY;
-                            }
-                            StrCopy(pVariable->szVariable, sizeof(pVariable->szVariable), pVarToken->szVariable);
-                            pVariable->pszExpr = StrDup(pszRightExpr);  /* @todo check for failure */
-                            pVariable->pvRPNQueue = SubExprEval.pvRPNQueue;
-                            pVariable->fCanReinit = true;
-                            SubExprEval.pvRPNQueue = NULL;  /* tricky shit, i know... */
-
-                            /*
-                             * Add variable entry to the 'global' list & connect Token to the variable.
-                             * Heh, good thing we are not multi-threaded.
-                             */
-                            ListAdd(&g_VarList, pVariable);
-                            MemFree(pToken);
-                        }
-                        else if (pVarToken->u.pVariable->fCanReinit)
-                        {
-                            /*
-                             * Reassigning existing variable.
-                             */
-                            if (pVarToken->u.pVariable->pszExpr)
-                                StrFree(pVarToken->u.pVariable->pszExpr);
-                            pVarToken->u.pVariable->pszExpr = StrDup(pszRightExpr);
-                            if (!pVarToken->u.pVariable->pszExpr)
-                            {
-                                MemFree(pToken);
-                                EvaluatorCleanUp(pEval, &Stack);
-                                EvaluatorDestroy(&SubExprEval);
-                                return RERR_NO_MEMORY;
-                            }
-
-                            pVarToken->u.pVariable->pvRPNQueue = SubExprEval.pvRPNQueue;
-                            SubExprEval.pvRPNQueue = NULL;  /* tricky shit, i know... */
-                        }
-                        else
-                        {
-                            StrCopy(pEval->Result.szVariable, sizeof(pEval->Result.szVariable), pVarToken->szVariable);
-                            MemFree(pToken);
-                            EvaluatorCleanUp(pEval, &Stack);
-                            EvaluatorDestroy(&SubExprEval);
-                            return RERR_VARIABLE_CANNOT_REASSIGN;
-                        }
-
-                        StrCopy(pEval->Result.szVariable, sizeof(pEval->Result.szVariable), pVarToken->szVariable);
-                        pEval->Result.fVariableAssignment = true;
-
-                        /*
-                         * Clean up undefined variables & destroy temporary Evaluator object used for parsing.
-                         */
-                        EvaluatorCleanVariables();
-                        EvaluatorDestroy(&SubExprEval);
-                        break;
-                    }
-                    else
-                    {
-                        MemFree(pToken);
-                        EvaluatorCleanUp(pEval, &Stack);
-                        EvaluatorDestroy(&SubExprEval);
-                        return RERR_EXPRESSION_INVALID;
-                    }
-                }
-                else
+                    && TokenIsVariable(pVarToken)
+                    && !pEval->pauParams)
                 {
-                    MemFree(pToken);
-                    EvaluatorCleanUp(pEval, &Stack);
-                    return RERR_INVALID_ASSIGNMENT;
+                    *ppAssignToken  = pVarToken;
+                    *ppszAssignExpr = pszEnd;
+                    break;
                 }
+
+                EvaluatorCleanUp(pEval, &Stack);
+                return RERR_INVALID_ASSIGNMENT;
             }
             else
             {
@@ -1375,26 +2283,26 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
         {
             if (rc == RERR_VARIABLE_NAME_TOO_LONG)
             {
-                DEBUGPRINTF(("Variable name '%s' too long\n", pToken->u.pVariable->szVariable));
+                DEBUGPRINTF(("Variable name '%s' too long\n", TokenVariableName(pToken)));
                 MemFree(pToken);
                 EvaluatorCleanUp(pEval, &Stack);
                 return rc;
             }
             else if (rc == RERR_VARIABLE_NAME_INVALID)
             {
-                DEBUGPRINTF(("Variable name '%s' invalid\n", pToken->u.pVariable->szVariable));
+                DEBUGPRINTF(("Variable name '%s' invalid\n", TokenVariableName(pToken)));
                 MemFree(pToken);
                 EvaluatorCleanUp(pEval, &Stack);
                 return rc;
             }
 
-            DEBUGPRINTF(("Adding variable '%s' to queue\n", pToken->szVariable));
+            DEBUGPRINTF(("Adding variable '%s' to queue\n", TokenVariableName(pToken)));
             QueueAdd(pQueue, pToken);
         }
         else if (pToken->Type == enmTokenCommand)
         {
-            DEBUGPRINTF(("Adding command '%s' to queue\n", pToken->u.pCommand->pszCommand));
-            QueueAdd(pQueue, pToken);
+            DEBUGPRINTF(("Adding command '%s' to queue\n", pToken->u.Command.pCommand->pszCommand));
+            QueueAdd(pQueue, pToken);   /* The Queue owns the Token from here on, including on failure. */
 
             /*
              * Evaluate the rest of the expression as an argument to the command token if any.
@@ -1402,33 +2310,35 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
             const char *pszRightExpr = pszEnd;
             if (*pszRightExpr)
             {
+                /*
+                 * The argument cannot be another command, rule that out before parsing it
+                 * so commands can't nest.
+                 */
+                const char *pszCommandEnd = NULL;
+                int rc2 = RINF_SUCCESS;
+                PTOKEN pNestedToken = EvaluatorParseCommand(pEval, pszRightExpr, &pszCommandEnd, NULL /* pPreviousToken */, &rc2);
+                if (pNestedToken)
+                {
+                    MemFree(pNestedToken);
+                    EvaluatorCleanUp(pEval, &Stack);
+                    return RERR_INVALID_COMMAND_PARAMETER;
+                }
+
                 DEBUGPRINTF(("Command: -- Parsing subexpression '%s'\n", pszRightExpr));
                 EVALUATOR SubExprEval;
                 EvaluatorInitInternal(&SubExprEval);
-                int rc2 = EvaluatorParse(&SubExprEval, pszRightExpr);
+                rc2 = EvaluatorParse(&SubExprEval, pszRightExpr);
                 if (RC_SUCCESS(rc2))
                 {
                     DEBUGPRINTF(("Command: -- Done subexpression evaluation '%s'\n", pszRightExpr));
 
                     if (SubExprEval.Result.fVariableAssignment)
                     {
-                        MemFree(pToken);
                         EvaluatorCleanUp(pEval, &Stack);
                         EvaluatorDestroy(&SubExprEval);
                         return RERR_CANT_ASSIGN_VARIABLE_FOR_COMMAND;
                     }
 
-                    Assert(!pToken->pszCommandExpr);
-                    pToken->pszCommandExpr = pszRightExpr;
-                    DEBUGPRINTF(("pszCommandExpr=%s\n", pToken->pszCommandExpr));
-                    if (!pToken->pszCommandExpr)
-                    {
-                        MemFree(pToken);
-                        EvaluatorCleanUp(pEval, &Stack);
-                        EvaluatorDestroy(&SubExprEval);
-                        return RERR_NO_MEMORY;
-                    }
-
                     /*
                      * Evaluate it and add resulting token to the RPN queue.
                      */
@@ -1437,16 +2347,14 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
                     {
                         if (SubExprEval.Result.fCommandEvaluated)
                         {
-                            MemFree(pToken);
                             EvaluatorCleanUp(pEval, &Stack);
                             EvaluatorDestroy(&SubExprEval);
                             return RERR_INVALID_COMMAND_PARAMETER;
                         }
 
-                        PTOKEN pParamToken = MemAlloc(sizeof(TOKEN));
+                        PTOKEN pParamToken = MemAllocTag(sizeof(TOKEN), enmMemTagToken);
                         if (!pParamToken)
                         {
-                            MemFree(pToken);
                             EvaluatorCleanUp(pEval, &Stack);
                             EvaluatorDestroy(&SubExprEval);
                             return RERR_NO_MEMORY;
@@ -1454,11 +2362,10 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
                         pParamToken->Type = enmTokenNumber;
                         pParamToken->u.Number.uValue = SubExprEval.Result.uValue;
                         pParamToken->u.Number.dValue = SubExprEval.Result.dValue;
-                        pToken->pvCommandParamToken = pParamToken;
+                        pToken->u.Command.pParamToken = pParamToken;
                     }
                     else
                     {
-                        MemFree(pToken);
                         EvaluatorCleanUp(pEval, &Stack);
                         EvaluatorDestroy(&SubExprEval);
                         return RERR_INVALID_PARAMETER;
@@ -1466,7 +2373,6 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
                 }
                 else
                 {
-                    MemFree(pToken);
                     EvaluatorCleanUp(pEval, &Stack);
                     EvaluatorDestroy(&SubExprEval);
                     return RERR_EXPRESSION_INVALID;
@@ -1475,8 +2381,7 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
             }
             else
             {
-                Assert(!pToken->pszCommandExpr);
-                Assert(!pToken->pvCommandParamToken);
+                Assert(!pToken->u.Command.pParamToken);
                 DEBUGPRINTF(("Command: -- Parsing completed sucessfully no params.\n"));
             }
 
@@ -1493,9 +2398,17 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
             break;
         }
         pszExpr = pszEnd;
+        *ppszStop = pszExpr;
         pPreviousToken = pToken;
     }
 
+    /*
+     * A trailing close parenthesis or separator isn't owned by the stack or queue.
+     */
+    if (   TokenIsCloseParenthesis(pPreviousToken)
+        || TokenIsParamSeparator(pPreviousToken))
+        MemFree((void *)pPreviousToken);
+
     /*
      * Pop remainder operators/functions to the queue.
      */
@@ -1517,21 +2430,8 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
         QueueAdd(pQueue, pToken);
     }
 
-    /*
-     * Clear old queue if any, and store the new one.
-     */
-    PQUEUE pPrevQueue = (PQUEUE)pEval->pvRPNQueue;
-    if (pPrevQueue)
-    {
-        while ((pToken = QueueRemove(pPrevQueue)) != NULL)
-            MemFree(pToken);
-        MemFree(pPrevQueue);
-    }
-    pEval->pvRPNQueue = pQueue;
-
     if (QueueSize(pQueue) == 0)
     {
-        EvaluatorCleanUp(pEval, &Stack);
         DEBUGPRINTF(("Error, no tokens detected!\n"));
         return RERR_EXPRESSION_INVALID;
     }
@@ -1540,866 +2440,3496 @@ int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
 
 
 /**
- * Evaluates an internal representation of a parsed expression. The logic is
- * reverse polish notation evaluation but modified to support variables, variable
- * parameters to functions and more.
+ * Assigns a parsed expression to a global Variable, creating the Variable if
+ * required.
  *
- * @return  Status code on the result of the evaluation.
- * @param   pEval   The Evaluator object.
+ * @return  Status code.
+ * @param   pEval       The Evaluator object.
+ * @param   pVarToken   The Variable Token being assigned.
+ * @param   pszExpr     The expression being assigned.
+ * @param   pQueue      The RPN Queue of @a pszExpr, ownership is taken on success.
+ *                      NULL to parse @a pszExpr when the Variable is first used.
  */
-int EvaluatorEvaluate(PEVALUATOR pEval)
+int EvaluatorAssignVariable(PEVALUATOR pEval, PCTOKEN pVarToken, const char *pszExpr, PQUEUE pQueue)
 {
-    Assert(pEval);
-    AssertReturn(pEval->u32Magic == RMAG_EVALUATOR, RERR_BAD_MAGIC);
-
-    PQUEUE pQueue = pEval->pvRPNQueue;
-    if (!pQueue)
-        return RERR_INVALID_RPN;
-
-    STACK Stack;
-    StackInit(&Stack);
-    PTOKEN pToken = NULL;
+    char *pszExprCopy = StrDup(pszExpr);
+    if (!pszExprCopy)
+        return RERR_NO_MEMORY;
 
     /*
-     * Evaluate RPN from Queue to the Stack.
+     * Variables of the global scope are shadowed rather than reassigned from a nested scope,
+     * unless they are constants.
      */
-    DEBUGPRINTF(("EvaluatorEvaluate: RPN: \n"));
-    while ((pToken = QueueRemove(pQueue)) != NULL)
+    PVARIABLE pVariable = ScopeFindVariable(g_pScope, pVarToken->uSymbol);
+    if (!pVariable)
     {
-        if (pToken->Type == enmTokenNumber)
+        PCVARIABLE pGlobalVariable = ScopeFindVariable(&g_GlobalScope, pVarToken->uSymbol);
+        if (   pGlobalVariable
+            && !pGlobalVariable->fCanReinit)
         {
-            DEBUGPRINTF(("Number: (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ") ", pToken->u.Number.uValue, pToken->u.Number.dValue));
-            StackPush(&Stack, pToken);
+            StrFree(pszExprCopy);
+            pEval->Result.pszVariable = TokenVariableName(pVarToken);
+            return RERR_VARIABLE_CANNOT_REASSIGN;
         }
-        else if (pToken->Type == enmTokenOperator)
+
+        DEBUGPRINTF(("Creating variable entry for '%s'\n", TokenVariableName(pVarToken)));
+        pVariable = MemAllocZTag(sizeof(VARIABLE), enmMemTagVariable);
+        if (!pVariable)
         {
-            PCOPERATOR pOperator = pToken->u.pOperator;
-            DEBUGPRINTF(("%s ", pOperator->pszOperator));
-            if (StackSize(&Stack) < pOperator->cParams)
-            {
-                DEBUGPRINTF(("Error StackSize=%u Operator '%s' cParams=%d\n",
-                                    (unsigned)StackSize(&Stack), pOperator->pszOperator, pOperator->cParams));
+            StrFree(pszExprCopy);
+            return RERR_NO_MEMORY;
+        }
+        pVariable->uSymbol    = pVarToken->uSymbol;
+        pVariable->fCanReinit = true;
 
-                /*
-                 * Insufficient parameters to operator.
-                 * Destroy remained of the queue, the stack and bail.
-                 */
-                MemFree(pToken);
-                EvaluatorCleanUp(pEval, &Stack);
-                return RERR_TOO_FEW_PARAMETERS;
-            }
+        int rc = ScopeAssignVariable(g_pScope, pVariable, pszExprCopy, pQueue);
+        if (RC_FAILURE(rc))
+        {
+            MemFree(pVariable);
+            StrFree(pszExprCopy);
+            return rc;
+        }
+        return RINF_SUCCESS;
+    }
+    else if (!pVariable->fCanReinit)
+    {
+        StrFree(pszExprCopy);
+        pEval->Result.pszVariable = TokenVariableName(pVarToken);
+        return RERR_VARIABLE_CANNOT_REASSIGN;
+    }
 
-            /*
-             * Construct the array of PTOKENS parameters and pass it to the Operator evaluator if any, otherwise
-             * just push the first parameter as the result.
-             */
-            PTOKEN apTokens[MAX_OPERATOR_PARAMETERS];
-            memset(apTokens, 0, sizeof(apTokens));
-            Assert(pOperator->cParams <= MAX_OPERATOR_PARAMETERS);
-            int rc = RINF_SUCCESS;
-            PTOKEN pResultantToken = NULL;
-            for (int i = 0; i < pOperator->cParams; i++)
-            {
-                apTokens[i] = StackPop(&Stack);
+    /*
+     * Reassigning existing variable, readers keep seeing the previous assignment until
+     * the batch is published.
+     */
+    int rc = VariableAssign(pVariable, pszExprCopy, pQueue);
+    if (RC_FAILURE(rc))
+    {
+        StrFree(pszExprCopy);
+        return rc;
+    }
+    if (ScopeFindVariable(&g_GlobalScope, pVariable->uSymbol) == pVariable)
+        SymIndexNoteVariable(pVariable->uSymbol);
+    return RINF_SUCCESS;
+}
 
-                /*
-                 * Check if operator can cast to required type to perform it's operation.
-                 * If not, we cannot proceed because it would invoke undefined behaviour.
-                 */
-                if (   pOperator->fUIntParams
-                    && !CanCastToken(apTokens[i], (long double)INT64_MIN, (long double)UINT64_MAX))
-                {
-                    /*
-                     * Bleh, operator cannot handle this big a number. Exit, stage whatever.
-                     */
-                    rc = RERR_UNDEFINED_BEHAVIOUR;
-                    DEBUGPRINTF(("Operand to '%s' cannot be cast to integer without UB. rc=%d\n", pOperator->pszOperator, rc));
-                    MemFree(pToken);
-                    EvaluatorCleanUp(pEval, &Stack);
-                    return rc;
-                }
-            }
 
-            if (RC_SUCCESS(rc))
-            {
-                if (pOperator->pfnOperator)
-                {
-                    EvaluatorInvertTokenArray(apTokens, pOperator->cParams);
-                    rc = pOperator->pfnOperator(pEval, apTokens);
-                    if (RC_SUCCESS(rc))
-                        pResultantToken = apTokens[0];
-                }
-                else
-                    pResultantToken = apTokens[0];
-            }
+/**
+ * Parses the expression of a lazily defined Variable the first time it's used,
+ * see EvaluatorLoadDefinitions(). Readers may get here too, parsing is done in a
+ * batch of assignments so only one of them does it.
+ *
+ * @return  Status code.
+ * @param   pVariable   The Variable.
+ * @param   pDef        The assignment of @a pVariable to parse, nothing is done if
+ *                      it's already parsed.
+ */
+int EvaluatorCompileVariable(PCVARIABLE pVariable, PVARDEF pDef)
+{
+    if (RCU_LOAD(&pDef->pvRPNQueue))
+        return RINF_SUCCESS;
 
-            if (   RC_SUCCESS(rc)
-                && pResultantToken)
-            {
-                for (int i = 1; i < pOperator->cParams; i++)
-                    MemFree(apTokens[i]);
-                StackPush(&Stack, pResultantToken);
-            }
-            else
-            {
-                DEBUGPRINTF(("Operator '%s' on given operands failed. rc=%d\n", pOperator->pszOperator, rc));
-                MemFree(pToken);
-                EvaluatorCleanUp(pEval, &Stack);
-                return RERR_BASIC_OPERATOR_MISSING;
-            }
-        }
-        else if (pToken->Type == enmTokenFunction)
-        {
-            PCFUNCTION pFunction = pToken->u.pFunction;
-            DEBUGPRINTF(("%s ", pFunction->pszFunction));
-            if (StackSize(&Stack) < pToken->cFunctionParams)
-            {
-                DEBUGPRINTF(("Error StackSize=%u Function '%s' cParams=%d cMinParams=%d cMaxParams=%d\n",
-                             (unsigned)StackSize(&Stack), pFunction->pszFunction, pToken->cFunctionParams,
-                             pFunction->cMinParams, pFunction->cMaxParams));
+    EvaluatorWriteBegin();
+    if (pDef->pvRPNQueue)
+    {
+        EvaluatorWriteEnd();
+        return RINF_SUCCESS;
+    }
 
-                /*
-                 * Insufficient parameters to function. Buh bye.
-                 */
-                MemFree(pToken);
-                EvaluatorCleanUp(pEval, &Stack);
-                return RERR_TOO_FEW_PARAMETERS;
-            }
+    PQUEUE pQueue = MemAllocTag(sizeof(QUEUE), enmMemTagNode);
+    if (!pQueue)
+    {
+        EvaluatorWriteEnd();
+        return RERR_NO_MEMORY;
+    }
+    QueueInit(pQueue);
 
-            /*
-             * Construct an array of maximum possible PTOKENS parameters and
-             * pass it to the Function evaluator if any, otherwise
-             * just push the first parameter as the result.
-             */
-            Assert(pFunction->cMaxParams <= MAX_FUNCTION_PARAMETERS);
-            uint32_t cParams = R_MIN(pToken->cFunctionParams, MAX_FUNCTION_PARAMETERS);
-            PTOKEN *papTokens = MemAlloc(cParams * sizeof(TOKEN));
-            if (!papTokens)
-            {
-                MemFree(pToken);
-                EvaluatorCleanUp(pEval, &Stack);
-                return RERR_NO_MEMORY;
-            }
+    /*
+     * Functions are looked up while parsing, a Variable of the global scope mustn't end
+     * up calling a Function of whichever nested scope happens to use it first.
+     */
+    PVARSCOPE pPrevScope = g_pScope;
+    if (ScopeFindVariable(&g_GlobalScope, pVariable->uSymbol) == pVariable)
+        g_pScope = &g_GlobalScope;
 
-            int rc = RERR_UNDEFINED;
-            for (uint32_t i = 0; i < cParams; i++)
-            {
-                papTokens[i] = StackPop(&Stack);
+    DEBUGPRINTF(("Parsing lazily defined variable '%s': '%s'\n", VariableName(pVariable), pDef->pszExpr));
+    EVALUATOR SubExprEval;
+    EvaluatorInitInternal(&SubExprEval);
+    PTOKEN pVarToken = NULL;
+    const char *pszRightExpr = NULL;
+    const char *pszStop = NULL;
+    int rc = EvaluatorParseExpr(&SubExprEval, pDef->pszExpr, pQueue, &pVarToken, &pszRightExpr, &pszStop);
+    g_pScope = pPrevScope;
+    EvaluatorDestroy(&SubExprEval);
+    if (   RC_SUCCESS(rc)
+        && pVarToken)
+    {
+        /* Assignments are never deferred, they'd take effect whenever the Variable is first used. */
+        MemFree(pVarToken);
+        rc = RERR_EXPRESSION_INVALID;
+    }
+    if (RC_SUCCESS(rc))
+        RCU_STORE(&pDef->pvRPNQueue, (void *)pQueue);
+    else
+        EvaluatorDestroyQueue(pQueue);
+    EvaluatorWriteEnd();
+    return rc;
+}
 
-                /*
-                 * Check if function can cast to required type to perform it's operation.
-                 * If not, we cannot proceed because it would invoke undefined behaviour.
-                 */
-                if (   pFunction->fUIntParams
-                    && !CanCastToken(papTokens[i], (long double)INT64_MIN, (long double)UINT64_MAX))
-                {
-                    /*
-                     * Bleh, function cannot handle this big a number. 0wT.
-                     */
-                    rc = RERR_UNDEFINED_BEHAVIOUR;
-                    DEBUGPRINTF(("Parameter to '%s' cannot be cast to integer without UB. rc=%d\n", pFunction->pszFunction, rc));
-                    MemFree(pToken);
-                    EvaluatorCleanUp(pEval, &Stack);
-                    return rc;
-                }
-            }
 
-            PTOKEN pResultantToken = NULL;
-            if (pFunction->pfnFunction)
-            {
-                EvaluatorInvertTokenArray(papTokens, cParams);
-                rc = pFunction->pfnFunction(pEval, papTokens, cParams);
-                if (RC_SUCCESS(rc))
-                    pResultantToken = papTokens[0];
-            }
-            else
-                pResultantToken = papTokens[0];
+/**
+ * Parses the expression, see EvaluatorParse().
+ *
+ * @return  Status code on result of the parsing pass.
+ * @param   pEval   The Evaluator object.
+ * @param   pszExpr The expression to parse.
+ */
+static int EvaluatorParseInternal(PEVALUATOR pEval, const char *pszExpr)
+{
 
-            if (pResultantToken)
-            {
-                for (uint32_t k = 1; k < cParams; k++)
-                    MemFree(papTokens[k]);
+    /*
+     * Assume this is not a variable assignment expression. If it is, the relevant
+     * parts will fill this information so the caller can handle it as an assignemnt.
+     */
+    pEval->Result.fVariableAssignment = false;
+    pEval->Result.fCommandEvaluated = false;
+    pEval->Result.fFunctionDefinition = false;
+    pEval->Result.pszVariable = "";
+    pEval->Result.pszFunction = "";
+    pEval->Result.pszCommand = NULL;
+    pEval->Result.ErrorIndex = -1;
+    if (pEval->Result.pszCommandResult)
+    {
+        StrFree(pEval->Result.pszCommandResult);
+        pEval->Result.pszCommandResult = NULL;
+    }
 
-                MemFree(papTokens);
-                StackPush(&Stack, pResultantToken);
-            }
-            else
-            {
-                Assert(RC_FAILURE(rc));
-                DEBUGPRINTF(("Function '%s' on given operands failed! rc=%d\n", pFunction->pszFunction, rc));
-                MemFree(pToken);
-                MemFree(papTokens);
-                EvaluatorCleanUp(pEval, &Stack);
-                return rc;
-            }
+    /*
+     * User-defined Function definitions are compiled and registered right away, there is
+     * nothing left to evaluate.
+     */
+    if (!pEval->pauParams)
+    {
+        bool fDefinition = false;
+        int rc = EvaluatorDefineFunction(pEval, pszExpr, &fDefinition);
+        if (fDefinition)
+        {
+            EvaluatorCleanUp(pEval, NULL /* pStack */);
+            return rc;
         }
-        else if (pToken->Type == enmTokenCommand)
+    }
+
+    /*
+     * Parse the expression. Chained assignments are parsed one link at a time instead of
+     * recursing, each link's right-hand side going into a Queue of its own. The Variables
+     * are then assigned from the innermost link outwards, each one getting the Queue of the
+     * link to its right, e.g. "_a=_b=5" assigns "5" to _b and then "_b" to _a.
+     */
+    ASSIGNLINK aLinksSmall[EVAL_ASSIGN_LINKS_SMALL];
+    PASSIGNLINK paLinks = aLinksSmall;
+    uint32_t cLinksAlloc = R_ARRAY_ELEMENTS(aLinksSmall);
+    uint32_t cLinks = 0;
+    PQUEUE pQueue = NULL;
+    const char *pszStart = pszExpr;
+    int rc = RINF_SUCCESS;
+    for (;;)
+    {
+        pQueue = MemAllocTag(sizeof(QUEUE), enmMemTagNode);
+        if (!pQueue)
         {
-            PCOMMAND pCommand = pToken->u.pCommand;
-            Assert(pCommand);
+            rc = RERR_NO_MEMORY;
+            break;
+        }
+        QueueInit(pQueue);
 
-            DEBUGPRINTF(("EvaluatorEvaluate: Command %s\n", pCommand->pszCommand));
+        PTOKEN pVarToken = NULL;
+        const char *pszRightExpr = NULL;
+        const char *pszStop = NULL;
+        rc = EvaluatorParseExpr(pEval, pszExpr, pQueue, &pVarToken, &pszRightExpr, &pszStop);
+        if (RC_FAILURE(rc))
+        {
+            pEval->Result.ErrorIndex = (int)(pszStop - pszStart);
+            break;
+        }
+        if (!pVarToken)
+            break;
 
-            char *pszResult  = NULL;
-            PTOKEN pParamToken = NULL;
-            int rc;
-            if (pToken->pvCommandParamToken)
+        if (cLinks == cLinksAlloc)
+        {
+            PASSIGNLINK paNewLinks = MemAlloc(cLinksAlloc * 2 * sizeof(ASSIGNLINK));
+            if (!paNewLinks)
             {
-                pParamToken = pToken->pvCommandParamToken;
-                if (!TokenIsNumber(pParamToken))
-                {
-                    DEBUGPRINTF(("Not a number token for command argument.\n"));
-                    MemFree(pToken);
-                    MemFree(pParamToken);
-                    EvaluatorCleanUp(pEval, &Stack);
-                    return RERR_INVALID_COMMAND_PARAMETER;
-                }
+                rc = RERR_NO_MEMORY;
+                break;
             }
+            MemCpy(paNewLinks, paLinks, cLinks * sizeof(ASSIGNLINK));
+            if (paLinks != aLinksSmall)
+                MemFree(paLinks);
+            paLinks = paNewLinks;
+            cLinksAlloc *= 2;
+        }
 
-            rc = pCommand->pfnCommand(pEval, pParamToken, &pszResult);
-            if (RC_SUCCESS(rc))
-            {
-                pEval->Result.fCommandEvaluated = true;
-                StrCopy(pEval->Result.szCommand, sizeof(pEval->Result.szCommand), pCommand->pszCommand);
-                if (pszResult)
-                {
-                    StrCopy(pEval->Result.szCommandResult, sizeof(pEval->Result.szCommandResult), pszResult);
-                    StrFree(pszResult);
-                }
-            }
-            else
-            {
-                pEval->Result.fCommandEvaluated = false;
-                rc = RERR_COMMAND_FAILED;
-            }
+        DEBUGPRINTF(("Assignment to '%s', parsing right-hand side '%s'\n", TokenVariableName(pVarToken), pszRightExpr));
+        paLinks[cLinks].pQueue    = pQueue;
+        paLinks[cLinks].pVarToken = pVarToken;
+        paLinks[cLinks].pszExpr   = pszRightExpr;
+        ++cLinks;
+        pQueue  = NULL;
+        pszExpr = pszRightExpr;
+    }
 
-            MemFree(pToken);
-            if (pParamToken)
-                MemFree(pParamToken);
-            EvaluatorCleanUp(pEval, &Stack);
+    /*
+     * A right-hand side that fails to parse makes the whole assignment invalid.
+     */
+    if (   RC_FAILURE(rc)
+        && cLinks > 0)
+        rc = RERR_EXPRESSION_INVALID;
+
+    while (   RC_SUCCESS(rc)
+           && cLinks > 0)
+    {
+        PASSIGNLINK pLink = &paLinks[cLinks - 1];
+        rc = EvaluatorAssignVariable(pEval, pLink->pVarToken, pLink->pszExpr, pQueue);
+        if (RC_FAILURE(rc))
+        {
+            if (cLinks > 1)
+                rc = RERR_EXPRESSION_INVALID;
             break;
         }
-        else if (pToken->Type == enmTokenVariable)
-        {
-            PVARIABLE pVariable = pToken->u.pVariable;
-            if (!pVariable)
-            {
-                /*
-                 * Try find the variable if the Variable token was created BEFORE the creation of
-                 * the variable entry. e.g. _a=_b+1, _b=5, _a and we are evaluating "_a" now whose
-                 * RPN Token "_b" has no association with the global variable entry "_b" yet.
-                 */
-                pToken->u.pVariable = EvaluatorFindVariable(pToken->szVariable, &g_VarList);
-                if (!pToken->u.pVariable)
-                {
-                    StrCopy(pEval->Result.szVariable, sizeof(pEval->Result.szVariable), pToken->szVariable);
-                    EvaluatorCleanVariables();
-                    MemFree(pToken);
-                    EvaluatorCleanUp(pEval, &Stack);
-                    return RERR_VARIABLE_UNDEFINED;
-                }
 
-                pVariable = pToken->u.pVariable;
-            }
+        pEval->Result.pszVariable = TokenVariableName(pLink->pVarToken);
+        pEval->Result.fVariableAssignment = true;
+        pQueue = pLink->pQueue;
+        --cLinks;
+    }
 
-            PQUEUE pVarQueue = pToken->u.pVariable->pvRPNQueue;
-            if (!pVarQueue)
-            {
-                /*
-                 * Huh? User typed probably typed some crap and we formed variables out of it.
-                 * Delete them and bail.
-                 */
-                EvaluatorCleanVariables();
-                MemFree(pToken);
-                EvaluatorCleanUp(pEval, &Stack);
-                return RERR_EXPRESSION_INVALID;
-            }
+    if (RC_SUCCESS(rc))
+    {
+        /*
+         * Clear old queue if any, and store the new one.
+         */
+        EvaluatorDestroyQueue(pEval->pvRPNQueue);
+        pEval->pvRPNQueue = pQueue;
+    }
+    else
+    {
+        EvaluatorDestroyQueue(pEval->pvRPNQueue);
+        pEval->pvRPNQueue = NULL;
+        EvaluatorDestroyQueue(pQueue);
+        while (cLinks > 0)
+            EvaluatorDestroyQueue(paLinks[--cLinks].pQueue);
+    }
 
-            /*
-             * Avoid circular variable dependencies. We know which variable we are evaluating, add it to
-             * a list of variables. As we recurse into sub-variables we check the list to make sure we are
-             * not evaluating a variable being evaluated.
-             */
-            PVARIABLE pAncestorVar = EvaluatorFindVariable(pToken->u.pVariable->szVariable, &pEval->VarList);
-            if (!pAncestorVar)
-            {
-                /*
-                 * Evaluating an RPN Queue 'consumes' the queue. So let's copy it to leave the original
-                 * Variable entry's RPN queue unmodified for further evaluations.
-                 */
-                PQUEUE pEvalQueue = MemAlloc(sizeof(QUEUE));    /* fix this shit. make pvRPNQueue as a stack variable */
-                QueueInit(pEvalQueue);
-                for (uint32_t i = 0; i < QueueSize(pVarQueue); i++)
-                {
-                    PTOKEN pSrcToken = QueueItemAt(pVarQueue, i);
-                    Assert(pSrcToken);
-                    PTOKEN pTmpToken = TokenDup(pSrcToken);
-                    if (!pTmpToken)
-                    {
-                        MemFree(pToken);
-                        EvaluatorCleanUp(pEval, &Stack);
-                        return RERR_NO_MEMORY;
-                    }
-                    QueueAdd(pEvalQueue, pTmpToken);
-                }
+    if (paLinks != aLinksSmall)
+        MemFree(paLinks);
+    return rc;
+}
 
-                /*
-                 * Construct a temporary Evaluator object and try evaluate the Variable.
-                 */
-                EVALUATOR VarEval;
-                EvaluatorInitInternal(&VarEval);
-                VarEval.pvRPNQueue = pEvalQueue;
-                ListAppend(&VarEval.VarList, &pEval->VarList);
-                ListAdd(&VarEval.VarList, pVariable);
 
-                DEBUGPRINTF(("Evaluating variable '%s'\n", pToken->u.pVariable->szVariable));
-#ifdef _DEBUG
-                EvaluatorPrintVarList(&VarEval.VarList);
-#endif
-                int rc = EvaluatorEvaluate(&VarEval);
-                if (RC_SUCCESS(rc))
-                {
-                    /*
-                     * Reuse Variable Token as a Number Token & push it to the Stack.
-                     */
-                    DEBUGPRINTF(("Variable '%s' is %" FMT_FLT_NAT "\n", pToken->u.pVariable->szVariable, VarEval.Result.dValue));
-                    pToken->Type = enmTokenNumber;
-                    pToken->u.Number.uValue = VarEval.Result.uValue;
-                    pToken->u.Number.dValue = VarEval.Result.dValue;
+/**
+ * Parses the expression into a modified reverse polish notation form. The logic
+ * is mostly based on the shunting yard algorithm with modifications for extra
+ * elements. This constitutes the first pass in evaluating an expression.
+ * The @a pEval object is internally updated with the intermediate representation
+ * which will be used in the next pass, which is evaluation.
+ *
+ * @return  Status code on result of the parsing pass.
+ * @param   pEval   The Evaluator object.
+ * @param   pszExpr The expression to parse.
+ */
+int EvaluatorParse(PEVALUATOR pEval, const char *pszExpr)
+{
+    Assert(pEval);
+    AssertReturn(pEval->u32Magic == RMAG_EVALUATOR, RERR_BAD_MAGIC);
 
-                    /*
-                     * Remove the variable from the dependency list.
-                     */
-                    StackPush(&Stack, pToken);
-                    EvaluatorDestroy(&VarEval);
-                }
-                else
-                {
-                    /** Do -NOT- alter rc, it could be circular dependency error. */
-                    DEBUGPRINTF(("Failed to evaluate right-hand expression for variable '%s'\n", pToken->u.pVariable->szVariable));
-                    StrCopy(pEval->Result.szVariable, sizeof(pEval->Result.szVariable), VarEval.Result.szVariable);
-                    MemFree(pToken);
-                    EvaluatorDestroy(&VarEval);
-                    EvaluatorCleanUp(pEval, &Stack);
-                    return rc;
-                }
-            }
-            else
-            {
-                DEBUGPRINTF(("Circular variable depedency on variable '%s'\n", pAncestorVar->szVariable));
-                StrCopy(pEval->Result.szVariable, sizeof(pEval->Result.szVariable), pAncestorVar->szVariable);
-                MemFree(pToken);
-                EvaluatorCleanUp(pEval, &Stack);
-                return RERR_CIRCULAR_DEPENDENCY;
-            }
-        }
-        else
-        {
-            DEBUGPRINTF(("UnknownToken!\n"));
-            MemFree(pToken);
-        }
+    /*
+     * Parsing interns names and assigns Variables, it's a batch of assignments readers
+     * see all of once the expression is parsed.
+     */
+    if (   !pEval->pStats
+        && !pEval->pTrace)
+    {
+        EvaluatorWriteBegin();
+        int rc = EvaluatorParseInternal(pEval, pszExpr);
+        EvaluatorWriteEnd();
+        return rc;
     }
 
-    DEBUGPRINTF(("\n"));
+    uint64_t const uStart = TimestampNanoSecs();
+    EvaluatorWriteBegin();
+    int rc = EvaluatorParseInternal(pEval, pszExpr);
+    EvaluatorWriteEnd();
+    uint64_t const uEnd = TimestampNanoSecs();
+    if (pEval->pTrace)
+        TraceSpan(pEval->pTrace, "parse", uStart, uEnd);
+    if (pEval->pStats)
+    {
+        pEval->pStats->acNanoSecs[enmStatsPhaseParse] += uEnd - uStart;
+        if (pEval->pvRPNQueue)
+            pEval->pStats->cTokens += QueueSize(pEval->pvRPNQueue);
+    }
+    return rc;
+}
+
+
+/**
+ * Accounts an invocation to an execution profile, unless other threads may be
+ * accounting to it at the same time.
+ *
+ * @param   pEval       The Evaluator object.
+ * @param   pProfile    The execution profile.
+ * @param   uStart      When the invocation started, ignored unless profiling.
+ */
+static inline void EvaluatorProfileAdd(PCEVALUATOR pEval, PPROFILE pProfile, uint64_t uStart)
+{
+    if (pEval->fConcurrent)
+        return;
+    ++pProfile->cCalls;
+    if (pEval->fProfile)
+        pProfile->cNanoSecs += TimestampNanoSecs() - uStart;
+}
+
+
+/**
+ * Applies an Operator to the values on top of the value stack.
+ *
+ * @return  Status code on the result of the operation.
+ * @param   pEval       The Evaluator object.
+ * @param   pOperator   The Operator.
+ * @param   paStack     The value stack.
+ * @param   pcStack     Number of values on the stack, updated on success.
+ */
+static int EvaluatorApplyOperator(PEVALUATOR pEval, PCOPERATOR pOperator, PTOKEN paStack, uint32_t *pcStack)
+{
+    DEBUGPRINTF(("%s ", pOperator->pszOperator));
+    Assert(pOperator->cParams <= MAX_OPERATOR_PARAMETERS);
+    if (*pcStack < pOperator->cParams)
+    {
+        DEBUGPRINTF(("Error StackSize=%u Operator '%s' cParams=%d\n", *pcStack, pOperator->pszOperator, pOperator->cParams));
+        return RERR_TOO_FEW_PARAMETERS;
+    }
+
+    if (!pOperator->cParams)
+    {
+        DEBUGPRINTF(("Operator '%s' takes no operands, nothing to evaluate.\n", pOperator->pszOperator));
+        return RERR_BASIC_OPERATOR_MISSING;
+    }
 
     /*
-     * If a command is evaluated successfully, stop evaluating and break.
+     * Check if operator can cast to required type to perform it's operation.
+     * If not, we cannot proceed because it would invoke undefined behaviour.
      */
-    if (pEval->Result.fCommandEvaluated)
+    PTOKEN paParams = &paStack[*pcStack - pOperator->cParams];
+    if (TokensHaveRange(paParams, pOperator->cParams))
     {
-        DEBUGPRINTF(("fCommandEvaluated\n"));
-        /** @todo Anything to cleanup? */
-        pEval->Result.ErrorIndex = -1;
-        return RINF_SUCCESS;
+        DEBUGPRINTF(("Range operand to '%s'.\n", pOperator->pszOperator));
+        return RERR_RANGE_UNEXPECTED;
     }
 
-    /*
-     * Result is on the stack, otherwise errors.
-     */
-    if (StackSize(&Stack) == 1)
-    {
-        pToken = StackPop(&Stack);
-        DEBUGPRINTF(("Result: (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ")\n", pToken->u.Number.uValue, pToken->u.Number.dValue));
-        pEval->Result.ErrorIndex = -1;
-        pEval->Result.uValue = pToken->u.Number.uValue;
-        pEval->Result.dValue = pToken->u.Number.dValue;
-        MemFree(pToken);
-        return RINF_SUCCESS;
-    }
-    else
-        DEBUGPRINTF(("Here\n"));
+    if (   pOperator->fUIntParams
+        && !CanCastTokens(paParams, pOperator->cParams, (long double)INT64_MIN, (long double)UINT64_MAX))
+    {
+        DEBUGPRINTF(("Operand to '%s' cannot be cast to integer without UB.\n", pOperator->pszOperator));
+        return RERR_UNDEFINED_BEHAVIOUR;
+    }
+
+    /*
+     * Call the Operator evaluator if any, otherwise the first parameter is the result.
+     */
+    if (pOperator->pfnOperator)
+    {
+        uint64_t const uStart = pEval->fProfile ? TimestampNanoSecs() : 0;
+        int rc = pOperator->pfnOperator(pEval, paParams);
+        EvaluatorProfileAdd(pEval, (PPROFILE)&pOperator->Profile, uStart);
+        if (RC_FAILURE(rc))
+        {
+            DEBUGPRINTF(("Operator '%s' on given operands failed. rc=%d\n", pOperator->pszOperator, rc));
+            return RERR_BASIC_OPERATOR_MISSING;
+        }
+    }
+    *pcStack -= pOperator->cParams - 1;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Applies a Function to the values on top of the value stack.
+ *
+ * @return  Status code on the result of the function.
+ * @param   pEval       The Evaluator object.
+ * @param   pToken      The Function Token.
+ * @param   paStack     The value stack.
+ * @param   pcStack     Number of values on the stack, updated on success.
+ */
+static int EvaluatorApplyFunction(PEVALUATOR pEval, PCTOKEN pToken, PTOKEN paStack, uint32_t *pcStack)
+{
+    PCFUNCTION pFunction = pToken->u.pFunction;
+    DEBUGPRINTF(("%s ", pFunction->pszFunction));
+    Assert(pFunction->cMaxParams <= MAX_FUNCTION_PARAMETERS);
+    uint32_t const cParams = R_MIN(pToken->cFunctionParams, MAX_FUNCTION_PARAMETERS);
+    if (   *pcStack < cParams
+        || !cParams)
+    {
+        DEBUGPRINTF(("Error StackSize=%u Function '%s' cParams=%d cMinParams=%d cMaxParams=%d\n",
+                     *pcStack, pFunction->pszFunction, pToken->cFunctionParams,
+                     pFunction->cMinParams, pFunction->cMaxParams));
+        return RERR_TOO_FEW_PARAMETERS;
+    }
+
+    /*
+     * Check if function can cast to required type to perform it's operation.
+     * If not, we cannot proceed because it would invoke undefined behaviour.
+     */
+    PTOKEN paParams = &paStack[*pcStack - cParams];
+    if (   !pFunction->fRangeParams
+        && TokensHaveRange(paParams, cParams))
+    {
+        DEBUGPRINTF(("Range parameter to '%s' which cannot take ranges.\n", pFunction->pszFunction));
+        return RERR_RANGE_UNEXPECTED;
+    }
+
+    if (   pFunction->fUIntParams
+        && !CanCastTokens(paParams, cParams, (long double)INT64_MIN, (long double)UINT64_MAX))
+    {
+        DEBUGPRINTF(("Parameter to '%s' cannot be cast to integer without UB.\n", pFunction->pszFunction));
+        return RERR_UNDEFINED_BEHAVIOUR;
+    }
+
+    /*
+     * User-defined Functions run their compiled body with the parameters as arguments, it may
+     * have been redefined with a different number of parameters since this call was parsed.
+     * Otherwise call the Function evaluator if any, otherwise the first parameter is the result.
+     */
+    int rc = RINF_SUCCESS;
+    uint64_t const uStart = pEval->fProfile ? TimestampNanoSecs() : 0;
+    if (pFunction->pProgram)
+    {
+        if (cParams < pFunction->pProgram->cParams)
+            rc = RERR_TOO_FEW_PARAMETERS;
+        else if (cParams > pFunction->pProgram->cParams)
+            rc = RERR_TOO_MANY_PARAMETERS;
+        else
+            rc = EvaluatorExecProgram(pEval, pFunction->pProgram, paParams, &paParams[0]);
+    }
+    else if (pFunction->pfnFunction)
+        rc = pFunction->pfnFunction(pEval, paParams, cParams);
+    EvaluatorProfileAdd(pEval, (PPROFILE)&pFunction->Profile, uStart);
+
+    if (RC_FAILURE(rc))
+    {
+        DEBUGPRINTF(("Function '%s' on given operands failed! rc=%d\n", pFunction->pszFunction, rc));
+        return rc;
+    }
+    *pcStack -= cParams - 1;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Makes sure the Variable bitmaps and values of an Evaluator cover every interned
+ * name. The values are the Evaluator's own so that evaluations running at the same
+ * time never see each other's.
+ *
+ * @return  Status code.
+ * @param   pEval       The Evaluator object.
+ */
+int EvaluatorReserveVarBitmaps(PEVALUATOR pEval)
+{
+    uint32_t cWords = (SymTableCount(&g_SymTable) + 31) / 32;
+    if (cWords <= pEval->cVarBitmapWords)
+        return RINF_SUCCESS;
+    cWords = R_MAX(cWords, pEval->cVarBitmapWords * 2);
+
+    /*
+     * The values and both bitmaps live in one allocation, the active bitmap following
+     * the values and the done bitmap following the active one. Values are only valid
+     * while marked done and need no clearing.
+     */
+    PNUMBER paVarValues = MemAllocTag(cWords * 32 * sizeof(NUMBER) + 2 * cWords * sizeof(uint32_t), enmMemTagVariable);
+    if (!paVarValues)
+        return RERR_NO_MEMORY;
+    uint32_t *pbmVarActive = (uint32_t *)&paVarValues[cWords * 32];
+    MemSet(pbmVarActive, 0, 2 * cWords * sizeof(uint32_t));
+    if (pEval->paVarValues)
+    {
+        MemCpy(paVarValues, pEval->paVarValues, pEval->cVarBitmapWords * 32 * sizeof(NUMBER));
+        MemCpy(pbmVarActive, pEval->pbmVarActive, pEval->cVarBitmapWords * sizeof(uint32_t));
+        MemCpy(pbmVarActive + cWords, pEval->pbmVarDone, pEval->cVarBitmapWords * sizeof(uint32_t));
+        MemFree(pEval->paVarValues);
+    }
+    pEval->paVarValues     = paVarValues;
+    pEval->pbmVarActive    = pbmVarActive;
+    pEval->pbmVarDone      = pbmVarActive + cWords;
+    pEval->cVarBitmapWords = cWords;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Evaluates a Variable Token.
+ *
+ * Variables referring to other Variables are resolved iteratively with an explicit
+ * stack of frames rather than by recursing, so dependency chains of any depth don't
+ * eat into the C stack. Each Variable's RPN Queue is walked in place. The Evaluator's
+ * bitmaps track which Variables are being resolved, to catch circular dependencies,
+ * and which have already been resolved by this evaluation, whose cached value is then
+ * reused so that shared dependencies are only evaluated once.
+ *
+ * @return  Status code on the result of the evaluation.
+ * @param   pEval       The Evaluator object.
+ * @param   pToken      The Variable Token.
+ * @param   pValue      Where to store the value as a Number Token.
+ */
+int EvaluatorEvaluateVariable(PEVALUATOR pEval, PCTOKEN pToken, PTOKEN pValue)
+{
+    int rc = EvaluatorReserveVarBitmaps(pEval);
+    if (RC_FAILURE(rc))
+        return rc;
+    pEval->fVarBitmapsDirty = true;
+
+    /*
+     * Only time the outermost resolution, Functions called while resolving may resolve more.
+     */
+    PEVALSTATS pStats = pEval->pStats;
+    bool const fOutermost = !pEval->cVarNesting;
+    uint64_t const uStart = fOutermost && (pStats || pEval->pTrace || pEval->fProfile) ? TimestampNanoSecs() : 0;
+    ++pEval->cVarNesting;
+
+    VARFRAME aFramesSmall[EVAL_VAR_FRAMES_SMALL];
+    PVARFRAME paFrames = aFramesSmall;
+    uint32_t cFramesAlloc = R_ARRAY_ELEMENTS(aFramesSmall);
+    uint32_t cFrames = 0;
+
+    TOKEN aStackSmall[EVAL_VALUE_STACK_SMALL];
+    PTOKEN paStack = aStackSmall;
+    uint32_t cStackAlloc = R_ARRAY_ELEMENTS(aStackSmall);
+    uint32_t cStack = 0;
+
+    PCTOKEN pVarToken = pToken;
+    for (;;)
+    {
+        if (pVarToken)
+        {
+            /*
+             * Enter a Variable, or push its value if this evaluation already resolved it.
+             */
+            PVARIABLE pVariable = EvaluatorFindVariable(pVarToken->uSymbol);
+            if (!pVariable)
+            {
+                pEval->Result.pszVariable = TokenVariableName(pVarToken);
+                rc = RERR_VARIABLE_UNDEFINED;
+                break;
+            }
+
+            PVARDEF const pDef = VariableDef(pVariable);
+            if (VarBitmapTest(pEval->pbmVarDone, pVariable->uSymbol))
+            {
+                DEBUGPRINTF(("Variable '%s' already resolved\n", VariableName(pVariable)));
+                if (pStats)
+                    ++pStats->cVarCacheHits;
+                paStack[cStack] = *pVarToken;
+                paStack[cStack].Type = enmTokenNumber;
+                paStack[cStack].u.Number = pEval->paVarValues[pVariable->uSymbol];
+                ++cStack;
+            }
+            else if (VarBitmapTest(pEval->pbmVarActive, pVariable->uSymbol))
+            {
+                DEBUGPRINTF(("Circular variable depedency on variable '%s'\n", VariableName(pVariable)));
+                pEval->Result.pszVariable = VariableName(pVariable);
+                rc = RERR_CIRCULAR_DEPENDENCY;
+                break;
+            }
+            else if (RC_FAILURE(EvaluatorCompileVariable(pVariable, pDef)))
+            {
+                /*
+                 * Lazily defined Variables are parsed when first used, report which one is broken.
+                 */
+                pEval->Result.pszVariable = VariableName(pVariable);
+                rc = RERR_VARIABLE_INVALID_DEFINITION;
+                break;
+            }
+            else
+            {
+                if (cFrames == cFramesAlloc)
+                {
+                    PVARFRAME paNewFrames = MemAllocTag(cFramesAlloc * 2 * sizeof(VARFRAME), enmMemTagVariable);
+                    if (!paNewFrames)
+                    {
+                        rc = RERR_NO_MEMORY;
+                        break;
+                    }
+                    MemCpy(paNewFrames, paFrames, cFrames * sizeof(VARFRAME));
+                    if (paFrames != aFramesSmall)
+                        MemFree(paFrames);
+                    paFrames = paNewFrames;
+                    cFramesAlloc *= 2;
+                }
+
+                DEBUGPRINTF(("Evaluating variable '%s'\n", VariableName(pVariable)));
+                VarBitmapSet(pEval->pbmVarActive, pVariable->uSymbol);
+                paFrames[cFrames].pVariable  = pVariable;
+                paFrames[cFrames].pNext      = ((PQUEUE)pDef->pvRPNQueue)->pHead;
+                paFrames[cFrames].iStackBase = cStack;
+                ++cFrames;
+                if (pStats)
+                {
+                    ++pStats->cVarResolved;
+                    pStats->cVarMaxDepth = R_MAX(pStats->cVarMaxDepth, cFrames);
+                }
+            }
+            pVarToken = NULL;
+        }
+
+        if (!cFrames)
+            break;
+
+        PVARFRAME pFrame = &paFrames[cFrames - 1];
+        if (!pFrame->pNext)
+        {
+            /*
+             * Done with the Variable, its value is the one left on top of the stack.
+             */
+            PVARIABLE pVariable = pFrame->pVariable;
+            if (cStack != pFrame->iStackBase + 1)
+            {
+                DEBUGPRINTF(("Failed to evaluate right-hand expression for variable '%s'\n", VariableName(pVariable)));
+                rc = RERR_EXPRESSION_INVALID;
+                break;
+            }
+            if (TokenIsRange(&paStack[cStack - 1]))
+            {
+                rc = RERR_RANGE_UNEXPECTED;
+                break;
+            }
+
+            DEBUGPRINTF(("Variable '%s' is %" FMT_FLT_NAT "\n", VariableName(pVariable), paStack[cStack - 1].u.Number.dValue));
+            pEval->paVarValues[pVariable->uSymbol] = paStack[cStack - 1].u.Number;
+            VarBitmapClear(pEval->pbmVarActive, pVariable->uSymbol);
+            VarBitmapSet(pEval->pbmVarDone, pVariable->uSymbol);
+            --cFrames;
+            continue;
+        }
+
+        PCTOKEN pCurToken = pFrame->pNext->pvData;
+        pFrame->pNext = pFrame->pNext->pNext;
+
+        rc = EvaluatorConsumeSteps(pEval, 1);
+        if (RC_FAILURE(rc))
+            break;
+
+        /*
+         * Every Token pushes at most one value, make sure there's room for it.
+         */
+        if (cStack == cStackAlloc)
+        {
+            PTOKEN paNewStack = MemAllocTag(cStackAlloc * 2 * sizeof(TOKEN), enmMemTagToken);
+            if (!paNewStack)
+            {
+                rc = RERR_NO_MEMORY;
+                break;
+            }
+            MemCpy(paNewStack, paStack, cStack * sizeof(TOKEN));
+            if (paStack != aStackSmall)
+                MemFree(paStack);
+            paStack = paNewStack;
+            cStackAlloc *= 2;
+        }
+
+        switch (pCurToken->Type)
+        {
+            case enmTokenNumber:    paStack[cStack++] = *pCurToken; break;
+            case enmTokenOperator:  rc = EvaluatorApplyOperator(pEval, pCurToken->u.pOperator, paStack, &cStack); break;
+            case enmTokenFunction:  rc = EvaluatorApplyFunction(pEval, pCurToken, paStack, &cStack); break;
+            case enmTokenVariable:  pVarToken = pCurToken; break;
+            default:                rc = RERR_INVALID_RPN; break;
+        }
+        if (RC_FAILURE(rc))
+            break;
+    }
+
+    if (RC_SUCCESS(rc))
+    {
+        Assert(cStack == 1);
+        *pValue = *pToken;
+        pValue->Type = enmTokenNumber;
+        pValue->u.Number = paStack[0].u.Number;
+    }
+
+    if (paStack != aStackSmall)
+        MemFree(paStack);
+    if (paFrames != aFramesSmall)
+        MemFree(paFrames);
+
+    --pEval->cVarNesting;
+    if (fOutermost)
+    {
+        EvaluatorProfileAdd(pEval, &g_VarProfile, uStart);
+        if (   pStats
+            || pEval->pTrace)
+        {
+            uint64_t const uEnd = TimestampNanoSecs();
+            if (pEval->pTrace)
+                TraceSpan(pEval->pTrace, "variables", uStart, uEnd);
+            if (pStats)
+                pStats->acNanoSecs[enmStatsPhaseVariables] += uEnd - uStart;
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Evaluates a compiled user-defined Function body.
+ *
+ * @return  Status code on the result of the evaluation.
+ * @param   pEval       The Evaluator object.
+ * @param   pProgram    The compiled Function body.
+ * @param   paArgs      The arguments, @a pProgram->cParams of them.
+ * @param   pResult     Where to store the result, may point into @a paArgs.
+ */
+static int EvaluatorExecProgram(PEVALUATOR pEval, PCPROGRAM pProgram, PCTOKEN paArgs, PTOKEN pResult)
+{
+    if (pEval->cCallDepth >= MAX_FUNCTION_CALL_DEPTH)
+        return RERR_FUNCTION_NESTING_TOO_DEEP;
+
+    /*
+     * The Program knows its exact stack depth, see EvaluatorCompileProgram().
+     */
+    TOKEN aStackSmall[EVAL_VALUE_STACK_SMALL];
+    PTOKEN paStack = aStackSmall;
+    uint32_t cStack = 0;
+    if (pProgram->cMaxStack > R_ARRAY_ELEMENTS(aStackSmall))
+    {
+        paStack = MemAllocTag(pProgram->cMaxStack * sizeof(TOKEN), enmMemTagToken);
+        if (!paStack)
+            return RERR_NO_MEMORY;
+    }
+
+    ++pEval->cCallDepth;
+    int rc = RINF_SUCCESS;
+    for (uint32_t i = 0; i < pProgram->cTokens && RC_SUCCESS(rc); i++)
+    {
+        rc = EvaluatorConsumeSteps(pEval, 1);
+        if (RC_FAILURE(rc))
+            break;
+
+        PTOKEN pToken = &pProgram->paTokens[i];
+        switch (pToken->Type)
+        {
+            case enmTokenNumber:    paStack[cStack++] = *pToken; break;
+            case enmTokenParam:     paStack[cStack++] = paArgs[pToken->u.iParam]; break;
+            case enmTokenOperator:  rc = EvaluatorApplyOperator(pEval, pToken->u.pOperator, paStack, &cStack); break;
+            case enmTokenFunction:  rc = EvaluatorApplyFunction(pEval, pToken, paStack, &cStack); break;
+            case enmTokenVariable:
+            {
+                rc = EvaluatorEvaluateVariable(pEval, pToken, &paStack[cStack]);
+                if (RC_SUCCESS(rc))
+                    ++cStack;
+                break;
+            }
+            default:                rc = RERR_INVALID_RPN; break;
+        }
+    }
+    --pEval->cCallDepth;
+
+    if (RC_SUCCESS(rc))
+    {
+        Assert(cStack == 1);
+        *pResult = paStack[0];
+    }
+
+    if (paStack != aStackSmall)
+        MemFree(paStack);
+    return rc;
+}
+
+
+/**
+ * Charges steps against the budget of the evaluation in progress and checks
+ * whether it must be abandoned. Called once per RPN Token and periodically by
+ * long-running Functions.
+ *
+ * @return  RINF_SUCCESS if evaluation may continue, otherwise the reason to stop.
+ * @param   pEval       The Evaluator object.
+ * @param   cSteps      Number of steps to charge.
+ */
+int EvaluatorConsumeSteps(PEVALUATOR pEval, uint64_t cSteps)
+{
+    uint64_t const cPrevSteps = pEval->cSteps;
+    pEval->cSteps += cSteps;
+
+    if (RCU_LOAD(&g_fCancelEvaluation))
+        return RERR_CANCELLED;
+
+    if (   pEval->cMaxSteps
+        && pEval->cSteps > pEval->cMaxSteps)
+        return RERR_STEP_BUDGET_EXCEEDED;
+
+    if (   pEval->uDeadline
+        && cPrevSteps / EVAL_DEADLINE_CHECK_STEPS != pEval->cSteps / EVAL_DEADLINE_CHECK_STEPS
+        && TimestampNanoSecs() >= pEval->uDeadline)
+        return RERR_DEADLINE_EXCEEDED;
+
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Sets the budget applied to each subsequent evaluation.
+ *
+ * @param   pEval           The Evaluator object.
+ * @param   cMaxSteps       Maximum number of steps, 0 for unlimited.
+ * @param   cMaxMilliSecs   Maximum wall-clock time in milliseconds, 0 for unlimited.
+ */
+void EvaluatorSetBudget(PEVALUATOR pEval, uint64_t cMaxSteps, uint64_t cMaxMilliSecs)
+{
+    AssertReturnVoid(pEval);
+    pEval->cMaxSteps     = cMaxSteps;
+    pEval->cMaxMilliSecs = cMaxMilliSecs;
+}
+
+
+/**
+ * Cancels the evaluation in progress, it fails with RERR_CANCELLED. Safe to
+ * call from a signal handler or another thread.
+ */
+void EvaluatorCancel(void)
+{
+    RCU_STORE(&g_fCancelEvaluation, 1);
+}
+
+
+/**
+ * PROFILEENTRY: A named execution profile being reported.
+ */
+typedef struct PROFILEENTRY
+{
+    const char     *pszKind;        /**< What was executed. */
+    const char     *pszName;        /**< Name of what was executed. */
+    PCPROFILE       pProfile;       /**< The execution profile. */
+} PROFILEENTRY;
+/** Pointer to a profile entry. */
+typedef PROFILEENTRY *PPROFILEENTRY;
+/** Pointer to a const profile entry. */
+typedef const PROFILEENTRY *PCPROFILEENTRY;
+
+
+/**
+ * Compares profile entries, the hottest first, by time and then by calls.
+ *
+ * @return  Integer less than, equal to or greater than 0 as @a pv1 sorts before,
+ *          with or after @a pv2.
+ * @param   pv1     Pointer to the first profile entry.
+ * @param   pv2     Pointer to the second profile entry.
+ */
+static int ProfileEntryCompare(const void *pv1, const void *pv2)
+{
+    PCPROFILE pProfile1 = ((PCPROFILEENTRY)pv1)->pProfile;
+    PCPROFILE pProfile2 = ((PCPROFILEENTRY)pv2)->pProfile;
+    if (pProfile1->cNanoSecs != pProfile2->cNanoSecs)
+        return pProfile1->cNanoSecs < pProfile2->cNanoSecs ? 1 : -1;
+    if (pProfile1->cCalls != pProfile2->cCalls)
+        return pProfile1->cCalls < pProfile2->cCalls ? 1 : -1;
+    return StrCmp(((PCPROFILEENTRY)pv1)->pszName, ((PCPROFILEENTRY)pv2)->pszName);
+}
+
+
+/**
+ * Adds an execution profile to the entries being reported if it was executed.
+ *
+ * @param   paEntries   The profile entries.
+ * @param   pcEntries   Number of valid entries, updated.
+ * @param   pszKind     What was executed.
+ * @param   pszName     Name of what was executed.
+ * @param   pProfile    The execution profile.
+ */
+static void ProfileEntryAdd(PPROFILEENTRY paEntries, uint32_t *pcEntries, const char *pszKind, const char *pszName,
+                            PCPROFILE pProfile)
+{
+    if (pProfile->cCalls)
+    {
+        paEntries[*pcEntries].pszKind  = pszKind;
+        paEntries[*pcEntries].pszName  = pszName;
+        paEntries[*pcEntries].pProfile = pProfile;
+        ++*pcEntries;
+    }
+}
+
+
+/**
+ * Formats the execution profile of Operators, Functions, Commands and Variable
+ * resolution, the hottest first.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pEval           The Evaluator object.
+ * @param   cMaxEntries     Maximum number of entries to list.
+ * @param   pszBuf          Where to store the formatted profile, truncated if
+ *                          too small.
+ * @param   cbBuf           Size of @a pszBuf.
+ */
+int EvaluatorFormatProfile(PCEVALUATOR pEval, uint32_t cMaxEntries, char *pszBuf, size_t cbBuf)
+{
+    AssertReturn(pEval, RERR_INVALID_PARAMETER);
+    AssertReturn(pszBuf, RERR_INVALID_PARAMETER);
+    AssertReturn(cbBuf, RERR_INVALID_PARAMETER);
+
+    uint32_t const cUserFunctions = ListSize(&g_pScope->UserFuncList);
+    PPROFILEENTRY paEntries = MemAlloc(sizeof(PROFILEENTRY) * (g_cOperators + g_cFunctions + cUserFunctions + g_cCommands + 1));
+    if (!paEntries)
+        return RERR_NO_MEMORY;
+
+    uint32_t cEntries = 0;
+    for (unsigned i = 0; i < g_cOperators; i++)
+        ProfileEntryAdd(paEntries, &cEntries, "operator", g_aOperators[i].pszOperator, &g_aOperators[i].Profile);
+    for (unsigned i = 0; i < g_cFunctions; i++)
+        ProfileEntryAdd(paEntries, &cEntries, "function", g_aFunctions[i].pszFunction, &g_aFunctions[i].Profile);
+    for (PLISTITEM pNode = g_pScope->UserFuncList.pHead; pNode; pNode = pNode->pNext)
+    {
+        PCFUNCTION pFunction = pNode->pvData;
+        ProfileEntryAdd(paEntries, &cEntries, "function", pFunction->pszFunction, &pFunction->Profile);
+    }
+    for (unsigned i = 0; i < g_cCommands; i++)
+        ProfileEntryAdd(paEntries, &cEntries, "command", g_aCommands[i].pszCommand, &g_aCommands[i].Profile);
+    ProfileEntryAdd(paEntries, &cEntries, "variable", "(resolution)", &g_VarProfile);
+
+    qsort(paEntries, cEntries, sizeof(PROFILEENTRY), ProfileEntryCompare);
+
+    size_t offBuf = StrNPrintf(pszBuf, cbBuf, "%-10s %-16s %14s %14s %12s\n", "kind", "name", "calls", "total (us)", "mean (us)");
+    for (uint32_t i = 0; i < R_MIN(cEntries, cMaxEntries) && offBuf < cbBuf; i++)
+    {
+        PCPROFILE pProfile = paEntries[i].pProfile;
+        offBuf += StrNPrintf(pszBuf + offBuf, cbBuf - offBuf, "%-10s %-16s %14" FMT_U64_NAT " %14.1f %12.3f\n",
+                             paEntries[i].pszKind, paEntries[i].pszName, pProfile->cCalls, pProfile->cNanoSecs / 1000.0,
+                             pProfile->cNanoSecs / 1000.0 / pProfile->cCalls);
+    }
+    if (   !pEval->fProfile
+        && offBuf < cbBuf)
+        StrNPrintf(pszBuf + offBuf, cbBuf - offBuf, "(timing disabled, calls only)\n");
+
+    MemFree(paEntries);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Resets the execution profile of all Operators, Functions, Commands and
+ * Variable resolution.
+ */
+void EvaluatorResetProfile(void)
+{
+    for (unsigned i = 0; i < g_cOperators; i++)
+        MemSet(&g_aOperators[i].Profile, 0, sizeof(PROFILE));
+    for (unsigned i = 0; i < g_cFunctions; i++)
+        MemSet(&g_aFunctions[i].Profile, 0, sizeof(PROFILE));
+    for (PLISTITEM pNode = g_pScope->UserFuncList.pHead; pNode; pNode = pNode->pNext)
+        MemSet(&((PFUNCTION)pNode->pvData)->Profile, 0, sizeof(PROFILE));
+    for (unsigned i = 0; i < g_cCommands; i++)
+        MemSet(&g_aCommands[i].Profile, 0, sizeof(PROFILE));
+    MemSet(&g_VarProfile, 0, sizeof(PROFILE));
+}
+
+
+/** Maximum number of Variables listed by EvaluatorExplain(). */
+#define EVAL_EXPLAIN_MAX_VARS       32
+
+/**
+ * EXPLAINVAR: A Variable, or a user-defined Function, pulled in by the expression
+ * being explained.
+ */
+typedef struct EXPLAINVAR
+{
+    PCVARIABLE      pVariable;      /**< The Variable, NULL for a Function. */
+    PCFUNCTION      pFunction;      /**< The user-defined Function, NULL for a Variable. */
+    uint32_t        cTokens;        /**< Number of Tokens in its RPN Queue or compiled body. */
+    uint32_t        uDepth;         /**< Longest chain of Variables it resolves through, a Variable itself included. */
+    long double     rdRefs;         /**< Number of times it would be resolved or called without caching. */
+    long double     rdCalls;        /**< Number of times a Function would be called with caching. */
+} EXPLAINVAR;
+/** Pointer to an explained Variable. */
+typedef EXPLAINVAR *PEXPLAINVAR;
+/** Pointer to a const explained Variable. */
+typedef const EXPLAINVAR *PCEXPLAINVAR;
+
+/**
+ * EXPLAINITER: Iterates the Tokens of an RPN Queue or of a compiled body.
+ */
+typedef struct EXPLAINITER
+{
+    PCQUEUEITEM     pItem;          /**< Next item of the RPN Queue, NULL when done or iterating a body. */
+    PCTOKEN         pToken;         /**< Next Token of the body. */
+    PCTOKEN         pTokenEnd;      /**< End of the body, NULL when iterating an RPN Queue. */
+} EXPLAINITER;
+/** Pointer to a Token iterator. */
+typedef EXPLAINITER *PEXPLAINITER;
+
+/**
+ * EXPLAINFRAME: A Variable or user-defined Function being walked, see
+ * ExplainWalkVariables().
+ */
+typedef struct EXPLAINFRAME
+{
+    EXPLAINVAR      Var;            /**< What is being walked, its Tokens being counted. */
+    EXPLAINITER     Iter;           /**< Its next Token. */
+    uint32_t       *puIndex;        /**< Its entry in the Variable or Function index. */
+} EXPLAINFRAME;
+/** Pointer to an explain frame. */
+typedef EXPLAINFRAME *PEXPLAINFRAME;
+
+
+/**
+ * Compares explained Variables, the most referenced and then the deepest first,
+ * Functions after all Variables.
+ *
+ * @return  Integer less than, equal to or greater than 0 as @a pv1 sorts before,
+ *          with or after @a pv2.
+ * @param   pv1     Pointer to the first explained Variable.
+ * @param   pv2     Pointer to the second explained Variable.
+ */
+static int ExplainVarCompare(const void *pv1, const void *pv2)
+{
+    PCEXPLAINVAR pVar1 = pv1;
+    PCEXPLAINVAR pVar2 = pv2;
+    if (!pVar1->pVariable != !pVar2->pVariable)
+        return pVar1->pVariable ? -1 : 1;
+    if (pVar1->rdRefs != pVar2->rdRefs)
+        return pVar1->rdRefs < pVar2->rdRefs ? 1 : -1;
+    if (pVar1->uDepth != pVar2->uDepth)
+        return pVar1->uDepth < pVar2->uDepth ? 1 : -1;
+    if (pVar1->pVariable)
+        return pVar1->pVariable->uSymbol < pVar2->pVariable->uSymbol ? -1 : 1;
+    return StrCmp(pVar1->pFunction->pszFunction, pVar2->pFunction->pszFunction);
+}
+
+
+/**
+ * Starts iterating the Tokens of an explained Variable or Function.
+ *
+ * @param   pIter       The iterator.
+ * @param   pVar        The explained Variable or Function.
+ */
+static void ExplainIterInit(PEXPLAINITER pIter, PCEXPLAINVAR pVar)
+{
+    if (pVar->pVariable)
+    {
+        pIter->pItem     = ((PCQUEUE)VariableDef(pVar->pVariable)->pvRPNQueue)->pHead;
+        pIter->pToken    = NULL;
+        pIter->pTokenEnd = NULL;
+    }
+    else
+    {
+        pIter->pItem     = NULL;
+        pIter->pToken    = pVar->pFunction->pProgram->paTokens;
+        pIter->pTokenEnd = pIter->pToken + pVar->pFunction->pProgram->cTokens;
+    }
+}
+
+
+/**
+ * Gets the next Token of an iteration.
+ *
+ * @return  The Token, NULL when done.
+ * @param   pIter       The iterator.
+ */
+static PCTOKEN ExplainIterNext(PEXPLAINITER pIter)
+{
+    if (pIter->pTokenEnd)
+        return pIter->pToken < pIter->pTokenEnd ? pIter->pToken++ : NULL;
+    if (!pIter->pItem)
+        return NULL;
+    PCTOKEN pToken = pIter->pItem->pvData;
+    pIter->pItem = pIter->pItem->pNext;
+    return pToken;
+}
+
+
+/**
+ * Gets the entry of the Variable or user-defined Function a Token refers to in
+ * the indexes of ExplainWalkVariables().
+ *
+ * @return  Pointer to the entry, NULL if the Token refers to neither.
+ * @param   pauVarIndex     Index of the Variables by Symbol Id.
+ * @param   pauFuncIndex    Index of the user-defined Functions by Symbol Id.
+ * @param   pToken          The Token.
+ */
+static uint32_t *ExplainIndexEntry(uint32_t *pauVarIndex, uint32_t *pauFuncIndex, PCTOKEN pToken)
+{
+    if (pToken->Type == enmTokenVariable)
+        return &pauVarIndex[pToken->uSymbol];
+    if (   pToken->Type != enmTokenFunction
+        || !pToken->u.pFunction->pProgram)
+        return NULL;
+    uint32_t const uSymbol = SymTableLookup(&g_SymTable, pToken->u.pFunction->pszFunction, StrLen(pToken->u.pFunction->pszFunction));
+    return uSymbol != NIL_SYMBOL ? &pauFuncIndex[uSymbol] : NULL;
+}
+
+
+/**
+ * Appends a Token to a string buffer.
+ *
+ * @param   pStrBuf     The string buffer.
+ * @param   pToken      The Token.
+ */
+static void ExplainAppendToken(PSTRBUF pStrBuf, PCTOKEN pToken)
+{
+    switch (pToken->Type)
+    {
+        case enmTokenNumber:    StrBufAppendF(pStrBuf, " %" FMT_FLT_NAT, pToken->u.Number.dValue); break;
+        case enmTokenOperator:  StrBufAppendF(pStrBuf, " %s", pToken->u.pOperator->pszOperator); break;
+        case enmTokenFunction:  StrBufAppendF(pStrBuf, " %s/%u", pToken->u.pFunction->pszFunction, pToken->cFunctionParams); break;
+        case enmTokenVariable:  StrBufAppendF(pStrBuf, " %s", TokenVariableName(pToken)); break;
+        case enmTokenParam:     StrBufAppendF(pStrBuf, " $%u", pToken->u.iParam); break;
+        case enmTokenCommand:   StrBufAppendF(pStrBuf, " %s", pToken->u.Command.pCommand->pszCommand); break;
+        default:                StrBufAppendF(pStrBuf, " ?"); break;
+    }
+}
+
+
+/**
+ * Appends the Tokens of an explained Variable or Function to a string buffer.
+ *
+ * @param   pStrBuf     The string buffer.
+ * @param   pVar        The explained Variable or Function.
+ */
+static void ExplainAppendRPN(PSTRBUF pStrBuf, PCEXPLAINVAR pVar)
+{
+    EXPLAINITER Iter;
+    ExplainIterInit(&Iter, pVar);
+    PCTOKEN pToken;
+    while ((pToken = ExplainIterNext(&Iter)) != NULL)
+        ExplainAppendToken(pStrBuf, pToken);
+    StrBufAppendF(pStrBuf, "\n");
+}
+
+
+/**
+ * Walks the Variables pulled in by an RPN Queue, following calls to user-defined
+ * Functions into their bodies, appending them to @a paVars in post-order, i.e.
+ * every Variable or Function after the ones it resolves through or calls.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pQueue          The RPN Queue.
+ * @param   pauVarIndex     Per Symbol Id, 0 if not yet seen, UINT32_MAX while
+ *                          being walked, otherwise 1 + index into @a paVars.
+ * @param   pauFuncIndex    Same as @a pauVarIndex for user-defined Functions.
+ * @param   paVars          Where to append the Variables, big enough for all.
+ * @param   pcVars          Number of entries in @a paVars, updated.
+ * @param   pStrBuf         Where to report undefined and circular Variables.
+ */
+static int ExplainWalkVariables(PCQUEUE pQueue, uint32_t *pauVarIndex, uint32_t *pauFuncIndex, PEXPLAINVAR paVars,
+                                uint32_t *pcVars, PSTRBUF pStrBuf)
+{
+    EXPLAINFRAME aFramesSmall[EVAL_VAR_FRAMES_SMALL];
+    PEXPLAINFRAME paFrames = aFramesSmall;
+    uint32_t cFramesAlloc = R_ARRAY_ELEMENTS(aFramesSmall);
+    uint32_t cFrames = 0;
+    EXPLAINITER TopIter;
+    TopIter.pItem     = pQueue->pHead;
+    TopIter.pToken    = NULL;
+    TopIter.pTokenEnd = NULL;
+    int rc = RINF_SUCCESS;
+    for (;;)
+    {
+        /*
+         * Take the next Token of the innermost Variable or Function, or of the expression itself.
+         */
+        PEXPLAINFRAME pFrame = cFrames ? &paFrames[cFrames - 1] : NULL;
+        PCTOKEN pToken = ExplainIterNext(pFrame ? &pFrame->Iter : &TopIter);
+        if (!pToken)
+        {
+            if (!cFrames)
+                break;
+
+            /*
+             * Done with the innermost Variable or Function, everything it resolves through
+             * or calls is done too. Functions don't count towards the depth themselves.
+             */
+            PEXPLAINVAR pVar = &paVars[*pcVars];
+            *pVar = pFrame->Var;
+            pVar->uDepth = pVar->pVariable ? 1 : 0;
+            EXPLAINITER Iter;
+            ExplainIterInit(&Iter, pVar);
+            PCTOKEN pChild;
+            while ((pChild = ExplainIterNext(&Iter)) != NULL)
+            {
+                uint32_t const *puChild = ExplainIndexEntry(pauVarIndex, pauFuncIndex, pChild);
+                if (   puChild
+                    && *puChild
+                    && *puChild != UINT32_MAX)
+                    pVar->uDepth = R_MAX(pVar->uDepth, paVars[*puChild - 1].uDepth + (pVar->pVariable ? 1 : 0));
+            }
+            *pFrame->puIndex = ++*pcVars;
+            --cFrames;
+            continue;
+        }
+
+        uint32_t *puIndex = ExplainIndexEntry(pauVarIndex, pauFuncIndex, pToken);
+        if (!puIndex)
+            continue;
+        bool const fFunction = pToken->Type == enmTokenFunction;
+        const char *pszName = fFunction ? pToken->u.pFunction->pszFunction : TokenVariableName(pToken);
+        if (*puIndex == UINT32_MAX)
+        {
+            StrBufAppendF(pStrBuf, "circular:   %s%s\n", pszName, fFunction ? "()" : "");
+            continue;
+        }
+        if (*puIndex)
+            continue;
+
+        EXPLAINVAR Var;
+        MemSet(&Var, 0, sizeof(Var));
+        if (fFunction)
+        {
+            Var.pFunction = pToken->u.pFunction;
+            Var.cTokens   = Var.pFunction->pProgram->cTokens;
+        }
+        else
+        {
+            PVARIABLE pVariable = EvaluatorFindVariable(pToken->uSymbol);
+            if (!pVariable)
+            {
+                StrBufAppendF(pStrBuf, "undefined:  %s\n", pszName);
+                continue;
+            }
+            PVARDEF const pDef = VariableDef(pVariable);
+            if (RC_FAILURE(EvaluatorCompileVariable(pVariable, pDef)))
+            {
+                StrBufAppendF(pStrBuf, "invalid:    %s\n", pszName);
+                continue;
+            }
+            Var.pVariable = pVariable;
+            Var.cTokens   = QueueSize(pDef->pvRPNQueue);
+        }
+
+        if (cFrames == cFramesAlloc)
+        {
+            PEXPLAINFRAME paNewFrames = MemAllocTag(cFramesAlloc * 2 * sizeof(EXPLAINFRAME), enmMemTagVariable);
+            if (!paNewFrames)
+            {
+                rc = RERR_NO_MEMORY;
+                break;
+            }
+            MemCpy(paNewFrames, paFrames, cFrames * sizeof(EXPLAINFRAME));
+            if (paFrames != aFramesSmall)
+                MemFree(paFrames);
+            paFrames = paNewFrames;
+            cFramesAlloc *= 2;
+        }
+        *puIndex = UINT32_MAX;
+        paFrames[cFrames].Var     = Var;
+        paFrames[cFrames].puIndex = puIndex;
+        ExplainIterInit(&paFrames[cFrames].Iter, &Var);
+        ++cFrames;
+    }
+
+    if (paFrames != aFramesSmall)
+        MemFree(paFrames);
+    return rc;
+}
+
+
+/**
+ * Explains an expression without evaluating it: its RPN program, the Functions
+ * it calls, the Variables it pulls in (with their RPN, depth and how often
+ * they're served from the evaluation's cache) and an estimated cost in steps.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pEval           The Evaluator object.
+ * @param   pszExpr         The expression to explain, the right-hand side is
+ *                          explained for assignments.
+ * @param   ppszExplain     Where to store the explanation, caller frees with
+ *                          StrFree().
+ */
+int EvaluatorExplain(PEVALUATOR pEval, const char *pszExpr, char **ppszExplain)
+{
+    AssertReturn(pEval, RERR_INVALID_PARAMETER);
+    AssertReturn(pszExpr, RERR_INVALID_PARAMETER);
+    AssertReturn(ppszExplain, RERR_INVALID_PARAMETER);
+    *ppszExplain = NULL;
+
+    /*
+     * Parse without assigning anything, the right-hand side of the last link is what
+     * gets evaluated. Names are interned and Variables parsed on the way, so it's done
+     * as a batch of assignments.
+     */
+    EvaluatorWriteBegin();
+    EVALUATOR ExplainEval;
+    EvaluatorInitInternal(&ExplainEval);
+    PQUEUE pQueue = NULL;
+    int rc;
+    for (;;)
+    {
+        EvaluatorDestroyQueue(pQueue);
+        pQueue = MemAllocTag(sizeof(QUEUE), enmMemTagNode);
+        if (!pQueue)
+        {
+            rc = RERR_NO_MEMORY;
+            break;
+        }
+        QueueInit(pQueue);
+
+        PTOKEN pVarToken = NULL;
+        const char *pszRightExpr = NULL;
+        const char *pszStop = NULL;
+        rc = EvaluatorParseExpr(&ExplainEval, pszExpr, pQueue, &pVarToken, &pszRightExpr, &pszStop);
+        if (   RC_FAILURE(rc)
+            || !pVarToken)
+            break;
+        pszExpr = pszRightExpr;
+    }
+    EvaluatorDestroy(&ExplainEval);
+    if (RC_FAILURE(rc))
+    {
+        EvaluatorDestroyQueue(pQueue);
+        EvaluatorWriteEnd();
+        return rc;
+    }
+
+    STRBUF StrBuf;
+    StrBufInit(&StrBuf);
+    StrBufAppendF(&StrBuf, "rpn:       ");
+    for (PCQUEUEITEM pItem = pQueue->pHead; pItem; pItem = pItem->pNext)
+        ExplainAppendToken(&StrBuf, pItem->pvData);
+    StrBufAppendF(&StrBuf, "\n");
+
+    StrBufAppendF(&StrBuf, "functions: ");
+    uint32_t cCalls = 0;
+    for (PCQUEUEITEM pItem = pQueue->pHead; pItem; pItem = pItem->pNext)
+    {
+        PCTOKEN pToken = pItem->pvData;
+        if (pToken->Type == enmTokenFunction)
+        {
+            StrBufAppendF(&StrBuf, "%s%s(%u arg%s%s)", cCalls++ ? ", " : "", pToken->u.pFunction->pszFunction,
+                          pToken->cFunctionParams, pToken->cFunctionParams == 1 ? "" : "s",
+                          pToken->u.pFunction->pProgram ? ", user-defined" : "");
+        }
+    }
+    StrBufAppendF(&StrBuf, "%s\n", cCalls ? "" : "none");
+
+    /*
+     * Walk the Variables and user-defined Functions, then count how often each would be
+     * resolved or called: callers come after what they call in post-order, so walk it
+     * backwards. With caching each Variable is resolved once, so what it calls is
+     * called once for it, while a Function calls everything in its body each time.
+     */
+    uint32_t cVars = 0;
+    uint32_t const cSymbols = SymTableCount(&g_SymTable) + 1;
+    uint32_t *pauVarIndex = MemAllocZTag(2 * cSymbols * sizeof(uint32_t), enmMemTagVariable);
+    uint32_t const cScopeVars = ListSize(&g_pScope->VarList) + (g_pScope != &g_GlobalScope ? ListSize(&g_GlobalScope.VarList) : 0)
+                              + (g_Image.pHdr ? g_Image.pHdr->cVars : 0)   /* Image Variables are added as they're walked. */
+                              + ListSize(&g_pScope->UserFuncList)
+                              + (g_pScope != &g_GlobalScope ? ListSize(&g_GlobalScope.UserFuncList) : 0);
+    PEXPLAINVAR paVars = MemAllocTag((cScopeVars + 1) * sizeof(EXPLAINVAR), enmMemTagVariable);
+    uint32_t *pauFuncIndex = pauVarIndex ? pauVarIndex + cSymbols : NULL;
+    if (   pauVarIndex
+        && paVars)
+        rc = ExplainWalkVariables(pQueue, pauVarIndex, pauFuncIndex, paVars, &cVars, &StrBuf);
+    else
+        rc = RERR_NO_MEMORY;
+
+    if (RC_SUCCESS(rc))
+    {
+        uint32_t const cTopTokens = QueueSize(pQueue);
+        for (PCQUEUEITEM pItem = pQueue->pHead; pItem; pItem = pItem->pNext)
+        {
+            uint32_t const *puChild = ExplainIndexEntry(pauVarIndex, pauFuncIndex, pItem->pvData);
+            if (   puChild
+                && *puChild
+                && *puChild != UINT32_MAX)
+            {
+                paVars[*puChild - 1].rdRefs  += 1;
+                paVars[*puChild - 1].rdCalls += 1;
+            }
+        }
+
+        long double rdCostCached   = cTopTokens;
+        long double rdCostUncached = cTopTokens;
+        uint32_t    uMaxDepth      = 0;
+        uint32_t    cFunctions     = 0;
+        for (uint32_t i = cVars; i-- > 0; )
+        {
+            PCEXPLAINVAR pVar = &paVars[i];
+            long double const rdCalls = pVar->pVariable ? 1 : pVar->rdCalls;
+            EXPLAINITER Iter;
+            ExplainIterInit(&Iter, pVar);
+            PCTOKEN pToken;
+            while ((pToken = ExplainIterNext(&Iter)) != NULL)
+            {
+                uint32_t const *puChild = ExplainIndexEntry(pauVarIndex, pauFuncIndex, pToken);
+                if (   puChild
+                    && *puChild
+                    && *puChild != UINT32_MAX)
+                {
+                    paVars[*puChild - 1].rdRefs  += pVar->rdRefs;
+                    paVars[*puChild - 1].rdCalls += rdCalls;
+                }
+            }
+            rdCostCached   += rdCalls * pVar->cTokens;
+            rdCostUncached += pVar->rdRefs * pVar->cTokens;
+            uMaxDepth       = R_MAX(uMaxDepth, pVar->uDepth);
+            cFunctions     += !pVar->pVariable;
+        }
+
+        StrBufAppendF(&StrBuf, "variables: %u, max depth %u\n", cVars - cFunctions, uMaxDepth);
+        qsort(paVars, cVars, sizeof(EXPLAINVAR), ExplainVarCompare);
+        for (uint32_t i = 0; i < R_MIN(cVars - cFunctions, EVAL_EXPLAIN_MAX_VARS); i++)
+        {
+            PCEXPLAINVAR pVar = &paVars[i];
+            StrBufAppendF(&StrBuf, "  %-16s depth %-5u refs %-8.0Lf cached %-8.0Lf rpn:",
+                          SymTableName(&g_SymTable, pVar->pVariable->uSymbol), pVar->uDepth, pVar->rdRefs,
+                          pVar->rdRefs - 1);
+            ExplainAppendRPN(&StrBuf, pVar);
+        }
+        if (cVars - cFunctions > EVAL_EXPLAIN_MAX_VARS)
+            StrBufAppendF(&StrBuf, "  ... and %u more\n", cVars - cFunctions - EVAL_EXPLAIN_MAX_VARS);
+
+        if (cFunctions)
+        {
+            StrBufAppendF(&StrBuf, "calls:     %u user-defined function%s\n", cFunctions, cFunctions == 1 ? "" : "s");
+            for (uint32_t i = cVars - cFunctions; i < R_MIN(cVars, cVars - cFunctions + EVAL_EXPLAIN_MAX_VARS); i++)
+            {
+                PCEXPLAINVAR pVar = &paVars[i];
+                StrBufAppendF(&StrBuf, "  %-16s depth %-5u calls %-7.0Lf cached %-8.0Lf rpn:",
+                              pVar->pFunction->pszFunction, pVar->uDepth, pVar->rdRefs, pVar->rdCalls);
+                ExplainAppendRPN(&StrBuf, pVar);
+            }
+            if (cFunctions > EVAL_EXPLAIN_MAX_VARS)
+                StrBufAppendF(&StrBuf, "  ... and %u more\n", cFunctions - EVAL_EXPLAIN_MAX_VARS);
+        }
+
+        StrBufAppendF(&StrBuf, "cost:      ~%.0Lf steps, ~%.0Lf without caching resolved Variables",
+                      rdCostCached, rdCostUncached);
+        rc = StrBufDetach(&StrBuf, ppszExplain);
+    }
+    else
+        StrBufDelete(&StrBuf);
+
+    MemFree(paVars);
+    MemFree(pauVarIndex);
+    EvaluatorDestroyQueue(pQueue);
+    EvaluatorWriteEnd();
+    return rc;
+}
+
+
+/** Minimum number of arguments worth evaluating in parallel for a call to a reduction Function. */
+#define EVAL_PARALLEL_ARGS_MIN      8
+/** Trace thread ID of the pool worker evaluating arguments with index 0, that worker being the caller. */
+#define EVAL_TRACE_ARG_THREAD       0x100
+
+/**
+ * EVALARG: An argument of a reduction Function evaluated by the pool, see
+ * EvaluatorEvaluateArgs().
+ */
+typedef struct EVALARG
+{
+    PQUEUEITEM      pFirst;         /**< The first item of the argument in the RPN Queue. */
+    uint32_t        iFirst;         /**< Index of @a pFirst in the RPN Queue. */
+    uint32_t        cTokens;        /**< Number of Tokens of the argument. */
+    int             rc;             /**< Status of the evaluation. */
+    TOKEN           Value;          /**< The value, if evaluated successfully. */
+} EVALARG;
+/** Pointer to an argument evaluated by the pool. */
+typedef EVALARG *PEVALARG;
+
+/**
+ * EVALARGSPAN: A value an RPN Queue leaves on the stack, as far as planning which
+ * arguments to evaluate in parallel is concerned.
+ */
+typedef struct EVALARGSPAN
+{
+    PQUEUEITEM      pFirst;         /**< The first item of the Tokens computing the value. */
+    uint32_t        iFirst;         /**< Index of @a pFirst in the RPN Queue. */
+    bool            fWorthIt;       /**< Whether the value refers to Variables or calls user-defined Functions. */
+} EVALARGSPAN;
+/** Pointer to a span of an RPN Queue. */
+typedef EVALARGSPAN *PEVALARGSPAN;
+
+/**
+ * EVALARGRUN: What the tasks evaluating arguments share, see EvaluatorArgTask().
+ */
+typedef struct EVALARGRUN
+{
+    PEVALARG        paArgs;         /**< The arguments. */
+    PVARSCOPE       pScope;         /**< Scope of the evaluation. */
+    uint64_t        uReadVersion;   /**< Version of the Variables the evaluation sees. */
+} EVALARGRUN;
+/** Pointer to a run of argument evaluations. */
+typedef EVALARGRUN *PEVALARGRUN;
+
+
+/**
+ * Finds the arguments of calls to reduction Functions (sum, avg, gcd, lcm, min,
+ * max) worth evaluating in parallel. A value on the stack is computed by a
+ * contiguous run of Tokens so each argument is a span of the Queue, independent
+ * of the others. Arguments of calls nested in such an argument are left to it.
+ *
+ * @return  Number of arguments found, 0 if there's nothing worth it or the Queue
+ *          can't be planned (the evaluation reports what's wrong with it).
+ * @param   pQueue      The RPN Queue.
+ * @param   paSpans     Scratch space for QueueSize(@a pQueue) spans.
+ * @param   paArgs      Where to store the arguments, room for QueueSize(@a pQueue).
+ */
+static uint32_t EvaluatorPlanArgs(PQUEUE pQueue, PEVALARGSPAN paSpans, PEVALARG paArgs)
+{
+    uint32_t cSpans = 0;
+    uint32_t cArgs  = 0;
+    uint32_t iToken = 0;
+    for (PQUEUEITEM pItem = pQueue->pHead; pItem; pItem = pItem->pNext, iToken++)
+    {
+        PCTOKEN pToken = pItem->pvData;
+        uint32_t cParams = 0;
+        bool fWorthIt = false;
+        switch (pToken->Type)
+        {
+            case enmTokenNumber:    break;
+            case enmTokenVariable:  fWorthIt = true; break;
+            case enmTokenOperator:  cParams = pToken->u.pOperator->cParams; break;
+            case enmTokenFunction:
+                cParams  = R_MIN(pToken->cFunctionParams, MAX_FUNCTION_PARAMETERS);
+                fWorthIt = pToken->u.pFunction->pProgram != NULL;
+                break;
+            default:                return 0;
+        }
+        if (   cParams > cSpans
+            || (   !cParams
+                && pToken->Type != enmTokenNumber
+                && pToken->Type != enmTokenVariable))
+            return 0;
+
+        PEVALARGSPAN paParams = &paSpans[cSpans - cParams];
+        if (   pToken->Type == enmTokenFunction
+            && pToken->u.pFunction->fRangeParams
+            && !pToken->u.pFunction->pProgram)
+        {
+            uint32_t cWorthIt = 0;
+            for (uint32_t i = 0; i < cParams; i++)
+                cWorthIt += paParams[i].fWorthIt;
+            if (cWorthIt >= EVAL_PARALLEL_ARGS_MIN)
+            {
+                while (   cArgs
+                       && paArgs[cArgs - 1].iFirst >= paParams[0].iFirst)
+                    --cArgs;
+                for (uint32_t i = 0; i < cParams; i++)
+                {
+                    if (!paParams[i].fWorthIt)
+                        continue;
+                    uint32_t const iEnd = i + 1 < cParams ? paParams[i + 1].iFirst : iToken;
+                    paArgs[cArgs].pFirst  = paParams[i].pFirst;
+                    paArgs[cArgs].iFirst  = paParams[i].iFirst;
+                    paArgs[cArgs].cTokens = iEnd - paParams[i].iFirst;
+                    ++cArgs;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < cParams; i++)
+            fWorthIt |= paParams[i].fWorthIt;
+        if (cParams)
+        {
+            cSpans -= cParams - 1;
+            paSpans[cSpans - 1].fWorthIt = fWorthIt;
+        }
+        else
+        {
+            paSpans[cSpans].pFirst   = pItem;
+            paSpans[cSpans].iFirst   = iToken;
+            paSpans[cSpans].fWorthIt = fWorthIt;
+            ++cSpans;
+        }
+    }
+    return cArgs;
+}
+
+
+/**
+ * Evaluates the Tokens of an argument, see EvaluatorPlanArgs().
+ *
+ * @return  Status code on the result of the evaluation.
+ * @param   pEval       The Evaluator object.
+ * @param   pFirst      The first item of the argument.
+ * @param   cTokens     Number of Tokens of the argument.
+ * @param   pResult     Where to store the value.
+ */
+static int EvaluatorEvaluateArg(PEVALUATOR pEval, PCQUEUEITEM pFirst, uint32_t cTokens, PTOKEN pResult)
+{
+    TOKEN aStackSmall[EVAL_VALUE_STACK_SMALL];
+    PTOKEN paStack = aStackSmall;
+    if (cTokens > R_ARRAY_ELEMENTS(aStackSmall))
+    {
+        paStack = MemAllocTag(cTokens * sizeof(TOKEN), enmMemTagToken);
+        if (!paStack)
+            return RERR_NO_MEMORY;
+    }
+
+    int rc = RINF_SUCCESS;
+    uint32_t cStack = 0;
+    PCQUEUEITEM pItem = pFirst;
+    for (uint32_t i = 0; i < cTokens && RC_SUCCESS(rc); i++, pItem = pItem->pNext)
+    {
+        PCTOKEN pToken = pItem->pvData;
+        rc = EvaluatorConsumeSteps(pEval, 1);
+        if (RC_FAILURE(rc))
+            break;
+        switch (pToken->Type)
+        {
+            case enmTokenNumber:    paStack[cStack++] = *pToken; break;
+            case enmTokenOperator:  rc = EvaluatorApplyOperator(pEval, pToken->u.pOperator, paStack, &cStack); break;
+            case enmTokenFunction:  rc = EvaluatorApplyFunction(pEval, pToken, paStack, &cStack); break;
+            case enmTokenVariable:
+                rc = EvaluatorEvaluateVariable(pEval, pToken, &paStack[cStack]);
+                if (RC_SUCCESS(rc))
+                    ++cStack;
+                break;
+            default:                rc = RERR_INVALID_RPN; break;
+        }
+    }
+
+    if (RC_SUCCESS(rc))
+    {
+        if (cStack == 1)
+            *pResult = paStack[0];
+        else
+            rc = RERR_EXPRESSION_INVALID;
+    }
+
+    if (paStack != aStackSmall)
+        MemFree(paStack);
+    return rc;
+}
+
+
+/**
+ * Evaluates an argument on a worker of the pool, see TaskPoolRun().
+ */
+static void EvaluatorArgTask(void *pvUser, uint32_t iWorker, uint32_t iTask)
+{
+    PEVALARGRUN pRun = pvUser;
+    PEVALUATOR pEval = &g_paArgEvals[iWorker];
+    PEVALARG pArg = &pRun->paArgs[iTask];
+    uint64_t const uStart = pEval->pTrace ? TimestampNanoSecs() : 0;
+
+    /*
+     * See the Variables in the caller's scope and as of when its evaluation started. Its
+     * read-side section keeps them around until the run is over.
+     */
+    PVARSCOPE const pOldScope = g_pScope;
+    g_pScope = pRun->pScope;
+    EvaluatorReadBegin(pEval);
+    uint64_t const uOldReadVersion = g_uReadVersion;
+    g_uReadVersion = pRun->uReadVersion;
+
+    pArg->rc = EvaluatorEvaluateArg(pEval, pArg->pFirst, pArg->cTokens, &pArg->Value);
+    if (   RC_FAILURE(pArg->rc)
+        && pEval->pbmVarActive)
+        MemSet(pEval->pbmVarActive, 0, pEval->cVarBitmapWords * sizeof(uint32_t));
+
+    g_uReadVersion = uOldReadVersion;
+    EvaluatorReadEnd(pEval);
+    g_pScope = pOldScope;
+
+    if (pEval->pTrace)
+        TraceSpan(pEval->pTrace, "argument", uStart, TimestampNanoSecs());
+}
+
+
+/**
+ * Creates the pool evaluating arguments in parallel, if there's more than one CPU.
+ *
+ * @return  true if the pool is there, false otherwise.
+ */
+static bool EvaluatorArgPoolCreate(void)
+{
+    if (g_pArgPool)
+        return true;
+    if (g_fArgPoolTried)
+        return false;
+    g_fArgPoolTried = true;
+
+    uint32_t const cCpus = ThreadCpuCount();
+    if (cCpus < 2)
+        return false;
+    PEVALUATOR paEvals = MemAllocZTag(cCpus * sizeof(EVALUATOR), enmMemTagOther);
+    if (!paEvals)
+        return false;
+    PTASKPOOL pPool;
+    int rc = TaskPoolCreate(cCpus, &pPool);
+    if (RC_FAILURE(rc))
+    {
+        MemFree(paEvals);
+        return false;
+    }
+    for (uint32_t i = 0; i < cCpus; i++)
+    {
+        EvaluatorInitInternal(&paEvals[i]);
+        paEvals[i].fConcurrent = true;
+    }
+    g_paArgEvals = paEvals;
+    g_pArgPool   = pPool;
+    return true;
+}
+
+
+/**
+ * Destroys the pool evaluating arguments in parallel.
+ */
+static void EvaluatorArgPoolDestroy(void)
+{
+    if (g_pArgPool)
+    {
+        uint32_t const cWorkers = TaskPoolWorkers(g_pArgPool);
+        TaskPoolDestroy(g_pArgPool);
+        for (uint32_t i = 0; i < cWorkers; i++)
+            EvaluatorDestroy(&g_paArgEvals[i]);
+        MemFree(g_paArgEvals);
+    }
+    g_pArgPool       = NULL;
+    g_paArgEvals     = NULL;
+    g_fArgPoolTried  = false;
+}
+
+
+/**
+ * Evaluates the arguments of calls to reduction Functions on the pool when there
+ * are enough of them, replacing their Tokens in the RPN Queue by their values. The
+ * Functions then reduce the values in argument order as always, so results don't
+ * depend on which worker evaluated what. Should anything fail the Queue is left
+ * alone, evaluating it reports the error as it always did.
+ *
+ * @param   pEval       The Evaluator object, in a read-side section.
+ * @param   pQueue      The RPN Queue.
+ */
+static void EvaluatorEvaluateArgs(PEVALUATOR pEval, PQUEUE pQueue)
+{
+    /*
+     * Workers may parse lazily defined Variables which needs the lock a writer would
+     * be holding, and the pool is used by one evaluation at a time. Variables used by
+     * arguments on several workers are resolved, and their steps counted, by each of
+     * them; how many steps an evaluation takes would depend on the workers then so
+     * those with a step budget stay sequential.
+     */
+    uint32_t const cTokens = QueueSize(pQueue);
+    if (   cTokens <= EVAL_PARALLEL_ARGS_MIN
+        || pEval->fConcurrent
+        || pEval->cMaxSteps
+        || g_cWriteNesting
+        || !g_pMemAllocator->fThreadSafe)
+        return;
+
+    PEVALARGSPAN paSpans = MemAllocTag(cTokens * sizeof(EVALARGSPAN), enmMemTagToken);
+    PEVALARG paArgs = MemAllocTag(cTokens * sizeof(EVALARG), enmMemTagToken);
+    uint32_t cArgs = 0;
+    if (   paSpans
+        && paArgs)
+        cArgs = EvaluatorPlanArgs(pQueue, paSpans, paArgs);
+    MemFree(paSpans);
+    if (   !cArgs
+        || !EvaluatorArgPoolCreate())
+    {
+        MemFree(paArgs);
+        return;
+    }
+
+    /*
+     * Workers share the deadline. Variables resolved by a worker are reused by it for
+     * the other arguments it evaluates. The caller's worker records into the caller's
+     * trace, the others into traces of their own written along with it.
+     */
+    uint32_t const cWorkers = TaskPoolWorkers(g_pArgPool);
+    int rc = RINF_SUCCESS;
+    for (uint32_t i = 0; i < cWorkers && RC_SUCCESS(rc); i++)
+    {
+        PEVALUATOR pArgEval = &g_paArgEvals[i];
+        rc = EvaluatorReserveVarBitmaps(pArgEval);
+        if (pArgEval->fVarBitmapsDirty)
+        {
+            MemSet(pArgEval->pbmVarActive, 0, 2 * pArgEval->cVarBitmapWords * sizeof(uint32_t));
+            pArgEval->fVarBitmapsDirty = false;
+        }
+        pArgEval->cSteps    = 0;
+        pArgEval->uDeadline = pEval->uDeadline;
+        pArgEval->pTrace    = pEval->pTrace && i ? TraceThread(pEval->pTrace, EVAL_TRACE_ARG_THREAD + i) : pEval->pTrace;
+    }
+
+    if (RC_SUCCESS(rc))
+    {
+        EVALARGRUN Run;
+        Run.paArgs       = paArgs;
+        Run.pScope       = g_pScope;
+        Run.uReadVersion = g_uReadVersion;
+        TaskPoolRun(g_pArgPool, cArgs, EvaluatorArgTask, &Run);
+        for (uint32_t i = 0; i < cArgs && RC_SUCCESS(rc); i++)
+            rc = paArgs[i].rc;
+    }
+
+    /*
+     * The steps the workers took are charged. The first Token of each argument becomes
+     * its value, the rest are dropped.
+     */
+    if (RC_SUCCESS(rc))
+    {
+        for (uint32_t i = 0; i < cWorkers; i++)
+            pEval->cSteps += g_paArgEvals[i].cSteps;
+        for (uint32_t i = 0; i < cArgs; i++)
+        {
+            PQUEUEITEM pItem = paArgs[i].pFirst;
+            *(PTOKEN)pItem->pvData = paArgs[i].Value;
+            for (uint32_t iToken = 1; iToken < paArgs[i].cTokens; iToken++)
+            {
+                PQUEUEITEM pNext = pItem->pNext;
+                pItem->pNext = pNext->pNext;
+                MemFree(pNext->pvData);
+                MemFree(pNext);
+            }
+            pQueue->cItems -= paArgs[i].cTokens - 1;
+        }
+    }
+    MemFree(paArgs);
+}
+
+
+/**
+ * Evaluates the RPN queue of the Evaluator, see EvaluatorEvaluate().
+ *
+ * @return  Status code on the result of the evaluation.
+ * @param   pEval   The Evaluator object.
+ */
+static int EvaluatorEvaluateQueue(PEVALUATOR pEval)
+{
+    PQUEUE pQueue = pEval->pvRPNQueue;
+    if (!pQueue)
+        return RERR_INVALID_RPN;
+
+    EvaluatorEvaluateArgs(pEval, pQueue);
+
+    /*
+     * The value stack is a contiguous array of Tokens. It can never hold more values than there
+     * are Tokens in the RPN queue so it's sized once up front, and small expressions don't need
+     * any allocation at all. Operators and Functions get a slice of the stack with their parameters
+     * in order and write their result into the first slot, which then becomes the top of the stack.
+     */
+    TOKEN aStackSmall[EVAL_VALUE_STACK_SMALL];
+    PTOKEN paStack = aStackSmall;
+    uint32_t cStack = 0;
+    size_t const cStackMax = QueueSize(pQueue);
+    if (cStackMax > R_ARRAY_ELEMENTS(aStackSmall))
+    {
+        paStack = MemAllocTag(cStackMax * sizeof(TOKEN), enmMemTagToken);
+        if (!paStack)
+        {
+            EvaluatorCleanUp(pEval, NULL /* pStack */);
+            return RERR_NO_MEMORY;
+        }
+    }
+
+    /*
+     * Evaluate RPN from Queue to the value stack.
+     */
+    DEBUGPRINTF(("EvaluatorEvaluate: RPN: \n"));
+    int rc = RINF_SUCCESS;
+    PTOKEN pToken = NULL;
+    while (   RC_SUCCESS(rc)
+           && (pToken = QueueRemove(pQueue)) != NULL)
+    {
+        rc = EvaluatorConsumeSteps(pEval, 1);
+        if (RC_FAILURE(rc))
+        {
+            MemFree(pToken);
+            break;
+        }
+
+        if (pToken->Type == enmTokenNumber)
+        {
+            DEBUGPRINTF(("Number: (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ") ", pToken->u.Number.uValue, pToken->u.Number.dValue));
+            paStack[cStack++] = *pToken;
+        }
+        else if (pToken->Type == enmTokenOperator)
+            rc = EvaluatorApplyOperator(pEval, pToken->u.pOperator, paStack, &cStack);
+        else if (pToken->Type == enmTokenFunction)
+            rc = EvaluatorApplyFunction(pEval, pToken, paStack, &cStack);
+        else if (pToken->Type == enmTokenVariable)
+        {
+            rc = EvaluatorEvaluateVariable(pEval, pToken, &paStack[cStack]);
+            if (RC_SUCCESS(rc))
+                ++cStack;
+        }
+        else if (pToken->Type == enmTokenCommand)
+        {
+            PCOMMAND pCommand = pToken->u.Command.pCommand;
+            Assert(pCommand);
+
+            DEBUGPRINTF(("EvaluatorEvaluate: Command %s\n", pCommand->pszCommand));
+
+            char *pszResult  = NULL;
+            PTOKEN pParamToken = pToken->u.Command.pParamToken;
+            if (   pParamToken
+                && !TokenIsNumber(pParamToken))
+            {
+                DEBUGPRINTF(("Not a number token for command argument.\n"));
+                rc = RERR_INVALID_COMMAND_PARAMETER;
+            }
+            else
+            {
+                uint64_t const uStart = pEval->fProfile ? TimestampNanoSecs() : 0;
+                rc = pCommand->pfnCommand(pEval, pParamToken, &pszResult);
+                EvaluatorProfileAdd(pEval, &pCommand->Profile, uStart);
+                if (RC_SUCCESS(rc))
+                {
+                    pEval->Result.fCommandEvaluated = true;
+                    pEval->Result.pszCommand = pCommand->pszCommand;
+                    pEval->Result.pszCommandResult = pszResult;   /* Ownership transferred to the result. */
+                }
+                else
+                {
+                    pEval->Result.fCommandEvaluated = false;
+                    rc = RERR_COMMAND_FAILED;
+                }
+            }
+
+            /*
+             * A Command consumes the rest of the expression, we're done.
+             */
+            if (pParamToken)
+                MemFree(pParamToken);
+            MemFree(pToken);
+            break;
+        }
+        else
+            DEBUGPRINTF(("UnknownToken!\n"));
+
+        MemFree(pToken);
+    }
+
+    DEBUGPRINTF(("\n"));
+
+    if (RC_SUCCESS(rc))
+    {
+        pEval->Result.ErrorIndex = -1;
+
+        /*
+         * If a command is evaluated successfully, we're done. Otherwise the result is on the stack.
+         */
+        if (pEval->Result.fCommandEvaluated)
+            DEBUGPRINTF(("fCommandEvaluated\n"));
+        else if (   cStack == 1
+                 && TokenIsRange(&paStack[0]))
+        {
+            DEBUGPRINTF(("Range result, it must be reduced to a number\n"));
+            rc = RERR_RANGE_UNEXPECTED;
+        }
+        else if (cStack == 1)
+        {
+            DEBUGPRINTF(("Result: (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ")\n", paStack[0].u.Number.uValue, paStack[0].u.Number.dValue));
+            pEval->Result.uValue = paStack[0].u.Number.uValue;
+            pEval->Result.dValue = paStack[0].u.Number.dValue;
+        }
+        else
+        {
+            DEBUGPRINTF(("Too many tokens, invalid expression\n"));
+            rc = RERR_EXPRESSION_INVALID;
+        }
+    }
+    else
+        EvaluatorCleanUp(pEval, NULL /* pStack */);
+
+    if (paStack != aStackSmall)
+        MemFree(paStack);
+    return rc;
+}
+
+
+/**
+ * Evaluates an internal representation of a parsed expression. The logic is
+ * reverse polish notation evaluation but modified to support variables, variable
+ * parameters to functions and more.
+ *
+ * @return  Status code on the result of the evaluation.
+ * @param   pEval   The Evaluator object.
+ */
+int EvaluatorEvaluate(PEVALUATOR pEval)
+{
+    Assert(pEval);
+    AssertReturn(pEval->u32Magic == RMAG_EVALUATOR, RERR_BAD_MAGIC);
+
+    /*
+     * Start a fresh budget, Variables and Functions evaluated on behalf of this
+     * expression draw from it.
+     */
+    uint64_t const uStart = pEval->pStats || pEval->pTrace || pEval->cMaxMilliSecs ? TimestampNanoSecs() : 0;
+    RCU_STORE(&g_fCancelEvaluation, 0);
+    pEval->cSteps    = 0;
+    pEval->uDeadline = 0;
+    if (pEval->cMaxMilliSecs)
+        pEval->uDeadline = uStart + pEval->cMaxMilliSecs * NANOSECS_PER_MILLISEC;
+
+    /*
+     * Forget Variables resolved by the previous evaluation, they may have been reassigned since.
+     */
+    if (pEval->fVarBitmapsDirty)
+    {
+        MemSet(pEval->pbmVarActive, 0, 2 * pEval->cVarBitmapWords * sizeof(uint32_t));
+        pEval->fVarBitmapsDirty = false;
+    }
+
+    EvaluatorReadBegin(pEval);
+    int rc = EvaluatorEvaluateQueue(pEval);
+    EvaluatorReadEnd(pEval);
+
+    if (   pEval->pStats
+        || pEval->pTrace)
+    {
+        uint64_t const uEnd = TimestampNanoSecs();
+        if (pEval->pTrace)
+            TraceSpan(pEval->pTrace, "evaluate", uStart, uEnd);
+        if (pEval->pStats)
+        {
+            pEval->pStats->acNanoSecs[enmStatsPhaseEvaluate] += uEnd - uStart;
+            pEval->pStats->cSteps += pEval->cSteps;
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Destroys the Evaluator object.
+ *
+ * @param   pEval   The Evaluator object, cannot be NULL.
+ */
+void EvaluatorDestroy(PEVALUATOR pEval)
+{
+    /*
+     * Free the RPN queue, don't destroy the global data.
+     */
+    EvaluatorCleanUp(pEval, NULL /* pStack */);
+    if (pEval->Result.pszCommandResult)
+    {
+        StrFree(pEval->Result.pszCommandResult);
+        pEval->Result.pszCommandResult = NULL;
+    }
+    if (pEval->paVarValues)
+    {
+        MemFree(pEval->paVarValues);
+        pEval->paVarValues  = NULL;
+        pEval->pbmVarActive = NULL;
+        pEval->pbmVarDone   = NULL;
+        pEval->cVarBitmapWords = 0;
+    }
+    RcuReaderDestroy(&pEval->RcuReader);
+    pEval->u32Magic = ~(RMAG_EVALUATOR);
+}
+
+
+/**
+ * Initializes the Evaluator object.
+ *
+ * @return  Status code of initialization.
+ * @param   pEval       The Evaluator object, cannot be NULL.
+ * @param   pszError    Where to write a descriptive error if one should occur while initializing.
+ * @param   cbError     Size of the @pszError buffer including NULL terminator.
+ */
+int EvaluatorInit(PEVALUATOR pEval, char *pszError, size_t cbError)
+{
+    Assert(pEval);
+
+    /*
+     * Dry run of operators to detect invalid, multiple definitions and conflicts.
+     */
+    pEval->u32Magic = ~(RMAG_EVALUATOR);
+    for (unsigned i = 0; i < g_cOperators; i++)
+    {
+        PCOPERATOR pOperator = &g_aOperators[i];
+        if (   !pOperator->pszOperator
+            || !pOperator->pszSyntax
+            || !pOperator->pszDesc)
+        {
+            StrNPrintf(pszError, cbError, "Operator with missing name/syntax or description. index=%d id=%d.", i, pOperator->OperatorId);
+            return RERR_INVALID_OPERATOR;
+        }
+
+        if (isdigit(*pOperator->pszOperator) || *pOperator->pszOperator == '.')
+        {
+            StrNPrintf(pszError, cbError, "Invalid operator name '%s' at [%d] id=%d.", pOperator->pszOperator, i, pOperator->OperatorId);
+            return RERR_INVALID_OPERATOR;
+        }
+
+        /*
+         * Let us for now only allow Operators taking 2 or lower parameters.
+         * The evaluation logic can of course handle any number of parameters
+         * but we don't have a parameter separator for Operators unlike Functions.
+         */
+        if (pOperator->cParams > 2)
+        {
+            StrNPrintf(pszError, cbError, "Operator '%s' at [%d] exceeds maximum parameter limit of 2.", pOperator->pszOperator, i);
+            return RERR_INVALID_OPERATOR;
+        }
+
+        for (unsigned k = 0; k < g_cOperators; k++)
+        {
+            if (i == k)
+                continue;
+
+            PCOPERATOR pCur = &g_aOperators[k];
+
+            /*
+             * Make sure each operator Id is unique.
+             */
+            if (pOperator->OperatorId == pCur->OperatorId)
+            {
+                StrNPrintf(pszError, cbError, "Duplicate operator Id=%d '%s' at [%d] and '%s' at [%d].", pOperator->OperatorId,
+                           pOperator->pszOperator, i, pCur->pszOperator, k);
+                return RERR_CONFLICTING_OPERATORS;
+            }
+
+            if (   !StrCmp(pOperator->pszOperator, pCur->pszOperator)
+                && pOperator->Direction == pCur->Direction)
+            {
+                if (pOperator->cParams == pCur->cParams)
+                {
+                    StrNPrintf(pszError, cbError, "Duplicate operator '%s' at [%d] and [%d].", pOperator->pszOperator, i, k);
+                    return RERR_DUPLICATE_OPERATOR;
+                }
+
+                StrNPrintf(pszError, cbError, "Conflicting operator '%s' at [%d] and [%d].", pOperator->pszOperator, i, k);
+                return RERR_CONFLICTING_OPERATORS;
+            }
+        }
+    }
+
+    /*
+     * Sort operator list to workaround overlapping operators names, eg: "++" always appears before "+".
+     * Also sort such that operators with the same name, the operator with more parameters is sorted first.
+     * For e.g. binary '-' before unary '-', the reason for this is to parse the correct operator
+     * (see EvaluatorParseOperator).
+     * Also locate open and close parenthesis.
+     */
+    qsort(g_aOperators, g_cOperators, sizeof(OPERATOR), OperatorSortCompare);
+    DEBUGPRINTF(("Sorted Operators\n"));
+    PCOPERATOR pOperatorParamSeparator = NULL;
+    for (unsigned i = 0; i < g_cOperators; i++)
+    {
+        DEBUGPRINTF(("%s cParams=%d Id=%d\n", g_aOperators[i].pszOperator, g_aOperators[i].cParams, g_aOperators[i].OperatorId));
+        if (OperatorIsOpenParenthesis(&g_aOperators[i]))
+            g_pOperatorOpenParenthesis = &g_aOperators[i];
+        else if (OperatorIsCloseParenthesis(&g_aOperators[i]))
+            g_pOperatorCloseParenthesis = &g_aOperators[i];
+        else if (OperatorIsParamSeparator(&g_aOperators[i]))
+            pOperatorParamSeparator = &g_aOperators[i];
+    }
+
+    if (!g_pOperatorOpenParenthesis)
+    {
+        StrNPrintf(pszError, cbError, "Extreme error! Open parenthesis operator not found!");
+        return RERR_BASIC_OPERATOR_MISSING;
+    }
+
+    if (!g_pOperatorCloseParenthesis)
+    {
+        StrNPrintf(pszError, cbError, "Extreme error! Close parenthesis operator not found!");
+        return RERR_BASIC_OPERATOR_MISSING;
+    }
+
+    if (!pOperatorParamSeparator)
+    {
+        StrNPrintf(pszError, cbError, "Extreme error! Parameter separator operator not found!");
+        return RERR_BASIC_OPERATOR_MISSING;
+    }
+
+    /*
+     * Check for function duplicates.
+     */
+    for (unsigned i = 0; i < g_cFunctions; i++)
+    {
+        PCFUNCTION pFunction = &g_aFunctions[i];
+        for (unsigned k = 0; k < g_cFunctions; k++)
+        {
+            if (i == k)
+                continue;
+
+            PCFUNCTION pCur = &g_aFunctions[k];
+            if (!StrCmp(pCur->pszFunction, pFunction->pszFunction))
+            {
+                StrNPrintf(pszError, cbError, "Function '%s' is duplicated. at [%d] and [%d].", pFunction->pszFunction, i, k);
+                return RERR_DUPLICATE_FUNCTION;
+            }
+        }
+    }
+
+    /*
+     * Sort function list to workaround overlapping function names, eg: "sqr" and "sqrt".
+     */
+    qsort(g_aFunctions, g_cFunctions, sizeof(FUNCTION), FunctionSortCompare);
+    DEBUGPRINTF(("Sorted Functions\n"));
+    for (unsigned i = 0; i < g_cFunctions; i++)
+    {
+        if (   !g_aFunctions[i].pszFunction
+            || !g_aFunctions[i].pszSyntax
+            || !g_aFunctions[i].pszDesc)
+        {
+            StrNPrintf(pszError, cbError, "Function with missing name/syntax or description. index=%d.", i);
+            return RERR_INVALID_FUNCTION;
+        }
+
+        DEBUGPRINTF(("%s cMinParams=%d cMaxParams=%d\n", g_aFunctions[i].pszFunction, g_aFunctions[i].cMinParams, g_aFunctions[i].cMaxParams));
+    }
+
+    /*
+     * Create alphabetically sorted Function list (for help listing)
+     */
+    if (g_paSortedFunctions)
+        MemFree(g_paSortedFunctions);
+    g_paSortedFunctions = MemAlloc(sizeof(FUNCTION) * g_cFunctions);
+    if (!g_paSortedFunctions)
+        return RERR_NO_MEMORY;
+
+    MemCpy(g_paSortedFunctions, &g_aFunctions, sizeof(FUNCTION) * g_cFunctions);
+    qsort(g_paSortedFunctions, g_cFunctions, sizeof(FUNCTION), AscendingFunctionSortCompare);
+
+    /*
+     * Create alphabetically sorted Command list (for help listing)
+     */
+    /** @todo  */
+
+    EvaluatorInitInternal(pEval);
+    return RINF_SUCCESS;
+}
+
+
+/*******************************************************************************
+ *   Hello, Operator?!                                                         *
+ *******************************************************************************/
+
+static int OpAdd(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue + paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.dValue + paTokens[1].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpSubtract(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue - paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.dValue - paTokens[1].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpNegate(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = -paTokens[0].u.Number.uValue;
+    paTokens[0].u.Number.dValue = -paTokens[0].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpMultiply(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue * paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.dValue * paTokens[1].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpDivide(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue / paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.dValue / paTokens[1].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpIncrement(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    ++paTokens[0].u.Number.uValue;
+    ++paTokens[0].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpDecrement(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    --paTokens[0].u.Number.uValue;
+    --paTokens[0].u.Number.dValue;
+    return RINF_SUCCESS;
+}
+
+static int OpShiftLeft(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue << paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = (uint64_t)paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpShiftRight(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue >> paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = (uint64_t)paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpBitNegate(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = ~paTokens[0].u.Number.uValue;
+    paTokens[0].u.Number.dValue = (uint64_t)paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpModulo(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue % paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpLessThan(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = !!(paTokens[0].u.Number.uValue < paTokens[1].u.Number.uValue);
+    paTokens[0].u.Number.dValue = (long double)DefinitelyLessThan(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    return RINF_SUCCESS;
+}
+
+static int OpGreaterThan(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = !!(paTokens[0].u.Number.uValue > paTokens[1].u.Number.uValue);
+    paTokens[0].u.Number.dValue = (long double)DefinitelyGreaterThan(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    return RINF_SUCCESS;
+}
+
+static int OpEqualTo(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = !!(paTokens[0].u.Number.uValue == paTokens[1].u.Number.uValue);
+    paTokens[0].u.Number.dValue = (long double)EssentiallyEqual(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    return RINF_SUCCESS;
+}
+
+static int OpLessThanOrEqualTo(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = !!(paTokens[0].u.Number.uValue <= paTokens[1].u.Number.uValue);
+    bool const fLessThan = DefinitelyLessThan(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    bool const fEqualTo  = EssentiallyEqual(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    paTokens[0].u.Number.dValue = (long double)(fLessThan || fEqualTo);
+    return RINF_SUCCESS;
+}
+
+static int OpGreaterThanOrEqualTo(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = !!(paTokens[0].u.Number.uValue >= paTokens[1].u.Number.uValue);
+    bool const fGreaterThan = DefinitelyGreaterThan(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    bool const fEqualTo = EssentiallyEqual(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    paTokens[0].u.Number.dValue = (long double)(fGreaterThan || fEqualTo);
+    return RINF_SUCCESS;
+}
+
+static int OpNotEqualTo(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    int rc = OpEqualTo(pEval, paTokens);
+    if (RC_SUCCESS(rc))
+    {
+        paTokens[0].u.Number.uValue = !paTokens[0].u.Number.uValue;
+        paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    }
+    return RINF_SUCCESS;
+}
+
+static int OpLogicalNot(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = !paTokens[0].u.Number.dValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpBitwiseAnd(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue & paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpBitwiseXor(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue ^ paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpBitwiseOr(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = paTokens[0].u.Number.uValue | paTokens[1].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpLogicalAnd(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue && paTokens[1].u.Number.dValue);
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+static int OpLogicalOr(PEVALUATOR pEval, PTOKEN paTokens)
+{
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue || paTokens[1].u.Number.dValue);
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Compares names by pointer, for qsort().
+ */
+static int NameIndexCompareNames(const void *pv1, const void *pv2)
+{
+    return StrCmp(*(const char * const *)pv1, *(const char * const *)pv2);
+}
+
+
+/**
+ * Compares Symbol Ids by name, for qsort().
+ */
+static int NameIndexCompareSymbols(const void *pv1, const void *pv2)
+{
+    return StrCmp(SymTableName(&g_SymTable, *(const uint32_t *)pv1), SymTableName(&g_SymTable, *(const uint32_t *)pv2));
+}
+
+
+/**
+ * Merges Symbol Ids sorted by name into an array of Symbol Ids sorted by name.
+ *
+ * @return  Status code.
+ * @param   ppauEntries     The array to merge into, replaced by the merged array.
+ * @param   pcEntries       Number of entries in the array, updated.
+ * @param   pauNew          The new Symbol Ids, sorted.
+ * @param   cNew            Number of new Symbol Ids.
+ */
+static int NameIndexMerge(uint32_t **ppauEntries, uint32_t *pcEntries, const uint32_t *pauNew, uint32_t cNew)
+{
+    const uint32_t *pauOld = *ppauEntries;
+    uint32_t const  cOld   = *pcEntries;
+    uint32_t *pauMerged = MemAllocTag(((size_t)cOld + cNew + 1) * sizeof(uint32_t), enmMemTagVariable);
+    if (!pauMerged)
+        return RERR_NO_MEMORY;
+
+    uint32_t iOld = 0;
+    uint32_t iNew = 0;
+    uint32_t cMerged = 0;
+    while (iOld < cOld || iNew < cNew)
+    {
+        if (   iNew == cNew
+            || (iOld < cOld && NameIndexCompareSymbols(&pauOld[iOld], &pauNew[iNew]) <= 0))
+            pauMerged[cMerged++] = pauOld[iOld++];
+        else
+            pauMerged[cMerged++] = pauNew[iNew++];
+    }
+
+    MemFree(*ppauEntries);
+    *ppauEntries = pauMerged;
+    *pcEntries   = cMerged;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Brings the completion index up to date, sorting the built-in names once and
+ * merging in the names interned since the last completion.
+ *
+ * @return  Status code.
+ */
+static int NameIndexUpdate(void)
+{
+    if (!g_NameIndex.papszBuiltins)
+    {
+        const char **papszBuiltins = MemAllocTag((g_cFunctions + g_cCommands + 1) * sizeof(const char *), enmMemTagFunction);
+        if (!papszBuiltins)
+            return RERR_NO_MEMORY;
+        uint32_t cBuiltins = 0;
+        for (unsigned i = 0; i < g_cFunctions; i++)
+            papszBuiltins[cBuiltins++] = g_aFunctions[i].pszFunction;
+        for (unsigned i = 0; i < g_cCommands; i++)
+            papszBuiltins[cBuiltins++] = g_aCommands[i].pszCommand;
+        qsort(papszBuiltins, cBuiltins, sizeof(const char *), NameIndexCompareNames);
+        g_NameIndex.papszBuiltins = papszBuiltins;
+        g_NameIndex.cBuiltins     = cBuiltins;
+    }
+
+    uint32_t const uFirst = R_MAX(g_NameIndex.cIndexed, NIL_SYMBOL + 1);
+    uint32_t const cSymbols = SymTableCount(&g_SymTable);
+    if (uFirst >= cSymbols)
+        return RINF_SUCCESS;
+
+    uint32_t const cNew = cSymbols - uFirst;
+    uint32_t *pauNew = MemAllocTag(cNew * sizeof(uint32_t), enmMemTagVariable);
+    if (!pauNew)
+        return RERR_NO_MEMORY;
+    for (uint32_t i = 0; i < cNew; i++)
+        pauNew[i] = uFirst + i;
+    qsort(pauNew, cNew, sizeof(uint32_t), NameIndexCompareSymbols);
+
+    /*
+     * Merge into the delta so completing after defining a name doesn't copy the
+     * whole index, unless the delta is as large as the index anyway.
+     */
+    int rc;
+    if (cNew > g_NameIndex.cEntries)
+        rc = NameIndexMerge(&g_NameIndex.pauEntries, &g_NameIndex.cEntries, pauNew, cNew);
+    else
+    {
+        rc = NameIndexMerge(&g_NameIndex.pauDelta, &g_NameIndex.cDelta, pauNew, cNew);
+        if (   RC_SUCCESS(rc)
+            && g_NameIndex.cDelta > NAMEINDEX_MAX_DELTA)
+        {
+            rc = NameIndexMerge(&g_NameIndex.pauEntries, &g_NameIndex.cEntries, g_NameIndex.pauDelta, g_NameIndex.cDelta);
+            if (RC_SUCCESS(rc))
+                g_NameIndex.cDelta = 0;
+        }
+    }
+    MemFree(pauNew);
+    if (RC_SUCCESS(rc))
+        g_NameIndex.cIndexed = cSymbols;
+    return rc;
+}
+
+
+/**
+ * Checks whether a name is currently a Variable or a user-defined Function.
+ *
+ * @return  true if it is, false otherwise.
+ * @param   uSymbol     Symbol Id of the name.
+ */
+static bool NameIndexIsDefined(uint32_t uSymbol)
+{
+    /* Don't use EvaluatorFindVariable(), it would materialize Variables of the image. */
+    if (   ScopeFindVariable(g_pScope, uSymbol)
+        || ScopeFindVariable(&g_GlobalScope, uSymbol))
+        return true;
+    if (   g_Image.pHdr
+        && uSymbol < g_Image.cVarBySymbol
+        && g_Image.pauVarBySymbol[uSymbol])
+        return true;
+    return EvaluatorFindUserFunction(uSymbol) != NULL;
+}
+
+
+/**
+ * Finds the first name in a sorted range not below a prefix.
+ *
+ * @return  Index of the first name not below the prefix.
+ * @param   papszNames  The names if searching names, otherwise NULL.
+ * @param   pauSymbols  The Symbol Ids if searching interned names, otherwise NULL.
+ * @param   cNames      Number of names.
+ * @param   pszPrefix   The prefix.
+ * @param   cchPrefix   Length of the prefix.
+ */
+static uint32_t NameIndexLowerBound(const char * const *papszNames, const uint32_t *pauSymbols, uint32_t cNames,
+                                    const char *pszPrefix, size_t cchPrefix)
+{
+    uint32_t iLow  = 0;
+    uint32_t iHigh = cNames;
+    while (iLow < iHigh)
+    {
+        uint32_t const iMid = iLow + (iHigh - iLow) / 2;
+        const char *pszName = papszNames ? papszNames[iMid] : SymTableName(&g_SymTable, pauSymbols[iMid]);
+        if (StrNCmp(pszName, pszPrefix, cchPrefix) < 0)
+            iLow = iMid + 1;
+        else
+            iHigh = iMid;
+    }
+    return iLow;
+}
+
+
+/**
+ * Finds names of Functions, Commands and Variables starting with a prefix, for
+ * completion. Call with @a iStart 0 for the first match and then the index
+ * returned in @a piEnd for the next ones, the names in between must not change.
+ * Matches are in sorted runs rather than all sorted, readline sorts them anyway.
+ *
+ * @return  Pointer to the matched name, NULL when there are no more matches.
+ * @param   pszPrefix   The prefix.
+ * @param   cchPrefix   Length of the prefix.
+ * @param   iStart      Where to continue the search, 0 for the first match.
+ * @param   piEnd       Where to store where to continue the search.
+ */
+const char *EvaluatorFindCompletion(const char *pszPrefix, uint32_t cchPrefix, uint32_t iStart, uint32_t *piEnd)
+{
+    AssertReturn(pszPrefix, NULL);
+    AssertReturn(piEnd, NULL);
+
+    if (   !iStart
+        && RC_FAILURE(NameIndexUpdate()))
+        return NULL;
+
+    /*
+     * The search index runs through the built-in names, the entries and then the
+     * delta. Within each, skip ahead to the names starting with the prefix.
+     */
+    uint32_t const cBuiltins = g_NameIndex.cBuiltins;
+    uint32_t const cEntries  = g_NameIndex.cEntries;
+    uint32_t const cDelta    = g_NameIndex.cDelta;
+    uint32_t i = iStart;
+    if (i < cBuiltins)
+    {
+        i = R_MAX(i, NameIndexLowerBound(g_NameIndex.papszBuiltins, NULL, cBuiltins, pszPrefix, cchPrefix));
+        if (   i < cBuiltins
+            && !StrNCmp(g_NameIndex.papszBuiltins[i], pszPrefix, cchPrefix))
+        {
+            *piEnd = i + 1;
+            return g_NameIndex.papszBuiltins[i];
+        }
+        i = cBuiltins;
+    }
+
+    for (int iRange = 0; iRange < 2; iRange++)
+    {
+        const uint32_t *pauSymbols = iRange == 0 ? g_NameIndex.pauEntries : g_NameIndex.pauDelta;
+        uint32_t const  cSymbols   = iRange == 0 ? cEntries : cDelta;
+        uint32_t const  iBase      = iRange == 0 ? cBuiltins : cBuiltins + cEntries;
+        if (i >= iBase + cSymbols)
+            continue;
+
+        uint32_t j = R_MAX(i - iBase, NameIndexLowerBound(NULL, pauSymbols, cSymbols, pszPrefix, cchPrefix));
+        for (; j < cSymbols; j++)
+        {
+            const char *pszName = SymTableName(&g_SymTable, pauSymbols[j]);
+            if (StrNCmp(pszName, pszPrefix, cchPrefix))
+                break;
+            if (NameIndexIsDefined(pauSymbols[j]))
+            {
+                *piEnd = iBase + j + 1;
+                return pszName;
+            }
+        }
+        i = iBase + cSymbols;
+    }
+
+    *piEnd = i;
+    return NULL;
+}
+
+
+/**
+ * Returns the syntax and description of a function.
+ *
+ * @return  RINF_SUCCESS on success, othwerise appropriate status code.
+ * @param   uIndex      The index of the requested function.
+ * @param   ppszName    Where to store the name of the function, caller frees with StrFree()
+ * @param   ppszSyntax  Where to store the syntax for the function, caller frees with StrFree()
+ * @param   ppszHelp    Where to store the description for the function, caller frees with StreFree()
+ */
+int EvaluatorFunctionHelp(unsigned uIndex, char **ppszName, char **ppszSyntax, char **ppszHelp)
+{
+    if (uIndex > g_cFunctions)
+        return RERR_NO_DATA;
+
+    *ppszName   = StrDup(g_paSortedFunctions[uIndex].pszFunction);
+    *ppszSyntax = StrDup(g_paSortedFunctions[uIndex].pszSyntax);
+    *ppszHelp   = StrDup(g_paSortedFunctions[uIndex].pszDesc);
 
-    while ((pToken = StackPop(&Stack)) != NULL)
-    {
-        DEBUGPRINTF(("PTOKEN free (U=%" FMT_U64_NAT " F=%" FMT_FLT_NAT ")\n", pToken->u.Number.uValue, pToken->u.Number.dValue));
-        MemFree(pToken);
-    }
+    return RINF_SUCCESS;
+}
 
-    DEBUGPRINTF(("Too many tokens, invalid expression\n"));
-    pEval->Result.ErrorIndex = -1;
-    return RERR_EXPRESSION_INVALID;
+/**
+ * Returns the total number of functions.
+ *
+ * @return  The total number of functions.
+ */
+unsigned EvaluatorFunctionCount(void)
+{
+    return g_cFunctions;
 }
 
 
 /**
- * Destroys the Evaluator object.
+ * Returns the total number of commands.
  *
- * @param   pEval   The Evaluator object, cannot be NULL.
+ * @return  The total number of commands.
  */
-void EvaluatorDestroy(PEVALUATOR pEval)
+unsigned EvaluatorCommandCount(void)
 {
-    /*
-     * Free the RPN queue, don't destroy the global data.
-     */
-    EvaluatorCleanUp(pEval, NULL /* pStack */);
-    pEval->u32Magic = ~(RMAG_EVALUATOR);
+    return g_cCommands;
 }
 
 
 /**
- * Initializes the Evaluator object.
+ * Returns the syntax and description of an operator.
  *
- * @return  Status code of initialization.
- * @param   pEval       The Evaluator object, cannot be NULL.
- * @param   pszError    Where to write a descriptive error if one should occur while initializing.
- * @param   cbError     Size of the @pszError buffer including NULL terminator.
+ * @return  RINF_SUCCESS on success, othwerise appropriate status code.
+ * @param   uIndex          The index of the requested operator.
+ * @param   ppszName        Where to store the name of the operator, caller frees
+ *                          with StrFree().
+ * @param   ppszSyntax      Where to store the syntax for the operator, caller frees
+ *                          with StrFree().
+ * @param   ppszHelp        Where to store the description for the operator, caller
+ *                          frees with StreFree().
  */
-int EvaluatorInit(PEVALUATOR pEval, char *pszError, size_t cbError)
+int EvaluatorOperatorHelp(unsigned uIndex, char **ppszName, char **ppszSyntax, char **ppszHelp)
 {
-    Assert(pEval);
+    if (uIndex > g_cOperators)
+        return RERR_NO_DATA;
 
-    /*
-     * Dry run of operators to detect invalid, multiple definitions and conflicts.
-     */
-    pEval->u32Magic = ~(RMAG_EVALUATOR);
-    for (unsigned i = 0; i < g_cOperators; i++)
-    {
-        PCOPERATOR pOperator = &g_aOperators[i];
-        if (   !pOperator->pszOperator
-            || !pOperator->pszSyntax
-            || !pOperator->pszDesc)
-        {
-            StrNPrintf(pszError, cbError, "Operator with missing name/syntax or description. index=%d id=%d.", i, pOperator->OperatorId);
-            return RERR_INVALID_OPERATOR;
-        }
+    *ppszName   = StrDup(g_aOperators[uIndex].pszOperator);
+    *ppszSyntax = StrDup(g_aOperators[uIndex].pszSyntax);
+    *ppszHelp   = StrDup(g_aOperators[uIndex].pszDesc);
 
-        if (isdigit(*pOperator->pszOperator) || *pOperator->pszOperator == '.')
-        {
-            StrNPrintf(pszError, cbError, "Invalid operator name '%s' at [%d] id=%d.", pOperator->pszOperator, i, pOperator->OperatorId);
-            return RERR_INVALID_OPERATOR;
-        }
+    return RINF_SUCCESS;
+}
 
-        /*
-         * Let us for now only allow Operators taking 2 or lower parameters.
-         * The evaluation logic can of course handle any number of parameters
-         * but we don't have a parameter separator for Operators unlike Functions.
-         */
-        if (pOperator->cParams > 2)
-        {
-            StrNPrintf(pszError, cbError, "Operator '%s' at [%d] exceeds maximum parameter limit of 2.", pOperator->pszOperator, i);
-            return RERR_INVALID_OPERATOR;
-        }
 
-        for (unsigned k = 0; k < g_cOperators; k++)
-        {
-            if (i == k)
-                continue;
+/**
+ * Makes room for one more entry in an array that grows as entries are added.
+ *
+ * @return  Status code.
+ * @param   ppvArray    The array.
+ * @param   pcAlloc     Number of entries allocated, updated.
+ * @param   cUsed       Number of entries used.
+ * @param   cbEntry     Size of an entry.
+ */
+int EvaluatorGrowArray(void **ppvArray, uint32_t *pcAlloc, uint32_t cUsed, size_t cbEntry)
+{
+    if (cUsed < *pcAlloc)
+        return RINF_SUCCESS;
+    if (cUsed == UINT32_MAX)
+        return RERR_NO_MEMORY;
 
-            PCOPERATOR pCur = &g_aOperators[k];
+    uint32_t const cAlloc = *pcAlloc ? (*pcAlloc <= UINT32_MAX / 2 ? *pcAlloc * 2 : UINT32_MAX) : 64;
+    void *pvArray = MemReallocTag(*ppvArray, cAlloc * cbEntry, enmMemTagVariable);
+    if (!pvArray)
+        return RERR_NO_MEMORY;
+    *ppvArray = pvArray;
+    *pcAlloc  = cAlloc;
+    return RINF_SUCCESS;
+}
 
-            /*
-             * Make sure each operator Id is unique.
-             */
-            if (pOperator->OperatorId == pCur->OperatorId)
-            {
-                StrNPrintf(pszError, cbError, "Duplicate operator Id=%d '%s' at [%d] and '%s' at [%d].", pOperator->OperatorId,
-                           pOperator->pszOperator, i, pCur->pszOperator, k);
-                return RERR_CONFLICTING_OPERATORS;
-            }
 
-            if (   !StrCmp(pOperator->pszOperator, pCur->pszOperator)
-                && pOperator->Direction == pCur->Direction)
-            {
-                if (pOperator->cParams == pCur->cParams)
-                {
-                    StrNPrintf(pszError, cbError, "Duplicate operator '%s' at [%d] and [%d].", pOperator->pszOperator, i, k);
-                    return RERR_DUPLICATE_OPERATOR;
-                }
+/**
+ * SYMIMPORT: State of a symbol import, see EvaluatorImportSymbols().
+ */
+typedef struct SYMIMPORT
+{
+    uint32_t        cImported;      /**< Number of symbols imported. */
+    uint32_t        cSkipped;       /**< Number of symbols skipped. */
+} SYMIMPORT;
+/** Pointer to the state of a symbol import. */
+typedef SYMIMPORT *PSYMIMPORT;
 
-                StrNPrintf(pszError, cbError, "Conflicting operator '%s' at [%d] and [%d].", pOperator->pszOperator, i, k);
-                return RERR_CONFLICTING_OPERATORS;
-            }
-        }
-    }
+
+/**
+ * Adds an imported symbol to the global scope as a constant, see FNSYMIMPORT.
+ */
+static int EvaluatorImportSymbol(void *pvUser, const char *pchName, size_t cchName, uint64_t uValue)
+{
+    PSYMIMPORT pImport = pvUser;
 
     /*
-     * Sort operator list to workaround overlapping operators names, eg: "++" always appears before "+".
-     * Also sort such that operators with the same name, the operator with more parameters is sorted first.
-     * For e.g. binary '-' before unary '-', the reason for this is to parse the correct operator
-     * (see EvaluatorParseOperator).
-     * Also locate open and close parenthesis.
+     * Names expressions can't refer to (e.g. "memcpy@GLIBC_2.14" or "foo.cold") and
+     * names already taken are skipped, the first symbol of a name wins.
      */
-    qsort(g_aOperators, g_cOperators, sizeof(OPERATOR), OperatorSortCompare);
-    DEBUGPRINTF(("Sorted Operators\n"));
-    PCOPERATOR pOperatorParamSeparator = NULL;
-    for (unsigned i = 0; i < g_cOperators; i++)
-    {
-        DEBUGPRINTF(("%s cParams=%d Id=%d\n", g_aOperators[i].pszOperator, g_aOperators[i].cParams, g_aOperators[i].OperatorId));
-        if (OperatorIsOpenParenthesis(&g_aOperators[i]))
-            g_pOperatorOpenParenthesis = &g_aOperators[i];
-        else if (OperatorIsCloseParenthesis(&g_aOperators[i]))
-            g_pOperatorCloseParenthesis = &g_aOperators[i];
-        else if (OperatorIsParamSeparator(&g_aOperators[i]))
-            pOperatorParamSeparator = &g_aOperators[i];
-    }
-
-    if (!g_pOperatorOpenParenthesis)
-    {
-        StrNPrintf(pszError, cbError, "Extreme error! Open parenthesis operator not found!");
-        return RERR_BASIC_OPERATOR_MISSING;
-    }
-
-    if (!g_pOperatorCloseParenthesis)
+    bool fValid =    cchName > 0
+                  && cchName < MAX_VARIABLE_NAME_LENGTH - 1
+                  && !isdigit((unsigned char)pchName[0]);
+    for (size_t i = 0; i < cchName && fValid; i++)
+        fValid = pchName[i] == '_' || isalnum((unsigned char)pchName[i]);
+
+    uint32_t uSymbol = NIL_SYMBOL;
+    if (fValid)
     {
-        StrNPrintf(pszError, cbError, "Extreme error! Close parenthesis operator not found!");
-        return RERR_BASIC_OPERATOR_MISSING;
+        int rc = SymTableIntern(&g_SymTable, pchName, cchName, &uSymbol);
+        if (RC_FAILURE(rc))
+            return rc;
     }
-
-    if (!pOperatorParamSeparator)
+    if (   !fValid
+        || ScopeFindVariable(&g_GlobalScope, uSymbol)
+        || (   g_Image.pHdr
+            && uSymbol < g_Image.cVarBySymbol
+            && g_Image.pauVarBySymbol[uSymbol]))
     {
-        StrNPrintf(pszError, cbError, "Extreme error! Parameter separator operator not found!");
-        return RERR_BASIC_OPERATOR_MISSING;
+        ++pImport->cSkipped;
+        return RINF_SUCCESS;
     }
 
     /*
-     * Check for function duplicates.
+     * The compiled expression is a single Number, nothing needs parsing.
      */
-    for (unsigned i = 0; i < g_cFunctions; i++)
+    char szExpr[sizeof("0x0123456789abcdef")];
+    StrNPrintf(szExpr, sizeof(szExpr), "0x%" FMT_U64_HEX, uValue);
+
+    PVARIABLE pVariable = MemAllocZTag(sizeof(VARIABLE), enmMemTagVariable);
+    PQUEUE pQueue       = MemAllocTag(sizeof(QUEUE), enmMemTagNode);
+    PTOKEN pToken       = MemAllocZTag(sizeof(TOKEN), enmMemTagToken);
+    char *pszExpr       = StrDup(szExpr);
+    int rc = RERR_NO_MEMORY;
+    if (   pVariable
+        && pQueue
+        && pToken
+        && pszExpr)
     {
-        PCFUNCTION pFunction = &g_aFunctions[i];
-        for (unsigned k = 0; k < g_cFunctions; k++)
+        QueueInit(pQueue);
+        pToken->Type            = enmTokenNumber;
+        pToken->u.Number.uValue = uValue;
+        pToken->u.Number.dValue = uValue;
+        rc = QueueAdd(pQueue, pToken);
+        if (RC_SUCCESS(rc))
         {
-            if (i == k)
-                continue;
-
-            PCFUNCTION pCur = &g_aFunctions[k];
-            if (!StrCmp(pCur->pszFunction, pFunction->pszFunction))
+            pToken = NULL;
+            pVariable->uSymbol    = uSymbol;
+            pVariable->fCanReinit = false;
+            rc = ScopeAssignVariable(&g_GlobalScope, pVariable, pszExpr, pQueue);
+            if (RC_SUCCESS(rc))
             {
-                StrNPrintf(pszError, cbError, "Function '%s' is duplicated. at [%d] and [%d].", pFunction->pszFunction, i, k);
-                return RERR_DUPLICATE_FUNCTION;
+                ++pImport->cImported;
+                return RINF_SUCCESS;
             }
+            EvaluatorDestroyQueue(pQueue);
+            pQueue = NULL;
         }
     }
+    MemFree(pToken);
+    MemFree(pQueue);
+    MemFree(pVariable);
+    StrFree(pszExpr);
+    return rc;
+}
 
-    /*
-     * Sort function list to workaround overlapping function names, eg: "sqr" and "sqrt".
-     */
-    qsort(g_aFunctions, g_cFunctions, sizeof(FUNCTION), FunctionSortCompare);
-    DEBUGPRINTF(("Sorted Functions\n"));
-    for (unsigned i = 0; i < g_cFunctions; i++)
-    {
-        if (   !g_aFunctions[i].pszFunction
-            || !g_aFunctions[i].pszSyntax
-            || !g_aFunctions[i].pszDesc)
-        {
-            StrNPrintf(pszError, cbError, "Function with missing name/syntax or description. index=%d.", i);
-            return RERR_INVALID_FUNCTION;
-        }
 
-        DEBUGPRINTF(("%s cMinParams=%d cMaxParams=%d\n", g_aFunctions[i].pszFunction, g_aFunctions[i].cMinParams, g_aFunctions[i].cMaxParams));
-    }
+/**
+ * Imports symbols as constants of the global scope, straight from the symbol
+ * table of an ELF file or from a System.map or nm listing, without parsing an
+ * expression for each. Symbols whose names aren't valid variable names or are
+ * already taken are skipped, as are lines of a listing that aren't symbols.
+ * Symbols imported before a failure stay.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile         The ELF file, System.map or nm listing.
+ * @param   pcImported      Where to store the number of symbols imported, optional.
+ * @param   pcSkipped       Where to store the number of symbols skipped, optional.
+ */
+int EvaluatorImportSymbols(const char *pszFile, uint32_t *pcImported, uint32_t *pcSkipped)
+{
+    SYMIMPORT Import;
+    Import.cImported = 0;
+    Import.cSkipped  = 0;
+    uint32_t cUnparsed = 0;
+    EvaluatorWriteBegin();
+    int rc = SymImportFile(pszFile, EvaluatorImportSymbol, &Import, &cUnparsed);
+    EvaluatorWriteEnd();
+    Import.cSkipped += cUnparsed;
+    if (pcImported)
+        *pcImported = Import.cImported;
+    if (pcSkipped)
+        *pcSkipped = Import.cSkipped;
+    return rc;
+}
+
+
+/**
+ * Checks whether a definition line is a plain "name = expr" Variable definition
+ * whose expression can be left unparsed until the Variable is used.
+ *
+ * @return  true if it is, false if it must be parsed right away.
+ * @param   pszLine         The line, without surrounding whitespace.
+ * @param   pcchName        Where to store the length of the name.
+ * @param   ppszExpr        Where to store the expression.
+ */
+bool EvaluatorIsPlainDefinition(const char *pszLine, size_t *pcchName, const char **ppszExpr)
+{
+    size_t cchName = 0;
+    while (   pszLine[cchName] == '_'
+           || isalnum((unsigned char)pszLine[cchName]))
+        cchName++;
+    if (   !cchName
+        || cchName >= MAX_VARIABLE_NAME_LENGTH - 1
+        || isdigit((unsigned char)pszLine[0]))
+        return false;
 
     /*
-     * Create alphabetically sorted Function list (for help listing)
+     * A Command name would be parsed as the Command.
      */
-    if (g_paSortedFunctions)
-        MemFree(g_paSortedFunctions);
-    g_paSortedFunctions = MemAlloc(sizeof(FUNCTION) * g_cFunctions);
-    if (!g_paSortedFunctions)
-        return RERR_NO_MEMORY;
+    for (unsigned i = 0; i < g_cCommands; i++)
+    {
+        if (   StrLen(g_aCommands[i].pszCommand) == cchName
+            && !StrNCmp(g_aCommands[i].pszCommand, pszLine, cchName))
+            return false;
+    }
 
-    MemCpy(g_paSortedFunctions, &g_aFunctions, sizeof(FUNCTION) * g_cFunctions);
-    qsort(g_paSortedFunctions, g_cFunctions, sizeof(FUNCTION), AscendingFunctionSortCompare);
+    const char *psz = pszLine + cchName;
+    while (isspace((unsigned char)*psz))
+        psz++;
+    if (   psz[0] != '='
+        || psz[1] == '=')
+        return false;
+    psz++;
+    while (isspace((unsigned char)*psz))
+        psz++;
+    if (!*psz)
+        return false;
 
     /*
-     * Create alphabetically sorted Command list (for help listing)
+     * Chained assignments take effect right away, leave them to the parser.
      */
-    /** @todo  */
+    for (const char *pszEq = psz; (pszEq = strchr(pszEq, '=')) != NULL; pszEq++)
+    {
+        if (   pszEq[1] != '='
+            && (pszEq == psz || !strchr("=<>!", pszEq[-1])))
+            return false;
+        if (pszEq[1] == '=')
+            pszEq++;
+    }
 
-    EvaluatorInitInternal(pEval);
-    return RINF_SUCCESS;
+    *pcchName = cchName;
+    *ppszExpr = psz;
+    return true;
 }
 
 
-/*******************************************************************************
- *   Hello, Operator?!                                                         *
- *******************************************************************************/
 
-static int OpAdd(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue + apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.dValue + apTokens[1]->u.Number.dValue;
-    return RINF_SUCCESS;
+/**
+ * Goes through the lines of a file of definitions, skipping empty lines and lines
+ * starting with '#'.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile         The file.
+ * @param   pfnLine         Called for each line.
+ * @param   pvUser          The user argument to @a pfnLine.
+ * @param   piLine          Where to store the number of the line that failed, optional.
+ */
+int EvaluatorForEachDefinition(const char *pszFile, PFNDEFINITIONLINE pfnLine, void *pvUser, uint32_t *piLine)
+{
+    FILEMAP FileMap;
+    int rc = FileMapOpen(&FileMap, pszFile);
+    if (RC_FAILURE(rc))
+        return rc;
+
+    char    *pszLine   = NULL;
+    size_t   cbLine    = 0;
+    uint32_t iLine     = 0;
+    const char *pch    = FileMap.pvData;
+    const char *pchEnd = pch + FileMap.cbData;
+    while (   pch < pchEnd
+           && RC_SUCCESS(rc))
+    {
+        const char *pchEol = MemChr(pch, '\n', (size_t)(pchEnd - pch));
+        if (!pchEol)
+            pchEol = pchEnd;
+        const char *pchLine = pch;
+        const char *pchLineEnd = pchEol;
+        pch = pchEol + 1;
+        ++iLine;
+
+        while (pchLine < pchLineEnd && isspace((unsigned char)*pchLine))
+            pchLine++;
+        while (pchLineEnd > pchLine && isspace((unsigned char)pchLineEnd[-1]))
+            pchLineEnd--;
+        if (   pchLine == pchLineEnd
+            || *pchLine == '#')
+            continue;
+
+        size_t const cchLine = pchLineEnd - pchLine;
+        if (cchLine + 1 > cbLine)
+        {
+            char *pszNew = MemReallocTag(pszLine, cchLine + 1, enmMemTagString);
+            if (!pszNew)
+            {
+                rc = RERR_NO_MEMORY;
+                break;
+            }
+            pszLine = pszNew;
+            cbLine  = cchLine + 1;
+        }
+        MemCpy(pszLine, pchLine, cchLine);
+        pszLine[cchLine] = '\0';
+
+        rc = pfnLine(pvUser, pszLine, iLine);
+    }
+
+    MemFree(pszLine);
+    FileMapClose(&FileMap);
+    if (piLine)
+        *piLine = RC_SUCCESS(rc) ? 0 : iLine;
+    return rc;
 }
 
-static int OpSubtract(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue - apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.dValue - apTokens[1]->u.Number.dValue;
-    return RINF_SUCCESS;
-}
 
-static int OpNegate(PEVALUATOR pEval, PTOKEN apTokens[])
+/**
+ * LOADDEFS: The state of loading a file of definitions.
+ */
+typedef struct LOADDEFS
 {
-    apTokens[0]->u.Number.uValue = -apTokens[0]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = -apTokens[0]->u.Number.dValue;
-    return RINF_SUCCESS;
-}
+    EVALUATOR       LineEval;       /**< The Evaluator parsing the lines. */
+    uint32_t        cDeferred;      /**< Number of Variables defined lazily. */
+    uint32_t        cParsed;        /**< Number of lines parsed right away. */
+} LOADDEFS;
+/** Pointer to the state of loading a file of definitions. */
+typedef LOADDEFS *PLOADDEFS;
 
-static int OpMultiply(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue * apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.dValue * apTokens[1]->u.Number.dValue;
-    return RINF_SUCCESS;
-}
 
-static int OpDivide(PEVALUATOR pEval, PTOKEN apTokens[])
+static int EvaluatorLoadDefinition(void *pvUser, const char *pszLine, uint32_t iLine)
 {
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue / apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.dValue / apTokens[1]->u.Number.dValue;
-    return RINF_SUCCESS;
-}
+    PLOADDEFS pLoad = pvUser;
+    NOREF(iLine);
 
-static int OpIncrement(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    ++apTokens[0]->u.Number.uValue;
-    ++apTokens[0]->u.Number.dValue;
-    return RINF_SUCCESS;
-}
+    size_t cchName;
+    const char *pszExpr;
+    if (EvaluatorIsPlainDefinition(pszLine, &cchName, &pszExpr))
+    {
+        TOKEN VarToken;
+        MemSet(&VarToken, 0, sizeof(VarToken));
+        VarToken.Type = enmTokenVariable;
+        int rc = SymTableIntern(&g_SymTable, pszLine, cchName, &VarToken.uSymbol);
+        if (RC_SUCCESS(rc))
+            rc = EvaluatorAssignVariable(&pLoad->LineEval, &VarToken, pszExpr, NULL /* pQueue */);
+        if (RC_SUCCESS(rc))
+            ++pLoad->cDeferred;
+        return rc;
+    }
 
-static int OpDecrement(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    --apTokens[0]->u.Number.uValue;
-    --apTokens[0]->u.Number.dValue;
-    return RINF_SUCCESS;
+    int rc = EvaluatorParse(&pLoad->LineEval, pszLine);
+    if (   RC_SUCCESS(rc)
+        && !pLoad->LineEval.Result.fVariableAssignment
+        && !pLoad->LineEval.Result.fFunctionDefinition)
+        rc = RERR_EXPRESSION_INVALID;
+    if (RC_SUCCESS(rc))
+        ++pLoad->cParsed;
+    return rc;
 }
 
-static int OpShiftLeft(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue << apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = (uint64_t)apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
-}
 
-static int OpShiftRight(PEVALUATOR pEval, PTOKEN apTokens[])
+/**
+ * Loads a file of definitions, one per line. Plain Variable definitions ("name =
+ * expr") only record the expression, which is parsed when the Variable is first
+ * used, so loading costs little however many there are and a broken expression
+ * is reported when used (or by the "check" Command). Other lines, e.g. Function
+ * definitions, are parsed right away and must define something. Empty lines and
+ * lines starting with '#' are skipped. Definitions before a failure stay. The
+ * file is a single batch of assignments, evaluations see all of it or none.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile         The file.
+ * @param   pcDeferred      Where to store the number of Variables defined lazily, optional.
+ * @param   pcParsed        Where to store the number of lines parsed right away, optional.
+ * @param   piLine          Where to store the number of the line that failed, optional.
+ */
+int EvaluatorLoadDefinitions(const char *pszFile, uint32_t *pcDeferred, uint32_t *pcParsed, uint32_t *piLine)
 {
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue >> apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = (uint64_t)apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
+    LOADDEFS Load;
+    EvaluatorInitInternal(&Load.LineEval);
+    Load.cDeferred = 0;
+    Load.cParsed   = 0;
+    EvaluatorWriteBegin();
+    int rc = EvaluatorForEachDefinition(pszFile, EvaluatorLoadDefinition, &Load, piLine);
+    EvaluatorWriteEnd();
+    EvaluatorDestroy(&Load.LineEval);
+    if (pcDeferred)
+        *pcDeferred = Load.cDeferred;
+    if (pcParsed)
+        *pcParsed = Load.cParsed;
+    return rc;
 }
 
-static int OpBitNegate(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = ~apTokens[0]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = (uint64_t)apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
-}
 
-static int OpModulo(PEVALUATOR pEval, PTOKEN apTokens[])
+/**
+ * Notes a lazily defined Variable that fails to parse, see EvaluatorCheckVariables().
+ */
+static void EvaluatorCheckNoteInvalid(PCVARIABLE pVariable, uint32_t *pcInvalid, char *pszInvalid, size_t cbInvalid,
+                                      size_t *poffInvalid)
 {
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue % apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
+    ++*pcInvalid;
+    if (*poffInvalid < cbInvalid)
+    {
+        int cch = StrNPrintf(pszInvalid + *poffInvalid, cbInvalid - *poffInvalid, "%s%s", *poffInvalid ? " " : "",
+                             VariableName(pVariable));
+        if (cch > 0)
+            *poffInvalid += (size_t)cch;
+    }
 }
 
-static int OpLessThan(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = !!(apTokens[0]->u.Number.uValue < apTokens[1]->u.Number.uValue);
-    apTokens[0]->u.Number.dValue = (long double)DefinitelyLessThan(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    return RINF_SUCCESS;
-}
 
-static int OpGreaterThan(PEVALUATOR pEval, PTOKEN apTokens[])
+/**
+ * Parses the expressions of the lazily defined Variables of the current and the
+ * global scope and of the loaded image that haven't been used yet, so broken
+ * definitions show up without having to use everything.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code. Variables
+ *          that fail to parse don't fail the check, they're counted and named.
+ * @param   pcChecked   Where to store the number of Variables parsed.
+ * @param   pcInvalid   Where to store the number of Variables that failed to parse.
+ * @param   pszInvalid  Where to store the names of the Variables that failed to
+ *                      parse, separated by spaces and truncated to fit.
+ * @param   cbInvalid   Size of @a pszInvalid.
+ */
+int EvaluatorCheckVariables(uint32_t *pcChecked, uint32_t *pcInvalid, char *pszInvalid, size_t cbInvalid)
 {
-    apTokens[0]->u.Number.uValue = !!(apTokens[0]->u.Number.uValue > apTokens[1]->u.Number.uValue);
-    apTokens[0]->u.Number.dValue = (long double)DefinitelyGreaterThan(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    return RINF_SUCCESS;
-}
+    AssertReturn(pcChecked, RERR_INVALID_PARAMETER);
+    AssertReturn(pcInvalid, RERR_INVALID_PARAMETER);
+    AssertReturn(pszInvalid, RERR_INVALID_PARAMETER);
+    AssertReturn(cbInvalid > 0, RERR_INVALID_PARAMETER);
 
-static int OpEqualTo(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = !!(apTokens[0]->u.Number.uValue == apTokens[1]->u.Number.uValue);
-    apTokens[0]->u.Number.dValue = (long double)EssentiallyEqual(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    return RINF_SUCCESS;
-}
+    *pcChecked = 0;
+    *pcInvalid = 0;
+    *pszInvalid = '\0';
+    size_t offInvalid = 0;
 
-static int OpLessThanOrEqualTo(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = !!(apTokens[0]->u.Number.uValue <= apTokens[1]->u.Number.uValue);
-    bool const fLessThan = DefinitelyLessThan(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    bool const fEqualTo  = EssentiallyEqual(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    apTokens[0]->u.Number.dValue = (long double)(fLessThan || fEqualTo);
-    return RINF_SUCCESS;
-}
+    /*
+     * Variables of the image that were saved lazily are taken into the global scope first.
+     */
+    int rc = RINF_SUCCESS;
+    EvaluatorWriteBegin();
+    PCIMAGEHDR pHdr = g_Image.pHdr;
+    for (uint32_t i = 0; pHdr && i < pHdr->cVars && RC_SUCCESS(rc); i++)
+    {
+        uint32_t const uSymbol = g_Image.pauSymbols[g_Image.paVars[i].iName];
+        if (   g_Image.pauVarBySymbol[uSymbol] == i + 1
+            && !g_Image.paVars[i].cTokens
+            && !ImageFindVariable(uSymbol))
+            rc = RERR_NO_MEMORY;
+    }
 
-static int OpGreaterThanOrEqualTo(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = !!(apTokens[0]->u.Number.uValue >= apTokens[1]->u.Number.uValue);
-    bool const fGreaterThan = DefinitelyGreaterThan(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    bool const fEqualTo = EssentiallyEqual(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    apTokens[0]->u.Number.dValue = (long double)(fGreaterThan || fEqualTo);
-    return RINF_SUCCESS;
+    PVARSCOPE apScopes[2] = { g_pScope, &g_GlobalScope };
+    unsigned const cScopes = g_pScope != &g_GlobalScope ? 2 : 1;
+    for (unsigned iScope = 0; iScope < cScopes && RC_SUCCESS(rc); iScope++)
+    {
+        for (PLISTITEM pNode = apScopes[iScope]->VarList.pHead; pNode; pNode = pNode->pNext)
+        {
+            PVARIABLE pVariable = pNode->pvData;
+            PVARDEF pDef = VariableDef(pVariable);
+            if (pDef->pvRPNQueue)
+                continue;
+
+            int rc2 = EvaluatorCompileVariable(pVariable, pDef);
+            if (rc2 == RERR_NO_MEMORY)
+            {
+                rc = rc2;
+                break;
+            }
+            ++*pcChecked;
+            if (RC_FAILURE(rc2))
+                EvaluatorCheckNoteInvalid(pVariable, pcInvalid, pszInvalid, cbInvalid, &offInvalid);
+        }
+    }
+    EvaluatorWriteEnd();
+    return rc;
 }
 
-static int OpNotEqualTo(PEVALUATOR pEval, PTOKEN apTokens[])
+
+/**
+ * Gets the value of a Variable if it's a constant, i.e. its compiled expression
+ * is a single Number.
+ *
+ * @return  true if the Variable is a constant, false otherwise.
+ * @param   uSymbol     Symbol Id of the name of the Variable, looked up in the
+ *                      global scope and then the loaded image.
+ * @param   puValue     Where to store the value.
+ */
+static bool SymIndexValue(uint32_t uSymbol, uint64_t *puValue)
 {
-    int rc = OpEqualTo(pEval, apTokens);
-    if (RC_SUCCESS(rc))
+    PVARIABLE pVariable = ScopeFindVariable(&g_GlobalScope, uSymbol);
+    if (pVariable)
     {
-        apTokens[0]->u.Number.uValue = !apTokens[0]->u.Number.uValue;
-        apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+        PVARDEF pDef = VariableDef(pVariable);
+        if (RC_FAILURE(EvaluatorCompileVariable(pVariable, pDef)))
+            return false;
+        PCQUEUE pQueue = pDef->pvRPNQueue;
+        if (   pVariable->fPredefined
+            || !pQueue
+            || pQueue->cItems != 1)
+            return false;
+        PCTOKEN pToken = pQueue->pHead->pvData;
+        if (pToken->Type != enmTokenNumber)
+            return false;
+        *puValue = pToken->u.Number.uValue;
+        return true;
     }
-    return RINF_SUCCESS;
-}
 
-static int OpLogicalNot(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = !apTokens[0]->u.Number.dValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
+    if (   g_Image.pHdr
+        && uSymbol < g_Image.cVarBySymbol
+        && g_Image.pauVarBySymbol[uSymbol])
+    {
+        PCIMAGEVAR pImgVar = &g_Image.paVars[g_Image.pauVarBySymbol[uSymbol] - 1];
+        if (pImgVar->cTokens != 1)
+            return false;
+        PCIMAGETOKEN pImgToken = &g_Image.paTokens[pImgVar->iToken];
+        if (   pImgToken->Type != enmTokenNumber
+            || pImgToken->uData >= g_Image.pHdr->cNumbers)
+            return false;
+        *puValue = g_Image.paNumbers[pImgToken->uData].uValue;
+        return true;
+    }
+    return false;
 }
 
-static int OpBitwiseAnd(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue & apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
-}
 
-static int OpBitwiseXor(PEVALUATOR pEval, PTOKEN apTokens[])
+/**
+ * Notes that a Variable of the global scope was assigned, the next lookup merges
+ * it into the index.
+ *
+ * @param   uSymbol     Symbol Id of the name of the Variable.
+ */
+static void SymIndexNoteVariable(uint32_t uSymbol)
 {
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue ^ apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
-}
+    if (!g_SymIndex.fValid)
+        return;
 
-static int OpBitwiseOr(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = apTokens[0]->u.Number.uValue | apTokens[1]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
-}
+    /*
+     * Merging costs as much as the index, past a point building it again is as cheap.
+     */
+    if (g_SymIndex.cPending >= R_MAX(g_SymIndex.cEntries, 1024))
+    {
+        SymIndexInvalidate();
+        return;
+    }
 
-static int OpLogicalAnd(PEVALUATOR pEval, PTOKEN apTokens[])
-{
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue && apTokens[1]->u.Number.dValue);
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
+    if (g_SymIndex.cPending == g_SymIndex.cPendingAlloc)
+    {
+        uint32_t const cAlloc = R_MAX(g_SymIndex.cPendingAlloc * 2, 64);
+        uint32_t *pauPending = MemReallocTag(g_SymIndex.pauPending, cAlloc * sizeof(uint32_t), enmMemTagVariable);
+        if (!pauPending)
+        {
+            SymIndexInvalidate();
+            return;
+        }
+        g_SymIndex.pauPending    = pauPending;
+        g_SymIndex.cPendingAlloc = cAlloc;
+    }
+    g_SymIndex.pauPending[g_SymIndex.cPending++] = uSymbol;
 }
 
-static int OpLogicalOr(PEVALUATOR pEval, PTOKEN apTokens[])
+
+/**
+ * Throws away the index, the next lookup builds it again.
+ */
+void SymIndexInvalidate(void)
 {
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue || apTokens[1]->u.Number.dValue);
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
-    return RINF_SUCCESS;
+    g_SymIndex.fValid   = false;
+    g_SymIndex.cPending = 0;
+    g_SymIndex.cDelta   = 0;
+    g_SymIndex.cStale   = 0;
 }
 
 
 /**
- * Searches the global list of function for commands.
- * @todo later this must probably be part of a Evaluator object so that
- * it may find variables? Probably but that's after I implemented proper
- * variable support.
- *
- * @return  Pointer to the full command
- * @param   pszCommand  Partial command to search for.
- * @param   cchCommand  Number of characters in command to search. Usually this is
- *                      the string length since @a pszCommand itself is partial.
- * @param   iStart      Starting index to search from.
- * @param   piEnd       Where to store the last index from the search.
+ * Compares reverse lookup index entries by value and then Symbol Id, for qsort().
  */
-const char *EvaluatorFindFunction(const char *pszCommand, uint32_t cchCommand, uint32_t iStart, uint32_t *piEnd)
+static int SymIndexCompare(const void *pv1, const void *pv2)
 {
-    for (uint32_t i = iStart; i < g_cFunctions; i++)
-    {
-        PCFUNCTION pFunction = &g_aFunctions[i];
-        if (!pFunction)
-            break;
-
-        *piEnd = i + 1;
-        if (!StrNCmp(pszCommand, pFunction->pszFunction, cchCommand))
-            return pFunction->pszFunction;
-    }
-
-    return NULL;
+    PCSYMINDEXENTRY pEntry1 = pv1;
+    PCSYMINDEXENTRY pEntry2 = pv2;
+    if (pEntry1->uValue != pEntry2->uValue)
+        return pEntry1->uValue < pEntry2->uValue ? -1 : 1;
+    if (pEntry1->uSymbol != pEntry2->uSymbol)
+        return pEntry1->uSymbol < pEntry2->uSymbol ? -1 : 1;
+    return 0;
 }
 
 
 /**
- * Returns the syntax and description of a function.
+ * Merges sorted entries into a sorted array of entries, dropping duplicates.
  *
- * @return  RINF_SUCCESS on success, othwerise appropriate status code.
- * @param   uIndex      The index of the requested function.
- * @param   ppszName    Where to store the name of the function, caller frees with StrFree()
- * @param   ppszSyntax  Where to store the syntax for the function, caller frees with StrFree()
- * @param   ppszHelp    Where to store the description for the function, caller frees with StreFree()
+ * @return  Status code.
+ * @param   ppaEntries  The array to merge into, replaced by the merged array.
+ * @param   pcEntries   Number of entries in the array, updated.
+ * @param   paNew       The new entries, sorted.
+ * @param   cNew        Number of new entries.
  */
-int EvaluatorFunctionHelp(unsigned uIndex, char **ppszName, char **ppszSyntax, char **ppszHelp)
+static int SymIndexMerge(PSYMINDEXENTRY *ppaEntries, uint32_t *pcEntries, PCSYMINDEXENTRY paNew, uint32_t cNew)
 {
-    if (uIndex > g_cFunctions)
-        return RERR_NO_DATA;
+    PCSYMINDEXENTRY paOld = *ppaEntries;
+    uint32_t const  cOld  = *pcEntries;
+    PSYMINDEXENTRY paMerged = MemAllocTag(((size_t)cOld + cNew + 1) * sizeof(SYMINDEXENTRY), enmMemTagVariable);
+    if (!paMerged)
+        return RERR_NO_MEMORY;
 
-    *ppszName   = StrDup(g_paSortedFunctions[uIndex].pszFunction);
-    *ppszSyntax = StrDup(g_paSortedFunctions[uIndex].pszSyntax);
-    *ppszHelp   = StrDup(g_paSortedFunctions[uIndex].pszDesc);
+    uint32_t iOld = 0;
+    uint32_t iNew = 0;
+    uint32_t cMerged = 0;
+    while (iOld < cOld || iNew < cNew)
+    {
+        PCSYMINDEXENTRY pEntry;
+        if (   iNew == cNew
+            || (iOld < cOld && SymIndexCompare(&paOld[iOld], &paNew[iNew]) <= 0))
+            pEntry = &paOld[iOld++];
+        else
+            pEntry = &paNew[iNew++];
+        if (   !cMerged
+            || SymIndexCompare(&paMerged[cMerged - 1], pEntry))
+            paMerged[cMerged++] = *pEntry;
+    }
 
+    MemFree(*ppaEntries);
+    *ppaEntries = paMerged;
+    *pcEntries  = cMerged;
     return RINF_SUCCESS;
 }
 
+
 /**
- * Returns the total number of functions.
+ * Brings the index up to date, building it if needed or merging in the Variables
+ * assigned since the last lookup.
  *
- * @return  The total number of functions.
+ * @return  Status code.
  */
-unsigned EvaluatorFunctionCount(void)
+static int SymIndexUpdate(void)
 {
-    return g_cFunctions;
+    if (   g_SymIndex.fValid
+        && !g_SymIndex.cPending)
+        return RINF_SUCCESS;
+
+    bool const fRebuild = !g_SymIndex.fValid;
+    size_t cMax = g_SymIndex.cPending;
+    if (fRebuild)
+        cMax = ListSize(&g_GlobalScope.VarList) + (g_Image.pHdr ? g_Image.pHdr->cVars : 0);
+    PSYMINDEXENTRY paNew = MemAllocTag((cMax + 1) * sizeof(SYMINDEXENTRY), enmMemTagVariable);
+    if (!paNew)
+        return RERR_NO_MEMORY;
+
+    uint32_t cNew = 0;
+    if (fRebuild)
+    {
+        for (PCLISTITEM pNode = g_GlobalScope.VarList.pHead; pNode; pNode = pNode->pNext)
+        {
+            PCVARIABLE pVariable = pNode->pvData;
+            if (SymIndexValue(pVariable->uSymbol, &paNew[cNew].uValue))
+                paNew[cNew++].uSymbol = pVariable->uSymbol;
+        }
+        for (uint32_t i = 0; g_Image.pHdr && i < g_Image.pHdr->cVars; i++)
+        {
+            uint32_t const uSymbol = g_Image.pauSymbols[g_Image.paVars[i].iName];
+            if (   g_Image.pauVarBySymbol[uSymbol] == i + 1
+                && SymIndexValue(uSymbol, &paNew[cNew].uValue))
+                paNew[cNew++].uSymbol = uSymbol;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < g_SymIndex.cPending; i++)
+        {
+            if (SymIndexValue(g_SymIndex.pauPending[i], &paNew[cNew].uValue))
+                paNew[cNew++].uSymbol = g_SymIndex.pauPending[i];
+        }
+    }
+
+    qsort(paNew, cNew, sizeof(SYMINDEXENTRY), SymIndexCompare);
+    int rc;
+    if (fRebuild)
+    {
+        MemFree(g_SymIndex.paEntries);
+        g_SymIndex.paEntries = NULL;
+        g_SymIndex.cEntries  = 0;
+        g_SymIndex.cDelta    = 0;
+        g_SymIndex.cStale    = 0;
+        rc = SymIndexMerge(&g_SymIndex.paEntries, &g_SymIndex.cEntries, paNew, cNew);
+    }
+    else
+    {
+        /*
+         * Merge into the delta so a lookup after each assignment doesn't copy the
+         * whole index, the delta is merged into the index only once it's grown.
+         */
+        rc = SymIndexMerge(&g_SymIndex.paDelta, &g_SymIndex.cDelta, paNew, cNew);
+        if (   RC_SUCCESS(rc)
+            && g_SymIndex.cDelta > SYMINDEX_MAX_DELTA)
+        {
+            rc = SymIndexMerge(&g_SymIndex.paEntries, &g_SymIndex.cEntries, g_SymIndex.paDelta, g_SymIndex.cDelta);
+            if (RC_SUCCESS(rc))
+                g_SymIndex.cDelta = 0;
+        }
+    }
+    MemFree(paNew);
+    if (RC_SUCCESS(rc))
+    {
+        g_SymIndex.cPending = 0;
+        g_SymIndex.fValid   = true;
+    }
+    else
+        SymIndexInvalidate();
+    return rc;
 }
 
 
 /**
- * Returns the total number of commands.
+ * Searches sorted index entries for the Variable with the largest value at or
+ * below a value, stale entries are skipped and counted.
  *
- * @return  The total number of commands.
+ * @return  Pointer to the entry found, NULL if none.
+ * @param   paEntries   The entries, sorted.
+ * @param   cEntries    Number of entries.
+ * @param   uValue      The value to look up.
  */
-unsigned EvaluatorCommandCount(void)
+static PCSYMINDEXENTRY SymIndexSearch(PCSYMINDEXENTRY paEntries, uint32_t cEntries, uint64_t uValue)
 {
-    return g_cCommands;
+    /*
+     * Find the first entry above the value, then walk back past stale entries to the
+     * first valid entry of the nearest value.
+     */
+    uint32_t iLow  = 0;
+    uint32_t iHigh = cEntries;
+    while (iLow < iHigh)
+    {
+        uint32_t const iMid = iLow + (iHigh - iLow) / 2;
+        if (paEntries[iMid].uValue <= uValue)
+            iLow = iMid + 1;
+        else
+            iHigh = iMid;
+    }
+
+    PCSYMINDEXENTRY pFound = NULL;
+    for (uint32_t i = iLow; i-- > 0; )
+    {
+        if (   pFound
+            && paEntries[i].uValue != pFound->uValue)
+            break;
+
+        uint64_t uCurValue;
+        if (   SymIndexValue(paEntries[i].uSymbol, &uCurValue)
+            && uCurValue == paEntries[i].uValue)
+            pFound = &paEntries[i];
+        else
+            ++g_SymIndex.cStale;
+    }
+    return pFound;
 }
 
 
 /**
- * Returns the syntax and description of an operator.
+ * Looks up the Variable with the largest constant value at or below a value,
+ * e.g. the symbol an address falls in. Variables of the global scope and the
+ * loaded image whose compiled expression is a single Number are considered,
+ * predefined constants aren't. Of several Variables with the same value, the
+ * one named first wins.
  *
- * @return  RINF_SUCCESS on success, othwerise appropriate status code.
- * @param   uIndex          The index of the requested operator.
- * @param   ppszName        Where to store the name of the operator, caller frees
- *                          with StrFree().
- * @param   ppszSyntax      Where to store the syntax for the operator, caller frees
- *                          with StrFree().
- * @param   ppszHelp        Where to store the description for the operator, caller
- *                          frees with StreFree().
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   uValue          The value to look up.
+ * @param   ppszName        Where to store the name of the Variable.
+ * @param   puSymbolValue   Where to store the value of the Variable.
  */
-int EvaluatorOperatorHelp(unsigned uIndex, char **ppszName, char **ppszSyntax, char **ppszHelp)
+int EvaluatorLookupSymbol(uint64_t uValue, const char **ppszName, uint64_t *puSymbolValue)
 {
-    if (uIndex > g_cOperators)
-        return RERR_NO_DATA;
+    AssertReturn(ppszName, RERR_INVALID_PARAMETER);
+    AssertReturn(puSymbolValue, RERR_INVALID_PARAMETER);
 
-    *ppszName   = StrDup(g_aOperators[uIndex].pszOperator);
-    *ppszSyntax = StrDup(g_aOperators[uIndex].pszSyntax);
-    *ppszHelp   = StrDup(g_aOperators[uIndex].pszDesc);
+    /*
+     * The index is brought up to date lazily, evaluations on other threads may be
+     * looking up symbols too so it's done with the writers' lock.
+     */
+    EvaluatorWriteBegin();
+    int rc = SymIndexUpdate();
+    if (RC_FAILURE(rc))
+    {
+        EvaluatorWriteEnd();
+        return rc;
+    }
 
-    return RINF_SUCCESS;
+    PCSYMINDEXENTRY pFound = SymIndexSearch(g_SymIndex.paEntries, g_SymIndex.cEntries, uValue);
+    PCSYMINDEXENTRY pDelta = SymIndexSearch(g_SymIndex.paDelta, g_SymIndex.cDelta, uValue);
+    if (   pDelta
+        && (   !pFound
+            || pDelta->uValue > pFound->uValue
+            || (   pDelta->uValue == pFound->uValue
+                && pDelta->uSymbol < pFound->uSymbol)))
+        pFound = pDelta;
+    if (!pFound)
+        rc = RERR_SYMBOL_NOT_FOUND;
+    else
+    {
+        *ppszName      = SymTableName(&g_SymTable, pFound->uSymbol);
+        *puSymbolValue = pFound->uValue;
+    }
+
+    if (g_SymIndex.cStale > (g_SymIndex.cEntries + g_SymIndex.cDelta) / 2)
+        SymIndexInvalidate();
+    EvaluatorWriteEnd();
+    return rc;
 }
 
 
@@ -2415,12 +5945,23 @@ int EvaluatorOperatorHelp(unsigned uIndex, char **ppszName, char **ppszSyntax, c
  */
 int EvaluatorVariableValue(unsigned uIndex, char **ppszName, char **ppszExpr)
 {
-    if (uIndex >= ListSize(&g_VarList))
-        return RERR_NO_DATA;
-    PVARIABLE pVariable = ListItemAt(&g_VarList, uIndex);
+    /*
+     * The current scope is listed first, followed by the global scope and the image.
+     */
+    PVARSCOPE pScope = g_pScope;
+    if (   uIndex >= ListSize(&pScope->VarList)
+        && pScope != &g_GlobalScope)
+    {
+        uIndex -= ListSize(&pScope->VarList);
+        pScope = &g_GlobalScope;
+    }
+    if (uIndex >= ListSize(&pScope->VarList))
+        return ImageVariableValue(uIndex - ListSize(&pScope->VarList), ppszName, ppszExpr);
+    PVARIABLE pVariable = ListItemAt(&pScope->VarList, uIndex);
     Assert(pVariable);
-    *ppszName = StrDup(pVariable->szVariable);
-    *ppszExpr = StrDup(pVariable->pszExpr);
+    *ppszName = StrDup(VariableName(pVariable));
+    PCVARDEF pDef = VariableDef(pVariable);
+    *ppszExpr = StrDup(pDef && pDef->pszExpr ? pDef->pszExpr : "");
     return RINF_SUCCESS;
 }
 
@@ -2443,7 +5984,12 @@ unsigned EvaluatorOperatorCount(void)
  */
 int EvaluatorInitGlobals(void)
 {
-    ListInit(&g_VarList);
+    int rc = RcuInit();
+    if (RC_FAILURE(rc))
+        return rc;
+    ScopeInit(&g_GlobalScope);
+    g_pScope = &g_GlobalScope;
+    SymTableInit(&g_SymTable);
 
     static struct
     {
@@ -2483,28 +6029,40 @@ int EvaluatorInitGlobals(void)
 
     EVALUATOR SubExprEval;
     EvaluatorInitInternal(&SubExprEval);
+    EvaluatorWriteBegin();
     for (size_t i = 0; i < R_ARRAY_ELEMENTS(s_aVars); i++)
     {
-        PVARIABLE pVar = MemAlloc(sizeof(VARIABLE));
+        PVARIABLE pVar = MemAllocZTag(sizeof(VARIABLE), enmMemTagVariable);
         if (!pVar)
         {
+            EvaluatorWriteEnd();
             EvaluatorDestroy(&SubExprEval);
             EvaluatorDestroyGlobals();
             return RERR_NO_MEMORY;
         }
 
-        int rc = EvaluatorParse(&SubExprEval, s_aVars[i].pszExpr);
+        rc = EvaluatorParse(&SubExprEval, s_aVars[i].pszExpr);
+        if (RC_SUCCESS(rc))
+            rc = SymTableIntern(&g_SymTable, s_aVars[i].pszVarName, StrLen(s_aVars[i].pszVarName), &pVar->uSymbol);
         if (RC_SUCCESS(rc))
         {
-            StrCopy(pVar->szVariable, sizeof(pVar->szVariable), s_aVars[i].pszVarName);
-            pVar->pszExpr = StrDup(s_aVars[i].pszExpr);
+            char *pszExpr = StrDup(s_aVars[i].pszExpr);
+            pVar->fCanReinit = false;
+            pVar->fPredefined = true;
 
             /** @todo Transfer queue ownership to variable from SubExprEval. This is bad
              *        style, fix it later. */
-            pVar->pvRPNQueue = SubExprEval.pvRPNQueue;
-            pVar->fCanReinit = false;
+            rc = pszExpr ? ScopeAssignVariable(g_pScope, pVar, pszExpr, SubExprEval.pvRPNQueue) : RERR_NO_MEMORY;
+            if (RC_FAILURE(rc))
+            {
+                StrFree(pszExpr);
+                MemFree(pVar);
+                EvaluatorWriteEnd();
+                EvaluatorDestroy(&SubExprEval);
+                EvaluatorDestroyGlobals();
+                return rc;
+            }
             SubExprEval.pvRPNQueue = NULL;
-            ListAdd(&g_VarList, pVar);
         }
         else
         {
@@ -2513,18 +6071,19 @@ int EvaluatorInitGlobals(void)
             /*
              * Free whatever was assigned so far.
              */
-            PVARIABLE pVariable = NULL;
-            while ((pVariable = ListRemoveItemAt(&g_VarList, 0)) != NULL)
-                EvaluatorDestroyVariable(pVariable);
-
-            DEBUGPRINTF(("Failed to parse expression for variable '%s' expr='%s' i=%u\n", pVar->szVariable, pVar->pszExpr, i));
+            DEBUGPRINTF(("Failed to parse expression for variable '%s' expr='%s' i=%u\n", s_aVars[i].pszVarName,
+                         s_aVars[i].pszExpr, (unsigned)i));
+            EvaluatorWriteEnd();
+            EvaluatorDestroy(&SubExprEval);
+            EvaluatorDestroyGlobals();
             return RERR_VARIABLE_UNDEFINED;
         }
     }
+    EvaluatorWriteEnd();
     EvaluatorDestroy(&SubExprEval);
 
 #ifdef _DEBUG
-    EvaluatorPrintVarList(&g_VarList);
+    EvaluatorPrintVarList(&g_GlobalScope.VarList);
 #endif
     return RINF_SUCCESS;
 }
@@ -2535,11 +6094,78 @@ int EvaluatorInitGlobals(void)
  */
 void EvaluatorDestroyGlobals(void)
 {
-    /*
-     * Free the queue of variables.
-     */
-    PVARIABLE pVariable = NULL;
-    while ((pVariable = ListRemoveItemAt(&g_VarList, 0)) != NULL)
-        EvaluatorDestroyVariable(pVariable);
+    ImageUnload();
+    MemFree(g_SymIndex.paEntries);
+    MemFree(g_SymIndex.paDelta);
+    MemFree(g_SymIndex.pauPending);
+    MemSet(&g_SymIndex, 0, sizeof(g_SymIndex));
+    MemFree(g_NameIndex.papszBuiltins);
+    MemFree(g_NameIndex.pauEntries);
+    MemFree(g_NameIndex.pauDelta);
+    MemSet(&g_NameIndex, 0, sizeof(g_NameIndex));
+    g_pScope = &g_GlobalScope;
+    ScopeClear(&g_GlobalScope);
+    EvaluatorArgPoolDestroy();
+    RcuTerm();
+    MemFree(g_papVarsAssigned);
+    g_papVarsAssigned    = NULL;
+    g_cVarsAssigned      = 0;
+    g_cVarsAssignedAlloc = 0;
+    SymTableDestroy(&g_SymTable);
+}
+
+
+/**
+ * Creates an empty scope for Variables and user-defined Functions, layered over
+ * the global scope. Names of the global scope can be shadowed from it but its
+ * constants cannot.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   ppScope     Where to store the scope, destroy with EvaluatorDestroyScope().
+ */
+int EvaluatorCreateScope(PVARSCOPE *ppScope)
+{
+    AssertReturn(ppScope, RERR_INVALID_PARAMETER);
+    PVARSCOPE pScope = MemAllocZTag(sizeof(VARSCOPE), enmMemTagVariable);
+    if (!pScope)
+        return RERR_NO_MEMORY;
+    ScopeInit(pScope);
+    *ppScope = pScope;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a scope along with its Variables and user-defined Functions. If it's
+ * the current scope, the global scope becomes current.
+ *
+ * @param   pScope      The scope, can be NULL.
+ */
+void EvaluatorDestroyScope(PVARSCOPE pScope)
+{
+    if (pScope)
+    {
+        AssertReturnVoid(pScope->u32Magic == RMAG_VARSCOPE);
+        AssertReturnVoid(pScope != &g_GlobalScope);
+        if (g_pScope == pScope)
+            g_pScope = &g_GlobalScope;
+        ScopeClear(pScope);
+        MemFree(pScope);
+    }
+}
+
+
+/**
+ * Sets the scope Variables are assigned and Functions defined in.
+ *
+ * @return  The previous scope, NULL if it was the global scope.
+ * @param   pScope      The scope, NULL for the global scope.
+ */
+PVARSCOPE EvaluatorSetScope(PVARSCOPE pScope)
+{
+    Assert(!pScope || pScope->u32Magic == RMAG_VARSCOPE);
+    PVARSCOPE pOldScope = g_pScope != &g_GlobalScope ? g_pScope : NULL;
+    g_pScope = pScope ? pScope : &g_GlobalScope;
+    return pOldScope;
 }
 
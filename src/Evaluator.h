@@ -29,10 +29,11 @@
 #include "Types.h"
 #include "Queue.h"
 #include "List.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "Rcu.h"
 
 #define MAX_VARIABLE_NAME_LENGTH    128
-#define MAX_COMMAND_NAME_LENGTH     64
-#define MAX_COMMAND_RESULT_LENGTH   4096
 
 /**
  * EVALRESULT: Holds the result of a parsed/evaluated expression.
@@ -41,13 +42,14 @@ typedef struct EVALRESULT
 {
     bool            fVariableAssignment;                           /**< Whether this is a Variable assignment. */
     bool            fCommandEvaluated;                             /**< Whether this is an evaluated Command. */
-    char            szVariable[MAX_VARIABLE_NAME_LENGTH];          /**< Name of assigned Variable if any. */
-    char            szFunction[MAX_VARIABLE_NAME_LENGTH];          /**< Name of the Function if it's a single function call. */
-    char            szCommand[MAX_COMMAND_NAME_LENGTH];            /**< Name of evaluated Command if any. */
-    char            szCommandResult[MAX_COMMAND_RESULT_LENGTH];    /**< Output of the Command if it's a Command. */
-    uint64_t        uValue;                                        /**< Integer value of the parse/evaluation phase. */
-    long double     dValue;                                        /**< Float value of the parse/evaluation phase. */
-    int             ErrorIndex;                                    /**< Index into the original expression if case of an error. */
+    bool            fFunctionDefinition;                           /**< Whether this is a user-defined Function definition. */
+    const char     *pszFunction;        /**< Name of the defined Function if any, owned by the symbol table. */
+    const char     *pszVariable;        /**< Name of assigned (or offending) Variable, "" if none; owned by the symbol table. */
+    const char     *pszCommand;         /**< Name of evaluated Command if any, owned by the command table. */
+    char           *pszCommandResult;   /**< Output of the Command if any, owned by the result and freed on the next parse. */
+    uint64_t        uValue;             /**< Integer value of the parse/evaluation phase. */
+    long double     dValue;             /**< Float value of the parse/evaluation phase. */
+    int             ErrorIndex;         /**< Index into the original expression if case of an error. */
 } EVALRESULT;
 /** Pointer to an evaluation result. */
 typedef EVALRESULT *PEVALRESULT;
@@ -55,6 +57,48 @@ typedef EVALRESULT *PEVALRESULT;
 typedef const EVALRESULT *PCCEVALRESULT;
 
 
+/**
+ * Called with the result of each Variable of a worksheet, see EvaluatorSheetUpdate().
+ *
+ * @return  Status code, a failure stops the reporting and is returned by
+ *          EvaluatorSheetUpdate().
+ * @param   pvUser      The user argument passed to EvaluatorSheetUpdate().
+ * @param   pszVariable Name of the Variable.
+ * @param   rc          Status of its evaluation.
+ * @param   pResult     Its value, or on failure the name of the offending Variable.
+ */
+typedef int FNEVALSHEETRESULT(void *pvUser, const char *pszVariable, int rc, PCCEVALRESULT pResult);
+/** Pointer to a worksheet result callback. */
+typedef FNEVALSHEETRESULT *PFNEVALSHEETRESULT;
+
+/**
+ * EVALSHEETSTATS: What an update of a worksheet did, see EvaluatorSheetUpdate().
+ */
+typedef struct EVALSHEETSTATS
+{
+    uint32_t        cVars;              /**< Number of Variables of the file. */
+    uint32_t        cFailed;            /**< Number of Variables of the file that failed to evaluate. */
+    uint32_t        cReported;          /**< Number of Variables of the file whose result changed. */
+    uint32_t        cEvaluated;         /**< Number of Variables evaluated, those the file uses included. */
+    uint32_t        cLevels;            /**< Number of levels evaluated one after another. */
+    uint32_t        cThreads;           /**< Number of threads used. */
+    uint32_t        iLine;              /**< Number of the line of the file that failed to load, 0 if none. */
+} EVALSHEETSTATS;
+/** Pointer to worksheet update statistics. */
+typedef EVALSHEETSTATS *PEVALSHEETSTATS;
+
+/** A worksheet kept up to date with its file, opaque, see EvaluatorSheetCreate(). */
+typedef struct EVALSHEET *PEVALSHEET;
+
+
+/** VARSCOPE: Variables and user-defined Functions visible to expressions, see EvaluatorCreateScope(). */
+typedef struct VARSCOPE VARSCOPE;
+/** Pointer to a scope. */
+typedef VARSCOPE *PVARSCOPE;
+/** Pointer to a const scope. */
+typedef const VARSCOPE *PCVARSCOPE;
+
+
 /**
  * EVALUATOR: The main evaluator object.
  */
@@ -64,7 +108,24 @@ typedef struct EVALUATOR
     EVALRESULT      Result;         /**< The result of the last parse/evaluation pass. */
     const char     *pszExpr;        /**< The current expression. */
     void           *pvRPNQueue;     /**< Internal RPN representation (Queue) done by the parse phase. */
-    LIST            VarList;        /**< List of Variables being evaluated, used for circular dependency prevention. */
+    const uint32_t *pauParams;      /**< Symbol Ids of the parameters while parsing a user-defined Function body, otherwise NULL. */
+    uint32_t        cParams;        /**< Number of entries in @a pauParams. */
+    uint32_t        cCallDepth;     /**< Nesting depth of user-defined Function calls. */
+    uint64_t        cMaxSteps;      /**< Step budget of an evaluation, 0 for unlimited. */
+    uint64_t        cMaxMilliSecs;  /**< Wall-clock budget of an evaluation in milliseconds, 0 for unlimited. */
+    uint64_t        cSteps;         /**< Steps consumed by the evaluation in progress. */
+    uint64_t        uDeadline;      /**< Deadline (TimestampNanoSecs) of the evaluation in progress, 0 for none. */
+    struct NUMBER  *paVarValues;    /**< Values of the Variables (by Symbol Id) resolved by the evaluation in progress. */
+    uint32_t       *pbmVarActive;   /**< Bitmap of Variables (by Symbol Id) being resolved by the evaluation in progress. */
+    uint32_t       *pbmVarDone;     /**< Bitmap of Variables (by Symbol Id) already resolved by the evaluation in progress. */
+    uint32_t        cVarBitmapWords;/**< Size of each Variable bitmap in 32-bit words. */
+    bool            fVarBitmapsDirty;/**< Whether the Variable bitmaps need clearing before the next evaluation. */
+    uint32_t        cVarNesting;    /**< Nesting depth of EvaluatorEvaluateVariable() calls. */
+    PEVALSTATS      pStats;         /**< Where to accumulate instrumentation, NULL when disabled. */
+    bool            fProfile;       /**< Whether to time Operators, Functions and Commands (calls are always counted). */
+    PTRACE          pTrace;         /**< Where to record the timeline of parsing and evaluation, NULL when disabled. */
+    bool            fConcurrent;    /**< Whether other threads evaluate at the same time, the shared profiles are left alone then. */
+    RCUREADER       RcuReader;      /**< Reader of the Variables, evaluations see them as they were when they started. */
 } EVALUATOR;
 /** Pointer to an evaluator. */
 typedef EVALUATOR *PEVALUATOR;
@@ -74,13 +135,33 @@ typedef const EVALUATOR *PCEVALUATOR;
 
 int         EvaluatorInitGlobals(void);
 void        EvaluatorDestroyGlobals(void);
+int         EvaluatorCreateScope(PVARSCOPE *ppScope);
+void        EvaluatorDestroyScope(PVARSCOPE pScope);
+PVARSCOPE   EvaluatorSetScope(PVARSCOPE pScope);
 
 int         EvaluatorInit(PEVALUATOR pEval, char *pszError, size_t cbError);
 void        EvaluatorDestroy(PEVALUATOR pEval);
 int         EvaluatorParse(PEVALUATOR pEval, const char *pszExpr);
 int         EvaluatorEvaluate(PEVALUATOR pEval);
+void        EvaluatorSetBudget(PEVALUATOR pEval, uint64_t cMaxSteps, uint64_t cMaxMilliSecs);
+void        EvaluatorCancel(void);
+int         EvaluatorFormatProfile(PCEVALUATOR pEval, uint32_t cMaxEntries, char *pszBuf, size_t cbBuf);
+void        EvaluatorResetProfile(void);
+int         EvaluatorExplain(PEVALUATOR pEval, const char *pszExpr, char **ppszExplain);
+int         EvaluatorSaveImage(const char *pszFile, uint32_t *pcVars, uint32_t *pcFunctions);
+int         EvaluatorLoadImage(const char *pszFile, uint32_t *pcVars, uint32_t *pcFunctions);
+int         EvaluatorPublishImage(const char *pszName, uint32_t *pcVars, uint32_t *pcFunctions);
+int         EvaluatorUnpublishImage(const char *pszName);
+int         EvaluatorAttachImage(const char *pszName, uint32_t *pcVars, uint32_t *pcFunctions);
+int         EvaluatorImportSymbols(const char *pszFile, uint32_t *pcImported, uint32_t *pcSkipped);
+int         EvaluatorLookupSymbol(uint64_t uValue, const char **ppszName, uint64_t *puSymbolValue);
+int         EvaluatorLoadDefinitions(const char *pszFile, uint32_t *pcDeferred, uint32_t *pcParsed, uint32_t *piLine);
+int         EvaluatorCheckVariables(uint32_t *pcChecked, uint32_t *pcInvalid, char *pszInvalid, size_t cbInvalid);
+int         EvaluatorSheetCreate(PCEVALUATOR pEval, const char *pszFile, uint32_t cThreads, PEVALSHEET *ppSheet);
+int         EvaluatorSheetUpdate(PEVALSHEET pSheet, PFNEVALSHEETRESULT pfnResult, void *pvUser, PEVALSHEETSTATS pStats);
+void        EvaluatorSheetDestroy(PEVALSHEET pSheet);
 
-const char *EvaluatorFindFunction(const char *pszCommand, uint32_t cchCommand, uint32_t iStart, uint32_t *piEnd);
+const char *EvaluatorFindCompletion(const char *pszPrefix, uint32_t cchPrefix, uint32_t iStart, uint32_t *piEnd);
 unsigned    EvaluatorFunctionCount(void);
 int         EvaluatorFunctionHelp(unsigned uIndex, char **ppszName, char **ppszSyntax, char **ppszHelp);
 unsigned    EvaluatorOperatorCount(void);
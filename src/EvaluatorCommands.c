@@ -42,10 +42,18 @@
 # define R_SPACECHAR     ' '
 #endif
 
+/** Size of the buffer allocated for a formatted Command result. */
+#define MAX_COMMAND_RESULT_LENGTH   4096UL
 /** Minimum width of 'long name' field while formatting registers. */
 #define R_LONG_NAME_FIELD_MIN       23UL
 /** Minimum width of the 'name' field while formatting registers. */
 #define R_NAME_FIELD_MIN            2UL
+/** Number of entries listed by the profile command by default. */
+#define R_PROFILE_ENTRIES_DEFAULT   10U
+/** Maximum number of entries listed by the profile command. */
+#define R_PROFILE_ENTRIES_MAX       1024U
+/** Space reserved per entry while formatting the profile. */
+#define R_PROFILE_ENTRY_LENGTH      96U
 
 
 /**
@@ -611,6 +619,133 @@ static int FnCSAttr(PEVALUATOR pEval, PTOKEN pToken, char **ppszResult)
 }
 
 
+static int FnProfile(PEVALUATOR pEval, PTOKEN pToken, char **ppszResult)
+{
+    /*
+     * A count of 0 resets the profile, otherwise it's the number of entries to list.
+     */
+    uint64_t const cEntries = pToken ? pToken->u.Number.uValue : R_PROFILE_ENTRIES_DEFAULT;
+    if (!cEntries)
+    {
+        EvaluatorResetProfile();
+        *ppszResult = StrDup("Profile reset.");
+        return *ppszResult ? RINF_SUCCESS : RERR_NO_MEMORY;
+    }
+
+    uint32_t const cMaxEntries = (uint32_t)R_MIN(cEntries, R_PROFILE_ENTRIES_MAX);
+    size_t const cbBuf = (cMaxEntries + 2) * R_PROFILE_ENTRY_LENGTH;
+    char *pszBuf = MemAlloc(cbBuf);
+    if (!pszBuf)
+        return RERR_NO_MEMORY;
+
+    int rc = EvaluatorFormatProfile(pEval, cMaxEntries, pszBuf, cbBuf);
+    if (RC_SUCCESS(rc))
+        *ppszResult = pszBuf;
+    else
+        MemFree(pszBuf);
+    return rc;
+}
+
+
+/**
+ * Formats one row of the memory accounting.
+ *
+ * @return  Number of characters written, or that would've been written.
+ * @param   pszBuf      Where to format the row.
+ * @param   cbBuf       Size of @a pszBuf.
+ * @param   pszName     Name of the row.
+ * @param   pTagStats   The accounting.
+ */
+static size_t FormatMemRow(char *pszBuf, size_t cbBuf, const char *pszName, PCMEMTAGSTATS pTagStats)
+{
+    return StrNPrintf(pszBuf, cbBuf, "%-10s %12" FMT_U64_NAT " %10" FMT_U64_NAT " %14" FMT_U64_NAT " %14" FMT_U64_NAT "\n",
+                      pszName, pTagStats->cAllocs, pTagStats->cLive, pTagStats->cbLive, pTagStats->cbPeak);
+}
+
+
+static int FnMem(PEVALUATOR pEval, PTOKEN pToken, char **ppszResult)
+{
+    NOREF(pEval);
+    NOREF(pToken);
+
+    char *pszBuf = StrAlloc(MAX_COMMAND_RESULT_LENGTH);
+    if (!pszBuf)
+        return RERR_NO_MEMORY;
+
+    MEMSTATS Stats;
+    if (!MemGetStats(&Stats))
+    {
+        StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "%" FMT_U64_NAT " allocations, the '%s' allocator keeps no accounting.\n"
+                   "Start with --mem-accounting for a breakdown.", g_cMemAllocs, g_pMemAllocator->pszName);
+        *ppszResult = pszBuf;
+        return RINF_SUCCESS;
+    }
+
+    size_t offBuf = StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "%-10s %12s %10s %14s %14s\n", "category", "allocs",
+                               "live", "live bytes", "peak bytes");
+    for (unsigned i = 0; i < enmMemTagMax && offBuf < MAX_COMMAND_RESULT_LENGTH; i++)
+        offBuf += FormatMemRow(pszBuf + offBuf, MAX_COMMAND_RESULT_LENGTH - offBuf, MemTagName((MEMTAG)i), &Stats.aTags[i]);
+    if (offBuf < MAX_COMMAND_RESULT_LENGTH)
+        FormatMemRow(pszBuf + offBuf, MAX_COMMAND_RESULT_LENGTH - offBuf, "total", &Stats.Total);
+    *ppszResult = pszBuf;
+    return RINF_SUCCESS;
+}
+
+
+static int FnSym(PEVALUATOR pEval, PTOKEN pToken, char **ppszResult)
+{
+    NOREF(pEval);
+    if (!pToken)
+        return RERR_INVALID_COMMAND_PARAMETER;
+
+    uint64_t const uValue = pToken->u.Number.uValue;
+    const char *pszName;
+    uint64_t uSymbolValue;
+    int rc = EvaluatorLookupSymbol(uValue, &pszName, &uSymbolValue);
+    if (   RC_FAILURE(rc)
+        && rc != RERR_SYMBOL_NOT_FOUND)
+        return rc;
+
+    char *pszBuf = StrAlloc(MAX_COMMAND_RESULT_LENGTH);
+    if (!pszBuf)
+        return RERR_NO_MEMORY;
+    if (rc == RERR_SYMBOL_NOT_FOUND)
+        StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "No variable at or below 0x%" FMT_U64_HEX, uValue);
+    else if (uValue == uSymbolValue)
+        StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "%s (0x%" FMT_U64_HEX ")", pszName, uValue);
+    else
+        StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "%s+0x%" FMT_U64_HEX " (0x%" FMT_U64_HEX ")", pszName,
+                   uValue - uSymbolValue, uValue);
+    *ppszResult = pszBuf;
+    return RINF_SUCCESS;
+}
+
+
+static int FnCheck(PEVALUATOR pEval, PTOKEN pToken, char **ppszResult)
+{
+    NOREF(pEval);
+    NOREF(pToken);
+
+    char szInvalid[MAX_COMMAND_RESULT_LENGTH / 2];
+    uint32_t cChecked;
+    uint32_t cInvalid;
+    int rc = EvaluatorCheckVariables(&cChecked, &cInvalid, szInvalid, sizeof(szInvalid));
+    if (RC_FAILURE(rc))
+        return rc;
+
+    char *pszBuf = StrAlloc(MAX_COMMAND_RESULT_LENGTH);
+    if (!pszBuf)
+        return RERR_NO_MEMORY;
+    if (cInvalid)
+        StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "Checked %u variables, %u invalid: %s", (unsigned)cChecked,
+                   (unsigned)cInvalid, szInvalid);
+    else
+        StrNPrintf(pszBuf, MAX_COMMAND_RESULT_LENGTH, "Checked %u variables, all valid.", (unsigned)cChecked);
+    *ppszResult = pszBuf;
+    return RINF_SUCCESS;
+}
+
+
 /**
  * g_aCommands: Table of commands.
  */
@@ -621,7 +756,11 @@ COMMAND g_aCommands[] =
     { "cr4",                            FnCr4,               "<x86reg>",      "Intel x86: CR4 register format." },
     { "eflags",                         FnEflags,            "<[e|r]flags>",  "Intel x86: EFLAGS register format." },
     { "efer",                           FnEfer,              "<x86reg>",      "Intel x86: EFER format." },
-    { "csattr",                         FnCSAttr,            "<csattr>",      "Intel x86: CS segment attributes." }
+    { "csattr",                         FnCSAttr,            "<csattr>",      "Intel x86: CS segment attributes." },
+    { "profile",                        FnProfile,           "[<count>]",     "Hottest operators and functions, 0 resets." },
+    { "mem",                            FnMem,               "",              "Heap usage by category." },
+    { "sym",                            FnSym,               "<addr>",        "Nearest variable at or below <addr> and the offset from it." },
+    { "check",                          FnCheck,             "",              "Parse variables defined but not used yet." }
 };
 
 /** Total number of commands in the table. */
@@ -0,0 +1,243 @@
+/** @file
+ * Evaluator core, shared with the image and worksheet code, internal header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVALUATOR_CORE_H___
+#define EVALUATOR_CORE_H___
+
+#include "EvaluatorInternal.h"
+#include "FileMap.h"
+#include "List.h"
+#include "Queue.h"
+#include "SymbolTable.h"
+
+#include <signal.h>
+
+/**
+ * IMAGEHDR: Header of an image of the global Variables and user-defined Functions.
+ * Images only hold offsets and indices, never pointers, so they can be mapped
+ * anywhere and shared between processes. The Number array comes right after the
+ * header, keeping it aligned for long double, and everything else is 4-byte
+ * aligned.
+ */
+typedef struct IMAGEHDR
+{
+    char            achMagic[8];    /**< IMAGE_MAGIC. */
+    uint32_t        uVersion;       /**< IMAGE_VERSION. */
+    uint32_t        uByteOrder;     /**< IMAGE_BYTE_ORDER. */
+    uint32_t        cbNumber;       /**< Size of a NUMBER, differs with the size of long double. */
+    uint32_t        cOperators;     /**< Number of Operators of the writer, Operators are stored by index. */
+    uint32_t        cNames;         /**< Number of names. */
+    uint32_t        cVars;          /**< Number of Variables. */
+    uint32_t        cFunctions;     /**< Number of user-defined Functions. */
+    uint32_t        cTokens;        /**< Number of Tokens. */
+    uint32_t        cNumbers;       /**< Number of Numbers. */
+    uint32_t        u32Reserved;    /**< Reserved, zero. */
+    uint64_t        cbImage;        /**< Size of the whole image. */
+    uint64_t        offNumbers;     /**< Offset of the NUMBER array. */
+    uint64_t        offTokens;      /**< Offset of the IMAGETOKEN array. */
+    uint64_t        offVars;        /**< Offset of the IMAGEVAR array. */
+    uint64_t        offFunctions;   /**< Offset of the IMAGEFUNC array. */
+    uint64_t        offNames;       /**< Offset of the array of name offsets into the strings. */
+    uint64_t        offStrings;     /**< Offset of the zero terminated strings. */
+    uint64_t        cbStrings;      /**< Size of the strings, the last byte is always a terminator. */
+} IMAGEHDR;
+/** Pointer to an image header. */
+typedef IMAGEHDR *PIMAGEHDR;
+/** Pointer to a const image header. */
+typedef const IMAGEHDR *PCIMAGEHDR;
+
+/**
+ * IMAGETOKEN: A Token of an image.
+ */
+typedef struct IMAGETOKEN
+{
+    uint16_t        Type;           /**< The TOKENTYPE, only Number, Operator, Function, Variable and Param. */
+    uint16_t        cFunctionParams;/**< Number of parameters to pass to a Function Token. */
+    uint32_t        Position;       /**< Cursor position. */
+    uint32_t        uData;          /**< Number index, Operator index, name index of a Function or Variable, or argument slot. */
+} IMAGETOKEN;
+#if MAX_FUNCTION_PARAMETERS > 0xffff
+# error "IMAGETOKEN::cFunctionParams is too small for MAX_FUNCTION_PARAMETERS."
+#endif
+/** Pointer to an image Token. */
+typedef IMAGETOKEN *PIMAGETOKEN;
+/** Pointer to a const image Token. */
+typedef const IMAGETOKEN *PCIMAGETOKEN;
+
+/**
+ * IMAGEVAR: A Variable of an image.
+ */
+typedef struct IMAGEVAR
+{
+    uint32_t        iName;          /**< Name index. */
+    uint32_t        offExpr;        /**< Offset of the assigned expression into the strings. */
+    uint32_t        iToken;         /**< Index of the first Token of the compiled expression. */
+    uint32_t        cTokens;        /**< Number of Tokens of the compiled expression. */
+    uint32_t        fFlags;         /**< IMAGE_VAR_F_XXX. */
+} IMAGEVAR;
+/** Pointer to an image Variable. */
+typedef IMAGEVAR *PIMAGEVAR;
+/** Pointer to a const image Variable. */
+typedef const IMAGEVAR *PCIMAGEVAR;
+
+/**
+ * IMAGEFUNC: A user-defined Function of an image.
+ */
+typedef struct IMAGEFUNC
+{
+    uint32_t        iName;          /**< Name index. */
+    uint32_t        offExpr;        /**< Offset of the definition into the strings. */
+    uint32_t        iToken;         /**< Index of the first Token of the compiled body. */
+    uint32_t        cTokens;        /**< Number of Tokens of the compiled body. */
+    uint32_t        cParams;        /**< Number of parameters. */
+} IMAGEFUNC;
+/** Pointer to an image Function. */
+typedef IMAGEFUNC *PIMAGEFUNC;
+/** Pointer to a const image Function. */
+typedef const IMAGEFUNC *PCIMAGEFUNC;
+
+/**
+ * IMAGE: The loaded image, see EvaluatorLoadImage().
+ * Its Variables are only turned into real ones the first time they're looked
+ * up, the rest stay in the mapping.
+ */
+typedef struct IMAGE
+{
+    FILEMAP         FileMap;        /**< The mapping, nothing is mapped if no image is loaded. */
+    PCIMAGEHDR      pHdr;           /**< The header, NULL if no image is loaded. */
+    PCNUMBER        paNumbers;      /**< The Numbers. */
+    PCIMAGETOKEN    paTokens;       /**< The Tokens. */
+    PCIMAGEVAR      paVars;         /**< The Variables. */
+    PCIMAGEFUNC     paFunctions;    /**< The user-defined Functions. */
+    const uint32_t *paoffNames;     /**< The names as offsets into @a pszStrings. */
+    const char     *pszStrings;     /**< The strings. */
+    uint32_t       *pauSymbols;     /**< Symbol Ids of the names by name index. */
+    uint32_t       *pauVarBySymbol; /**< 1 + index of the not yet looked up Variable by Symbol Id, 0 if none. */
+    uint32_t        cVarBySymbol;   /**< Number of entries in @a pauVarBySymbol. */
+    uint32_t        iListVar;       /**< Variable last listed by EvaluatorVariableValue(). */
+    unsigned        uListIndex;     /**< Index @a iListVar was listed as. */
+} IMAGE;
+
+/**
+ * VARTABLE: Variables of a scope. The global scope indexes them by Symbol Id, the
+ * other scopes hold a handful each and hash the Symbol Id into an open-addressing
+ * table so they don't take memory for every name ever interned. Readers may be
+ * looking up Variables in it, so rather than being grown it's replaced by a larger
+ * copy.
+ */
+typedef struct VARTABLE
+{
+    uint32_t        cVars;              /**< Number of entries, a power of 2 if @a fHashed. */
+    uint32_t        cHashed;            /**< Number of Variables if @a fHashed. */
+    bool            fHashed;            /**< Whether the entries are hashed by Symbol Id rather than indexed by it. */
+    PVARIABLE       apVars[1];          /**< Variables, NULL for unused entries (variable sized). */
+} VARTABLE;
+/** Pointer to a Variable table. */
+typedef VARTABLE *PVARTABLE;
+/** Pointer to a const Variable table. */
+typedef const VARTABLE *PCVARTABLE;
+
+/**
+ * VARSCOPE: Variables and user-defined Functions visible to expressions.
+ */
+struct VARSCOPE
+{
+    uint32_t        u32Magic;           /**< Magic (RMAG_VARSCOPE). */
+    LIST            VarList;            /**< List of Variables, used by the writer only. */
+    LIST            UserFuncList;       /**< List of user-defined Functions. */
+    PVARTABLE       pVarTable;          /**< Variables indexed by Symbol Id, NULL until the first one is added. */
+};
+
+extern VARSCOPE g_GlobalScope;
+extern SYMTABLE g_SymTable;
+extern IMAGE g_Image;
+extern volatile sig_atomic_t g_fCancelEvaluation;
+
+/**
+ * Called for each line of a file of definitions, see EvaluatorForEachDefinition().
+ *
+ * @return  Status code, a failure stops going through the file.
+ * @param   pvUser      The user argument passed to EvaluatorForEachDefinition().
+ * @param   pszLine     The line, without surrounding whitespace.
+ * @param   iLine       The number of the line.
+ */
+typedef int FNDEFINITIONLINE(void *pvUser, const char *pszLine, uint32_t iLine);
+/** Pointer to a definition line callback. */
+typedef FNDEFINITIONLINE *PFNDEFINITIONLINE;
+
+/**
+ * Returns the name of a Variable.
+ *
+ * @return  The name of the variable.
+ * @param   pVariable   The Variable.
+ */
+static inline const char *VariableName(PCVARIABLE pVariable)
+{
+    return SymTableName(&g_SymTable, pVariable->uSymbol);
+}
+
+
+static inline bool VarBitmapTest(const uint32_t *pbm, uint32_t uSymbol)
+{
+    return (pbm[uSymbol / 32] >> (uSymbol % 32)) & 1;
+}
+
+static inline void VarBitmapSet(uint32_t *pbm, uint32_t uSymbol)
+{
+    pbm[uSymbol / 32] |= UINT32_C(1) << (uSymbol % 32);
+}
+
+static inline void VarBitmapClear(uint32_t *pbm, uint32_t uSymbol)
+{
+    pbm[uSymbol / 32] &= ~(UINT32_C(1) << (uSymbol % 32));
+}
+
+
+/* Evaluator.c */
+PVARDEF     VariableDef(PCVARIABLE pVariable);
+PVARIABLE   ScopeFindVariable(PCVARSCOPE pScope, uint32_t uSymbol);
+int         ScopeAddVariable(PVARSCOPE pScope, PVARIABLE pVariable);
+PFUNCTION   ScopeFindUserFunction(PCVARSCOPE pScope, uint32_t uSymbol);
+void        EvaluatorDestroyQueue(PQUEUE pQueue);
+void        EvaluatorDestroyVariable(PVARIABLE pVariable);
+void        EvaluatorDestroyProgram(PPROGRAM pProgram);
+int         EvaluatorCompileProgram(PQUEUE pQueue, uint32_t cParams, const char *pszExpr, PPROGRAM *ppProgram);
+void        EvaluatorWriteBegin(void);
+void        EvaluatorWriteEnd(void);
+int         EvaluatorGrowArray(void **ppvArray, uint32_t *pcAlloc, uint32_t cUsed, size_t cbEntry);
+void        SymIndexInvalidate(void);
+void        EvaluatorInitInternal(PEVALUATOR pEval);
+int         EvaluatorReserveVarBitmaps(PEVALUATOR pEval);
+void        EvaluatorReadBegin(PEVALUATOR pEval);
+void        EvaluatorReadEnd(PEVALUATOR pEval);
+PVARIABLE   EvaluatorFindVariable(uint32_t uSymbol);
+int         EvaluatorAssignVariable(PEVALUATOR pEval, PCTOKEN pVarToken, const char *pszExpr, PQUEUE pQueue);
+int         EvaluatorCompileVariable(PCVARIABLE pVariable, PVARDEF pDef);
+int         EvaluatorEvaluateVariable(PEVALUATOR pEval, PCTOKEN pToken, PTOKEN pValue);
+bool        EvaluatorIsPlainDefinition(const char *pszLine, size_t *pcchName, const char **ppszExpr);
+int         EvaluatorForEachDefinition(const char *pszFile, PFNDEFINITIONLINE pfnLine, void *pvUser, uint32_t *piLine);
+
+/* EvaluatorImage.c */
+PVARIABLE   ImageFindVariable(uint32_t uSymbol);
+int         ImageVariableValue(unsigned uIndex, char **ppszName, char **ppszExpr);
+void        ImageUnload(void);
+
+#endif /* EVALUATOR_CORE_H___ */
@@ -30,749 +30,938 @@
 #include "InputOutput.h"
 
 
+/*******************************************************************************
+ *   Number and Range Token helpers                                           *
+ *******************************************************************************/
+/**
+ * Makes a Token a Range Token.
+ *
+ * @param   pToken      The Token.
+ * @param   uFirst      The first item.
+ * @param   iStep       Difference between successive items.
+ * @param   cItems      Number of items.
+ */
+static void TokenSetRange(PTOKEN pToken, uint64_t uFirst, int64_t iStep, uint64_t cItems)
+{
+    pToken->Type           = enmTokenRange;
+    pToken->u.Range.uFirst = uFirst;
+    pToken->u.Range.iStep  = iStep;
+    pToken->u.Range.cItems = cItems;
+}
+
+/**
+ * Makes a Token a Number Token.
+ *
+ * @param   pToken      The Token.
+ * @param   pNumber     The value.
+ */
+static void TokenSetNumber(PTOKEN pToken, PCNUMBER pNumber)
+{
+    pToken->Type     = enmTokenNumber;
+    pToken->u.Number = *pNumber;
+}
+
+/**
+ * Sums the items of a Number or Range Token. Ranges are summed using the closed
+ * form of the arithmetic series, n*a + d*n*(n-1)/2.
+ *
+ * @param   pToken      The Number or Range Token.
+ * @param   pSum        Where to store the sum.
+ */
+static void TokenItemSum(PCTOKEN pToken, PNUMBER pSum)
+{
+    if (TokenIsRange(pToken))
+    {
+        /*
+         * Halve whichever of n or n-1 is even so the integer part wraps exactly like adding the items would.
+         */
+        uint64_t const cItems = pToken->u.Range.cItems;
+        uint64_t const uTriangle = (cItems % 2 == 0) ? (cItems / 2) * (cItems - 1) : cItems * ((cItems - 1) / 2);
+        pSum->uValue = cItems * pToken->u.Range.uFirst + uTriangle * (uint64_t)pToken->u.Range.iStep;
+        pSum->dValue = (long double)cItems * (int64_t)pToken->u.Range.uFirst
+                     + (long double)pToken->u.Range.iStep * ((long double)cItems * (cItems - 1) / 2);
+    }
+    else
+        *pSum = pToken->u.Number;
+}
+
+/**
+ * Returns the magnitude of an integer item.
+ *
+ * @return  The absolute value.
+ * @param   pNumber     The item.
+ */
+static inline uint64_t ItemMagnitude(PCNUMBER pNumber)
+{
+    return pNumber->dValue < 0 ? -pNumber->uValue : pNumber->uValue;
+}
+
+/**
+ * Euclid's greatest common divisor.
+ *
+ * @return  GCD of @a u and @a v, 0 if both are 0.
+ * @param   u           The first number.
+ * @param   v           The second number.
+ */
+static uint64_t GCD(uint64_t u, uint64_t v)
+{
+    while (v)
+    {
+        uint64_t const t = u % v;
+        u = v;
+        v = t;
+    }
+    return u;
+}
+
+/**
+ * Finds the minimum or maximum item of Number and Range Tokens.
+ * The items of a Range are monotonic so only its first and last items matter.
+ *
+ * @return  Status code.
+ * @param   paTokens    The Tokens, result is stored in the first one.
+ * @param   cTokens     Number of Tokens.
+ * @param   fMax        Whether to find the maximum, otherwise the minimum.
+ */
+static int TokenItemMinMax(PTOKEN paTokens, uint32_t cTokens, bool fMax)
+{
+    bool fFound = false;
+    NUMBER Extreme = { 0, 0 };
+    for (uint32_t i = 0; i < cTokens; i++)
+    {
+        uint64_t const cItems = TokenItemCount(&paTokens[i]);
+        if (!cItems)
+            continue;
+
+        NUMBER aEnds[2];
+        TokenItemAt(&paTokens[i], 0, &aEnds[0]);
+        TokenItemAt(&paTokens[i], cItems - 1, &aEnds[1]);
+        for (unsigned k = 0; k < R_ARRAY_ELEMENTS(aEnds); k++)
+        {
+            if (   !fFound
+                || (fMax ? aEnds[k].dValue > Extreme.dValue : aEnds[k].dValue < Extreme.dValue))
+            {
+                Extreme = aEnds[k];
+                fFound = true;
+            }
+        }
+    }
+
+    if (!fFound)
+        return RERR_RANGE_INVALID;
+
+    TokenSetNumber(&paTokens[0], &Extreme);
+    return RINF_SUCCESS;
+}
+
+
 /*******************************************************************************
  *   Function Functions!                                                       *
  *******************************************************************************/
-static int FnSum(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSum(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    for (uint32_t i = 1; i < cTokens; i++)
+    NUMBER Sum = { 0, 0 };
+    for (uint32_t i = 0; i < cTokens; i++)
     {
-        apTokens[0]->u.Number.uValue += apTokens[i]->u.Number.uValue;
-        apTokens[0]->u.Number.dValue += apTokens[i]->u.Number.dValue;
+        NUMBER Item;
+        TokenItemSum(&paTokens[i], &Item);
+        Sum.uValue += Item.uValue;
+        Sum.dValue += Item.dValue;
     }
+    TokenSetNumber(&paTokens[0], &Sum);
     return RINF_SUCCESS;
 }
 
-static int FnAverage(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnAverage(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    int rc = FnSum(pEval, apTokens, cTokens);
+    uint64_t cItems = 0;
+    for (uint32_t i = 0; i < cTokens; i++)
+        cItems += TokenItemCount(&paTokens[i]);
+    if (!cItems)
+        return RERR_RANGE_INVALID;
+
+    int rc = FnSum(pEval, paTokens, cTokens);
     if (RC_SUCCESS(rc))
     {
-        apTokens[0]->u.Number.uValue /= cTokens;
-        apTokens[0]->u.Number.dValue /= cTokens;
+        paTokens[0].u.Number.uValue /= cItems;
+        paTokens[0].u.Number.dValue /= cItems;
     }
-    return RINF_SUCCESS;
+    return rc;
 }
 
-static int FnFactorial(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnFactorial(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    uint64_t uValue = apTokens[0]->u.Number.uValue;
+    /*
+     * The product wraps modulo 2^64 and once it has picked up 64 factors of two it stays
+     * zero, so there is no point in walking the rest of a huge argument.
+     */
+    uint64_t uValue = paTokens[0].u.Number.uValue;
     uint64_t uFact  = 1;
-    while (uValue > 1)
+    while (uValue > 1 && uFact)
     {
+        int rc = EvaluatorConsumeSteps(pEval, 1);
+        if (RC_FAILURE(rc))
+            return rc;
         uFact *= uValue;
         --uValue;
     }
-    apTokens[0]->u.Number.uValue = uFact;
-    apTokens[0]->u.Number.dValue = uFact;
+    paTokens[0].u.Number.uValue = uFact;
+    paTokens[0].u.Number.dValue = uFact;
     return RINF_SUCCESS;
 }
 
-static int FnGCD(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnGCD(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
     /*
-     * Bleh, just write something quickly now. I'll revisit this to make it
-     * more efficient later.
+     * The items of a Range are a, a+d, a+2d... which all share gcd(a, d), so a Range
+     * contributes just those two values regardless of how many items it has.
      */
-    uint64_t uMin = apTokens[0]->u.Number.uValue;
-    for (uint32_t i = 1; i < cTokens; i++)
+    uint64_t uGCD = 0;
+    for (uint32_t i = 0; i < cTokens; i++)
     {
-        uint64_t uCur = apTokens[i]->u.Number.uValue;
-        if (uMin < uCur)
-            uMin = uCur;
+        PCTOKEN pToken = &paTokens[i];
+        uint64_t const cItems = TokenItemCount(pToken);
+        if (!cItems)
+            continue;
+
+        NUMBER Item;
+        TokenItemAt(pToken, 0, &Item);
+        uGCD = GCD(uGCD, ItemMagnitude(&Item));
+        if (cItems > 1)
+        {
+            int64_t const iStep = pToken->u.Range.iStep;
+            uGCD = GCD(uGCD, iStep < 0 ? -(uint64_t)iStep : (uint64_t)iStep);
+        }
     }
 
-    bool fSet = false;
-    for (uint64_t u = uMin; u > 0; u--)
+    NUMBER Result = { uGCD, uGCD };
+    TokenSetNumber(&paTokens[0], &Result);
+    return RINF_SUCCESS;
+}
+
+static int FnLCM(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
+{
+    /*
+     * No closed form here, walk the items one at a time, each one charged to the budget.
+     * Any zero item makes the LCM zero. An LCM that no longer fits is an overflow, which
+     * also ends the walk of a huge Range after a few dozen items.
+     */
+    uint64_t uLCM = 1;
+    for (uint32_t i = 0; i < cTokens && uLCM; i++)
     {
-        if (uMin % u == 0)
+        PCTOKEN pToken = &paTokens[i];
+        uint64_t const cItems = TokenItemCount(pToken);
+        for (uint64_t k = 0; k < cItems && uLCM; k++)
         {
-            uint32_t cFactors = 0;
-            for (uint64_t k = 0; k < cTokens; k++)
-            {
-                if (apTokens[k]->u.Number.uValue % u == 0)
-                    cFactors ++;
-            }
-            if (cFactors == cTokens)
+            int rc = EvaluatorConsumeSteps(pEval, 1);
+            if (RC_FAILURE(rc))
+                return rc;
+
+            NUMBER Item;
+            TokenItemAt(pToken, k, &Item);
+            uint64_t const u = ItemMagnitude(&Item);
+            if (!u)
             {
-                apTokens[0]->u.Number.uValue = u;
-                apTokens[0]->u.Number.dValue = u;
-                fSet = true;
+                uLCM = 0;
                 break;
             }
+            uint64_t const uPart = uLCM / GCD(uLCM, u);
+            if (uPart > UINT64_MAX / u)
+                return RERR_UNDEFINED_BEHAVIOUR;
+            uLCM = uPart * u;
         }
     }
-    if (!fSet)
-    {
-        apTokens[0]->u.Number.uValue = 1;
-        apTokens[0]->u.Number.dValue = 1;
-    }
+
+    NUMBER Result = { uLCM, uLCM };
+    TokenSetNumber(&paTokens[0], &Result);
     return RINF_SUCCESS;
 }
 
-static int FnLCM(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMax(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
+    return TokenItemMinMax(paTokens, cTokens, true /* fMax */);
+}
+
+static int FnMin(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
+{
+    return TokenItemMinMax(paTokens, cTokens, false /* fMax */);
+}
+
+static int FnRange(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
+{
+    int64_t const iStart = (int64_t)paTokens[0].u.Number.uValue;
+    int64_t const iEnd   = (int64_t)paTokens[1].u.Number.uValue;
+    int64_t const iStep  = cTokens > 2 ? (int64_t)paTokens[2].u.Number.uValue : 1;
+    if (!iStep)
+        return RERR_RANGE_INVALID;
+
     /*
-     * Bleh, just write something quickly now. I'll revisit this to make it
-     * more efficient later.
+     * Half-open, <end> is never an item. A range that doesn't move towards <end> is empty.
      */
-    uint64_t uMax = apTokens[0]->u.Number.uValue;
-    uint64_t uProduct = 1;
-    for (uint32_t i = 0; i < cTokens; i++)
-    {
-        uint64_t uCur = apTokens[i]->u.Number.uValue;
-        uProduct *= uCur;
-        if (uMax > uCur)
-            uMax = uCur;
-    }
+    uint64_t cItems = 0;
+    if (iStep > 0 && iEnd > iStart)
+        cItems = ((uint64_t)iEnd - (uint64_t)iStart - 1) / (uint64_t)iStep + 1;
+    else if (iStep < 0 && iEnd < iStart)
+        cItems = ((uint64_t)iStart - (uint64_t)iEnd - 1) / -(uint64_t)iStep + 1;
 
-    bool fSet = false;
-    for (uint64_t u = uMax; u <= uProduct; u += uMax)
-    {
-        uint32_t cFactors = 0;
-        for (uint64_t k = 0; k < cTokens; k++)
-        {
-            if (u % apTokens[k]->u.Number.uValue == 0)
-                cFactors++;
-        }
-        if (cFactors == cTokens)
-        {
-            apTokens[0]->u.Number.uValue = u;
-            apTokens[0]->u.Number.dValue = u;
-            fSet = true;
-            break;
-        }
-    }
-    if (!fSet)
-    {
-        apTokens[0]->u.Number.uValue = 1;
-        apTokens[0]->u.Number.dValue = 1;
-    }
+    TokenSetRange(&paTokens[0], (uint64_t)iStart, iStep, cItems);
     return RINF_SUCCESS;
 }
 
+static int FnSeq(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
+{
+    if (paTokens[1].u.Number.dValue < 0)
+        return RERR_RANGE_INVALID;
 
-static int FnPow(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+    int64_t const iStep = cTokens > 2 ? (int64_t)paTokens[2].u.Number.uValue : 1;
+    TokenSetRange(&paTokens[0], paTokens[0].u.Number.uValue, iStep, paTokens[1].u.Number.uValue);
+    return RINF_SUCCESS;
+}
+
+
+static int FnPow(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue = powl(apTokens[0]->u.Number.dValue, apTokens[1]->u.Number.dValue);
-    apTokens[0]->u.Number.uValue = (uint64_t)(apTokens[0]->u.Number.dValue + 0.50);
+    paTokens[0].u.Number.dValue = powl(paTokens[0].u.Number.dValue, paTokens[1].u.Number.dValue);
+    paTokens[0].u.Number.uValue = (uint64_t)(paTokens[0].u.Number.dValue + 0.50);
     return RINF_SUCCESS;
 }
 
-static int FnSqrt(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSqrt(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue = powl(apTokens[0]->u.Number.dValue, (long double)0.50);
-    apTokens[0]->u.Number.uValue = (uint64_t)(apTokens[0]->u.Number.dValue + 0.50);
+    paTokens[0].u.Number.dValue = powl(paTokens[0].u.Number.dValue, (long double)0.50);
+    paTokens[0].u.Number.uValue = (uint64_t)(paTokens[0].u.Number.dValue + 0.50);
     return RINF_SUCCESS;
 }
 
-static int FnRoot(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnRoot(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue = powl(apTokens[0]->u.Number.dValue, 1 / (long double)apTokens[1]->u.Number.dValue);
-    apTokens[0]->u.Number.uValue = (uint64_t)(apTokens[0]->u.Number.dValue + 0.50);
+    paTokens[0].u.Number.dValue = powl(paTokens[0].u.Number.dValue, 1 / (long double)paTokens[1].u.Number.dValue);
+    paTokens[0].u.Number.uValue = (uint64_t)(paTokens[0].u.Number.dValue + 0.50);
     return RINF_SUCCESS;
 }
 
-static int FnIf(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnIf(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    uint8_t const idxResultToken = apTokens[0]->u.Number.uValue ? 1 : 2;
-    apTokens[0]->u.Number.uValue = apTokens[idxResultToken]->u.Number.uValue;
-    apTokens[0]->u.Number.dValue = apTokens[idxResultToken]->u.Number.dValue;
+    uint8_t const idxResultToken = paTokens[0].u.Number.uValue ? 1 : 2;
+    paTokens[0].u.Number.uValue = paTokens[idxResultToken].u.Number.uValue;
+    paTokens[0].u.Number.dValue = paTokens[idxResultToken].u.Number.dValue;
     return RINF_SUCCESS;
 }
 
 
-static int FnByteToPage(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSymAddr(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
+{
+    const char *pszName;
+    uint64_t uSymbolValue;
+    int rc = EvaluatorLookupSymbol(paTokens[0].u.Number.uValue, &pszName, &uSymbolValue);
+    if (RC_SUCCESS(rc))
+    {
+        paTokens[0].u.Number.uValue = uSymbolValue;
+        paTokens[0].u.Number.dValue = uSymbolValue;
+    }
+    else if (rc == RERR_SYMBOL_NOT_FOUND)
+        pEval->Result.uValue = paTokens[0].u.Number.uValue;
+    return rc;
+}
+
+
+static int FnSymOff(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
+{
+    const char *pszName;
+    uint64_t uSymbolValue;
+    int rc = EvaluatorLookupSymbol(paTokens[0].u.Number.uValue, &pszName, &uSymbolValue);
+    if (RC_SUCCESS(rc))
+    {
+        paTokens[0].u.Number.uValue -= uSymbolValue;
+        paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
+    }
+    else if (rc == RERR_SYMBOL_NOT_FOUND)
+        pEval->Result.uValue = paTokens[0].u.Number.uValue;
+    return rc;
+}
+
+
+static int FnByteToPage(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
     /** @todo Make Functions specify minimum parameter widths like Operators. */
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnByteToKiloByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnByteToKiloByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1K;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue /= _1K;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnByteToMegaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnByteToMegaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1M;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue /= _1M;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnByteToGigaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnByteToGigaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1G;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue /= _1G;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnByteToTeraByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnByteToTeraByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1T;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue /= _1T;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
 
-static int FnKiloByteToByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnKiloByteToByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1K;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= _1K;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnKiloByteToMegaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnKiloByteToMegaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnByteToKiloByte(pEval, apTokens, cTokens);
+    return FnByteToKiloByte(pEval, paTokens, cTokens);
 }
 
-static int FnKiloByteToGigaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnKiloByteToGigaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnByteToMegaByte(pEval, apTokens, cTokens);
+    return FnByteToMegaByte(pEval, paTokens, cTokens);
 }
 
-static int FnKiloByteToTeraByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnKiloByteToTeraByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnByteToGigaByte(pEval, apTokens, cTokens);
+    return FnByteToGigaByte(pEval, paTokens, cTokens);
 }
 
-static int FnKiloByteToPage(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnKiloByteToPage(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue * _1K + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue * _1K + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
 
-static int FnMegaByteToByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMegaByteToByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1M;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= _1M;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnMegaByteToKiloByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMegaByteToKiloByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1K;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= _1K;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnMegaByteToGigaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMegaByteToGigaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnByteToKiloByte(pEval, apTokens, cTokens);
+    return FnByteToKiloByte(pEval, paTokens, cTokens);
 }
 
-static int FnMegaByteToTeraByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMegaByteToTeraByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnByteToMegaByte(pEval, apTokens, cTokens);
+    return FnByteToMegaByte(pEval, paTokens, cTokens);
 }
 
-static int FnMegaByteToPage(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMegaByteToPage(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue * _1M + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue * _1M + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
 
-static int FnGigaByteToByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnGigaByteToByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1G;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= _1G;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnGigaByteToKiloByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnGigaByteToKiloByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnMegaByteToByte(pEval, apTokens, cTokens);
+    return FnMegaByteToByte(pEval, paTokens, cTokens);
 }
 
-static int FnGigaByteToMegaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnGigaByteToMegaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnMegaByteToKiloByte(pEval, apTokens, cTokens);
+    return FnMegaByteToKiloByte(pEval, paTokens, cTokens);
 }
 
-static int FnGigaByteToTeraByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnGigaByteToTeraByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnByteToKiloByte(pEval, apTokens, cTokens);
+    return FnByteToKiloByte(pEval, paTokens, cTokens);
 }
 
-static int FnGigaByteToPage(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnGigaByteToPage(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue * _1G + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue * _1G + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnTeraByteToByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnTeraByteToByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1T;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= _1T;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnTeraByteToKiloByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnTeraByteToKiloByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnGigaByteToByte(pEval, apTokens, cTokens);
+    return FnGigaByteToByte(pEval, paTokens, cTokens);
 }
 
-static int FnTeraByteToMegaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnTeraByteToMegaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnMegaByteToByte(pEval, apTokens, cTokens);
+    return FnMegaByteToByte(pEval, paTokens, cTokens);
 }
 
-static int FnTeraByteToGigaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnTeraByteToGigaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return FnKiloByteToByte(pEval, apTokens, cTokens);
+    return FnKiloByteToByte(pEval, paTokens, cTokens);
 }
 
-static int FnTeraByteToPage(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnTeraByteToPage(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue = (apTokens[0]->u.Number.uValue * _1T + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = (paTokens[0].u.Number.uValue * _1T + _MEM_PAGEOFFSET) >> _MEM_PAGESHIFT;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnPageToByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnPageToByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _MEM_PAGESIZE;
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= _MEM_PAGESIZE;
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnPageToKiloByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnPageToKiloByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= (_MEM_PAGESIZE / _1K);
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= (_MEM_PAGESIZE / _1K);
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnPageToMegaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnPageToMegaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= (_MEM_PAGESIZE / _1M);
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= (_MEM_PAGESIZE / _1M);
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnPageToGigaByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnPageToGigaByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= (_MEM_PAGESIZE / _1G);
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= (_MEM_PAGESIZE / _1G);
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnPageToTeraByte(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnPageToTeraByte(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= (_MEM_PAGESIZE / _1T);
-    apTokens[0]->u.Number.dValue  = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue *= (_MEM_PAGESIZE / _1T);
+    paTokens[0].u.Number.dValue  = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
 
 
-static int FnNanosecToMicrosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToMicrosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1MILLI;
-    apTokens[0]->u.Number.dValue /= _1MILLI;
+    paTokens[0].u.Number.uValue /= _1MILLI;
+    paTokens[0].u.Number.dValue /= _1MILLI;
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToMillisec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToMillisec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1MICRO;
-    apTokens[0]->u.Number.dValue /= _1MICRO;
+    paTokens[0].u.Number.uValue /= _1MICRO;
+    paTokens[0].u.Number.dValue /= _1MICRO;
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToSecond(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToSecond(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1NANO;
-    apTokens[0]->u.Number.dValue /= _1NANO;
+    paTokens[0].u.Number.uValue /= _1NANO;
+    paTokens[0].u.Number.dValue /= _1NANO;
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToMinute(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToMinute(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (60 * _1NANO);
-    apTokens[0]->u.Number.dValue /= (60 * _1NANO);
+    paTokens[0].u.Number.uValue /= (60 * _1NANO);
+    paTokens[0].u.Number.dValue /= (60 * _1NANO);
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToHour(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToHour(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (3600LL * _1NANO);
-    apTokens[0]->u.Number.dValue /= ((long double)3600LL * _1NANO);
+    paTokens[0].u.Number.uValue /= (3600LL * _1NANO);
+    paTokens[0].u.Number.dValue /= ((long double)3600LL * _1NANO);
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToDay(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToDay(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (86400LL * _1NANO);
-    apTokens[0]->u.Number.dValue /= ((long double)86400LL * _1NANO);
+    paTokens[0].u.Number.uValue /= (86400LL * _1NANO);
+    paTokens[0].u.Number.dValue /= ((long double)86400LL * _1NANO);
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToWeek(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToWeek(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (604800LL * _1NANO);
-    apTokens[0]->u.Number.dValue /= ((long double)604800LL * _1NANO);
+    paTokens[0].u.Number.uValue /= (604800LL * _1NANO);
+    paTokens[0].u.Number.dValue /= ((long double)604800LL * _1NANO);
     return RINF_SUCCESS;
 }
 
-static int FnNanosecToYear(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnNanosecToYear(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (31556926LL * _1NANO);
-    apTokens[0]->u.Number.dValue /= ((long double)31556926LL * _1NANO);
+    paTokens[0].u.Number.uValue /= (31556926LL * _1NANO);
+    paTokens[0].u.Number.dValue /= ((long double)31556926LL * _1NANO);
     return RINF_SUCCESS;
 }
 
-static int FnMicrosecToNanosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToNanosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1MILLI;
-    apTokens[0]->u.Number.dValue *= _1MILLI;
+    paTokens[0].u.Number.uValue *= _1MILLI;
+    paTokens[0].u.Number.dValue *= _1MILLI;
     return RINF_SUCCESS;
 }
 
-static int FnMicrosecToMillisec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToMillisec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1MILLI;
-    apTokens[0]->u.Number.dValue /= _1MILLI;
+    paTokens[0].u.Number.uValue /= _1MILLI;
+    paTokens[0].u.Number.dValue /= _1MILLI;
     return RINF_SUCCESS;
 }
 
 
-static int FnMicrosecToSecond(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToSecond(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1MICRO;
-    apTokens[0]->u.Number.dValue /= _1MICRO;
+    paTokens[0].u.Number.uValue /= _1MICRO;
+    paTokens[0].u.Number.dValue /= _1MICRO;
     return RINF_SUCCESS;
 }
 
 
-static int FnMicrosecToMinute(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToMinute(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (60 * _1MICRO);
-    apTokens[0]->u.Number.dValue /= (60 * _1MICRO);
+    paTokens[0].u.Number.uValue /= (60 * _1MICRO);
+    paTokens[0].u.Number.dValue /= (60 * _1MICRO);
     return RINF_SUCCESS;
 }
 
-static int FnMicrosecToHour(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToHour(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (3600LL * _1MICRO);
-    apTokens[0]->u.Number.dValue /= ((long double)3600LL * _1MICRO);
+    paTokens[0].u.Number.uValue /= (3600LL * _1MICRO);
+    paTokens[0].u.Number.dValue /= ((long double)3600LL * _1MICRO);
     return RINF_SUCCESS;
 }
 
-static int FnMicrosecToDay(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToDay(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (86400LL * _1MICRO);
-    apTokens[0]->u.Number.dValue /= ((long double)86400LL * _1MICRO);
+    paTokens[0].u.Number.uValue /= (86400LL * _1MICRO);
+    paTokens[0].u.Number.dValue /= ((long double)86400LL * _1MICRO);
     return RINF_SUCCESS;
 }
 
-static int FnMicrosecToWeek(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToWeek(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (604800LL * _1MICRO);
-    apTokens[0]->u.Number.dValue /= ((long double)604800LL * _1MICRO);
+    paTokens[0].u.Number.uValue /= (604800LL * _1MICRO);
+    paTokens[0].u.Number.dValue /= ((long double)604800LL * _1MICRO);
     return RINF_SUCCESS;
 }
 
-static int FnMicrosecToYear(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMicrosecToYear(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (31556926LL * _1MICRO);
-    apTokens[0]->u.Number.dValue /= ((long double)31556926LL * _1MICRO);
+    paTokens[0].u.Number.uValue /= (31556926LL * _1MICRO);
+    paTokens[0].u.Number.dValue /= ((long double)31556926LL * _1MICRO);
     return RINF_SUCCESS;
 }
 
 
-static int FnMillisecToNanosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToNanosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1MICRO;
-    apTokens[0]->u.Number.dValue *= _1MICRO;
+    paTokens[0].u.Number.uValue *= _1MICRO;
+    paTokens[0].u.Number.dValue *= _1MICRO;
     return RINF_SUCCESS;
 }
 
-static int FnMillisecToMicrosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToMicrosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1MILLI;
-    apTokens[0]->u.Number.dValue *= _1MILLI;
+    paTokens[0].u.Number.uValue *= _1MILLI;
+    paTokens[0].u.Number.dValue *= _1MILLI;
     return RINF_SUCCESS;
 }
 
 
-static int FnMillisecToSecond(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToSecond(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= _1MILLI;
-    apTokens[0]->u.Number.dValue /= _1MILLI;
+    paTokens[0].u.Number.uValue /= _1MILLI;
+    paTokens[0].u.Number.dValue /= _1MILLI;
     return RINF_SUCCESS;
 }
 
 
-static int FnMillisecToMinute(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToMinute(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (60 * _1MILLI);
-    apTokens[0]->u.Number.dValue /= (60 * _1MILLI);
+    paTokens[0].u.Number.uValue /= (60 * _1MILLI);
+    paTokens[0].u.Number.dValue /= (60 * _1MILLI);
     return RINF_SUCCESS;
 }
 
-static int FnMillisecToHour(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToHour(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (3600LL * _1MILLI);
-    apTokens[0]->u.Number.dValue /= ((long double)3600LL * _1MILLI);
+    paTokens[0].u.Number.uValue /= (3600LL * _1MILLI);
+    paTokens[0].u.Number.dValue /= ((long double)3600LL * _1MILLI);
     return RINF_SUCCESS;
 }
 
-static int FnMillisecToDay(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToDay(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (86400LL * _1MILLI);
-    apTokens[0]->u.Number.dValue /= ((long double)86400LL * _1MILLI);
+    paTokens[0].u.Number.uValue /= (86400LL * _1MILLI);
+    paTokens[0].u.Number.dValue /= ((long double)86400LL * _1MILLI);
     return RINF_SUCCESS;
 }
 
-static int FnMillisecToWeek(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToWeek(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (604800LL * _1MILLI);
-    apTokens[0]->u.Number.dValue /= ((long double)604800LL * _1MILLI);
+    paTokens[0].u.Number.uValue /= (604800LL * _1MILLI);
+    paTokens[0].u.Number.dValue /= ((long double)604800LL * _1MILLI);
     return RINF_SUCCESS;
 }
 
-static int FnMillisecToYear(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMillisecToYear(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= (31556926LL * _1MILLI);
-    apTokens[0]->u.Number.dValue /= ((long double)31556926LL * _1MILLI);
+    paTokens[0].u.Number.uValue /= (31556926LL * _1MILLI);
+    paTokens[0].u.Number.dValue /= ((long double)31556926LL * _1MILLI);
     return RINF_SUCCESS;
 }
 
 
-static int FnSecondToNanosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToNanosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1NANO;
-    apTokens[0]->u.Number.dValue *= _1NANO;
+    paTokens[0].u.Number.uValue *= _1NANO;
+    paTokens[0].u.Number.dValue *= _1NANO;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToMicrosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToMicrosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1MICRO;
-    apTokens[0]->u.Number.dValue *= _1MICRO;
+    paTokens[0].u.Number.uValue *= _1MICRO;
+    paTokens[0].u.Number.dValue *= _1MICRO;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToMillisec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToMillisec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= _1MILLI;
-    apTokens[0]->u.Number.dValue *= _1MILLI;
+    paTokens[0].u.Number.uValue *= _1MILLI;
+    paTokens[0].u.Number.dValue *= _1MILLI;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToMinute(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToMinute(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 60LL;
-    apTokens[0]->u.Number.dValue /= 60LL;
+    paTokens[0].u.Number.uValue /= 60LL;
+    paTokens[0].u.Number.dValue /= 60LL;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToHour(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToHour(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 3600LL;
-    apTokens[0]->u.Number.dValue /= (long double)3600LL;
+    paTokens[0].u.Number.uValue /= 3600LL;
+    paTokens[0].u.Number.dValue /= (long double)3600LL;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToDay(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToDay(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 86400LL;
-    apTokens[0]->u.Number.dValue /= (long double)86400LL;
+    paTokens[0].u.Number.uValue /= 86400LL;
+    paTokens[0].u.Number.dValue /= (long double)86400LL;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToWeek(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToWeek(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 604800LL;
-    apTokens[0]->u.Number.dValue /= (long double)604800LL;
+    paTokens[0].u.Number.uValue /= 604800LL;
+    paTokens[0].u.Number.dValue /= (long double)604800LL;
     return RINF_SUCCESS;
 }
 
-static int FnSecondToYear(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSecondToYear(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 31556926LL;
-    apTokens[0]->u.Number.dValue /= (long double)31556926LL;
+    paTokens[0].u.Number.uValue /= 31556926LL;
+    paTokens[0].u.Number.dValue /= (long double)31556926LL;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToNanosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToNanosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue *= 60 * _1NANO;
-    apTokens[0]->u.Number.dValue *= 60 * _1NANO;
+    paTokens[0].u.Number.dValue *= 60 * _1NANO;
+    paTokens[0].u.Number.dValue *= 60 * _1NANO;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToMicrosec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToMicrosec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= 60 * _1MICRO;
-    apTokens[0]->u.Number.dValue *= 60 * _1MICRO;
+    paTokens[0].u.Number.uValue *= 60 * _1MICRO;
+    paTokens[0].u.Number.dValue *= 60 * _1MICRO;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToMillisec(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToMillisec(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= 60 * _1MILLI;
-    apTokens[0]->u.Number.dValue *= 60 * _1MILLI;
+    paTokens[0].u.Number.uValue *= 60 * _1MILLI;
+    paTokens[0].u.Number.dValue *= 60 * _1MILLI;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToSecond(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToSecond(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue *= 60LL;
-    apTokens[0]->u.Number.dValue *= 60LL;
+    paTokens[0].u.Number.uValue *= 60LL;
+    paTokens[0].u.Number.dValue *= 60LL;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToHour(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToHour(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 60LL;
-    apTokens[0]->u.Number.dValue /= (long double)60LL;
+    paTokens[0].u.Number.uValue /= 60LL;
+    paTokens[0].u.Number.dValue /= (long double)60LL;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToDay(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToDay(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue /= 1440LL;
-    apTokens[0]->u.Number.dValue /= (long double)1440LL;
+    paTokens[0].u.Number.dValue /= 1440LL;
+    paTokens[0].u.Number.dValue /= (long double)1440LL;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToWeek(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToWeek(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 10080LL;
-    apTokens[0]->u.Number.dValue /= (long double)10080LL;
+    paTokens[0].u.Number.uValue /= 10080LL;
+    paTokens[0].u.Number.dValue /= (long double)10080LL;
     return RINF_SUCCESS;
 }
 
-static int FnMinuteToYear(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnMinuteToYear(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.uValue /= 525948.766;
-    apTokens[0]->u.Number.dValue /= (long double)525948.766;
+    paTokens[0].u.Number.uValue /= 525948.766;
+    paTokens[0].u.Number.dValue /= (long double)525948.766;
     return RINF_SUCCESS;
 }
 
-static int FnCelciusToFahrenheit(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnCelciusToFahrenheit(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue *= (long double)(9 / 5.0);
-    apTokens[0]->u.Number.dValue += 32;
-    apTokens[0]->u.Number.uValue  = (uint64_t)apTokens[0]->u.Number.dValue;
+    paTokens[0].u.Number.dValue *= (long double)(9 / 5.0);
+    paTokens[0].u.Number.dValue += 32;
+    paTokens[0].u.Number.uValue  = (uint64_t)paTokens[0].u.Number.dValue;
     return RINF_SUCCESS;
 }
 
-static int FnFahrenheitToCelcius(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnFahrenheitToCelcius(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    apTokens[0]->u.Number.dValue -= 32;
-    apTokens[0]->u.Number.dValue /= (long double)(9 / 5.0);
-    apTokens[0]->u.Number.uValue  = (uint64_t)apTokens[0]->u.Number.dValue;
+    paTokens[0].u.Number.dValue -= 32;
+    paTokens[0].u.Number.dValue /= (long double)(9 / 5.0);
+    paTokens[0].u.Number.uValue  = (uint64_t)paTokens[0].u.Number.dValue;
     return RINF_SUCCESS;
 }
 
-static int FnSetBit32(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSetBit32(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
     /* We're fine shifting unsigned, well defined behaviour*/
-    if (apTokens[0]->u.Number.uValue <= 31)
+    if (paTokens[0].u.Number.uValue <= 31)
     {
         uint32_t const u32Val = 1;
-        apTokens[0]->u.Number.uValue = (u32Val << apTokens[0]->u.Number.uValue);
-        apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+        paTokens[0].u.Number.uValue = (u32Val << paTokens[0].u.Number.uValue);
+        paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
         return RINF_SUCCESS;
     }
     else
         return RERR_INVALID_COMMAND_PARAMETER;
 }
 
-static int FnSetBit64(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSetBit64(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
     /* We're fine shifting unsigned, well defined behaviour*/
-    if (apTokens[0]->u.Number.uValue <= 63)
+    if (paTokens[0].u.Number.uValue <= 63)
     {
         uint64_t const u64Val = 1;
-        apTokens[0]->u.Number.uValue = (u64Val << apTokens[0]->u.Number.uValue);
-        apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+        paTokens[0].u.Number.uValue = (u64Val << paTokens[0].u.Number.uValue);
+        paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
         return RINF_SUCCESS;
     }
     else
         return RERR_INVALID_COMMAND_PARAMETER;
 }
 
-static int FnSetBitRange32(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSetBitRange32(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    if (   apTokens[0]->u.Number.uValue > 31
-        || apTokens[1]->u.Number.uValue > 31)
+    if (   paTokens[0].u.Number.uValue > 31
+        || paTokens[1].u.Number.uValue > 31)
         return RERR_INVALID_COMMAND_PARAMETER;
 
-    uint8_t const uFirstBit = R_MIN(apTokens[0]->u.Number.uValue, apTokens[1]->u.Number.uValue);
-    uint8_t const uLastBit  = R_MAX(apTokens[0]->u.Number.uValue, apTokens[1]->u.Number.uValue);
+    uint8_t const uFirstBit = R_MIN(paTokens[0].u.Number.uValue, paTokens[1].u.Number.uValue);
+    uint8_t const uLastBit  = R_MAX(paTokens[0].u.Number.uValue, paTokens[1].u.Number.uValue);
 
     uint32_t u32Val = 0;
     for (unsigned i = uFirstBit; i <= uLastBit; i++)
         u32Val |= ((uint64_t)1U << i);
 
-    apTokens[0]->u.Number.uValue = u32Val;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = u32Val;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnSetBitRange64(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnSetBitRange64(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    if (   apTokens[0]->u.Number.uValue > 63
-        || apTokens[1]->u.Number.uValue > 63)
+    if (   paTokens[0].u.Number.uValue > 63
+        || paTokens[1].u.Number.uValue > 63)
         return RERR_INVALID_COMMAND_PARAMETER;
 
-    uint8_t const uFirstBit = R_MIN(apTokens[0]->u.Number.uValue, apTokens[1]->u.Number.uValue);
-    uint8_t const uLastBit  = R_MAX(apTokens[0]->u.Number.uValue, apTokens[1]->u.Number.uValue);
+    uint8_t const uFirstBit = R_MIN(paTokens[0].u.Number.uValue, paTokens[1].u.Number.uValue);
+    uint8_t const uLastBit  = R_MAX(paTokens[0].u.Number.uValue, paTokens[1].u.Number.uValue);
 
     uint64_t u64Val = 0;
     for (unsigned i = uFirstBit; i <= uLastBit; i++)
         u64Val |= ((uint64_t)1U << i);
 
-    apTokens[0]->u.Number.uValue = u64Val;
-    apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+    paTokens[0].u.Number.uValue = u64Val;
+    paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
     return RINF_SUCCESS;
 }
 
-static int FnMax(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
-{
-    return RERR_NOT_IMPLEMENTED;
-}
-
-static int FnMin(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnAlign32(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    return RERR_NOT_IMPLEMENTED;
-}
-
-static int FnAlign32(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
-{
-    uint32_t const u32Val   = apTokens[0]->u.Number.uValue;
-    uint32_t const u32Align = apTokens[1]->u.Number.uValue;
+    uint32_t const u32Val   = paTokens[0].u.Number.uValue;
+    uint32_t const u32Align = paTokens[1].u.Number.uValue;
     if (u32Align % 2 == 0)
     {
-        apTokens[0]->u.Number.uValue = ((u32Val + u32Align - 1) & ~(u32Align - 1));
-        apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+        paTokens[0].u.Number.uValue = ((u32Val + u32Align - 1) & ~(u32Align - 1));
+        paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
         return RINF_SUCCESS;
     }
     return RERR_INVALID_COMMAND_PARAMETER;
 }
 
-static int FnAlign64(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
+static int FnAlign64(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens)
 {
-    uint64_t const u64Val   = apTokens[0]->u.Number.uValue;
-    uint64_t const u64Align = apTokens[1]->u.Number.uValue;
+    uint64_t const u64Val   = paTokens[0].u.Number.uValue;
+    uint64_t const u64Align = paTokens[1].u.Number.uValue;
     if (u64Align % 2 == 0)
     {
-        apTokens[0]->u.Number.uValue = ((u64Val + u64Align - 1) & ~(u64Align - 1));
-        apTokens[0]->u.Number.dValue = apTokens[0]->u.Number.uValue;
+        paTokens[0].u.Number.uValue = ((u64Val + u64Align - 1) & ~(u64Align - 1));
+        paTokens[0].u.Number.dValue = paTokens[0].u.Number.uValue;
         return RINF_SUCCESS;
     }
     return RERR_INVALID_COMMAND_PARAMETER;
@@ -784,122 +973,141 @@ static int FnAlign64(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens)
  */
 FUNCTION g_aFunctions[] =
 {
-    /*  Name            Function               fUInt   cMin  cMax    Args    Desc   */
-    { "help",           NULL,                  false,    1,  1,          "", "Like you don't know what this does." },
-    { "vars",           NULL,                  false,    1,  1,          "", "Displays all defined variables." },
-    { "quit",           NULL,                  false,    1,  1,          "", "Exit, stage left." },
-    { "bye",            NULL,                  false,    1,  1,          "", "Exit, stage smiling." },
-
-    { "sum",            FnSum,                 false,    1,  MAX_FUNCTION_PARAMETERS, "<num1> [,<num2>...<numN>]", "Sum of the numbers." },
-    { "avg",            FnAverage,             false,    1,  MAX_FUNCTION_PARAMETERS, "<num1> [,<num2>...<numN>]", "Average (arithmetic mean) of the numbers." },
-    { "if",             FnIf,                  false,    3,  3,          "<cond>,<expr-t>,<expr-f>", "If <cond> evaluates to true, returns <expr-t> otherwise <expr-f>." },
-    { "fact",           FnFactorial,           true,     1,  1,          "<num1>", "Factorial." },
-    { "gcd",            FnGCD,                 true,     2,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "GCD, Greatest Common Divisor." },
-    { "hcf",            FnGCD,                 true,     2,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "HCF, Highest Common Factor." },
-    { "lcm",            FnLCM,                 true,     2,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "LCM, Least Common Multiple." },
-    { "max",            FnMax,                 true,     2,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "Maximum of the numbers." },
-    { "min",            FnMin,                 true,     2,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "Minimum of the numbers." },
-
-    { "pow",            FnPow,                 false,    2,  2, "<num1>, <num2>", "Returns <num1> raised to the power of <num2>." },
-    { "root",           FnRoot,                false,    2,  2, "<num1>, <num2>", "Returns the <num2>th root of <num1>." },
-    { "sqrt",           FnSqrt,                false,    1,  1, "<num1>", "Returns the square root of <num1>." },
-
-    { "b2kb",           FnByteToKiloByte,      true,     1,  1, "<int1>", "Bytes to kilobytes." },
-    { "b2mb",           FnByteToMegaByte,      true,     1,  1, "<int1>", "Bytes to megabytes." },
-    { "b2gb",           FnByteToGigaByte,      true,     1,  1, "<int1>", "Bytes to gigabytes." },
-    { "b2tb",           FnByteToTeraByte,      true,     1,  1, "<int1>", "Bytes to terabytes." },
-    { "b2p",            FnByteToPage,          true,     1,  1, "<int1>", "Bytes to 4K size pages." },
-
-    { "kb2b",           FnKiloByteToByte,      true,     1,  1, "<int1>", "Kilobytes to bytes." },
-    { "kb2mb",          FnKiloByteToMegaByte,  true,     1,  1, "<int1>", "Kilobytes to megabytes." },
-    { "kb2gb",          FnKiloByteToGigaByte,  true,     1,  1, "<int1>", "Kilobytes to gigabytes." },
-    { "kb2tb",          FnKiloByteToTeraByte,  true,     1,  1, "<int1>", "Kilobytes to terabytes." },
-    { "kb2p",           FnKiloByteToPage,      true,     1,  1, "<int1>", "Kilobytes to 4K size pages." },
-
-    { "mb2b",           FnMegaByteToByte,      true,     1,  1, "<int1>", "Megabytes to bytes." },
-    { "mb2kb",          FnMegaByteToKiloByte,  true,     1,  1, "<int1>", "Megabytes to kilobytes." },
-    { "mb2gb",          FnMegaByteToGigaByte,  true,     1,  1, "<int1>", "Megabytes to gigabytes." },
-    { "mb2tb",          FnMegaByteToTeraByte,  true,     1,  1, "<int1>", "Megabytes to terabytes." },
-    { "mb2p",           FnMegaByteToPage,      true,     1,  1, "<int1>", "Megabytes to 4K size pages." },
-
-    { "gb2b",           FnGigaByteToByte,      true,     1,  1, "<int1>", "Gigabytes to bytes." },
-    { "gb2kb",          FnGigaByteToKiloByte,  true,     1,  1, "<int1>", "Gigabytes to kilobytes." },
-    { "gb2mb",          FnGigaByteToMegaByte,  true,     1,  1, "<int1>", "Gigabytes to megabytes." },
-    { "gb2tb",          FnGigaByteToTeraByte,  true,     1,  1, "<int1>", "Gigabytes to terabytes." },
-    { "gb2p",           FnGigaByteToPage,      true,     1,  1, "<int1>", "Gigabytes to 4K size pages." },
-
-    { "tb2b",           FnTeraByteToByte,      true,     1,  1, "<int1>", "Terabytes to bytes." },
-    { "tb2kb",          FnTeraByteToKiloByte,  true,     1,  1, "<int1>", "Terabytes to kilobytes." },
-    { "tb2mb",          FnTeraByteToMegaByte,  true,     1,  1, "<int1>", "Terabytes to megabytes." },
-    { "tb2gb",          FnTeraByteToGigaByte,  true,     1,  1, "<int1>", "Terabytes to gigabytes." },
-    { "tb2p",           FnTeraByteToPage,      true,     1,  1, "<int1>", "Terabytes to 4K size pages." },
-
-    { "p2b",            FnPageToByte,          true,     1,  1, "<int1>", "Pages of size 4K to bytes." },
-    { "p2kb",           FnPageToKiloByte,      true,     1,  1, "<int1>", "Pages of size 4K to kilobytes." },
-    { "p2mb",           FnPageToMegaByte,      true,     1,  1, "<int1>", "Pages of size 4K to megabytes." },
-    { "p2gb",           FnPageToGigaByte,      true,     1,  1, "<int1>", "Pages of size 4K to gigabytes." },
-    { "p2tb",           FnPageToTeraByte,      true,     1,  1, "<int1>", "Pages of size 4K to terabytes." },
-
-    { "nsec2usec",      FnNanosecToMicrosec,   true,     1,  1, "<num1>", "Nanoseconds to microseconds." },
-    { "nsec2msec",      FnNanosecToMillisec,   true,     1,  1, "<num1>", "Nanoseconds to milliseconds." },
-    { "nsec2sec",       FnNanosecToSecond,     true,     1,  1, "<num1>", "Nanoseconds to seconds." },
-    { "nsec2min",       FnNanosecToMinute,     true,     1,  1, "<num1>", "Nanoseconds to minutes." },
-    { "nsec2hr",        FnNanosecToHour,       true,     1,  1, "<num1>", "Nanoseconds to hours." },
-    { "nsec2day",       FnNanosecToDay,        true,     1,  1, "<num1>", "Nanoseconds to days." },
-    { "nsec2week",      FnNanosecToWeek,       true,     1,  1, "<num1>", "Nanoseconds to weeks." },
-    { "nsec2year",      FnNanosecToYear,       true,     1,  1, "<num1>", "Nanoseconds to years." },
-
-    { "usec2nsec",      FnMicrosecToNanosec,   true,     1,  1, "<num1>", "Microseconds to nanoseconds." },
-    { "usec2msec",      FnMicrosecToMillisec,  true,     1,  1, "<num1>", "Microseconds to milliseconds." },
-    { "usec2sec",       FnMicrosecToSecond,    true,     1,  1, "<num1>", "Microseconds to seconds." },
-    { "usec2min",       FnMicrosecToMinute,    true,     1,  1, "<num1>", "Microseconds to minutes." },
-    { "usec2hr",        FnMicrosecToHour,      true,     1,  1, "<num1>", "Microseconds to hours." },
-    { "usec2day",       FnMicrosecToDay,       true,     1,  1, "<num1>", "Microseconds to days." },
-    { "usec2week",      FnMicrosecToWeek,      true,     1,  1, "<num1>", "Microseconds to weeks." },
-    { "usec2year",      FnMicrosecToYear,      true,     1,  1, "<num1>", "Microseconds to years." },
-
-    { "msec2nsec",      FnMillisecToNanosec,   true,     1,  1, "<num1>", "Milliseconds to nanoseconds." },
-    { "msec2usec",      FnMillisecToMicrosec,  true,     1,  1, "<num1>", "Milliseconds to milliseconds." },
-    { "msec2sec",       FnMillisecToSecond,    true,     1,  1, "<num1>", "Milliseconds to seconds." },
-    { "msec2min",       FnMillisecToMinute,    true,     1,  1, "<num1>", "Milliseconds to minutes." },
-    { "msec2hr",        FnMillisecToHour,      true,     1,  1, "<num1>", "Milliseconds to hours." },
-    { "msec2day",       FnMillisecToDay,       true,     1,  1, "<num1>", "Milliseconds to days." },
-    { "msec2week",      FnMillisecToWeek,      true,     1,  1, "<num1>", "Milliseconds to weeks." },
-    { "msec2year",      FnMillisecToYear,      true,     1,  1, "<num1>", "Milliseconds to years." },
-
-    { "sec2nsec",       FnSecondToNanosec,     true,     1,  1, "<num1>", "Seconds to nanoseconds." },
-    { "sec2usec",       FnSecondToMicrosec,    true,     1,  1, "<num1>", "Seconds to microseconds." },
-    { "sec2msec",       FnSecondToMillisec,    true,     1,  1, "<num1>", "Seconds to milliseconds." },
-    { "sec2min",        FnSecondToMinute,      true,     1,  1, "<num1>", "Seconds to minutes." },
-    { "sec2hr",         FnSecondToHour,        true,     1,  1, "<num1>", "Seconds to hours." },
-    { "sec2day",        FnSecondToDay,         true,     1,  1, "<num1>", "Seconds to days." },
-    { "sec2week",       FnSecondToWeek,        true,     1,  1, "<num1>", "Seconds to weeks." },
-    { "sec2year",       FnSecondToYear,        true,     1,  1, "<num1>", "Seconds to years." },
-
-    { "min2nsec",       FnMinuteToNanosec,     true,     1,  1, "<num1>", "Minutes to nanoseconds." },
-    { "min2usec",       FnMinuteToMicrosec,    true,     1,  1, "<num1>", "Minutes to microseconds." },
-    { "min2msec",       FnMinuteToMillisec,    true,     1,  1, "<num1>", "Minutes to milliseconds." },
-    { "min2sec",        FnMinuteToSecond,      true,     1,  1, "<num1>", "Minutes to seconds." },
-    { "min2hr",         FnMinuteToHour,        true,     1,  1, "<num1>", "Minutes to hours." },
-    { "min2day",        FnMinuteToDay,         true,     1,  1, "<num1>", "Minutes to days." },
-    { "min2week",       FnMinuteToWeek,        true,     1,  1, "<num1>", "Minutes to weeks." },
-    { "min2year",       FnMinuteToYear,        true,     1,  1, "<num1>", "Minutes to years." },
-
-    { "cel2frh",        FnCelciusToFahrenheit, false,    1,  1, "<num1>", "Celcius to fahrenheit." },
-    { "frh2cel",        FnFahrenheitToCelcius, false,    1,  1, "<num1>", "Fahrenheit to celcius." },
+    /*  Name            Function               fUInt     fRange    cMin  cMax    Args    Desc   */
+    { "help",           NULL,                  false,    false,    1,  1,          "", "Like you don't know what this does." },
+    { "vars",           NULL,                  false,    false,    1,  1,          "", "Displays all defined variables." },
+    { "quit",           NULL,                  false,    false,    1,  1,          "", "Exit, stage left." },
+    { "bye",            NULL,                  false,    false,    1,  1,          "", "Exit, stage smiling." },
+
+    { "sum",            FnSum,                 false,    true,     1,  MAX_FUNCTION_PARAMETERS, "<num1> [,<num2>...<numN>]", "Sum of the numbers." },
+    { "avg",            FnAverage,             false,    true,     1,  MAX_FUNCTION_PARAMETERS, "<num1> [,<num2>...<numN>]", "Average (arithmetic mean) of the numbers." },
+    { "if",             FnIf,                  false,    false,    3,  3,          "<cond>,<expr-t>,<expr-f>", "If <cond> evaluates to true, returns <expr-t> otherwise <expr-f>." },
+    { "fact",           FnFactorial,           true,     false,    1,  1,          "<num1>", "Factorial." },
+    { "gcd",            FnGCD,                 true,     true,     1,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "GCD, Greatest Common Divisor." },
+    { "hcf",            FnGCD,                 true,     true,     1,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "HCF, Highest Common Factor." },
+    { "lcm",            FnLCM,                 true,     true,     1,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "LCM, Least Common Multiple." },
+    { "max",            FnMax,                 true,     true,     1,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "Maximum of the numbers." },
+    { "min",            FnMin,                 true,     true,     1,  MAX_FUNCTION_PARAMETERS, "<num1>, <num2> [,<num3>...<numN>]", "Minimum of the numbers." },
+    { "range",          FnRange,               true,     false,    2,  3, "<start>, <end> [,<step>]", "Integers from <start> up to but excluding <end>, for sum, avg, min, max, gcd and lcm." },
+    { "seq",            FnSeq,                 true,     false,    2,  3, "<start>, <count> [,<step>]", "<count> integers from <start>, for sum, avg, min, max, gcd and lcm." },
+
+    { "pow",            FnPow,                 false,    false,    2,  2, "<num1>, <num2>", "Returns <num1> raised to the power of <num2>." },
+    { "root",           FnRoot,                false,    false,    2,  2, "<num1>, <num2>", "Returns the <num2>th root of <num1>." },
+    { "sqrt",           FnSqrt,                false,    false,    1,  1, "<num1>", "Returns the square root of <num1>." },
+
+    { "symaddr",        FnSymAddr,             true,     false,    1,  1, "<addr>", "Value of the nearest variable at or below <addr>, see the sym command." },
+    { "symoff",         FnSymOff,              true,     false,    1,  1, "<addr>", "Offset of <addr> from the nearest variable at or below it." },
+
+    { "b2kb",           FnByteToKiloByte,      true,     false,    1,  1, "<int1>", "Bytes to kilobytes." },
+    { "b2mb",           FnByteToMegaByte,      true,     false,    1,  1, "<int1>", "Bytes to megabytes." },
+    { "b2gb",           FnByteToGigaByte,      true,     false,    1,  1, "<int1>", "Bytes to gigabytes." },
+    { "b2tb",           FnByteToTeraByte,      true,     false,    1,  1, "<int1>", "Bytes to terabytes." },
+    { "b2p",            FnByteToPage,          true,     false,    1,  1, "<int1>", "Bytes to 4K size pages." },
+
+    { "kb2b",           FnKiloByteToByte,      true,     false,    1,  1, "<int1>", "Kilobytes to bytes." },
+    { "kb2mb",          FnKiloByteToMegaByte,  true,     false,    1,  1, "<int1>", "Kilobytes to megabytes." },
+    { "kb2gb",          FnKiloByteToGigaByte,  true,     false,    1,  1, "<int1>", "Kilobytes to gigabytes." },
+    { "kb2tb",          FnKiloByteToTeraByte,  true,     false,    1,  1, "<int1>", "Kilobytes to terabytes." },
+    { "kb2p",           FnKiloByteToPage,      true,     false,    1,  1, "<int1>", "Kilobytes to 4K size pages." },
+
+    { "mb2b",           FnMegaByteToByte,      true,     false,    1,  1, "<int1>", "Megabytes to bytes." },
+    { "mb2kb",          FnMegaByteToKiloByte,  true,     false,    1,  1, "<int1>", "Megabytes to kilobytes." },
+    { "mb2gb",          FnMegaByteToGigaByte,  true,     false,    1,  1, "<int1>", "Megabytes to gigabytes." },
+    { "mb2tb",          FnMegaByteToTeraByte,  true,     false,    1,  1, "<int1>", "Megabytes to terabytes." },
+    { "mb2p",           FnMegaByteToPage,      true,     false,    1,  1, "<int1>", "Megabytes to 4K size pages." },
+
+    { "gb2b",           FnGigaByteToByte,      true,     false,    1,  1, "<int1>", "Gigabytes to bytes." },
+    { "gb2kb",          FnGigaByteToKiloByte,  true,     false,    1,  1, "<int1>", "Gigabytes to kilobytes." },
+    { "gb2mb",          FnGigaByteToMegaByte,  true,     false,    1,  1, "<int1>", "Gigabytes to megabytes." },
+    { "gb2tb",          FnGigaByteToTeraByte,  true,     false,    1,  1, "<int1>", "Gigabytes to terabytes." },
+    { "gb2p",           FnGigaByteToPage,      true,     false,    1,  1, "<int1>", "Gigabytes to 4K size pages." },
+
+    { "tb2b",           FnTeraByteToByte,      true,     false,    1,  1, "<int1>", "Terabytes to bytes." },
+    { "tb2kb",          FnTeraByteToKiloByte,  true,     false,    1,  1, "<int1>", "Terabytes to kilobytes." },
+    { "tb2mb",          FnTeraByteToMegaByte,  true,     false,    1,  1, "<int1>", "Terabytes to megabytes." },
+    { "tb2gb",          FnTeraByteToGigaByte,  true,     false,    1,  1, "<int1>", "Terabytes to gigabytes." },
+    { "tb2p",           FnTeraByteToPage,      true,     false,    1,  1, "<int1>", "Terabytes to 4K size pages." },
+
+    { "p2b",            FnPageToByte,          true,     false,    1,  1, "<int1>", "Pages of size 4K to bytes." },
+    { "p2kb",           FnPageToKiloByte,      true,     false,    1,  1, "<int1>", "Pages of size 4K to kilobytes." },
+    { "p2mb",           FnPageToMegaByte,      true,     false,    1,  1, "<int1>", "Pages of size 4K to megabytes." },
+    { "p2gb",           FnPageToGigaByte,      true,     false,    1,  1, "<int1>", "Pages of size 4K to gigabytes." },
+    { "p2tb",           FnPageToTeraByte,      true,     false,    1,  1, "<int1>", "Pages of size 4K to terabytes." },
+
+    { "nsec2usec",      FnNanosecToMicrosec,   true,     false,    1,  1, "<num1>", "Nanoseconds to microseconds." },
+    { "nsec2msec",      FnNanosecToMillisec,   true,     false,    1,  1, "<num1>", "Nanoseconds to milliseconds." },
+    { "nsec2sec",       FnNanosecToSecond,     true,     false,    1,  1, "<num1>", "Nanoseconds to seconds." },
+    { "nsec2min",       FnNanosecToMinute,     true,     false,    1,  1, "<num1>", "Nanoseconds to minutes." },
+    { "nsec2hr",        FnNanosecToHour,       true,     false,    1,  1, "<num1>", "Nanoseconds to hours." },
+    { "nsec2day",       FnNanosecToDay,        true,     false,    1,  1, "<num1>", "Nanoseconds to days." },
+    { "nsec2week",      FnNanosecToWeek,       true,     false,    1,  1, "<num1>", "Nanoseconds to weeks." },
+    { "nsec2year",      FnNanosecToYear,       true,     false,    1,  1, "<num1>", "Nanoseconds to years." },
+
+    { "usec2nsec",      FnMicrosecToNanosec,   true,     false,    1,  1, "<num1>", "Microseconds to nanoseconds." },
+    { "usec2msec",      FnMicrosecToMillisec,  true,     false,    1,  1, "<num1>", "Microseconds to milliseconds." },
+    { "usec2sec",       FnMicrosecToSecond,    true,     false,    1,  1, "<num1>", "Microseconds to seconds." },
+    { "usec2min",       FnMicrosecToMinute,    true,     false,    1,  1, "<num1>", "Microseconds to minutes." },
+    { "usec2hr",        FnMicrosecToHour,      true,     false,    1,  1, "<num1>", "Microseconds to hours." },
+    { "usec2day",       FnMicrosecToDay,       true,     false,    1,  1, "<num1>", "Microseconds to days." },
+    { "usec2week",      FnMicrosecToWeek,      true,     false,    1,  1, "<num1>", "Microseconds to weeks." },
+    { "usec2year",      FnMicrosecToYear,      true,     false,    1,  1, "<num1>", "Microseconds to years." },
+
+    { "msec2nsec",      FnMillisecToNanosec,   true,     false,    1,  1, "<num1>", "Milliseconds to nanoseconds." },
+    { "msec2usec",      FnMillisecToMicrosec,  true,     false,    1,  1, "<num1>", "Milliseconds to milliseconds." },
+    { "msec2sec",       FnMillisecToSecond,    true,     false,    1,  1, "<num1>", "Milliseconds to seconds." },
+    { "msec2min",       FnMillisecToMinute,    true,     false,    1,  1, "<num1>", "Milliseconds to minutes." },
+    { "msec2hr",        FnMillisecToHour,      true,     false,    1,  1, "<num1>", "Milliseconds to hours." },
+    { "msec2day",       FnMillisecToDay,       true,     false,    1,  1, "<num1>", "Milliseconds to days." },
+    { "msec2week",      FnMillisecToWeek,      true,     false,    1,  1, "<num1>", "Milliseconds to weeks." },
+    { "msec2year",      FnMillisecToYear,      true,     false,    1,  1, "<num1>", "Milliseconds to years." },
+
+    { "sec2nsec",       FnSecondToNanosec,     true,     false,    1,  1, "<num1>", "Seconds to nanoseconds." },
+    { "sec2usec",       FnSecondToMicrosec,    true,     false,    1,  1, "<num1>", "Seconds to microseconds." },
+    { "sec2msec",       FnSecondToMillisec,    true,     false,    1,  1, "<num1>", "Seconds to milliseconds." },
+    { "sec2min",        FnSecondToMinute,      true,     false,    1,  1, "<num1>", "Seconds to minutes." },
+    { "sec2hr",         FnSecondToHour,        true,     false,    1,  1, "<num1>", "Seconds to hours." },
+    { "sec2day",        FnSecondToDay,         true,     false,    1,  1, "<num1>", "Seconds to days." },
+    { "sec2week",       FnSecondToWeek,        true,     false,    1,  1, "<num1>", "Seconds to weeks." },
+    { "sec2year",       FnSecondToYear,        true,     false,    1,  1, "<num1>", "Seconds to years." },
+
+    { "min2nsec",       FnMinuteToNanosec,     true,     false,    1,  1, "<num1>", "Minutes to nanoseconds." },
+    { "min2usec",       FnMinuteToMicrosec,    true,     false,    1,  1, "<num1>", "Minutes to microseconds." },
+    { "min2msec",       FnMinuteToMillisec,    true,     false,    1,  1, "<num1>", "Minutes to milliseconds." },
+    { "min2sec",        FnMinuteToSecond,      true,     false,    1,  1, "<num1>", "Minutes to seconds." },
+    { "min2hr",         FnMinuteToHour,        true,     false,    1,  1, "<num1>", "Minutes to hours." },
+    { "min2day",        FnMinuteToDay,         true,     false,    1,  1, "<num1>", "Minutes to days." },
+    { "min2week",       FnMinuteToWeek,        true,     false,    1,  1, "<num1>", "Minutes to weeks." },
+    { "min2year",       FnMinuteToYear,        true,     false,    1,  1, "<num1>", "Minutes to years." },
+
+    { "cel2frh",        FnCelciusToFahrenheit, false,    false,    1,  1, "<num1>", "Celcius to fahrenheit." },
+    { "frh2cel",        FnFahrenheitToCelcius, false,    false,    1,  1, "<num1>", "Fahrenheit to celcius." },
 
     /* VirtualBox style macros/functions. */
-    { "RT_BIT",         FnSetBit32,            true,     1,  1, "<bit>", "Sets the specified bit (0-31)." },
-    { "RT_BIT_32",      FnSetBit32,            true,     1,  1, "<bit>", "Sets specified bit (0-31). Same as RT_BIT." },
-    { "RT_BIT_64",      FnSetBit64,            true,     1,  1, "<bit>", "Sets specified bit (0-63)." },
-    { "RT_BITS",        FnSetBitRange32,       true,     1,  2, "<bit_f>,<bit_l>", "Sets the specified bits (0-31) from <bit_f> to <bit_l> both inclusive." },
-    { "RT_BITS_32",     FnSetBitRange32,       true,     1,  2, "<bit_f>,<bit_l>", "Sets the specified bits (0-31) from <bit_f> to <bit_l> both inclusive." },
-    { "RT_BITS_64",     FnSetBitRange64,       true,     1,  2, "<bit_f>,<bit_l>", "Sets the specified bits (0-63) from <bit_f> to <bit_l> both inclusive." },
-    { "RT_ALIGN",       FnAlign32,             true,     2,  2, "<val>, <align>", "Aligns 32-bit <val> to <align>. <align> must be a power of 2." },
-    { "RT_ALIGN_32",    FnAlign32,             true,     2,  2, "<val>, <align>", "Aligns 32-bit <val> to <align>. <align> must be a power of 2. Same as RT_ALIGN." },
-    { "RT_ALIGN_64",    FnAlign64,             true,     2,  2, "<val>, <align>", "Aligns 64-bit <val> to <align>. <align> must be a power of 2." }
+    { "RT_BIT",         FnSetBit32,            true,     false,    1,  1, "<bit>", "Sets the specified bit (0-31)." },
+    { "RT_BIT_32",      FnSetBit32,            true,     false,    1,  1, "<bit>", "Sets specified bit (0-31). Same as RT_BIT." },
+    { "RT_BIT_64",      FnSetBit64,            true,     false,    1,  1, "<bit>", "Sets specified bit (0-63)." },
+    { "RT_BITS",        FnSetBitRange32,       true,     false,    1,  2, "<bit_f>,<bit_l>", "Sets the specified bits (0-31) from <bit_f> to <bit_l> both inclusive." },
+    { "RT_BITS_32",     FnSetBitRange32,       true,     false,    1,  2, "<bit_f>,<bit_l>", "Sets the specified bits (0-31) from <bit_f> to <bit_l> both inclusive." },
+    { "RT_BITS_64",     FnSetBitRange64,       true,     false,    1,  2, "<bit_f>,<bit_l>", "Sets the specified bits (0-63) from <bit_f> to <bit_l> both inclusive." },
+    { "RT_ALIGN",       FnAlign32,             true,     false,    2,  2, "<val>, <align>", "Aligns 32-bit <val> to <align>. <align> must be a power of 2." },
+    { "RT_ALIGN_32",    FnAlign32,             true,     false,    2,  2, "<val>, <align>", "Aligns 32-bit <val> to <align>. <align> must be a power of 2. Same as RT_ALIGN." },
+    { "RT_ALIGN_64",    FnAlign64,             true,     false,    2,  2, "<val>, <align>", "Aligns 64-bit <val> to <align>. <align> must be a power of 2." }
 };
 
 /** Total number of Functions in the table. */
 const uint32_t g_cFunctions = R_ARRAY_ELEMENTS(g_aFunctions);
 
+
+/**
+ * Checks whether a Function may be called by several threads at once. The symbol
+ * lookups maintain the index of the global scope as they go, everything else only
+ * works on its parameters.
+ *
+ * @return  true if it may, false if it must only be called by one thread at a time.
+ * @param   pFunction   The Function.
+ */
+bool FunctionIsThreadSafe(PCFUNCTION pFunction)
+{
+    return    pFunction->pfnFunction != FnSymAddr
+           && pFunction->pfnFunction != FnSymOff;
+}
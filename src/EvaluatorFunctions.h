@@ -27,5 +27,7 @@
 extern FUNCTION g_aFunctions[];
 extern const unsigned g_cFunctions;
 
+bool FunctionIsThreadSafe(PCFUNCTION pFunction);
+
 #endif /* EVALUATOR_FUNCTIONS_H___ */
 
@@ -0,0 +1,1152 @@
+/** @file
+ * Evaluator images, saving, loading and publishing the global Variables and
+ * user-defined Functions.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*******************************************************************************
+ *   Header Files                                                              *
+ *******************************************************************************/
+#include "EvaluatorCore.h"
+#include "EvaluatorFunctions.h"
+#include "InputOutput.h"
+#include "Assert.h"
+#include "GenericDefs.h"
+#include "Errors.h"
+#include "StringOps.h"
+#include "Rcu.h"
+
+
+/*******************************************************************************
+ *   Defines                                                                   *
+ *******************************************************************************/
+/** Prefix of the shared memory object name of a published image, see EvaluatorPublishImage(). */
+#define IMAGE_SHARED_PREFIX         "/nopf-"
+/** Maximum length of the name an image is published under. */
+#define MAX_IMAGE_NAME_LENGTH       64
+/** Magic at the start of an image, see EvaluatorSaveImage(). */
+#define IMAGE_MAGIC                 "NOPFIMG"
+/** Version of the image layout. */
+#define IMAGE_VERSION               1
+/** Written in the host's byte order to reject images from the other one. */
+#define IMAGE_BYTE_ORDER            UINT32_C(0x01020304)
+/** The Variable may be reassigned. */
+#define IMAGE_VAR_F_CAN_REINIT      UINT32_C(1)
+
+
+/*******************************************************************************
+ *   Static functions                                                          *
+ *******************************************************************************/
+static int ImageLoadMapped(uint32_t *pcVars, uint32_t *pcFunctions);
+
+
+/*******************************************************************************
+ *   Globals                                                                   *
+ *******************************************************************************/
+/** The loaded image, its Variables come after those of the global scope. */
+IMAGE g_Image;
+
+
+/**
+ * IMAGEWRITER: An image being put together, see EvaluatorSaveImage().
+ */
+typedef struct IMAGEWRITER
+{
+    PNUMBER         paNumbers;      /**< The Numbers. */
+    uint32_t        cNumbers;       /**< Number of Numbers. */
+    uint32_t        cNumbersAlloc;  /**< Number of Numbers allocated. */
+    PIMAGETOKEN     paTokens;       /**< The Tokens. */
+    uint32_t        cTokens;        /**< Number of Tokens. */
+    uint32_t        cTokensAlloc;   /**< Number of Tokens allocated. */
+    PIMAGEVAR       paVars;         /**< The Variables. */
+    uint32_t        cVars;          /**< Number of Variables. */
+    uint32_t        cVarsAlloc;     /**< Number of Variables allocated. */
+    PIMAGEFUNC      paFunctions;    /**< The user-defined Functions. */
+    uint32_t        cFunctions;     /**< Number of user-defined Functions. */
+    uint32_t        cFunctionsAlloc;/**< Number of user-defined Functions allocated. */
+    uint32_t       *paoffNames;     /**< The names as offsets into @a Strings. */
+    uint32_t        cNames;         /**< Number of names. */
+    uint32_t        cNamesAlloc;    /**< Number of names allocated. */
+    uint32_t       *pauNameBySymbol;/**< 1 + name index by Symbol Id, 0 if the name isn't in the image yet. */
+    uint32_t        cNameBySymbol;  /**< Number of entries in @a pauNameBySymbol. */
+    STRBUF          Strings;        /**< The zero terminated strings. */
+} IMAGEWRITER;
+/** Pointer to an image writer. */
+typedef IMAGEWRITER *PIMAGEWRITER;
+
+
+/**
+ * Adds a string to an image.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   psz         The string.
+ * @param   poffString  Where to store the offset of the string.
+ */
+static int ImageWriterAddString(PIMAGEWRITER pWriter, const char *psz, uint32_t *poffString)
+{
+    if (pWriter->Strings.cchBuf >= UINT32_MAX - StrLen(psz))
+        return RERR_NO_MEMORY;
+    *poffString = (uint32_t)pWriter->Strings.cchBuf;
+    StrBufAppendF(&pWriter->Strings, "%s%c", psz, '\0');
+    return pWriter->Strings.rc;
+}
+
+
+/**
+ * Adds a name to an image unless it's already in it.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   uSymbol     Symbol Id of the name.
+ * @param   piName      Where to store the name index.
+ */
+static int ImageWriterAddName(PIMAGEWRITER pWriter, uint32_t uSymbol, uint32_t *piName)
+{
+    AssertReturn(uSymbol < pWriter->cNameBySymbol, RERR_INVALID_PARAMETER);
+    if (pWriter->pauNameBySymbol[uSymbol])
+    {
+        *piName = pWriter->pauNameBySymbol[uSymbol] - 1;
+        return RINF_SUCCESS;
+    }
+
+    int rc = EvaluatorGrowArray((void **)&pWriter->paoffNames, &pWriter->cNamesAlloc, pWriter->cNames, sizeof(uint32_t));
+    if (RC_SUCCESS(rc))
+        rc = ImageWriterAddString(pWriter, SymTableName(&g_SymTable, uSymbol), &pWriter->paoffNames[pWriter->cNames]);
+    if (RC_SUCCESS(rc))
+    {
+        *piName = pWriter->cNames++;
+        pWriter->pauNameBySymbol[uSymbol] = pWriter->cNames;
+    }
+    return rc;
+}
+
+
+/**
+ * Adds a Number to an image.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   pNumber     The Number.
+ * @param   piNumber    Where to store the Number index.
+ */
+static int ImageWriterAddNumber(PIMAGEWRITER pWriter, PCNUMBER pNumber, uint32_t *piNumber)
+{
+    int rc = EvaluatorGrowArray((void **)&pWriter->paNumbers, &pWriter->cNumbersAlloc, pWriter->cNumbers, sizeof(NUMBER));
+    if (RC_SUCCESS(rc))
+    {
+        /* Zero the padding of long double so images don't carry stale heap contents. */
+        MemSet(&pWriter->paNumbers[pWriter->cNumbers], 0, sizeof(NUMBER));
+        pWriter->paNumbers[pWriter->cNumbers].uValue = pNumber->uValue;
+        pWriter->paNumbers[pWriter->cNumbers].dValue = pNumber->dValue;
+        *piNumber = pWriter->cNumbers++;
+    }
+    return rc;
+}
+
+
+/**
+ * Adds a Token of a compiled expression to an image.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   pToken      The Token.
+ */
+static int ImageWriterAddToken(PIMAGEWRITER pWriter, PCTOKEN pToken)
+{
+    int rc = EvaluatorGrowArray((void **)&pWriter->paTokens, &pWriter->cTokensAlloc, pWriter->cTokens, sizeof(IMAGETOKEN));
+    if (RC_FAILURE(rc))
+        return rc;
+
+    PIMAGETOKEN pImgToken = &pWriter->paTokens[pWriter->cTokens];
+    MemSet(pImgToken, 0, sizeof(*pImgToken));
+    pImgToken->Type     = (uint16_t)pToken->Type;
+    pImgToken->Position = pToken->Position;
+    if (pToken->Type == enmTokenFunction)
+    {
+        pImgToken->cFunctionParams = (uint16_t)R_MIN(pToken->cFunctionParams, MAX_FUNCTION_PARAMETERS);
+    }
+    switch (pToken->Type)
+    {
+        case enmTokenNumber:
+            rc = ImageWriterAddNumber(pWriter, &pToken->u.Number, &pImgToken->uData);
+            break;
+
+        case enmTokenOperator:
+            pImgToken->uData = (uint32_t)(pToken->u.pOperator - g_aOperators);
+            break;
+
+        case enmTokenFunction:
+        {
+            /* Built-in Functions are stored by name too, their order isn't part of the layout. */
+            const char *pszFunction = pToken->u.pFunction->pszFunction;
+            uint32_t uSymbol = NIL_SYMBOL;
+            rc = SymTableIntern(&g_SymTable, pszFunction, StrLen(pszFunction), &uSymbol);
+            if (   RC_SUCCESS(rc)
+                && uSymbol >= pWriter->cNameBySymbol)
+            {
+                /* Interned just now, which only grows the table by one. */
+                uint32_t *pauNameBySymbol = MemReallocTag(pWriter->pauNameBySymbol, (uSymbol + 1) * sizeof(uint32_t),
+                                                          enmMemTagVariable);
+                if (!pauNameBySymbol)
+                    return RERR_NO_MEMORY;
+                MemSet(&pauNameBySymbol[pWriter->cNameBySymbol], 0, (uSymbol + 1 - pWriter->cNameBySymbol) * sizeof(uint32_t));
+                pWriter->pauNameBySymbol = pauNameBySymbol;
+                pWriter->cNameBySymbol   = uSymbol + 1;
+            }
+            if (RC_SUCCESS(rc))
+                rc = ImageWriterAddName(pWriter, uSymbol, &pImgToken->uData);
+            break;
+        }
+
+        case enmTokenVariable:
+            rc = ImageWriterAddName(pWriter, pToken->uSymbol, &pImgToken->uData);
+            break;
+
+        case enmTokenParam:
+            pImgToken->uData = pToken->u.iParam;
+            break;
+
+        default:
+            rc = RERR_NOT_SUPPORTED;
+            break;
+    }
+
+    if (RC_SUCCESS(rc))
+        ++pWriter->cTokens;
+    return rc;
+}
+
+
+/**
+ * Adds a Token of the loaded image to the image being written.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   pImgToken   The Token of the loaded image.
+ */
+static int ImageWriterAddImageToken(PIMAGEWRITER pWriter, PCIMAGETOKEN pImgToken)
+{
+    int rc = EvaluatorGrowArray((void **)&pWriter->paTokens, &pWriter->cTokensAlloc, pWriter->cTokens, sizeof(IMAGETOKEN));
+    if (RC_FAILURE(rc))
+        return rc;
+
+    PIMAGETOKEN pNewToken = &pWriter->paTokens[pWriter->cTokens];
+    *pNewToken = *pImgToken;
+    if (pImgToken->Type == enmTokenNumber)
+    {
+        if (pImgToken->uData >= g_Image.pHdr->cNumbers)
+            return RERR_IMAGE_INVALID;
+        rc = ImageWriterAddNumber(pWriter, &g_Image.paNumbers[pImgToken->uData], &pNewToken->uData);
+    }
+    else if (   pImgToken->Type == enmTokenFunction
+             || pImgToken->Type == enmTokenVariable)
+    {
+        if (pImgToken->uData >= g_Image.pHdr->cNames)
+            return RERR_IMAGE_INVALID;
+        rc = ImageWriterAddName(pWriter, g_Image.pauSymbols[pImgToken->uData], &pNewToken->uData);
+    }
+
+    if (RC_SUCCESS(rc))
+        ++pWriter->cTokens;
+    return rc;
+}
+
+
+/**
+ * Fills in the header of an image once everything has been added to it.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   pHdr        Where to store the header.
+ */
+static int ImageWriterInitHeader(PIMAGEWRITER pWriter, PIMAGEHDR pHdr)
+{
+    /*
+     * The strings end with a terminator, the header says so even if there are none.
+     */
+    if (!pWriter->Strings.cchBuf)
+        StrBufAppendF(&pWriter->Strings, "%c", '\0');
+    if (RC_FAILURE(pWriter->Strings.rc))
+        return pWriter->Strings.rc;
+
+    MemSet(pHdr, 0, sizeof(*pHdr));
+    MemCpy(pHdr->achMagic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    pHdr->uVersion     = IMAGE_VERSION;
+    pHdr->uByteOrder   = IMAGE_BYTE_ORDER;
+    pHdr->cbNumber     = sizeof(NUMBER);
+    pHdr->cOperators   = g_cOperators;
+    pHdr->cNames       = pWriter->cNames;
+    pHdr->cVars        = pWriter->cVars;
+    pHdr->cFunctions   = pWriter->cFunctions;
+    pHdr->cTokens      = pWriter->cTokens;
+    pHdr->cNumbers     = pWriter->cNumbers;
+    pHdr->offNumbers   = sizeof(*pHdr);
+    pHdr->offTokens    = pHdr->offNumbers   + (uint64_t)pWriter->cNumbers * sizeof(NUMBER);
+    pHdr->offVars      = pHdr->offTokens    + (uint64_t)pWriter->cTokens * sizeof(IMAGETOKEN);
+    pHdr->offFunctions = pHdr->offVars      + (uint64_t)pWriter->cVars * sizeof(IMAGEVAR);
+    pHdr->offNames     = pHdr->offFunctions + (uint64_t)pWriter->cFunctions * sizeof(IMAGEFUNC);
+    pHdr->offStrings   = pHdr->offNames     + (uint64_t)pWriter->cNames * sizeof(uint32_t);
+    pHdr->cbStrings    = pWriter->Strings.cchBuf;
+    pHdr->cbImage      = pHdr->offStrings   + pHdr->cbStrings;
+
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Writes an array of an image section to a file.
+ *
+ * @return  true if everything was written, false otherwise.
+ * @param   pFile       The file.
+ * @param   pvArray     The array, can be NULL when @a cItems is 0.
+ * @param   cbItem      Size of an item.
+ * @param   cItems      Number of items.
+ */
+static bool ImageWriteArray(FILE *pFile, const void *pvArray, size_t cbItem, size_t cItems)
+{
+    return !cItems || fwrite(pvArray, cbItem, cItems, pFile) == cItems;
+}
+
+
+/**
+ * Writes an image to a file, replacing the file only once it's complete.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer.
+ * @param   pszFile     The file.
+ */
+static int ImageWriterWrite(PIMAGEWRITER pWriter, const char *pszFile)
+{
+    IMAGEHDR Hdr;
+    int rc = ImageWriterInitHeader(pWriter, &Hdr);
+    if (RC_FAILURE(rc))
+        return rc;
+
+    /*
+     * Mappings of the old file stay intact when it's replaced by renaming.
+     */
+    char *pszTmpFile = StrAlloc(StrLen(pszFile) + sizeof(".tmp"));
+    if (!pszTmpFile)
+        return RERR_NO_MEMORY;
+    StrNPrintf(pszTmpFile, StrLen(pszFile) + sizeof(".tmp"), "%s.tmp", pszFile);
+
+    rc = RERR_FILE_IO;
+    FILE *pFile = fopen(pszTmpFile, "wb");
+    if (pFile)
+    {
+        bool fOk = ImageWriteArray(pFile, &Hdr, sizeof(Hdr), 1);
+        fOk &= ImageWriteArray(pFile, pWriter->paNumbers, sizeof(NUMBER), pWriter->cNumbers);
+        fOk &= ImageWriteArray(pFile, pWriter->paTokens, sizeof(IMAGETOKEN), pWriter->cTokens);
+        fOk &= ImageWriteArray(pFile, pWriter->paVars, sizeof(IMAGEVAR), pWriter->cVars);
+        fOk &= ImageWriteArray(pFile, pWriter->paFunctions, sizeof(IMAGEFUNC), pWriter->cFunctions);
+        fOk &= ImageWriteArray(pFile, pWriter->paoffNames, sizeof(uint32_t), pWriter->cNames);
+        fOk &= ImageWriteArray(pFile, pWriter->Strings.pszBuf, 1, pWriter->Strings.cchBuf);
+        fOk &= !fclose(pFile);
+#ifdef _WIN32
+        if (fOk)
+            remove(pszFile);
+#endif
+        if (   fOk
+            && !rename(pszTmpFile, pszFile))
+            rc = RINF_SUCCESS;
+        else
+            remove(pszTmpFile);
+    }
+    StrFree(pszTmpFile);
+    return rc;
+}
+
+
+/**
+ * Puts together an image of the Variables and user-defined Functions of the
+ * global scope, along with the Variables of the loaded image nobody looked up.
+ * The predefined constants aren't included.
+ *
+ * @return  Status code.
+ * @param   pWriter     The image writer to initialize, delete with
+ *                      ImageWriterDelete() even on failure.
+ */
+static int ImageWriterBuild(PIMAGEWRITER pWriter)
+{
+    MemSet(pWriter, 0, sizeof(*pWriter));
+    StrBufInit(&pWriter->Strings);
+    pWriter->cNameBySymbol   = SymTableCount(&g_SymTable) + 1;
+    pWriter->pauNameBySymbol = MemAllocZTag(pWriter->cNameBySymbol * sizeof(uint32_t), enmMemTagVariable);
+    int rc = pWriter->pauNameBySymbol ? RINF_SUCCESS : RERR_NO_MEMORY;
+
+    /*
+     * Variables of the global scope, as a batch of assignments so they're walked as
+     * the writer sees them.
+     */
+    EvaluatorWriteBegin();
+    for (PLISTITEM pNode = g_GlobalScope.VarList.pHead; pNode && RC_SUCCESS(rc); pNode = pNode->pNext)
+    {
+        PCVARIABLE pVariable = pNode->pvData;
+        if (pVariable->fPredefined)
+            continue;
+        PCVARDEF pDef = VariableDef(pVariable);
+
+        rc = EvaluatorGrowArray((void **)&pWriter->paVars, &pWriter->cVarsAlloc, pWriter->cVars, sizeof(IMAGEVAR));
+        if (RC_FAILURE(rc))
+            break;
+        PIMAGEVAR pImgVar = &pWriter->paVars[pWriter->cVars];
+        pImgVar->iToken = pWriter->cTokens;
+        pImgVar->fFlags = pVariable->fCanReinit ? IMAGE_VAR_F_CAN_REINIT : 0;
+        rc = ImageWriterAddName(pWriter, pVariable->uSymbol, &pImgVar->iName);
+        if (RC_SUCCESS(rc))
+            rc = ImageWriterAddString(pWriter, pDef->pszExpr, &pImgVar->offExpr);
+        /* Lazily defined Variables not used yet are saved without Tokens and stay lazy when loaded. */
+        PCQUEUE pQueue = pDef->pvRPNQueue;
+        for (PCQUEUEITEM pItem = pQueue ? pQueue->pHead : NULL; pItem && RC_SUCCESS(rc); pItem = pItem->pNext)
+            rc = ImageWriterAddToken(pWriter, pItem->pvData);
+        pImgVar->cTokens = pWriter->cTokens - pImgVar->iToken;
+        ++pWriter->cVars;
+    }
+
+    /*
+     * Variables of the loaded image nobody looked up, they're saved as they are.
+     */
+    PCIMAGEHDR pHdr = g_Image.pHdr;
+    for (uint32_t i = 0; pHdr && i < pHdr->cVars && RC_SUCCESS(rc); i++)
+    {
+        PCIMAGEVAR pLoadedVar = &g_Image.paVars[i];
+        uint32_t const uSymbol = g_Image.pauSymbols[pLoadedVar->iName];
+        if (g_Image.pauVarBySymbol[uSymbol] != i + 1)
+            continue;
+
+        rc = EvaluatorGrowArray((void **)&pWriter->paVars, &pWriter->cVarsAlloc, pWriter->cVars, sizeof(IMAGEVAR));
+        if (RC_FAILURE(rc))
+            break;
+        PIMAGEVAR pImgVar = &pWriter->paVars[pWriter->cVars];
+        pImgVar->iToken = pWriter->cTokens;
+        pImgVar->fFlags = pLoadedVar->fFlags;
+        rc = ImageWriterAddName(pWriter, uSymbol, &pImgVar->iName);
+        if (RC_SUCCESS(rc))
+            rc = ImageWriterAddString(pWriter, g_Image.pszStrings + pLoadedVar->offExpr, &pImgVar->offExpr);
+        for (uint32_t k = 0; k < pLoadedVar->cTokens && RC_SUCCESS(rc); k++)
+            rc = ImageWriterAddImageToken(pWriter, &g_Image.paTokens[pLoadedVar->iToken + k]);
+        pImgVar->cTokens = pWriter->cTokens - pImgVar->iToken;
+        ++pWriter->cVars;
+    }
+
+    /*
+     * User-defined Functions of the global scope.
+     */
+    for (PLISTITEM pNode = g_GlobalScope.UserFuncList.pHead; pNode && RC_SUCCESS(rc); pNode = pNode->pNext)
+    {
+        PCFUNCTION pFunction = pNode->pvData;
+        PCPROGRAM pProgram = pFunction->pProgram;
+        rc = EvaluatorGrowArray((void **)&pWriter->paFunctions, &pWriter->cFunctionsAlloc, pWriter->cFunctions, sizeof(IMAGEFUNC));
+        if (RC_FAILURE(rc))
+            break;
+        PIMAGEFUNC pImgFunc = &pWriter->paFunctions[pWriter->cFunctions];
+        pImgFunc->iToken  = pWriter->cTokens;
+        pImgFunc->cParams = pProgram->cParams;
+        rc = ImageWriterAddName(pWriter, SymTableLookup(&g_SymTable, pFunction->pszFunction, StrLen(pFunction->pszFunction)),
+                                &pImgFunc->iName);
+        if (RC_SUCCESS(rc))
+            rc = ImageWriterAddString(pWriter, pProgram->pszExpr, &pImgFunc->offExpr);
+        for (uint32_t k = 0; k < pProgram->cTokens && RC_SUCCESS(rc); k++)
+            rc = ImageWriterAddToken(pWriter, &pProgram->paTokens[k]);
+        pImgFunc->cTokens = pWriter->cTokens - pImgFunc->iToken;
+        ++pWriter->cFunctions;
+    }
+    EvaluatorWriteEnd();
+
+    return rc;
+}
+
+
+/**
+ * Frees everything an image writer holds.
+ *
+ * @param   pWriter     The image writer.
+ */
+static void ImageWriterDelete(PIMAGEWRITER pWriter)
+{
+    MemFree(pWriter->paNumbers);
+    MemFree(pWriter->paTokens);
+    MemFree(pWriter->paVars);
+    MemFree(pWriter->paFunctions);
+    MemFree(pWriter->paoffNames);
+    MemFree(pWriter->pauNameBySymbol);
+    StrBufDelete(&pWriter->Strings);
+}
+
+
+/**
+ * Saves the Variables and user-defined Functions of the global scope, along with
+ * the Variables of the loaded image, to an image that EvaluatorLoadImage() can
+ * bring back without parsing anything. The predefined constants aren't saved.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile         The file to save to, replaced if it exists.
+ * @param   pcVars          Where to store the number of Variables saved, optional.
+ * @param   pcFunctions     Where to store the number of Functions saved, optional.
+ */
+int EvaluatorSaveImage(const char *pszFile, uint32_t *pcVars, uint32_t *pcFunctions)
+{
+    IMAGEWRITER Writer;
+    int rc = ImageWriterBuild(&Writer);
+    if (RC_SUCCESS(rc))
+        rc = ImageWriterWrite(&Writer, pszFile);
+    if (RC_SUCCESS(rc))
+    {
+        if (pcVars)
+            *pcVars = Writer.cVars;
+        if (pcFunctions)
+            *pcFunctions = Writer.cFunctions;
+    }
+    ImageWriterDelete(&Writer);
+    return rc;
+}
+
+
+/**
+ * Gets the name of the shared memory object of a published image.
+ *
+ * @return  Status code.
+ * @param   pszName     The name the image is published under.
+ * @param   pszShmName  Where to store the shared memory object name.
+ * @param   cbShmName   Size of @a pszShmName.
+ */
+static int ImageSharedName(const char *pszName, char *pszShmName, size_t cbShmName)
+{
+    size_t const cchName = StrLen(pszName);
+    if (   !cchName
+        || cchName > MAX_IMAGE_NAME_LENGTH)
+        return RERR_INVALID_PARAMETER;
+    for (size_t i = 0; i < cchName; i++)
+    {
+        if (   !isalnum((unsigned char)pszName[i])
+            && pszName[i] != '_'
+            && pszName[i] != '-'
+            && pszName[i] != '.')
+            return RERR_INVALID_PARAMETER;
+    }
+    StrNPrintf(pszShmName, cbShmName, "%s%s", IMAGE_SHARED_PREFIX, pszName);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Copies an array of an image section into memory.
+ *
+ * @return  Where the next section goes.
+ * @param   pbDst       Where to copy the array to.
+ * @param   pvArray     The array, can be NULL when @a cItems is 0.
+ * @param   cbItem      Size of an item.
+ * @param   cItems      Number of items.
+ */
+static uint8_t *ImageCopyArray(uint8_t *pbDst, const void *pvArray, size_t cbItem, size_t cItems)
+{
+    if (cItems)
+        MemCpy(pbDst, pvArray, cbItem * cItems);
+    return pbDst + cbItem * cItems;
+}
+
+
+/**
+ * Publishes the same image EvaluatorSaveImage() saves into a shared memory
+ * object which any number of processes can attach read-only with
+ * EvaluatorAttachImage(). A previously published image of the same name is
+ * replaced, processes that have it attached keep using the old one.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszName         The name to publish the image under, letters, digits
+ *                          and any of "_-." only.
+ * @param   pcVars          Where to store the number of Variables published, optional.
+ * @param   pcFunctions     Where to store the number of Functions published, optional.
+ */
+int EvaluatorPublishImage(const char *pszName, uint32_t *pcVars, uint32_t *pcFunctions)
+{
+    char szShmName[sizeof(IMAGE_SHARED_PREFIX) + MAX_IMAGE_NAME_LENGTH];
+    int rc = ImageSharedName(pszName, szShmName, sizeof(szShmName));
+    if (RC_FAILURE(rc))
+        return rc;
+
+    IMAGEWRITER Writer;
+    IMAGEHDR Hdr;
+    rc = ImageWriterBuild(&Writer);
+    if (RC_SUCCESS(rc))
+        rc = ImageWriterInitHeader(&Writer, &Hdr);
+    if (   RC_SUCCESS(rc)
+        && Hdr.cbImage > SIZE_MAX)
+        rc = RERR_NO_MEMORY;
+    if (RC_SUCCESS(rc))
+    {
+        FILEMAP FileMap;
+        uint8_t *pbImage = NULL;
+        rc = FileMapCreateShared(&FileMap, szShmName, (size_t)Hdr.cbImage, (void **)&pbImage);
+        if (RC_SUCCESS(rc))
+        {
+            /*
+             * The header goes in last, attaching before that fails the magic check
+             * instead of picking up a partial image.
+             */
+            uint8_t *pb = pbImage + sizeof(Hdr);
+            pb = ImageCopyArray(pb, Writer.paNumbers, sizeof(NUMBER), Writer.cNumbers);
+            pb = ImageCopyArray(pb, Writer.paTokens, sizeof(IMAGETOKEN), Writer.cTokens);
+            pb = ImageCopyArray(pb, Writer.paVars, sizeof(IMAGEVAR), Writer.cVars);
+            pb = ImageCopyArray(pb, Writer.paFunctions, sizeof(IMAGEFUNC), Writer.cFunctions);
+            pb = ImageCopyArray(pb, Writer.paoffNames, sizeof(uint32_t), Writer.cNames);
+            pb = ImageCopyArray(pb, Writer.Strings.pszBuf, 1, Writer.Strings.cchBuf);
+            Assert((uint64_t)(pb - pbImage) == Hdr.cbImage);
+            MemCpy(pbImage, &Hdr, sizeof(Hdr));
+            FileMapClose(&FileMap);
+
+            if (pcVars)
+                *pcVars = Writer.cVars;
+            if (pcFunctions)
+                *pcFunctions = Writer.cFunctions;
+        }
+    }
+    ImageWriterDelete(&Writer);
+    return rc;
+}
+
+
+/**
+ * Removes an image published by EvaluatorPublishImage(). Processes that have it
+ * attached keep using it.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszName         The name the image is published under.
+ */
+int EvaluatorUnpublishImage(const char *pszName)
+{
+    char szShmName[sizeof(IMAGE_SHARED_PREFIX) + MAX_IMAGE_NAME_LENGTH];
+    int rc = ImageSharedName(pszName, szShmName, sizeof(szShmName));
+    if (RC_SUCCESS(rc))
+        rc = FileMapRemoveShared(szShmName);
+    return rc;
+}
+
+
+/**
+ * Unloads the loaded image. Variables and Functions already taken from it stay.
+ */
+void ImageUnload(void)
+{
+    SymIndexInvalidate();
+    MemFree(g_Image.pauSymbols);
+    MemFree(g_Image.pauVarBySymbol);
+    FileMapClose(&g_Image.FileMap);
+    MemSet(&g_Image, 0, sizeof(g_Image));
+}
+
+
+/**
+ * Checks that an array of an image lies within it.
+ *
+ * @return  true if it does, false otherwise.
+ * @param   pHdr        The image header.
+ * @param   off         Offset of the array.
+ * @param   cEntries    Number of entries.
+ * @param   cbEntry     Size of an entry.
+ */
+static bool ImageIsArrayValid(PCIMAGEHDR pHdr, uint64_t off, uint32_t cEntries, size_t cbEntry)
+{
+    return off <= pHdr->cbImage
+        && off % sizeof(uint32_t) == 0
+        && (uint64_t)cEntries * cbEntry <= pHdr->cbImage - off;
+}
+
+
+/**
+ * Checks that a Token range of an image lies within its Token array.
+ *
+ * @return  true if it does, false otherwise.
+ * @param   pHdr        The image header.
+ * @param   iToken      Index of the first Token.
+ * @param   cTokens     Number of Tokens.
+ */
+static bool ImageIsTokenRangeValid(PCIMAGEHDR pHdr, uint32_t iToken, uint32_t cTokens)
+{
+    return cTokens > 0
+        && (uint64_t)iToken + cTokens <= pHdr->cTokens;
+}
+
+
+/**
+ * Builds the RPN Queue of a compiled expression of the loaded image.
+ *
+ * @return  Status code.
+ * @param   iToken      Index of the first Token.
+ * @param   cTokens     Number of Tokens.
+ * @param   cParams     Number of argument slots Param Tokens may refer to.
+ * @param   ppQueue     Where to store the Queue, destroy with EvaluatorDestroyQueue().
+ */
+static int ImageBuildQueue(uint32_t iToken, uint32_t cTokens, uint32_t cParams, PQUEUE *ppQueue)
+{
+    PQUEUE pQueue = MemAllocTag(sizeof(QUEUE), enmMemTagNode);
+    if (!pQueue)
+        return RERR_NO_MEMORY;
+    QueueInit(pQueue);
+
+    int rc = RINF_SUCCESS;
+    for (uint32_t i = 0; i < cTokens && RC_SUCCESS(rc); i++)
+    {
+        PCIMAGETOKEN pImgToken = &g_Image.paTokens[iToken + i];
+        PTOKEN pToken = MemAllocZTag(sizeof(TOKEN), enmMemTagToken);
+        if (!pToken)
+        {
+            rc = RERR_NO_MEMORY;
+            break;
+        }
+        pToken->Type            = (TOKENTYPE)pImgToken->Type;
+        pToken->Position        = pImgToken->Position;
+        pToken->cFunctionParams = pImgToken->cFunctionParams;
+        switch (pImgToken->Type)
+        {
+            case enmTokenNumber:
+                if (pImgToken->uData < g_Image.pHdr->cNumbers)
+                    pToken->u.Number = g_Image.paNumbers[pImgToken->uData];
+                else
+                    rc = RERR_IMAGE_INVALID;
+                break;
+
+            case enmTokenOperator:
+                if (pImgToken->uData < g_cOperators)
+                    pToken->u.pOperator = &g_aOperators[pImgToken->uData];
+                else
+                    rc = RERR_IMAGE_INVALID;
+                break;
+
+            case enmTokenFunction:
+            {
+                rc = RERR_IMAGE_INVALID;
+                if (pImgToken->uData >= g_Image.pHdr->cNames)
+                    break;
+                const char *pszName = g_Image.pszStrings + g_Image.paoffNames[pImgToken->uData];
+                for (unsigned k = 0; k < g_cFunctions; k++)
+                {
+                    if (!StrCmp(g_aFunctions[k].pszFunction, pszName))
+                    {
+                        pToken->u.pFunction = &g_aFunctions[k];
+                        break;
+                    }
+                }
+                if (!pToken->u.pFunction)
+                    pToken->u.pFunction = ScopeFindUserFunction(&g_GlobalScope, g_Image.pauSymbols[pImgToken->uData]);
+                if (pToken->u.pFunction)
+                    rc = RINF_SUCCESS;
+                break;
+            }
+
+            case enmTokenVariable:
+                if (pImgToken->uData < g_Image.pHdr->cNames)
+                    pToken->uSymbol = g_Image.pauSymbols[pImgToken->uData];
+                else
+                    rc = RERR_IMAGE_INVALID;
+                break;
+
+            case enmTokenParam:
+                if (pImgToken->uData < cParams)
+                    pToken->u.iParam = pImgToken->uData;
+                else
+                    rc = RERR_IMAGE_INVALID;
+                break;
+
+            default:
+                rc = RERR_IMAGE_INVALID;
+                break;
+        }
+
+        if (RC_SUCCESS(rc))
+            rc = QueueAdd(pQueue, pToken);
+        if (RC_FAILURE(rc))
+            MemFree(pToken);
+    }
+
+    if (RC_SUCCESS(rc))
+        *ppQueue = pQueue;
+    else
+        EvaluatorDestroyQueue(pQueue);
+    return rc;
+}
+
+
+/**
+ * Turns a Variable of the loaded image into a Variable of the global scope, in the
+ * batch of assignments in progress.
+ *
+ * @return  Status code.
+ * @param   uSymbol     Symbol Id of the name of the variable.
+ * @param   iImgVar     Index of the Variable in the image plus one.
+ */
+static int ImageTakeVariable(uint32_t uSymbol, uint32_t iImgVar)
+{
+    PCIMAGEVAR pImgVar = &g_Image.paVars[iImgVar - 1];
+    PVARIABLE pVariable = MemAllocZTag(sizeof(VARIABLE), enmMemTagVariable);
+    PVARDEF pDef = MemAllocZTag(sizeof(VARDEF), enmMemTagVariable);
+    if (   !pVariable
+        || !pDef)
+    {
+        MemFree(pVariable);
+        MemFree(pDef);
+        return RERR_NO_MEMORY;
+    }
+
+    /* Unlike assignments, Variables of the image are seen by every reader however long ago it began. */
+    pVariable->uSymbol    = uSymbol;
+    pVariable->fCanReinit = !!(pImgVar->fFlags & IMAGE_VAR_F_CAN_REINIT);
+    pVariable->pDef       = pDef;
+    pDef->uVersion        = 0;
+    pDef->pszExpr         = StrDup(g_Image.pszStrings + pImgVar->offExpr);
+    PQUEUE pQueue = NULL;
+    int rc = pDef->pszExpr ? RINF_SUCCESS : RERR_NO_MEMORY;
+    if (   RC_SUCCESS(rc)
+        && pImgVar->cTokens)
+        rc = ImageBuildQueue(pImgVar->iToken, pImgVar->cTokens, 0 /* cParams */, &pQueue);
+    if (RC_SUCCESS(rc))
+    {
+        pDef->pvRPNQueue = pQueue;
+        rc = ScopeAddVariable(&g_GlobalScope, pVariable);
+    }
+    if (RC_FAILURE(rc))
+    {
+        DEBUGPRINTF(("Failed to take variable '%s' from the image rc=%d\n", SymTableName(&g_SymTable, uSymbol), rc));
+        EvaluatorDestroyVariable(pVariable);
+        return rc;
+    }
+
+    RCU_STORE(&g_Image.pauVarBySymbol[uSymbol], UINT32_C(0));
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Looks up a Variable of the loaded image, turning it into a Variable of the
+ * global scope the first time.
+ *
+ * @return  Pointer to the Variable or NULL if @a uSymbol is not a Variable of the
+ *          image that hasn't been looked up yet.
+ * @param   uSymbol     Symbol Id of the name of the variable to find.
+ */
+PVARIABLE ImageFindVariable(uint32_t uSymbol)
+{
+    if (   uSymbol >= g_Image.cVarBySymbol
+        || !RCU_LOAD(&g_Image.pauVarBySymbol[uSymbol]))
+        return NULL;
+
+    /*
+     * Readers get here too, only one of them takes the Variable. It can't be taken while
+     * a Variable of the global scope by the same name is there, one assigned after the
+     * calling thread's read-side section began.
+     */
+    EvaluatorWriteBegin();
+    uint32_t const iImgVar = g_Image.pauVarBySymbol[uSymbol];
+    if (   iImgVar
+        && !ScopeFindVariable(&g_GlobalScope, uSymbol))
+        ImageTakeVariable(uSymbol, iImgVar);
+    EvaluatorWriteEnd();
+    return ScopeFindVariable(&g_GlobalScope, uSymbol);
+}
+
+
+/**
+ * Defines the user-defined Functions of the loaded image in the global scope,
+ * replacing the bodies of existing ones with the same names.
+ *
+ * @return  Status code.
+ */
+static int ImageDefineFunctions(void)
+{
+    PCIMAGEHDR pHdr = g_Image.pHdr;
+
+    /*
+     * Create them all before compiling any, bodies can call Functions defined after them.
+     */
+    for (uint32_t i = 0; i < pHdr->cFunctions; i++)
+    {
+        uint32_t const uSymbol = g_Image.pauSymbols[g_Image.paFunctions[i].iName];
+        const char *pszName = SymTableName(&g_SymTable, uSymbol);
+        for (unsigned k = 0; k < g_cFunctions; k++)
+        {
+            if (!StrCmp(g_aFunctions[k].pszFunction, pszName))
+                return RERR_DUPLICATE_FUNCTION;
+        }
+
+        if (!ScopeFindUserFunction(&g_GlobalScope, uSymbol))
+        {
+            PFUNCTION pFunction = MemAllocZTag(sizeof(FUNCTION), enmMemTagFunction);
+            if (!pFunction)
+                return RERR_NO_MEMORY;
+            pFunction->pszFunction  = pszName;
+            pFunction->fUIntParams  = false;
+            pFunction->fRangeParams = true;
+            pFunction->pszSyntax    = "";
+            pFunction->pszDesc      = "";
+            int rc = ListAdd(&g_GlobalScope.UserFuncList, pFunction);
+            if (RC_FAILURE(rc))
+            {
+                MemFree(pFunction);
+                return rc;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < pHdr->cFunctions; i++)
+    {
+        PCIMAGEFUNC pImgFunc = &g_Image.paFunctions[i];
+        PFUNCTION pFunction = ScopeFindUserFunction(&g_GlobalScope, g_Image.pauSymbols[pImgFunc->iName]);
+        PQUEUE pQueue = NULL;
+        int rc = ImageBuildQueue(pImgFunc->iToken, pImgFunc->cTokens, pImgFunc->cParams, &pQueue);
+        PPROGRAM pProgram = NULL;
+        if (RC_SUCCESS(rc))
+        {
+            rc = EvaluatorCompileProgram(pQueue, pImgFunc->cParams, g_Image.pszStrings + pImgFunc->offExpr, &pProgram);
+            EvaluatorDestroyQueue(pQueue);
+        }
+        if (RC_FAILURE(rc))
+            return rc;
+
+        EvaluatorDestroyProgram(pFunction->pProgram);
+        pFunction->cMinParams = pImgFunc->cParams;
+        pFunction->cMaxParams = pImgFunc->cParams;
+        pFunction->pszDesc    = pProgram->pszExpr;
+        pFunction->pProgram   = pProgram;
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Loads an image saved by EvaluatorSaveImage(). The image is mapped read-only,
+ * its Functions are defined right away but its Variables are only copied out of
+ * the mapping when they're first looked up, names of the global scope take
+ * precedence over them. A previously loaded image is unloaded.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile         The image file.
+ * @param   pcVars          Where to store the number of Variables in the image, optional.
+ * @param   pcFunctions     Where to store the number of Functions in the image, optional.
+ */
+int EvaluatorLoadImage(const char *pszFile, uint32_t *pcVars, uint32_t *pcFunctions)
+{
+    ImageUnload();
+    int rc = FileMapOpen(&g_Image.FileMap, pszFile);
+    if (RC_SUCCESS(rc))
+        rc = ImageLoadMapped(pcVars, pcFunctions);
+    return rc;
+}
+
+
+/**
+ * Attaches an image published by EvaluatorPublishImage(). The image is shared
+ * read-only with every other process that has it attached, otherwise it behaves
+ * exactly like one loaded by EvaluatorLoadImage(): Variables of the global scope
+ * overlay those of the image. A previously loaded image is unloaded.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszName         The name the image is published under.
+ * @param   pcVars          Where to store the number of Variables in the image, optional.
+ * @param   pcFunctions     Where to store the number of Functions in the image, optional.
+ */
+int EvaluatorAttachImage(const char *pszName, uint32_t *pcVars, uint32_t *pcFunctions)
+{
+    char szShmName[sizeof(IMAGE_SHARED_PREFIX) + MAX_IMAGE_NAME_LENGTH];
+    int rc = ImageSharedName(pszName, szShmName, sizeof(szShmName));
+    if (RC_FAILURE(rc))
+        return rc;
+
+    ImageUnload();
+    rc = FileMapOpenShared(&g_Image.FileMap, szShmName);
+    if (RC_SUCCESS(rc))
+        rc = ImageLoadMapped(pcVars, pcFunctions);
+    return rc;
+}
+
+
+/**
+ * Validates and sets up the image just mapped into g_Image.FileMap, unmapping it
+ * on failure.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pcVars          Where to store the number of Variables in the image, optional.
+ * @param   pcFunctions     Where to store the number of Functions in the image, optional.
+ */
+static int ImageLoadMapped(uint32_t *pcVars, uint32_t *pcFunctions)
+{
+    int rc;
+
+    /*
+     * Check the layout before trusting anything in it.
+     */
+    PCIMAGEHDR pHdr = (PCIMAGEHDR)g_Image.FileMap.pvData;
+    if (   g_Image.FileMap.cbData < sizeof(IMAGEHDR)
+        || MemCmp(pHdr->achMagic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC))
+        || pHdr->uVersion != IMAGE_VERSION
+        || pHdr->uByteOrder != IMAGE_BYTE_ORDER
+        || pHdr->cbNumber != sizeof(NUMBER)
+        || pHdr->cOperators != g_cOperators
+        || pHdr->cbImage != g_Image.FileMap.cbData
+        || pHdr->offNumbers != sizeof(IMAGEHDR)
+        || !ImageIsArrayValid(pHdr, pHdr->offNumbers, pHdr->cNumbers, sizeof(NUMBER))
+        || !ImageIsArrayValid(pHdr, pHdr->offTokens, pHdr->cTokens, sizeof(IMAGETOKEN))
+        || !ImageIsArrayValid(pHdr, pHdr->offVars, pHdr->cVars, sizeof(IMAGEVAR))
+        || !ImageIsArrayValid(pHdr, pHdr->offFunctions, pHdr->cFunctions, sizeof(IMAGEFUNC))
+        || !ImageIsArrayValid(pHdr, pHdr->offNames, pHdr->cNames, sizeof(uint32_t))
+        || pHdr->offStrings > pHdr->cbImage
+        || pHdr->cbStrings != pHdr->cbImage - pHdr->offStrings
+        || pHdr->cbStrings == 0
+        || pHdr->cbStrings > UINT32_MAX)
+    {
+        ImageUnload();
+        return RERR_IMAGE_INVALID;
+    }
+
+    const uint8_t *pbImage = g_Image.FileMap.pvData;
+    g_Image.paNumbers   = (PCNUMBER)(pbImage + pHdr->offNumbers);
+    g_Image.paTokens    = (PCIMAGETOKEN)(pbImage + pHdr->offTokens);
+    g_Image.paVars      = (PCIMAGEVAR)(pbImage + pHdr->offVars);
+    g_Image.paFunctions = (PCIMAGEFUNC)(pbImage + pHdr->offFunctions);
+    g_Image.paoffNames  = (const uint32_t *)(pbImage + pHdr->offNames);
+    g_Image.pszStrings  = (const char *)(pbImage + pHdr->offStrings);
+    if (g_Image.pszStrings[pHdr->cbStrings - 1] != '\0')
+    {
+        ImageUnload();
+        return RERR_IMAGE_INVALID;
+    }
+
+    /*
+     * Intern the names so Tokens can be turned into real ones without looking anything up.
+     */
+    g_Image.pauSymbols = MemAllocTag((pHdr->cNames + 1) * sizeof(uint32_t), enmMemTagVariable);
+    if (!g_Image.pauSymbols)
+    {
+        ImageUnload();
+        return RERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < pHdr->cNames; i++)
+    {
+        if (g_Image.paoffNames[i] >= pHdr->cbStrings)
+        {
+            ImageUnload();
+            return RERR_IMAGE_INVALID;
+        }
+        const char *pszName = g_Image.pszStrings + g_Image.paoffNames[i];
+        rc = SymTableIntern(&g_SymTable, pszName, StrLen(pszName), &g_Image.pauSymbols[i]);
+        if (RC_FAILURE(rc))
+        {
+            ImageUnload();
+            return rc;
+        }
+    }
+
+    g_Image.cVarBySymbol   = SymTableCount(&g_SymTable) + 1;
+    g_Image.pauVarBySymbol = MemAllocZTag(g_Image.cVarBySymbol * sizeof(uint32_t), enmMemTagVariable);
+    if (!g_Image.pauVarBySymbol)
+    {
+        ImageUnload();
+        return RERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < pHdr->cVars; i++)
+    {
+        PCIMAGEVAR pImgVar = &g_Image.paVars[i];
+        if (   pImgVar->iName >= pHdr->cNames
+            || pImgVar->offExpr >= pHdr->cbStrings
+            || (   pImgVar->cTokens
+                && !ImageIsTokenRangeValid(pHdr, pImgVar->iToken, pImgVar->cTokens)))
+        {
+            ImageUnload();
+            return RERR_IMAGE_INVALID;
+        }
+        uint32_t const uSymbol = g_Image.pauSymbols[pImgVar->iName];
+        if (!ScopeFindVariable(&g_GlobalScope, uSymbol))
+            g_Image.pauVarBySymbol[uSymbol] = i + 1;
+    }
+    for (uint32_t i = 0; i < pHdr->cFunctions; i++)
+    {
+        PCIMAGEFUNC pImgFunc = &g_Image.paFunctions[i];
+        if (   pImgFunc->iName >= pHdr->cNames
+            || pImgFunc->offExpr >= pHdr->cbStrings
+            || pImgFunc->cParams > MAX_USER_FUNCTION_PARAMETERS
+            || !ImageIsTokenRangeValid(pHdr, pImgFunc->iToken, pImgFunc->cTokens))
+        {
+            ImageUnload();
+            return RERR_IMAGE_INVALID;
+        }
+    }
+
+    g_Image.pHdr = pHdr;
+    SymIndexInvalidate();
+    rc = ImageDefineFunctions();
+    if (RC_FAILURE(rc))
+    {
+        ImageUnload();
+        return rc;
+    }
+
+    if (pcVars)
+        *pcVars = pHdr->cVars;
+    if (pcFunctions)
+        *pcFunctions = pHdr->cFunctions;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Finds a Variable of the loaded image for the given index, skipping those that
+ * were looked up (they're listed with the global scope).
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   uIndex      The index of the requested variable among those of the image.
+ * @param   ppszName    Where to store the name of the variable, caller frees with
+ *                      StrFree().
+ * @param   ppszExpr    Where to store the expression assigned to the variable,
+ *                      caller frees with StrFree().
+ */
+int ImageVariableValue(unsigned uIndex, char **ppszName, char **ppszExpr)
+{
+    PCIMAGEHDR pHdr = g_Image.pHdr;
+    if (!pHdr)
+        return RERR_NO_DATA;
+
+    /*
+     * Variables are listed one index after the other, so carry on from the last one.
+     */
+    uint32_t i = 0;
+    unsigned uCur = 0;
+    if (   uIndex >= g_Image.uListIndex
+        && g_Image.iListVar < pHdr->cVars)
+    {
+        i    = g_Image.iListVar;
+        uCur = g_Image.uListIndex;
+    }
+    for (; i < pHdr->cVars; i++)
+    {
+        PCIMAGEVAR pImgVar = &g_Image.paVars[i];
+        uint32_t const uSymbol = g_Image.pauSymbols[pImgVar->iName];
+        if (g_Image.pauVarBySymbol[uSymbol] != i + 1)
+            continue;
+        if (uCur == uIndex)
+        {
+            g_Image.iListVar   = i;
+            g_Image.uListIndex = uIndex;
+            *ppszName = StrDup(SymTableName(&g_SymTable, uSymbol));
+            *ppszExpr = StrDup(g_Image.pszStrings + pImgVar->offExpr);
+            return RINF_SUCCESS;
+        }
+        ++uCur;
+    }
+    return RERR_NO_DATA;
+}
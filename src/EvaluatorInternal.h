@@ -42,6 +42,10 @@
 #define PARAM_SEP_ID                INT16_MAX - 3
 /** Variable assignment Operator Id. */
 #define VAR_ASSIGN_ID               INT16_MAX - 4
+/** Maximum number of parameters of a user-defined Function. */
+#define MAX_USER_FUNCTION_PARAMETERS 32
+/** Maximum nesting depth of user-defined Function calls. */
+#define MAX_FUNCTION_CALL_DEPTH     64
 /** Maximum length of a Variable name. */
 #define MAX_VARIABLE_NAME_LENGTH    128
 
@@ -97,21 +101,22 @@ typedef enum TOKENTYPE
     enmTokenOperator,   /**< Operator Token. */
     enmTokenFunction,   /**< Function Token. */
     enmTokenVariable,   /**< Variable Token. */
-    enmTokenCommand     /**< Command Token. */
+    enmTokenCommand,    /**< Command Token. */
+    enmTokenParam,      /**< Parameter Token, refers to an argument slot of a user-defined Function. */
+    enmTokenRange       /**< Range Token, a lazy sequence of integers only produced during evaluation. */
 } TOKENTYPE;
 
 /**
  * TOKEN: A Token.
- * A Token represents the smallest unit of parsing.
+ * A Token represents the smallest unit of parsing. Tokens are compact tagged
+ * values; names are interned in the symbol table and referenced by Id.
  */
 typedef struct TOKEN
 {
-    TOKENTYPE    Type;                                  /**< The type. */
-    uint32_t     Position;                              /**< Cursor position, an index used to flag errors. */
-    uint32_t     cFunctionParams;                       /**< Number of parameters to pass to the Function Token. */
-    char         szVariable[MAX_VARIABLE_NAME_LENGTH];  /**< Variable Name if this is a Variable Token. */
-    const char  *pszCommandExpr;                        /**< The expression of a command if this is a Command token. */
-    void        *pvCommandParamToken;                   /**< The Number Token parameter for a Command Token. */
+    TOKENTYPE    Type;                  /**< The type. */
+    uint32_t     Position;              /**< Cursor position, an index used to flag errors. */
+    uint32_t     cFunctionParams;       /**< Number of parameters to pass to the Function Token. */
+    uint32_t     uSymbol;               /**< Symbol Id of the name if this is a Variable Token. */
 
     /** The data union. */
     union
@@ -120,7 +125,18 @@ typedef struct TOKEN
         struct OPERATOR const   *pOperator;     /**< Pointer to the OPERATOR for an Operator Token. */
         struct FUNCTION const   *pFunction;     /**< Pointer to the FUNCTION for a Function Token. */
         struct VARIABLE         *pVariable;     /**< Pointer to the VARIABLE entry for a Variable Token. */
-        struct COMMAND          *pCommand;      /**< Pointer to the COMMAND entry for the Command Token. */
+        uint32_t                 iParam;        /**< Argument slot index for a Param Token. */
+        struct
+        {
+            struct COMMAND      *pCommand;      /**< Pointer to the COMMAND entry for the Command Token. */
+            struct TOKEN        *pParamToken;   /**< The Number Token parameter for the Command Token, can be NULL. */
+        } Command;
+        struct
+        {
+            uint64_t             uFirst;        /**< The first item of the Range Token. */
+            int64_t              iStep;         /**< Difference between successive items. */
+            uint64_t             cItems;        /**< Number of items, can be 0. */
+        } Range;
     } u;
 } TOKEN;
 /** Pointer to an Token object. */
@@ -128,8 +144,12 @@ typedef TOKEN *PTOKEN;
 /** Pointer to a const Token object. */
 typedef const TOKEN *PCTOKEN;
 
-/** An Operator function. */
-typedef int FNOPERATOR(PEVALUATOR pEval, PTOKEN apTokens[]);
+/**
+ * An Operator function.
+ * @a paTokens is a slice of the value stack holding the operands in order, the
+ * result is written into paTokens[0].
+ */
+typedef int FNOPERATOR(PEVALUATOR pEval, PTOKEN paTokens);
 /** Pointer to an Operator function. */
 typedef FNOPERATOR *PFNOPERATOR;
 
@@ -144,6 +164,19 @@ typedef enum OPERATORDIR
     enmDirRight         /**< Operator is right associative. */
 } OPERATORDIR;
 
+/**
+ * PROFILE: Execution profile of an Operator, Function or Command.
+ */
+typedef struct PROFILE
+{
+    uint64_t        cCalls;         /**< Number of times it was invoked. */
+    uint64_t        cNanoSecs;      /**< Cumulative (inclusive) time spent in it while profiling is enabled. */
+} PROFILE;
+/** Pointer to an execution profile. */
+typedef PROFILE *PPROFILE;
+/** Pointer to a const execution profile. */
+typedef const PROFILE *PCPROFILE;
+
 /**
  * OPERATOR: An Operator.
  * An Operator performs an operation on one or more operands.
@@ -159,15 +192,42 @@ typedef struct OPERATOR
     PFNOPERATOR     pfnOperator;    /**< Pointer to the Operator evaluator function. */
     const char     *pszSyntax;      /**< Short description of the Operator, NULL if already described. */
     const char     *pszDesc;        /**< Long description of the Operator, NULL if already described. */
+    PROFILE         Profile;        /**< Execution profile. */
 } OPERATOR;
 /** Pointer to an Operator object. */
 typedef OPERATOR *POPERATOR;
 /** Pointer to a const Operator object. */
 typedef const OPERATOR *PCOPERATOR;
 
+extern OPERATOR g_aOperators[];
+extern const unsigned g_cOperators;
+
+
+/**
+ * PROGRAM: A compiled expression.
+ * The RPN Tokens of an expression laid out contiguously so it can be evaluated
+ * any number of times without being consumed, copied or reparsed.
+ */
+typedef struct PROGRAM
+{
+    uint32_t        cTokens;        /**< Number of Tokens in @a paTokens. */
+    uint32_t        cMaxStack;      /**< Maximum depth of the value stack while evaluating. */
+    uint32_t        cParams;        /**< Number of argument slots referred to by Param Tokens. */
+    char           *pszExpr;        /**< The source text of the definition. */
+    TOKEN          *paTokens;       /**< The Tokens in RPN order. */
+} PROGRAM;
+/** Pointer to a Program object. */
+typedef PROGRAM *PPROGRAM;
+/** Pointer to a const Program object. */
+typedef const PROGRAM *PCPROGRAM;
 
-/** A function. */
-typedef int FNFUNCTION(PEVALUATOR pEval, PTOKEN apTokens[], uint32_t cTokens);
+
+/**
+ * A function.
+ * @a paTokens is a slice of the value stack holding the @a cTokens parameters in
+ * order, the result is written into paTokens[0].
+ */
+typedef int FNFUNCTION(PEVALUATOR pEval, PTOKEN paTokens, uint32_t cTokens);
 /** Pointer to a Function function. */
 typedef FNFUNCTION *PFNFUNCTION;
 
@@ -180,10 +240,13 @@ typedef struct FUNCTION
     const char     *pszFunction;    /**< Name of the Function as seen in the expression. */
     PFNFUNCTION     pfnFunction;    /**< Pointer to the Function evaluator function. */
     bool            fUIntParams;    /**< Whether the parameters must all fit into uint64_t */
+    bool            fRangeParams;   /**< Whether the parameters can be Range Tokens (reductions). */
     uint32_t        cMinParams;     /**< Minimum parameters accepted by @a pfnFunction. */
     uint32_t        cMaxParams;     /**< Maximum paramaters accepted by @a pfnFunction. */
     const char     *pszSyntax;      /**< Short description of the Function, NULL if already described. */
     const char     *pszDesc;        /**< Long description of the Function, NULL if already described. */
+    PPROGRAM        pProgram;       /**< Compiled body of a user-defined Function, NULL for built-ins. */
+    PROFILE         Profile;        /**< Execution profile. */
 } FUNCTION;
 /** Pointer to a Function object. */
 typedef FUNCTION *PFUNCTION;
@@ -191,15 +254,31 @@ typedef FUNCTION *PFUNCTION;
 typedef const FUNCTION *PCFUNCTION;
 
 
+/**
+ * VARDEF: An assignment of a Variable. Published assignments are never modified,
+ * except for parsing a lazily defined one once, readers may still be using them.
+ */
+typedef struct VARDEF
+{
+    char           *pszExpr;        /**< The expression assigned to the variable. */
+    void           *pvRPNQueue;     /**< Pointer to the RPN Queue, NULL until first used if defined lazily. */
+    uint64_t        uVersion;       /**< Version of the Variables the assignment was published in, 0 if always visible. */
+    struct VARDEF  *pPrev;          /**< The assignment it replaced, kept while readers may still see it. */
+} VARDEF;
+/** Pointer to a Variable assignment. */
+typedef VARDEF *PVARDEF;
+/** Pointer to a const Variable assignment. */
+typedef const VARDEF *PCVARDEF;
+
 /**
  * VARIABLE: Variable table entry to match names to values.
  */
 typedef struct VARIABLE
 {
-    char    szVariable[MAX_VARIABLE_NAME_LENGTH]; /**< Name of the variable as seen in the expression. */
-    char   *pszExpr;                              /**< The expression assigned to the variable. */
-    bool    fCanReinit;                           /**< Whether this variable can be re-assigned. */
-    void   *pvRPNQueue;                           /**< Pointer to the RPN Queue. */
+    uint32_t    uSymbol;        /**< Symbol Id of the name of the variable as seen in the expression. */
+    PVARDEF     pDef;           /**< The latest assignment, older ones readers may see follow it. */
+    bool        fCanReinit;     /**< Whether this variable can be re-assigned. */
+    bool        fPredefined;    /**< Whether this is one of the predefined constants. */
 } VARIABLE;
 /** Pointer to a Varbucket object. */
 typedef VARIABLE *PVARIABLE;
@@ -224,6 +303,7 @@ typedef struct COMMAND
     PFNCOMMAND      pfnCommand;    /**< Pointer to the Command evaluator function. */
     const char     *pszSyntax;     /**< Short description of the Command, NULL if already described. */
     const char     *pszDesc;       /** Long description of the Command, NULL if already described. */
+    PROFILE         Profile;       /**< Execution profile. */
 } COMMAND;
 /** Pointer to a Command object. */
 typedef COMMAND *PCOMMAND;
@@ -236,5 +316,52 @@ static inline bool TokenIsNumber(PCTOKEN pToken)
     return (pToken && pToken->Type == enmTokenNumber);
 }
 
+static inline bool TokenIsRange(PCTOKEN pToken)
+{
+    return (pToken && pToken->Type == enmTokenRange);
+}
+
+static inline bool TokenIsFunction(PCTOKEN pToken)
+{
+    return (pToken && pToken->Type == enmTokenFunction);
+}
+
+static inline bool TokenIsVariable(PCTOKEN pToken)
+{
+    return (pToken && pToken->Type == enmTokenVariable);
+}
+
+/**
+ * Returns the number of items a Number or Range Token stands for.
+ *
+ * @return  Number of items.
+ * @param   pToken      The Number or Range Token.
+ */
+static inline uint64_t TokenItemCount(PCTOKEN pToken)
+{
+    return TokenIsRange(pToken) ? pToken->u.Range.cItems : 1;
+}
+
+/**
+ * Gets an item of a Number or Range Token. Range items are computed on the fly
+ * and are signed 64-bit integers.
+ *
+ * @param   pToken      The Number or Range Token.
+ * @param   iItem       Index of the item, must be less than TokenItemCount().
+ * @param   pNumber     Where to store the item.
+ */
+static inline void TokenItemAt(PCTOKEN pToken, uint64_t iItem, PNUMBER pNumber)
+{
+    if (TokenIsRange(pToken))
+    {
+        pNumber->uValue = pToken->u.Range.uFirst + iItem * (uint64_t)pToken->u.Range.iStep;
+        pNumber->dValue = (int64_t)pNumber->uValue;
+    }
+    else
+        *pNumber = pToken->u.Number;
+}
+
+int EvaluatorConsumeSteps(PEVALUATOR pEval, uint64_t cSteps);
+
 #endif /* EVALUATOR_INTERNAL_H___ */
 
@@ -0,0 +1,1088 @@
+/** @file
+ * Evaluator worksheets, the Variables of a file kept up to date in dependency
+ * order.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*******************************************************************************
+ *   Header Files                                                              *
+ *******************************************************************************/
+#include "EvaluatorCore.h"
+#include "EvaluatorFunctions.h"
+#include "Assert.h"
+#include "GenericDefs.h"
+#include "Errors.h"
+#include "Magics.h"
+#include "StringOps.h"
+#include "Timestamp.h"
+#include "Thread.h"
+#include "Rcu.h"
+
+
+/*******************************************************************************
+ *   Defines                                                                   *
+ *******************************************************************************/
+/** Minimum number of nodes in a level of a worksheet before it's worth waking the workers. */
+#define SHEET_PARALLEL_LEVEL_MIN    64
+/** Maximum number of nodes of a level handed to a worker at a time. */
+#define SHEET_CHUNK_MAX             256
+/** Trace thread ID of the worksheet worker with index 0, that worker being the caller. */
+#define SHEET_TRACE_THREAD          0x200
+/** Number of dependencies left behind by rescans that are tolerated before compacting them. */
+#define SHEET_DEPS_SLACK_MIN        1024
+
+
+/**
+ * SHEETRESULT: The result of evaluating a Variable of a worksheet.
+ */
+typedef struct SHEETRESULT
+{
+    int             rc;             /**< Status of the evaluation. */
+    const char     *pszCulprit;     /**< Name of the Variable that failed the evaluation, if it failed. */
+    NUMBER          Value;          /**< The value, if evaluated successfully. */
+} SHEETRESULT;
+/** Pointer to a worksheet result. */
+typedef SHEETRESULT *PSHEETRESULT;
+/** Pointer to a const worksheet result. */
+typedef const SHEETRESULT *PCSHEETRESULT;
+
+/**
+ * SHEETNODE: A Variable evaluated by a worksheet, see EvaluatorSheetCreate().
+ */
+typedef struct SHEETNODE
+{
+    PVARIABLE       pVariable;      /**< The Variable. */
+    uint32_t        iFirstDep;      /**< Index of its first dependency in EVALSHEET::pauDeps. */
+    uint32_t        cDeps;          /**< Number of Variables it uses, directly or through Functions. */
+    uint32_t        cPending;       /**< Number of dependencies the current update has yet to evaluate. */
+    uint32_t        uLoad;          /**< The load that last found it in the file, for dropping duplicates. */
+    bool            fStale;         /**< Whether it must be scanned and evaluated again. */
+    bool            fInvalid;       /**< Whether its expression fails to parse. */
+    bool            fDirty;         /**< Whether the current update evaluates it. */
+    bool            fReported;      /**< Whether @a Reported is valid. */
+    SHEETRESULT     Result;         /**< The result of its last evaluation. */
+    SHEETRESULT     Reported;       /**< The result last reported. */
+} SHEETNODE;
+/** Pointer to a worksheet node. */
+typedef SHEETNODE *PSHEETNODE;
+/** Pointer to a const worksheet node. */
+typedef const SHEETNODE *PCSHEETNODE;
+
+/**
+ * SHEETLINE: A line of a worksheet that is parsed when loaded, e.g. a Function
+ * definition, remembered so it's parsed again only when it changes.
+ */
+typedef struct SHEETLINE
+{
+    char           *pszLine;        /**< The line. */
+    uint32_t        uSymbol;        /**< Symbol Id of the Variable it assigns, NIL_SYMBOL if none. */
+} SHEETLINE;
+/** Pointer to a worksheet line. */
+typedef SHEETLINE *PSHEETLINE;
+/** Pointer to a const worksheet line. */
+typedef const SHEETLINE *PCSHEETLINE;
+
+/**
+ * EVALSHEET: A worksheet, the dependency graph of the Variables of a file and the
+ * state of their evaluation.
+ */
+struct EVALSHEET
+{
+    char           *pszFile;        /**< The file. */
+    uint32_t        cMaxThreads;    /**< Maximum number of threads. */
+    uint64_t        cMaxSteps;      /**< Step budget of each node, 0 for unlimited. */
+    uint64_t        cMaxMilliSecs;  /**< Wall-clock budget of each node in milliseconds, 0 for unlimited. */
+    PTRACE          pTrace;         /**< Where to record the timeline of updates, NULL when disabled. */
+    PSHEETNODE      paNodes;        /**< The nodes. */
+    uint32_t        cNodes;         /**< Number of nodes. */
+    uint32_t        cNodesAlloc;    /**< Number of nodes allocated. */
+    uint32_t       *pauNodeBySymbol;/**< Index + 1 of the node of each Symbol Id, 0 for none. */
+    uint32_t        cSymbols;       /**< Number of entries in @a pauNodeBySymbol. */
+    uint32_t       *pauDeps;        /**< Node indexes of the dependencies of all nodes. */
+    uint32_t        cDeps;          /**< Number of entries in @a pauDeps. */
+    uint32_t        cDepsAlloc;     /**< Number of entries allocated in @a pauDeps. */
+    uint32_t        cDepsLive;      /**< Number of entries of @a pauDeps in use, the rest being left by rescans. */
+    uint32_t       *pauDepMark;     /**< The scan that last added each node as a dependency, for dropping duplicates. */
+    uint32_t        cDepMarkAlloc;  /**< Number of entries allocated in @a pauDepMark. */
+    uint32_t        uScan;          /**< Number of node scans so far. */
+    PCPROGRAM      *papPrograms;    /**< Function bodies used by the node being scanned. */
+    uint32_t        cPrograms;      /**< Number of entries in @a papPrograms. */
+    uint32_t        cProgramsAlloc; /**< Number of entries allocated in @a papPrograms. */
+    const char    **papszFunctions; /**< Names of the Functions redefined since the last scan. */
+    uint32_t        cFunctions;     /**< Number of entries in @a papszFunctions. */
+    uint32_t        cFunctionsAlloc;/**< Number of entries allocated in @a papszFunctions. */
+    bool            fCallsRedefined;/**< Whether the node being scanned calls a redefined Function. */
+    bool            fSerial;        /**< Whether a Function that is not thread-safe is used. */
+    EVALUATOR       LineEval;       /**< The Evaluator parsing the lines of the file while loading. */
+    uint32_t        uLoad;          /**< Number of loads so far. */
+    PSHEETLINE      paLines;        /**< The lines parsed by the last load, sorted. */
+    uint32_t        cLines;         /**< Number of entries in @a paLines. */
+    PSHEETLINE      paNewLines;     /**< The lines of the load in progress. */
+    uint32_t        cNewLines;      /**< Number of entries in @a paNewLines. */
+    uint32_t        cNewLinesAlloc; /**< Number of entries allocated in @a paNewLines. */
+    uint32_t       *pauFileNodes;   /**< The nodes of the Variables of the file, in the order of the file. */
+    uint32_t        cFileNodes;     /**< Number of entries in @a pauFileNodes. */
+    uint32_t        cFileNodesAlloc;/**< Number of entries allocated in @a pauFileNodes. */
+    uint32_t       *pauUserStart;   /**< Index of the first user of each node in @a pauUsers, during an update. */
+    uint32_t       *pauUsers;       /**< Node indexes of the users of all nodes, during an update. */
+    uint32_t       *pauDirty;       /**< Node indexes of the nodes evaluated by the update in progress. */
+    uint32_t        cDirty;         /**< Number of entries in @a pauDirty. */
+    uint32_t       *pauLevels;      /**< Node indexes of the levels evaluated so far, one after the other. */
+    uint32_t       *pauLevel;       /**< Node indexes of the level being evaluated. */
+    uint32_t        cLevel;         /**< Number of entries in @a pauLevel. */
+    uint32_t        iNext;          /**< Next entry of @a pauLevel to hand out. */
+    uint32_t        cChunk;         /**< Number of entries of @a pauLevel handed out at a time. */
+    PTHREADMUTEX    pMutex;         /**< Protects the members below and @a iNext. */
+    PTHREADCOND     pWorkCond;      /**< Signalled when a level is ready or the workers must quit. */
+    PTHREADCOND     pDoneCond;      /**< Signalled when the last worker finished its share of a level. */
+    uint32_t        uGeneration;    /**< Incremented for each level handed to the workers. */
+    uint32_t        cBusy;          /**< Number of workers still evaluating the current level. */
+    bool            fShutdown;      /**< Whether the workers must quit. */
+};
+
+/**
+ * SHEETWORKER: A thread evaluating levels of a worksheet.
+ */
+typedef struct SHEETWORKER
+{
+    PEVALSHEET      pSheet;         /**< The worksheet. */
+    EVALUATOR       Eval;           /**< The Evaluator of the thread. */
+    PTHREAD         pThread;        /**< The thread, NULL for the calling thread. */
+} SHEETWORKER;
+/** Pointer to a worksheet worker. */
+typedef SHEETWORKER *PSHEETWORKER;
+
+
+/**
+ * Gets the node of a Variable, adding one if there's none yet. New nodes are
+ * stale, i.e. yet to be scanned and evaluated.
+ *
+ * @return  Status code.
+ * @param   pSheet      The worksheet.
+ * @param   pVariable   The Variable.
+ * @param   piNode      Where to store the index of the node.
+ */
+static int SheetNodeForVariable(PEVALSHEET pSheet, PVARIABLE pVariable, uint32_t *piNode)
+{
+    uint32_t const uSymbol = pVariable->uSymbol;
+    if (uSymbol >= pSheet->cSymbols)
+    {
+        /* Parsing lazily defined Variables interns the names they use. */
+        uint32_t const cSymbols = R_MAX(SymTableCount(&g_SymTable), uSymbol + 1);
+        uint32_t *pauNodeBySymbol = MemReallocTag(pSheet->pauNodeBySymbol, cSymbols * sizeof(uint32_t), enmMemTagVariable);
+        if (!pauNodeBySymbol)
+            return RERR_NO_MEMORY;
+        MemSet(pauNodeBySymbol + pSheet->cSymbols, 0, (cSymbols - pSheet->cSymbols) * sizeof(uint32_t));
+        pSheet->pauNodeBySymbol = pauNodeBySymbol;
+        pSheet->cSymbols        = cSymbols;
+    }
+    if (pSheet->pauNodeBySymbol[uSymbol])
+    {
+        *piNode = pSheet->pauNodeBySymbol[uSymbol] - 1;
+        return RINF_SUCCESS;
+    }
+
+    int rc = EvaluatorGrowArray((void **)&pSheet->paNodes, &pSheet->cNodesAlloc, pSheet->cNodes, sizeof(SHEETNODE));
+    if (RC_SUCCESS(rc))
+        rc = EvaluatorGrowArray((void **)&pSheet->pauDepMark, &pSheet->cDepMarkAlloc, pSheet->cNodes, sizeof(uint32_t));
+    if (RC_FAILURE(rc))
+        return rc;
+
+    PSHEETNODE pNode = &pSheet->paNodes[pSheet->cNodes];
+    MemSet(pNode, 0, sizeof(*pNode));
+    pNode->pVariable = pVariable;
+    pNode->fStale    = true;
+    pSheet->pauDepMark[pSheet->cNodes] = 0;
+    *piNode = pSheet->cNodes++;
+    pSheet->pauNodeBySymbol[uSymbol] = *piNode + 1;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Compares worksheet lines, for qsort() and bsearch().
+ */
+static int SheetLineCompare(const void *pvLine1, const void *pvLine2)
+{
+    return StrCmp(((PCSHEETLINE)pvLine1)->pszLine, ((PCSHEETLINE)pvLine2)->pszLine);
+}
+
+
+/**
+ * Defines what a line of a worksheet defines, see EvaluatorForEachDefinition().
+ * Definitions that didn't change since the last load are left alone, those that
+ * did make the node of their Variable stale. Redefined Functions are noted so the
+ * nodes calling them are found by the next scan.
+ */
+static int SheetLoadLine(void *pvUser, const char *pszLine, uint32_t iLine)
+{
+    PEVALSHEET pSheet = pvUser;
+    NOREF(iLine);
+
+    uint32_t uSymbol = NIL_SYMBOL;
+    bool fChanged = true;
+    size_t cchName;
+    const char *pszExpr;
+    int rc;
+    if (EvaluatorIsPlainDefinition(pszLine, &cchName, &pszExpr))
+    {
+        TOKEN VarToken;
+        MemSet(&VarToken, 0, sizeof(VarToken));
+        VarToken.Type = enmTokenVariable;
+        rc = SymTableIntern(&g_SymTable, pszLine, cchName, &VarToken.uSymbol);
+        if (RC_FAILURE(rc))
+            return rc;
+        uSymbol = VarToken.uSymbol;
+
+        PCVARIABLE pVariable = EvaluatorFindVariable(uSymbol);
+        PCVARDEF pDef = pVariable ? VariableDef(pVariable) : NULL;
+        fChanged = !pDef
+                || !pDef->pszExpr
+                || StrCmp(pDef->pszExpr, pszExpr);
+        if (fChanged)
+        {
+            rc = EvaluatorAssignVariable(&pSheet->LineEval, &VarToken, pszExpr, NULL /* pQueue */);
+            if (RC_FAILURE(rc))
+                return rc;
+        }
+    }
+    else
+    {
+        SHEETLINE Line;
+        Line.pszLine = (char *)pszLine;
+        PCSHEETLINE pOldLine = pSheet->cLines ? bsearch(&Line, pSheet->paLines, pSheet->cLines, sizeof(SHEETLINE), SheetLineCompare)
+                                              : NULL;
+        if (pOldLine)
+        {
+            uSymbol  = pOldLine->uSymbol;
+            fChanged = false;
+        }
+        else
+        {
+            rc = EvaluatorParse(&pSheet->LineEval, pszLine);
+            if (   RC_SUCCESS(rc)
+                && !pSheet->LineEval.Result.fVariableAssignment
+                && !pSheet->LineEval.Result.fFunctionDefinition)
+                rc = RERR_EXPRESSION_INVALID;
+            if (   RC_SUCCESS(rc)
+                && pSheet->LineEval.Result.fFunctionDefinition)
+            {
+                rc = EvaluatorGrowArray((void **)&pSheet->papszFunctions, &pSheet->cFunctionsAlloc, pSheet->cFunctions,
+                                        sizeof(const char *));
+                if (RC_SUCCESS(rc))
+                    pSheet->papszFunctions[pSheet->cFunctions++] = pSheet->LineEval.Result.pszFunction;
+            }
+            if (RC_FAILURE(rc))
+                return rc;
+            if (pSheet->LineEval.Result.fVariableAssignment)
+                uSymbol = SymTableLookup(&g_SymTable, pSheet->LineEval.Result.pszVariable,
+                                         StrLen(pSheet->LineEval.Result.pszVariable));
+        }
+
+        rc = EvaluatorGrowArray((void **)&pSheet->paNewLines, &pSheet->cNewLinesAlloc, pSheet->cNewLines, sizeof(SHEETLINE));
+        if (RC_FAILURE(rc))
+            return rc;
+        Line.pszLine = StrDup(pszLine);
+        Line.uSymbol = uSymbol;
+        if (!Line.pszLine)
+            return RERR_NO_MEMORY;
+        pSheet->paNewLines[pSheet->cNewLines++] = Line;
+    }
+
+    if (uSymbol == NIL_SYMBOL)
+        return RINF_SUCCESS;
+    PVARIABLE pVariable = EvaluatorFindVariable(uSymbol);
+    if (!pVariable)
+        return RINF_SUCCESS;
+
+    uint32_t iNode;
+    rc = SheetNodeForVariable(pSheet, pVariable, &iNode);
+    if (RC_FAILURE(rc))
+        return rc;
+    PSHEETNODE pNode = &pSheet->paNodes[iNode];
+    if (fChanged)
+        pNode->fStale = true;
+    if (pNode->uLoad != pSheet->uLoad)
+    {
+        pNode->uLoad = pSheet->uLoad;
+        rc = EvaluatorGrowArray((void **)&pSheet->pauFileNodes, &pSheet->cFileNodesAlloc, pSheet->cFileNodes, sizeof(uint32_t));
+        if (RC_FAILURE(rc))
+            return rc;
+        pSheet->pauFileNodes[pSheet->cFileNodes++] = iNode;
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Frees the lines of a worksheet.
+ *
+ * @param   paLines     The lines, can be NULL.
+ * @param   cLines      Number of lines.
+ */
+static void SheetFreeLines(PSHEETLINE paLines, uint32_t cLines)
+{
+    for (uint32_t i = 0; i < cLines; i++)
+        StrFree(paLines[i].pszLine);
+    MemFree(paLines);
+}
+
+
+/**
+ * Loads the file of a worksheet, defining what changed since the last load.
+ *
+ * @return  Status code. Definitions before a failing line stay and are picked up
+ *          by the next load that succeeds.
+ * @param   pSheet      The worksheet.
+ * @param   piLine      Where to store the number of the line that failed, optional.
+ */
+static int SheetLoad(PEVALSHEET pSheet, uint32_t *piLine)
+{
+    ++pSheet->uLoad;
+    pSheet->cFileNodes = 0;
+    pSheet->paNewLines     = NULL;
+    pSheet->cNewLines      = 0;
+    pSheet->cNewLinesAlloc = 0;
+
+    EvaluatorInitInternal(&pSheet->LineEval);
+    EvaluatorWriteBegin();
+    int rc = EvaluatorForEachDefinition(pSheet->pszFile, SheetLoadLine, pSheet, piLine);
+    EvaluatorWriteEnd();
+    EvaluatorDestroy(&pSheet->LineEval);
+
+    /*
+     * The lines seen this time are the ones to compare with next time, even if loading
+     * failed half-way: lines of the last load might have been overridden since.
+     */
+    SheetFreeLines(pSheet->paLines, pSheet->cLines);
+    if (pSheet->cNewLines)
+        qsort(pSheet->paNewLines, pSheet->cNewLines, sizeof(SHEETLINE), SheetLineCompare);
+    pSheet->paLines    = pSheet->paNewLines;
+    pSheet->cLines     = pSheet->cNewLines;
+    pSheet->paNewLines = NULL;
+    pSheet->cNewLines  = 0;
+    return rc;
+}
+
+
+/**
+ * Notes what a Token of a node's expression, or of a Function body it calls,
+ * makes the node depend on.
+ *
+ * @return  Status code.
+ * @param   pSheet      The worksheet.
+ * @param   iNode       Index of the node.
+ * @param   pToken      The Token.
+ */
+static int SheetScanToken(PEVALSHEET pSheet, uint32_t iNode, PCTOKEN pToken)
+{
+    if (TokenIsFunction(pToken))
+    {
+        PCFUNCTION pFunction = pToken->u.pFunction;
+        if (!pFunction->pProgram)
+        {
+            if (!FunctionIsThreadSafe(pFunction))
+                pSheet->fSerial = true;
+            return RINF_SUCCESS;
+        }
+
+        /* Function bodies are scanned by the caller, once per node however often they're called. */
+        for (uint32_t i = 0; i < pSheet->cPrograms; i++)
+            if (pSheet->papPrograms[i] == pFunction->pProgram)
+                return RINF_SUCCESS;
+        int rc = EvaluatorGrowArray((void **)&pSheet->papPrograms, &pSheet->cProgramsAlloc, pSheet->cPrograms, sizeof(PCPROGRAM));
+        if (RC_FAILURE(rc))
+            return rc;
+        pSheet->papPrograms[pSheet->cPrograms++] = pFunction->pProgram;
+
+        /* Function names are interned, see ScopeFindUserFunction(). */
+        for (uint32_t i = 0; i < pSheet->cFunctions; i++)
+            if (pSheet->papszFunctions[i] == pFunction->pszFunction)
+                pSheet->fCallsRedefined = true;
+        return RINF_SUCCESS;
+    }
+
+    if (!TokenIsVariable(pToken))
+        return RINF_SUCCESS;
+
+    /*
+     * Undefined Variables aren't part of the graph, evaluating the node reports them.
+     */
+    PVARIABLE pVariable = EvaluatorFindVariable(pToken->uSymbol);
+    if (!pVariable)
+        return RINF_SUCCESS;
+
+    uint32_t iDep;
+    int rc = SheetNodeForVariable(pSheet, pVariable, &iDep);
+    if (RC_FAILURE(rc))
+        return rc;
+    if (pSheet->pauDepMark[iDep] == pSheet->uScan)
+        return RINF_SUCCESS;
+    pSheet->pauDepMark[iDep] = pSheet->uScan;
+
+    rc = EvaluatorGrowArray((void **)&pSheet->pauDeps, &pSheet->cDepsAlloc, pSheet->cDeps, sizeof(uint32_t));
+    if (RC_FAILURE(rc))
+        return rc;
+    pSheet->pauDeps[pSheet->cDeps++] = iDep;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Scans a node for the nodes it depends on, adding nodes for the Variables it uses
+ * on the way. Its dependencies are appended to the others, those of an earlier
+ * scan are left behind until compacted.
+ *
+ * @return  Status code, a Variable that fails to parse doesn't fail it.
+ * @param   pSheet      The worksheet.
+ * @param   iNode       Index of the node.
+ */
+static int SheetScanNode(PEVALSHEET pSheet, uint32_t iNode)
+{
+    PSHEETNODE pNode = &pSheet->paNodes[iNode];
+    pSheet->cDepsLive -= pNode->cDeps;
+    pNode->iFirstDep = pSheet->cDeps;
+    pNode->cDeps     = 0;
+    pNode->fInvalid  = false;
+
+    PVARIABLE pVariable = pNode->pVariable;
+    PVARDEF pDef = VariableDef(pVariable);
+    int rc = pDef ? EvaluatorCompileVariable(pVariable, pDef) : RERR_VARIABLE_UNDEFINED;
+    if (rc == RERR_NO_MEMORY)
+        return rc;
+    if (RC_FAILURE(rc))
+    {
+        pNode->fInvalid = true;
+        pNode->fStale   = true;
+        return RINF_SUCCESS;
+    }
+
+    ++pSheet->uScan;
+    pSheet->cPrograms       = 0;
+    pSheet->fCallsRedefined = false;
+    for (PCQUEUEITEM pItem = ((PCQUEUE)pDef->pvRPNQueue)->pHead; pItem && RC_SUCCESS(rc); pItem = pItem->pNext)
+        rc = SheetScanToken(pSheet, iNode, pItem->pvData);
+    for (uint32_t iProgram = 0; iProgram < pSheet->cPrograms && RC_SUCCESS(rc); iProgram++)
+    {
+        PCPROGRAM pProgram = pSheet->papPrograms[iProgram];
+        for (uint32_t i = 0; i < pProgram->cTokens && RC_SUCCESS(rc); i++)
+            rc = SheetScanToken(pSheet, iNode, &pProgram->paTokens[i]);
+    }
+
+    /* SheetScanToken() may have moved the nodes. */
+    pNode = &pSheet->paNodes[iNode];
+    pNode->cDeps = pSheet->cDeps - pNode->iFirstDep;
+    pSheet->cDepsLive += pNode->cDeps;
+    if (pSheet->fCallsRedefined)
+        pNode->fStale = true;
+    return rc;
+}
+
+
+/**
+ * Drops the dependencies left behind by rescans.
+ *
+ * @return  Status code.
+ * @param   pSheet      The worksheet.
+ */
+static int SheetCompactDeps(PEVALSHEET pSheet)
+{
+    uint32_t const cDepsAlloc = R_MAX(pSheet->cDepsLive, 1);
+    uint32_t *pauDeps = MemAllocTag(cDepsAlloc * sizeof(uint32_t), enmMemTagVariable);
+    if (!pauDeps)
+        return RERR_NO_MEMORY;
+
+    uint32_t cDeps = 0;
+    for (uint32_t iNode = 0; iNode < pSheet->cNodes; iNode++)
+    {
+        PSHEETNODE pNode = &pSheet->paNodes[iNode];
+        MemCpy(&pauDeps[cDeps], &pSheet->pauDeps[pNode->iFirstDep], pNode->cDeps * sizeof(uint32_t));
+        pNode->iFirstDep = cDeps;
+        cDeps += pNode->cDeps;
+    }
+    Assert(cDeps == pSheet->cDepsLive);
+
+    MemFree(pSheet->pauDeps);
+    pSheet->pauDeps    = pauDeps;
+    pSheet->cDeps      = cDeps;
+    pSheet->cDepsAlloc = cDepsAlloc;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Brings the dependency graph of a worksheet up to date, scanning the stale nodes
+ * and the nodes they add. Lazily defined Variables are parsed and Variables of
+ * the image taken into the global scope on the way, so evaluating doesn't modify
+ * anything shared. When Functions were redefined every node is scanned again,
+ * those calling them becoming stale.
+ *
+ * @return  Status code.
+ * @param   pSheet      The worksheet.
+ */
+static int SheetScan(PEVALSHEET pSheet)
+{
+    bool const fAll = pSheet->cFunctions > 0;
+    for (uint32_t iNode = 0; iNode < pSheet->cNodes; iNode++)
+    {
+        if (   fAll
+            || pSheet->paNodes[iNode].fStale)
+        {
+            int rc = SheetScanNode(pSheet, iNode);
+            if (RC_FAILURE(rc))
+                return rc;
+        }
+    }
+    pSheet->cFunctions = 0;
+
+    if (pSheet->cDeps - pSheet->cDepsLive > R_MAX(pSheet->cDepsLive, SHEET_DEPS_SLACK_MIN))
+        return SheetCompactDeps(pSheet);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Finds the nodes the update in progress evaluates: the stale ones and those
+ * depending on them, however indirectly. The users of each node, the reverse of
+ * the dependencies, are indexed on the way.
+ *
+ * @return  Status code.
+ * @param   pSheet      The worksheet.
+ */
+static int SheetMarkDirty(PEVALSHEET pSheet)
+{
+    uint32_t const cNodes = pSheet->cNodes;
+    pSheet->pauUserStart = MemAllocZTag((cNodes + 1) * sizeof(uint32_t), enmMemTagVariable);
+    pSheet->pauUsers     = MemAllocTag(R_MAX(pSheet->cDepsLive, 1) * sizeof(uint32_t), enmMemTagVariable);
+    pSheet->pauDirty     = MemAllocTag(R_MAX(cNodes, 1) * sizeof(uint32_t), enmMemTagVariable);
+    pSheet->pauLevels    = MemAllocTag(R_MAX(cNodes, 1) * sizeof(uint32_t), enmMemTagVariable);
+    if (   !pSheet->pauUserStart
+        || !pSheet->pauUsers
+        || !pSheet->pauDirty
+        || !pSheet->pauLevels)
+        return RERR_NO_MEMORY;
+
+    uint32_t *pauUserStart = pSheet->pauUserStart;
+    uint32_t *pauUsers     = pSheet->pauUsers;
+    for (uint32_t iNode = 0; iNode < cNodes; iNode++)
+    {
+        PCSHEETNODE pNode = &pSheet->paNodes[iNode];
+        for (uint32_t i = 0; i < pNode->cDeps; i++)
+            ++pauUserStart[pSheet->pauDeps[pNode->iFirstDep + i] + 1];
+    }
+    for (uint32_t i = 0; i < cNodes; i++)
+        pauUserStart[i + 1] += pauUserStart[i];
+    for (uint32_t iNode = 0; iNode < cNodes; iNode++)
+    {
+        PCSHEETNODE pNode = &pSheet->paNodes[iNode];
+        for (uint32_t i = 0; i < pNode->cDeps; i++)
+            pauUsers[pauUserStart[pSheet->pauDeps[pNode->iFirstDep + i]]++] = iNode;
+    }
+    for (uint32_t i = cNodes; i > 0; i--)
+        pauUserStart[i] = pauUserStart[i - 1];
+    pauUserStart[0] = 0;
+
+    /*
+     * Spread staleness to the users.
+     */
+    uint32_t cDirty = 0;
+    for (uint32_t iNode = 0; iNode < cNodes; iNode++)
+    {
+        PSHEETNODE pNode = &pSheet->paNodes[iNode];
+        pNode->fDirty = pNode->fStale;
+        if (pNode->fDirty)
+            pSheet->pauDirty[cDirty++] = iNode;
+    }
+    for (uint32_t iDirty = 0; iDirty < cDirty; iDirty++)
+    {
+        uint32_t const iNode = pSheet->pauDirty[iDirty];
+        for (uint32_t i = pauUserStart[iNode]; i < pauUserStart[iNode + 1]; i++)
+        {
+            PSHEETNODE pUser = &pSheet->paNodes[pauUsers[i]];
+            if (!pUser->fDirty)
+            {
+                pUser->fDirty = true;
+                pSheet->pauDirty[cDirty++] = pauUsers[i];
+            }
+        }
+    }
+    pSheet->cDirty = cDirty;
+
+    /* Dirty nodes stay stale until evaluated, should the update fail before. */
+    for (uint32_t iDirty = 0; iDirty < cDirty; iDirty++)
+    {
+        PSHEETNODE pNode = &pSheet->paNodes[pSheet->pauDirty[iDirty]];
+        pNode->fStale   = true;
+        pNode->cPending = 0;
+        for (uint32_t i = 0; i < pNode->cDeps; i++)
+            if (pSheet->paNodes[pSheet->pauDeps[pNode->iFirstDep + i]].fDirty)
+                ++pNode->cPending;
+        pNode->Result.rc         = pNode->fInvalid ? RERR_VARIABLE_INVALID_DEFINITION : RINF_SUCCESS;
+        pNode->Result.pszCulprit = pNode->fInvalid ? VariableName(pNode->pVariable) : NULL;
+        MemSet(&pNode->Result.Value, 0, sizeof(pNode->Result.Value));
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Evaluates a node whose dependencies have all been evaluated.
+ *
+ * @param   pSheet      The worksheet.
+ * @param   pEval       The Evaluator of the calling thread.
+ * @param   iNode       Index of the node.
+ */
+static void SheetEvaluateNode(PEVALSHEET pSheet, PEVALUATOR pEval, uint32_t iNode)
+{
+    PSHEETNODE pNode = &pSheet->paNodes[iNode];
+    if (RC_FAILURE(pNode->Result.rc))
+        return;
+
+    /*
+     * The dependencies were evaluated by earlier levels or updates, mark them resolved
+     * so their values are used as they are rather than evaluated all over again.
+     */
+    for (uint32_t i = 0; i < pNode->cDeps; i++)
+    {
+        PCSHEETNODE pDep = &pSheet->paNodes[pSheet->pauDeps[pNode->iFirstDep + i]];
+        if (RC_FAILURE(pDep->Result.rc))
+        {
+            pNode->Result.rc         = pDep->Result.rc;
+            pNode->Result.pszCulprit = pDep->Result.pszCulprit;
+            return;
+        }
+        pEval->paVarValues[pDep->pVariable->uSymbol] = pDep->Result.Value;
+        VarBitmapSet(pEval->pbmVarDone, pDep->pVariable->uSymbol);
+    }
+
+    pEval->Result.pszVariable = "";
+    pEval->cSteps    = 0;
+    pEval->uDeadline = 0;
+    if (pSheet->cMaxMilliSecs)
+        pEval->uDeadline = TimestampNanoSecs() + pSheet->cMaxMilliSecs * NANOSECS_PER_MILLISEC;
+
+    TOKEN VarToken;
+    MemSet(&VarToken, 0, sizeof(VarToken));
+    VarToken.Type    = enmTokenVariable;
+    VarToken.uSymbol = pNode->pVariable->uSymbol;
+    TOKEN Value;
+    pNode->Result.rc = EvaluatorEvaluateVariable(pEval, &VarToken, &Value);
+    if (RC_SUCCESS(pNode->Result.rc))
+        pNode->Result.Value = Value.u.Number;
+    else
+    {
+        pNode->Result.pszCulprit = *pEval->Result.pszVariable ? pEval->Result.pszVariable : VariableName(pNode->pVariable);
+        MemSet(pEval->pbmVarActive, 0, pEval->cVarBitmapWords * sizeof(uint32_t));
+    }
+}
+
+
+/**
+ * Evaluates nodes of the current level until there are none left to hand out.
+ *
+ * @param   pSheet      The worksheet.
+ * @param   pEval       The Evaluator of the calling thread.
+ */
+static void SheetEvaluateLevel(PEVALSHEET pSheet, PEVALUATOR pEval)
+{
+    uint64_t const uStart = pEval->pTrace ? TimestampNanoSecs() : 0;
+    EvaluatorReadBegin(pEval);
+    for (;;)
+    {
+        ThreadMutexLock(pSheet->pMutex);
+        uint32_t const iFirst = pSheet->iNext;
+        pSheet->iNext = R_MIN(pSheet->cLevel, iFirst + pSheet->cChunk);
+        uint32_t const iEnd = pSheet->iNext;
+        ThreadMutexUnlock(pSheet->pMutex);
+        if (iFirst >= iEnd)
+            break;
+        for (uint32_t i = iFirst; i < iEnd; i++)
+            SheetEvaluateNode(pSheet, pEval, pSheet->pauLevel[i]);
+    }
+    EvaluatorReadEnd(pEval);
+    if (pEval->pTrace)
+        TraceSpan(pEval->pTrace, "level", uStart, TimestampNanoSecs());
+}
+
+
+static int SheetWorkerThread(void *pvUser)
+{
+    PSHEETWORKER pWorker = pvUser;
+    PEVALSHEET pSheet = pWorker->pSheet;
+    uint32_t uGeneration = 0;
+
+    ThreadMutexLock(pSheet->pMutex);
+    for (;;)
+    {
+        while (   !pSheet->fShutdown
+               && pSheet->uGeneration == uGeneration)
+            ThreadCondWait(pSheet->pWorkCond, pSheet->pMutex);
+        if (pSheet->fShutdown)
+            break;
+        uGeneration = pSheet->uGeneration;
+        ThreadMutexUnlock(pSheet->pMutex);
+
+        SheetEvaluateLevel(pSheet, &pWorker->Eval);
+
+        ThreadMutexLock(pSheet->pMutex);
+        if (!--pSheet->cBusy)
+            ThreadCondBroadcast(pSheet->pDoneCond);
+    }
+    ThreadMutexUnlock(pSheet->pMutex);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Evaluates the dirty nodes of a worksheet one level at a time, each level holding
+ * the nodes whose dirty dependencies are all in earlier levels (Kahn's algorithm).
+ * Nodes never reaching a level are part of, or depend on, a circular dependency.
+ *
+ * @return  Number of levels.
+ * @param   pSheet      The worksheet, see SheetMarkDirty().
+ * @param   paWorkers   The workers, the first one being the calling thread.
+ * @param   cWorkers    Number of workers.
+ */
+static uint32_t SheetEvaluate(PEVALSHEET pSheet, PSHEETWORKER paWorkers, uint32_t cWorkers)
+{
+    /*
+     * The levels are stored one after the other, each one being filled in while the
+     * previous one is evaluated.
+     */
+    uint32_t *pauLevels = pSheet->pauLevels;
+    uint32_t cQueued = 0;
+    for (uint32_t iDirty = 0; iDirty < pSheet->cDirty; iDirty++)
+        if (!pSheet->paNodes[pSheet->pauDirty[iDirty]].cPending)
+            pauLevels[cQueued++] = pSheet->pauDirty[iDirty];
+
+    uint32_t cLevels = 0;
+    uint32_t iLevel = 0;
+    while (iLevel < cQueued)
+    {
+        pSheet->pauLevel = &pauLevels[iLevel];
+        pSheet->cLevel   = cQueued - iLevel;
+        pSheet->iNext    = 0;
+        if (   cWorkers > 1
+            && pSheet->cLevel >= SHEET_PARALLEL_LEVEL_MIN)
+        {
+            pSheet->cChunk = R_MAX(1, R_MIN(SHEET_CHUNK_MAX, pSheet->cLevel / (cWorkers * 4)));
+            ThreadMutexLock(pSheet->pMutex);
+            pSheet->cBusy = cWorkers - 1;
+            ++pSheet->uGeneration;
+            ThreadCondBroadcast(pSheet->pWorkCond);
+            ThreadMutexUnlock(pSheet->pMutex);
+
+            SheetEvaluateLevel(pSheet, &paWorkers[0].Eval);
+
+            ThreadMutexLock(pSheet->pMutex);
+            while (pSheet->cBusy)
+                ThreadCondWait(pSheet->pDoneCond, pSheet->pMutex);
+            ThreadMutexUnlock(pSheet->pMutex);
+        }
+        else
+        {
+            uint64_t const uStart = pSheet->pTrace ? TimestampNanoSecs() : 0;
+            for (uint32_t i = 0; i < pSheet->cLevel; i++)
+                SheetEvaluateNode(pSheet, &paWorkers[0].Eval, pSheet->pauLevel[i]);
+            if (pSheet->pTrace)
+                TraceSpan(pSheet->pTrace, "level", uStart, TimestampNanoSecs());
+        }
+
+        uint32_t const iLevelEnd = cQueued;
+        for (; iLevel < iLevelEnd; iLevel++)
+        {
+            uint32_t const iNode = pauLevels[iLevel];
+            for (uint32_t i = pSheet->pauUserStart[iNode]; i < pSheet->pauUserStart[iNode + 1]; i++)
+                if (!--pSheet->paNodes[pSheet->pauUsers[i]].cPending)
+                    pauLevels[cQueued++] = pSheet->pauUsers[i];
+        }
+        ++cLevels;
+    }
+
+    /*
+     * Blame whatever is left on the first dependency that is left too, part of the cycle or
+     * on the way to it.
+     */
+    for (uint32_t iDirty = 0; iDirty < pSheet->cDirty; iDirty++)
+    {
+        PSHEETNODE pNode = &pSheet->paNodes[pSheet->pauDirty[iDirty]];
+        if (!pNode->cPending)
+            continue;
+        pNode->Result.rc         = RERR_CIRCULAR_DEPENDENCY;
+        pNode->Result.pszCulprit = VariableName(pNode->pVariable);
+        for (uint32_t i = 0; i < pNode->cDeps; i++)
+        {
+            PCSHEETNODE pDep = &pSheet->paNodes[pSheet->pauDeps[pNode->iFirstDep + i]];
+            if (pDep->cPending)
+            {
+                pNode->Result.pszCulprit = VariableName(pDep->pVariable);
+                break;
+            }
+        }
+    }
+
+    /* Failures are retried by the next update, whatever they depend on might be defined by then. */
+    for (uint32_t iDirty = 0; iDirty < pSheet->cDirty; iDirty++)
+    {
+        PSHEETNODE pNode = &pSheet->paNodes[pSheet->pauDirty[iDirty]];
+        pNode->fStale = RC_FAILURE(pNode->Result.rc);
+    }
+    return cLevels;
+}
+
+
+/**
+ * Checks whether the result of a node differs from the one last reported.
+ *
+ * @return  true if it does, or was never reported, false otherwise.
+ * @param   pNode       The node.
+ */
+static bool SheetNodeChanged(PCSHEETNODE pNode)
+{
+    PCSHEETRESULT pResult   = &pNode->Result;
+    PCSHEETRESULT pReported = &pNode->Reported;
+    if (   !pNode->fReported
+        || pResult->rc != pReported->rc)
+        return true;
+    if (RC_FAILURE(pResult->rc))
+        return StrCmp(pResult->pszCulprit, pReported->pszCulprit) != 0;
+
+    /* NaNs never compare equal, not even to themselves. */
+    long double const dValue = pResult->Value.dValue;
+    long double const dReported = pReported->Value.dValue;
+    return pResult->Value.uValue != pReported->Value.uValue
+        || (   dValue != dReported
+            && (dValue == dValue || dReported == dReported));
+}
+
+
+/**
+ * Creates a worksheet: the Variables of a file of definitions (see
+ * EvaluatorLoadDefinitions()), all evaluated by EvaluatorSheetUpdate(). The
+ * dependency graph is kept between updates, so an update only evaluates what
+ * changed in the file and what depends on it.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pEval       The Evaluator object, whose budget applies to each Variable.
+ * @param   pszFile     The file, nothing is read until the first update.
+ * @param   cThreads    Maximum number of threads to use, 0 for one per CPU.
+ * @param   ppSheet     Where to store the worksheet, free it with EvaluatorSheetDestroy().
+ */
+int EvaluatorSheetCreate(PCEVALUATOR pEval, const char *pszFile, uint32_t cThreads, PEVALSHEET *ppSheet)
+{
+    AssertReturn(pEval, RERR_INVALID_PARAMETER);
+    AssertReturn(pEval->u32Magic == RMAG_EVALUATOR, RERR_BAD_MAGIC);
+    AssertReturn(pszFile, RERR_INVALID_PARAMETER);
+    AssertReturn(ppSheet, RERR_INVALID_PARAMETER);
+    *ppSheet = NULL;
+
+    PEVALSHEET pSheet = MemAllocZTag(sizeof(*pSheet), enmMemTagVariable);
+    if (!pSheet)
+        return RERR_NO_MEMORY;
+    pSheet->pszFile = StrDup(pszFile);
+    if (!pSheet->pszFile)
+    {
+        MemFree(pSheet);
+        return RERR_NO_MEMORY;
+    }
+    pSheet->cMaxThreads   = cThreads ? cThreads : ThreadCpuCount();
+    pSheet->cMaxSteps     = pEval->cMaxSteps;
+    pSheet->cMaxMilliSecs = pEval->cMaxMilliSecs;
+    pSheet->pTrace        = pEval->pTrace;
+    *ppSheet = pSheet;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a worksheet. Whatever its file defined stays defined.
+ *
+ * @param   pSheet      The worksheet, can be NULL.
+ */
+void EvaluatorSheetDestroy(PEVALSHEET pSheet)
+{
+    if (!pSheet)
+        return;
+    ThreadCondDestroy(pSheet->pDoneCond);
+    ThreadCondDestroy(pSheet->pWorkCond);
+    ThreadMutexDestroy(pSheet->pMutex);
+    SheetFreeLines(pSheet->paLines, pSheet->cLines);
+    MemFree(pSheet->pauFileNodes);
+    MemFree(pSheet->papszFunctions);
+    MemFree(pSheet->papPrograms);
+    MemFree(pSheet->pauDepMark);
+    MemFree(pSheet->pauDeps);
+    MemFree(pSheet->pauNodeBySymbol);
+    MemFree(pSheet->paNodes);
+    StrFree(pSheet->pszFile);
+    MemFree(pSheet);
+}
+
+
+/**
+ * Updates a worksheet from its file. The graph is built incrementally, which
+ * also finds circular dependencies once, and the Variables are then evaluated in
+ * topological order, those not depending on one another in parallel. Only the
+ * Variables whose definitions changed since the last update, those failing the
+ * last time and those depending on them, however indirectly, are evaluated, each
+ * once however many others use it. The results don't depend on the number of
+ * threads.
+ *
+ * Functions that are not thread-safe, and allocators that are not, make it use
+ * a single thread. Evaluations on other threads aren't counted in the execution
+ * profiles.
+ *
+ * Definitions removed from the file stay defined, there's no undefining
+ * Variables or Functions.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code. Variables
+ *          failing to evaluate don't fail it, they're reported as such.
+ * @param   pSheet      The worksheet.
+ * @param   pfnResult   Called with the result of each Variable of the file whose
+ *                      result changed since the last update (all of them the first
+ *                      time), in the order of the file.
+ * @param   pvUser      The user argument to @a pfnResult.
+ * @param   pStats      Where to store what the update did.
+ */
+int EvaluatorSheetUpdate(PEVALSHEET pSheet, PFNEVALSHEETRESULT pfnResult, void *pvUser, PEVALSHEETSTATS pStats)
+{
+    AssertReturn(pSheet, RERR_INVALID_PARAMETER);
+    AssertReturn(pfnResult, RERR_INVALID_PARAMETER);
+    AssertReturn(pStats, RERR_INVALID_PARAMETER);
+    MemSet(pStats, 0, sizeof(*pStats));
+    uint64_t const uStart = pSheet->pTrace ? TimestampNanoSecs() : 0;
+
+    int rc = SheetLoad(pSheet, &pStats->iLine);
+    if (RC_SUCCESS(rc))
+        rc = SheetScan(pSheet);
+    if (RC_SUCCESS(rc))
+        rc = SheetMarkDirty(pSheet);
+
+    if (pSheet->pTrace)
+        TraceSpan(pSheet->pTrace, "scan", uStart, TimestampNanoSecs());
+
+    /*
+     * Each thread has an Evaluator of its own, sized for every name up front, and a
+     * trace of its own written along with the caller's.
+     */
+    uint32_t cThreads = pSheet->cMaxThreads;
+    if (   pSheet->fSerial
+        || !g_pMemAllocator->fThreadSafe)
+        cThreads = 1;
+    cThreads = R_MAX(1, R_MIN(cThreads, pSheet->cDirty / SHEET_PARALLEL_LEVEL_MIN));
+
+    PSHEETWORKER paWorkers = NULL;
+    uint32_t cWorkers = 0;
+    if (RC_SUCCESS(rc))
+    {
+        paWorkers = MemAllocZTag(cThreads * sizeof(SHEETWORKER), enmMemTagVariable);
+        if (!paWorkers)
+            rc = RERR_NO_MEMORY;
+    }
+    for (; cWorkers < cThreads && RC_SUCCESS(rc); cWorkers++)
+    {
+        paWorkers[cWorkers].pSheet = pSheet;
+        EvaluatorInitInternal(&paWorkers[cWorkers].Eval);
+        paWorkers[cWorkers].Eval.cMaxSteps   = pSheet->cMaxSteps;
+        paWorkers[cWorkers].Eval.fConcurrent = cThreads > 1;
+        paWorkers[cWorkers].Eval.pTrace      = pSheet->pTrace && cWorkers ? TraceThread(pSheet->pTrace, SHEET_TRACE_THREAD + cWorkers)
+                                                                          : pSheet->pTrace;
+        rc = EvaluatorReserveVarBitmaps(&paWorkers[cWorkers].Eval);
+    }
+
+    if (   RC_SUCCESS(rc)
+        && cThreads > 1
+        && !pSheet->pMutex)
+    {
+        rc = ThreadMutexCreate(&pSheet->pMutex);
+        if (RC_SUCCESS(rc))
+            rc = ThreadCondCreate(&pSheet->pWorkCond);
+        if (RC_SUCCESS(rc))
+            rc = ThreadCondCreate(&pSheet->pDoneCond);
+    }
+
+    /*
+     * Workers that can't be created are done without, at worst everything runs here.
+     */
+    if (RC_SUCCESS(rc))
+    {
+        pSheet->uGeneration = 0;
+        pSheet->fShutdown   = false;
+        uint32_t cStarted = 1;
+        while (   cStarted < cWorkers
+               && RC_SUCCESS(ThreadCreate(&paWorkers[cStarted].pThread, SheetWorkerThread, &paWorkers[cStarted])))
+            cStarted++;
+        paWorkers[0].Eval.fConcurrent = cStarted > 1;
+
+        RCU_STORE(&g_fCancelEvaluation, 0);
+        pStats->cLevels    = SheetEvaluate(pSheet, paWorkers, cStarted);
+        pStats->cThreads   = cStarted;
+        pStats->cEvaluated = pSheet->cDirty;
+
+        if (cStarted > 1)
+        {
+            ThreadMutexLock(pSheet->pMutex);
+            pSheet->fShutdown = true;
+            ThreadCondBroadcast(pSheet->pWorkCond);
+            ThreadMutexUnlock(pSheet->pMutex);
+            for (uint32_t i = 1; i < cStarted; i++)
+                ThreadJoin(paWorkers[i].pThread, NULL /* prcThread */);
+        }
+    }
+
+    /*
+     * Report the Variables of the file whose results changed, in the order of the file.
+     */
+    for (uint32_t iFile = 0; iFile < pSheet->cFileNodes && RC_SUCCESS(rc); iFile++)
+    {
+        PSHEETNODE pNode = &pSheet->paNodes[pSheet->pauFileNodes[iFile]];
+        ++pStats->cVars;
+        if (RC_FAILURE(pNode->Result.rc))
+            ++pStats->cFailed;
+        if (   !pNode->fDirty
+            || !SheetNodeChanged(pNode))
+            continue;
+        pNode->Reported  = pNode->Result;
+        pNode->fReported = true;
+        ++pStats->cReported;
+
+        EVALRESULT Result;
+        MemSet(&Result, 0, sizeof(Result));
+        Result.pszVariable = RC_SUCCESS(pNode->Result.rc) ? VariableName(pNode->pVariable) : pNode->Result.pszCulprit;
+        Result.pszFunction = "";
+        Result.uValue      = pNode->Result.Value.uValue;
+        Result.dValue      = pNode->Result.Value.dValue;
+        Result.ErrorIndex  = -1;
+        rc = pfnResult(pvUser, VariableName(pNode->pVariable), pNode->Result.rc, &Result);
+    }
+
+    for (uint32_t i = 0; i < cWorkers; i++)
+        EvaluatorDestroy(&paWorkers[i].Eval);
+    MemFree(paWorkers);
+    MemFree(pSheet->pauUserStart);
+    MemFree(pSheet->pauUsers);
+    MemFree(pSheet->pauDirty);
+    MemFree(pSheet->pauLevels);
+    pSheet->pauUserStart = NULL;
+    pSheet->pauUsers     = NULL;
+    pSheet->pauDirty     = NULL;
+    pSheet->pauLevels    = NULL;
+    pSheet->cDirty       = 0;
+    return rc;
+}
@@ -0,0 +1,222 @@
+/** @file
+ * Read-only mapping of whole files.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WIN32
+/* mmap(), shm_open() and friends are POSIX, not C99. */
+# define _POSIX_C_SOURCE 200112L
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#else
+# include <stdio.h>
+#endif
+
+#include "FileMap.h"
+#include "Errors.h"
+#include "Memory.h"
+#include "GenericDefs.h"
+
+#ifndef _WIN32
+/**
+ * Maps all of an open file read-only and closes it.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pFileMap    Where to store the mapping.
+ * @param   hFile       The file descriptor, negative if opening it failed.
+ */
+static int FileMapDescriptor(PFILEMAP pFileMap, int hFile)
+{
+    if (hFile < 0)
+        return RERR_FILE_IO;
+
+    int rc = RERR_FILE_IO;
+    struct stat Stat;
+    if (   !fstat(hFile, &Stat)
+        && Stat.st_size > 0)
+    {
+        void *pv = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, hFile, 0);
+        if (pv != MAP_FAILED)
+        {
+            pFileMap->pvData  = pv;
+            pFileMap->cbData  = (size_t)Stat.st_size;
+            pFileMap->fMapped = true;
+            rc = RINF_SUCCESS;
+        }
+    }
+    close(hFile);   /* The mapping keeps the file referenced. */
+    return rc;
+}
+#endif
+
+
+/**
+ * Maps a file read-only. Pages are shared with every other process mapping the
+ * same file and only read in when touched. Where mapping isn't available the
+ * file is read into memory instead.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pFileMap    Where to store the mapping, unmap with FileMapClose().
+ * @param   pszFile     The file.
+ */
+int FileMapOpen(PFILEMAP pFileMap, const char *pszFile)
+{
+    pFileMap->pvData  = NULL;
+    pFileMap->cbData  = 0;
+    pFileMap->fMapped = false;
+
+#ifndef _WIN32
+    return FileMapDescriptor(pFileMap, open(pszFile, O_RDONLY));
+#else
+    FILE *pFile = fopen(pszFile, "rb");
+    if (!pFile)
+        return RERR_FILE_IO;
+
+    int rc = RERR_FILE_IO;
+    long cbFile = 0;
+    if (   !fseek(pFile, 0, SEEK_END)
+        && (cbFile = ftell(pFile)) > 0
+        && !fseek(pFile, 0, SEEK_SET))
+    {
+        void *pv = MemAlloc((size_t)cbFile);
+        if (!pv)
+            rc = RERR_NO_MEMORY;
+        else if (fread(pv, 1, (size_t)cbFile, pFile) != (size_t)cbFile)
+            MemFree(pv);
+        else
+        {
+            pFileMap->pvData = pv;
+            pFileMap->cbData = (size_t)cbFile;
+            rc = RINF_SUCCESS;
+        }
+    }
+    fclose(pFile);
+    return rc;
+#endif
+}
+
+
+/**
+ * Unmaps a file mapped by FileMapOpen().
+ *
+ * @param   pFileMap    The mapping, nothing is done if nothing is mapped.
+ */
+void FileMapClose(PFILEMAP pFileMap)
+{
+    if (!pFileMap->pvData)
+        return;
+#ifndef _WIN32
+    if (pFileMap->fMapped)
+        munmap((void *)pFileMap->pvData, pFileMap->cbData);
+    else
+#endif
+        MemFree((void *)pFileMap->pvData);
+    pFileMap->pvData  = NULL;
+    pFileMap->cbData  = 0;
+    pFileMap->fMapped = false;
+}
+
+
+/**
+ * Maps a shared memory object read-only.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pFileMap    Where to store the mapping, unmap with FileMapClose().
+ * @param   pszName     The shared memory object name, starts with a slash.
+ */
+int FileMapOpenShared(PFILEMAP pFileMap, const char *pszName)
+{
+    pFileMap->pvData  = NULL;
+    pFileMap->cbData  = 0;
+    pFileMap->fMapped = false;
+
+#ifndef _WIN32
+    return FileMapDescriptor(pFileMap, shm_open(pszName, O_RDONLY, 0));
+#else
+    NOREF(pszName);
+    return RERR_NOT_SUPPORTED;
+#endif
+}
+
+
+/**
+ * Creates a shared memory object, replacing any existing one of the same name,
+ * and maps it writable. Whoever has the replaced object mapped keeps it.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pFileMap    Where to store the mapping, unmap with FileMapClose().
+ * @param   pszName     The shared memory object name, starts with a slash.
+ * @param   cbData      Size of the object, must not be 0.
+ * @param   ppvData     Where to store the writable address of the mapping.
+ */
+int FileMapCreateShared(PFILEMAP pFileMap, const char *pszName, size_t cbData, void **ppvData)
+{
+    pFileMap->pvData  = NULL;
+    pFileMap->cbData  = 0;
+    pFileMap->fMapped = false;
+    *ppvData = NULL;
+
+#ifndef _WIN32
+    shm_unlink(pszName);
+    int hShm = shm_open(pszName, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (hShm < 0)
+        return RERR_FILE_IO;
+
+    int rc = RERR_FILE_IO;
+    if (!ftruncate(hShm, (off_t)cbData))
+    {
+        void *pv = mmap(NULL, cbData, PROT_READ | PROT_WRITE, MAP_SHARED, hShm, 0);
+        if (pv != MAP_FAILED)
+        {
+            pFileMap->pvData  = pv;
+            pFileMap->cbData  = cbData;
+            pFileMap->fMapped = true;
+            *ppvData = pv;
+            rc = RINF_SUCCESS;
+        }
+    }
+    close(hShm);
+    if (RC_FAILURE(rc))
+        shm_unlink(pszName);
+    return rc;
+#else
+    NOREF(pszName);
+    NOREF(cbData);
+    return RERR_NOT_SUPPORTED;
+#endif
+}
+
+
+/**
+ * Removes a shared memory object, whoever has it mapped keeps it.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszName     The shared memory object name, starts with a slash.
+ */
+int FileMapRemoveShared(const char *pszName)
+{
+#ifndef _WIN32
+    return shm_unlink(pszName) ? RERR_FILE_IO : RINF_SUCCESS;
+#else
+    NOREF(pszName);
+    return RERR_NOT_SUPPORTED;
+#endif
+}
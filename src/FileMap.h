@@ -0,0 +1,48 @@
+/** @file
+ * Read-only mapping of whole files, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFFILEMAP_H___
+#define NOPFFILEMAP_H___
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * FILEMAP: The contents of a file, mapped read-only.
+ */
+typedef struct FILEMAP
+{
+    const void     *pvData;         /**< The contents, NULL if nothing is mapped. */
+    size_t          cbData;         /**< Size of the contents in bytes. */
+    bool            fMapped;        /**< Whether @a pvData is a memory mapping rather than a heap copy. */
+} FILEMAP;
+/** Pointer to a file mapping. */
+typedef FILEMAP *PFILEMAP;
+/** Pointer to a const file mapping. */
+typedef const FILEMAP *PCFILEMAP;
+
+int         FileMapOpen(PFILEMAP pFileMap, const char *pszFile);
+void        FileMapClose(PFILEMAP pFileMap);
+int         FileMapOpenShared(PFILEMAP pFileMap, const char *pszName);
+int         FileMapCreateShared(PFILEMAP pFileMap, const char *pszName, size_t cbData, void **ppvData);
+int         FileMapRemoveShared(const char *pszName);
+
+#endif /* NOPFFILEMAP_H___ */
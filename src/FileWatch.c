@@ -0,0 +1,276 @@
+/** @file
+ * Watching files for changes.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WIN32
+/* poll(), stat() and nanosleep() are POSIX, not C99. */
+# define _POSIX_C_SOURCE 200112L
+# include <sys/stat.h>
+# include <poll.h>
+# include <time.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/inotify.h>
+# endif
+#endif
+#include <string.h>
+
+#include "FileWatch.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "Memory.h"
+#include "StringOps.h"
+#include "GenericDefs.h"
+
+/*
+ * On Linux the directory of the file is watched with inotify, so saving by renaming
+ * a new file over the old one is seen as well. Elsewhere the file is polled with
+ * stat(). Without either (Windows builds for now) watching isn't supported.
+ */
+
+/** How often a file is polled when there's no way to be told about changes, in milliseconds. */
+#define FILEWATCH_POLL_MILLISECS    250
+/** How long a file must be left alone after a change before it's reported, in milliseconds. */
+#define FILEWATCH_SETTLE_MILLISECS  50
+
+/**
+ * FILEWATCH: A watched file.
+ */
+struct FILEWATCH
+{
+    char           *pszFile;        /**< The file. */
+#ifndef _WIN32
+    struct stat     Stat;           /**< What the file looked like the last time, zero if missing. */
+#endif
+#ifdef __linux__
+    int             hInotify;       /**< The inotify descriptor, negative when polling. */
+    const char     *pszName;        /**< The name of the file within its directory, points into @a pszFile. */
+#endif
+};
+
+
+#ifndef _WIN32
+/**
+ * Checks whether a watched file looks different since the last check.
+ *
+ * @return  true if it does, false otherwise.
+ * @param   pWatch      The watched file.
+ */
+static bool FileWatchStatChanged(PFILEWATCH pWatch)
+{
+    struct stat Stat;
+    if (stat(pWatch->pszFile, &Stat))
+        memset(&Stat, 0, sizeof(Stat));
+    bool const fChanged = Stat.st_ino   != pWatch->Stat.st_ino
+                       || Stat.st_dev   != pWatch->Stat.st_dev
+                       || Stat.st_size  != pWatch->Stat.st_size
+                       || Stat.st_mtime != pWatch->Stat.st_mtime;
+    pWatch->Stat = Stat;
+    return fChanged;
+}
+
+
+static void FileWatchSleep(uint32_t cMilliSecs)
+{
+    struct timespec Delay;
+    Delay.tv_sec  = cMilliSecs / 1000;
+    Delay.tv_nsec = (long)(cMilliSecs % 1000) * 1000000L;
+    nanosleep(&Delay, NULL);
+}
+#endif
+
+
+#ifdef __linux__
+/**
+ * Waits for inotify events about a watched file.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pWatch      The watched file.
+ * @param   cMilliSecs  How long to wait at most.
+ * @param   pfChanged   Where to store whether there were events about the file.
+ */
+static int FileWatchReadEvents(PFILEWATCH pWatch, uint32_t cMilliSecs, bool *pfChanged)
+{
+    struct pollfd PollFd;
+    PollFd.fd      = pWatch->hInotify;
+    PollFd.events  = POLLIN;
+    PollFd.revents = 0;
+    int cReady = poll(&PollFd, 1, (int)R_MIN(cMilliSecs, (uint32_t)INT32_MAX));
+    if (cReady <= 0)
+        return RINF_SUCCESS;    /* Interrupted by a signal is as good as a timeout. */
+
+    /* Events are aligned for struct inotify_event, see inotify(7). */
+    union
+    {
+        struct inotify_event Event;
+        char                 ach[4096];
+    } Buf;
+    ssize_t cbRead = read(pWatch->hInotify, &Buf, sizeof(Buf));
+    if (cbRead < 0)
+        return RINF_SUCCESS;
+
+    for (ssize_t off = 0; off + (ssize_t)sizeof(struct inotify_event) <= cbRead; )
+    {
+        struct inotify_event const *pEvent = (struct inotify_event const *)&Buf.ach[off];
+        if (   pEvent->len
+            && !StrCmp(pEvent->name, pWatch->pszName))
+            *pfChanged = true;
+        off += sizeof(struct inotify_event) + pEvent->len;
+    }
+    return RINF_SUCCESS;
+}
+#endif
+
+
+/**
+ * Starts watching a file, which needn't exist yet.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile     The file.
+ * @param   ppWatch     Where to store the watched file, free it with FileWatchDestroy().
+ */
+int FileWatchCreate(const char *pszFile, PFILEWATCH *ppWatch)
+{
+    AssertReturn(pszFile, RERR_INVALID_PARAMETER);
+    AssertReturn(ppWatch, RERR_INVALID_PARAMETER);
+    *ppWatch = NULL;
+
+#ifndef _WIN32
+    PFILEWATCH pWatch = MemAlloc(sizeof(*pWatch));
+    if (!pWatch)
+        return RERR_NO_MEMORY;
+    pWatch->pszFile = StrDup(pszFile);
+    if (!pWatch->pszFile)
+    {
+        MemFree(pWatch);
+        return RERR_NO_MEMORY;
+    }
+    memset(&pWatch->Stat, 0, sizeof(pWatch->Stat));
+    FileWatchStatChanged(pWatch);
+
+# ifdef __linux__
+    /*
+     * Watch the directory for the file being written, or moved or created in place.
+     */
+    char *pszSlash = strrchr(pWatch->pszFile, '/');
+    pWatch->pszName  = pszSlash ? pszSlash + 1 : pWatch->pszFile;
+    pWatch->hInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (pWatch->hInotify >= 0)
+    {
+        int iWatch;
+        if (!pszSlash)
+            iWatch = inotify_add_watch(pWatch->hInotify, ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        else if (pszSlash == pWatch->pszFile)
+            iWatch = inotify_add_watch(pWatch->hInotify, "/", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        else
+        {
+            *pszSlash = '\0';
+            iWatch = inotify_add_watch(pWatch->hInotify, pWatch->pszFile, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            *pszSlash = '/';
+        }
+        if (iWatch < 0)
+        {
+            close(pWatch->hInotify);
+            pWatch->hInotify = -1;
+        }
+    }
+# endif
+    *ppWatch = pWatch;
+    return RINF_SUCCESS;
+#else
+    return RERR_NOT_SUPPORTED;
+#endif
+}
+
+
+/**
+ * Waits for a watched file to change. A change is reported once the file has been
+ * left alone for a moment, so saving it in several steps is reported once.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pWatch      The watched file.
+ * @param   cMilliSecs  How long to wait at most, signals may cut it short.
+ * @param   pfChanged   Where to store whether the file changed.
+ */
+int FileWatchWait(PFILEWATCH pWatch, uint32_t cMilliSecs, bool *pfChanged)
+{
+    AssertReturn(pWatch, RERR_INVALID_PARAMETER);
+    AssertReturn(pfChanged, RERR_INVALID_PARAMETER);
+    *pfChanged = false;
+
+#ifndef _WIN32
+# ifdef __linux__
+    if (pWatch->hInotify >= 0)
+    {
+        int rc = FileWatchReadEvents(pWatch, cMilliSecs, pfChanged);
+        if (*pfChanged)
+        {
+            bool fMore;
+            do
+            {
+                fMore = false;
+                rc = FileWatchReadEvents(pWatch, FILEWATCH_SETTLE_MILLISECS, &fMore);
+            } while (   RC_SUCCESS(rc)
+                     && fMore);
+            FileWatchStatChanged(pWatch);
+        }
+        return rc;
+    }
+# endif
+
+    uint32_t cWaited = 0;
+    do
+    {
+        uint32_t const cDelay = R_MIN(FILEWATCH_POLL_MILLISECS, cMilliSecs - cWaited);
+        FileWatchSleep(cDelay);
+        cWaited += cDelay;
+        if (FileWatchStatChanged(pWatch))
+        {
+            do
+                FileWatchSleep(FILEWATCH_SETTLE_MILLISECS);
+            while (FileWatchStatChanged(pWatch));
+            *pfChanged = true;
+            break;
+        }
+    } while (cWaited < cMilliSecs);
+    return RINF_SUCCESS;
+#else
+    NOREF(cMilliSecs);
+    return RERR_NOT_SUPPORTED;
+#endif
+}
+
+
+/**
+ * Stops watching a file.
+ *
+ * @param   pWatch      The watched file, can be NULL.
+ */
+void FileWatchDestroy(PFILEWATCH pWatch)
+{
+    if (!pWatch)
+        return;
+#ifdef __linux__
+    if (pWatch->hInotify >= 0)
+        close(pWatch->hInotify);
+#endif
+    StrFree(pWatch->pszFile);
+    MemFree(pWatch);
+}
@@ -0,0 +1,35 @@
+/** @file
+ * Watching files for changes, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFFILEWATCH_H___
+#define NOPFFILEWATCH_H___
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/** A watched file, opaque. */
+typedef struct FILEWATCH *PFILEWATCH;
+
+int         FileWatchCreate(const char *pszFile, PFILEWATCH *ppWatch);
+int         FileWatchWait(PFILEWATCH pWatch, uint32_t cMilliSecs, bool *pfChanged);
+void        FileWatchDestroy(PFILEWATCH pWatch);
+
+#endif /* NOPFFILEWATCH_H___ */
@@ -76,5 +76,15 @@
 # define R_FALLTHRU()                               do { } while (0)
 #endif
 
+/** @def R_THREAD_LOCAL
+ * Gives each thread its own copy of a static or global variable. */
+#if defined(_MSC_VER)
+# define R_THREAD_LOCAL                             __declspec(thread)
+#elif defined(__GNUC__)
+# define R_THREAD_LOCAL                             __thread
+#else
+# define R_THREAD_LOCAL
+#endif
+
 #endif /* GENERICS_H___ */
 
@@ -45,6 +45,9 @@ static bool g_fxTermColors = true;
 static bool g_fxTermColors = false;
 #endif
 
+/** Where output goes instead of stdout and stderr, see TextOutputCapture(). */
+static PSTRBUF g_pOutputCapture = NULL;
+
 #ifdef _WIN32
 static inline WORD GetOutConsoleAttrs(HANDLE *phConsole)
 {
@@ -73,6 +76,47 @@ static inline void SetConsoleAttrs(HANDLE hConsole, WORD wAttrs)
 }
 #endif
 
+/**
+ * Redirects everything printed by Printf(), ColorPrintf() and ErrorPrintf() into
+ * a string buffer, without colors, e.g. to send it somewhere else.
+ *
+ * @return  The previous capture buffer, NULL if output was going to stdout and
+ *          stderr.
+ * @param   pStrBuf     The string buffer to append output to, NULL to print to
+ *                      stdout and stderr again.
+ */
+PSTRBUF TextOutputCapture(PSTRBUF pStrBuf)
+{
+    PSTRBUF pOldStrBuf = g_pOutputCapture;
+    g_pOutputCapture = pStrBuf;
+    return pOldStrBuf;
+}
+
+
+/**
+ * Turns colors in the output on or off, overriding what the terminal was
+ * detected to support.
+ *
+ * @param   fColors     Whether to use colors.
+ */
+void TextOutputColors(bool fColors)
+{
+    g_fxTermColors = fColors;
+}
+
+
+void Printf(char *pszMsg, ...)
+{
+    va_list FmtArgs;
+    va_start(FmtArgs, pszMsg);
+    if (g_pOutputCapture)
+        StrBufAppendV(g_pOutputCapture, pszMsg, FmtArgs);
+    else
+        vfprintf(stdout, pszMsg, FmtArgs);
+    va_end(FmtArgs);
+}
+
+
 void ErrorPrintf(int rc, char *pszError, ...)
 {
     va_list FmtArgs;
@@ -85,6 +129,12 @@ void ErrorPrintf(int rc, char *pszError, ...)
     char *pszBuf = StrStripLF(szBuf, NULL /* pfStripped */);
 
     PCRCSTATUSMSG pStatusMsg = StatusMsgForRC(rc);
+    if (g_pOutputCapture)
+    {
+        StrBufAppendF(g_pOutputCapture, "Error! %s rc=%s (%d)\n\n", pszBuf, pStatusMsg ? pStatusMsg->pszName : "?", rc);
+        return;
+    }
+
     if (pStatusMsg)
     {
         if (g_fxTermColors)
@@ -120,7 +170,9 @@ void ColorPrintf(TEXTCOLOR enmTextColor, char *pszMsg, ...)
     bool fNewLine;
     char *pszBuf = StrStripLF(szBuf, &fNewLine);
 
-    if (g_fxTermColors)
+    if (g_pOutputCapture)
+        StrBufAppendF(g_pOutputCapture, "%s%s", pszBuf, fNewLine ? "\n" : "");
+    else if (g_fxTermColors)
     {
 #ifdef _WIN32
         static WORD s_wColorCodes[] = { 0,                                                                           /* None */
@@ -198,12 +250,19 @@ static char *TextLineGenerator(const char *pszText, int fState)
         s_cchCommand    = StrLen(pszText);
     }
 
-    /* Return the next name which partially matches from the command list. */
+    /* Return the next Function, Command or Variable name starting with the text. */
     uint32_t iEnd = 0;
-    const char *pszCommand = EvaluatorFindFunction(pszText, s_cchCommand, s_iCommandIndex, &iEnd);
+    const char *pszCommand = EvaluatorFindCompletion(pszText, s_cchCommand, s_iCommandIndex, &iEnd);
     s_iCommandIndex = iEnd;
     if (pszCommand)
-        return StrDup(pszCommand);
+    {
+        /* Readline frees matches with free(), so they must come straight from the C library. */
+        size_t const cbCommand = StrLen(pszCommand) + 1;
+        char *pszMatch = malloc(cbCommand);
+        if (pszMatch)
+            MemCpy(pszMatch, pszCommand, cbCommand);
+        return pszMatch;
+    }
 
     /* Nothing found. */
     return NULL;
@@ -23,6 +23,9 @@
 #define INPUT_OUTPUT_H___
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "StringOps.h"
 
 typedef enum TEXTCOLOR
 {
@@ -36,10 +39,12 @@ typedef enum TEXTCOLOR
     enmTextColorBold,
 } TEXTCOLOR;
 
-#define Printf      printf
+void    Printf(char *pszMsg, ...);
 void    ErrorPrintf(int rc, char *pszError, ...);
 void    ColorPrintf(TEXTCOLOR enmTextColor, char *pszMsg, ...);
 void    DebugPrintf(char *pszMsg, ...);
+PSTRBUF TextOutputCapture(PSTRBUF pStrBuf);
+void    TextOutputColors(bool fColors);
 
 #ifdef _DEBUG
 #define DEBUGPRINTF(s)         DebugPrintf s
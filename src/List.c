@@ -44,7 +44,7 @@ bool ListIsEmpty(PLIST pList)
 
 int ListAdd(PLIST pList, void *pvData)
 {
-    PLISTITEM pNode = MemAlloc(sizeof(LISTITEM));
+    PLISTITEM pNode = MemAllocTag(sizeof(LISTITEM), enmMemTagNode);
     if (pNode)
     {
         if (!pList->pHead)
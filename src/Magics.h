@@ -26,6 +26,12 @@
 #define RMAG_TEXTLINE                           0xba5eba11
 /** The magic value for EVALUATOR::u32Magic. */
 #define RMAG_EVALUATOR                          0xbadb100d
+/** The magic value for VARSCOPE::u32Magic. */
+#define RMAG_VARSCOPE                           0x5c0fe5ed
+/** The magic value for MEMHDR::u32Magic. */
+#define RMAG_MEMHDR                             0xfeedf00d
+/** The magic value for MEMHDR::u32Magic after it's freed. */
+#define RMAG_MEMHDR_DEAD                        0xdeadf00d
 
 #endif /* MAGICS_H__ */
 
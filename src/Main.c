@@ -30,8 +30,15 @@
 #include "Settings.h"
 #include "GenericDefs.h"
 #include "InputOutput.h"
+#include "Server.h"
+#include "Stats.h"
+#include "Timestamp.h"
+#include "FileWatch.h"
 
+#include <ctype.h>
 #include <math.h>
+#include <stdlib.h>
+#include <signal.h>
 
 /*******************************************************************************
 *   Structures, Typedefs & Defines                                             *
@@ -46,12 +53,35 @@
 #define APP_COPYRIGHT_COLOR         enmTextColorWhite
 
 #define CMD_HELP                    "help"
-#define CMD_QUIT                    "quit"
-#define CMD_QUIT_SHORT              "q"
-#define CMD_EXIT                    "exit"
 #define CMD_BYE                     "bye"
 #define CMD_VARS                    "vars"
-
+#define CMD_EXPLAIN                 "explain"
+#define CMD_SAVE                    "save"
+#define CMD_PUBLISH                 "publish"
+#define CMD_UNPUBLISH               "unpublish"
+#define CMD_IMPORT                  "import"
+#define CMD_DEFINE                  "define"
+#define CMD_SHEET                   "sheet"
+#define CMD_WATCH                   "watch"
+
+#define OPT_MAX_STEPS               "--max-steps="
+#define OPT_TIMEOUT                 "--timeout="
+#define OPT_STATS                   "--stats"
+#define OPT_BATCH                   "--batch"
+#define OPT_PROFILE                 "--profile"
+#define OPT_MEM_ACCOUNTING          "--mem-accounting"
+#define OPT_TRACE                   "--trace="
+#define OPT_SERVER                  "--server="
+#define OPT_CONNECT                 "--connect="
+#define OPT_COPROCESS               "--coprocess"
+#define OPT_LOAD                    "--load="
+#define OPT_ATTACH                  "--attach="
+
+/** How long watching a worksheet waits for its file to change before checking for an interrupt, in milliseconds. */
+#define WATCH_WAIT_MILLISECS        500
+
+/** Set when watching a worksheet is interrupted. */
+static volatile sig_atomic_t g_fWatchInterrupted = 0;
 
 static char *GetValueAsBinaryString(uint64_t uValue, size_t *pcDigits)
 {
@@ -346,22 +376,391 @@ static void PrintVars(PSETTINGS pSettings)
 }
 
 
+/**
+ * Checks if a line is a command taking an argument, e.g. explain.
+ *
+ * @return  Pointer to the argument, NULL if it's not the command.
+ * @param   pszLine     The line.
+ * @param   pszCmd      The command.
+ */
+static const char *GetCommandArg(const char *pszLine, const char *pszCmd)
+{
+    size_t const cchCmd = StrLen(pszCmd);
+    if (   !StrNCmp(pszLine, pszCmd, cchCmd)
+        && isspace((unsigned char)pszLine[cchCmd]))
+        return pszLine + cchCmd + 1;
+    return NULL;
+}
+
+
+static int PrintExplain(PSETTINGS pSettings, PEVALUATOR pEval, const char *pszExpr)
+{
+    NOREF(pSettings);
+
+    char *pszExplain = NULL;
+    int rc = EvaluatorExplain(pEval, pszExpr, &pszExplain);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Explain:\n");
+        ColorPrintf(OUTPUT_COLOR, "%s\n", pszExplain);
+        Printf("\n");
+        StrFree(pszExplain);
+    }
+    else
+        ErrorPrintf(rc, "Failed to explain '%s'.\n", pszExpr);
+    return rc;
+}
+
+
+static int SaveImage(PSETTINGS pSettings, const char *pszFile)
+{
+    NOREF(pSettings);
+
+    uint32_t cVars = 0;
+    uint32_t cFunctions = 0;
+    int rc = EvaluatorSaveImage(pszFile, &cVars, &cFunctions);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Saved:");
+        ColorPrintf(OUTPUT_COLOR, " %u variables and %u functions to '%s'\n", (unsigned)cVars, (unsigned)cFunctions, pszFile);
+        Printf("\n");
+    }
+    else
+        ErrorPrintf(rc, "Failed to save '%s'.\n", pszFile);
+    return rc;
+}
+
+static int PublishImage(PSETTINGS pSettings, const char *pszName)
+{
+    NOREF(pSettings);
+
+    uint32_t cVars = 0;
+    uint32_t cFunctions = 0;
+    int rc = EvaluatorPublishImage(pszName, &cVars, &cFunctions);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Published:");
+        ColorPrintf(OUTPUT_COLOR, " %u variables and %u functions as '%s'\n", (unsigned)cVars, (unsigned)cFunctions, pszName);
+        Printf("\n");
+    }
+    else
+        ErrorPrintf(rc, "Failed to publish '%s'.\n", pszName);
+    return rc;
+}
+
+static int UnpublishImage(PSETTINGS pSettings, const char *pszName)
+{
+    NOREF(pSettings);
+
+    int rc = EvaluatorUnpublishImage(pszName);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Unpublished:");
+        ColorPrintf(OUTPUT_COLOR, " '%s'\n", pszName);
+        Printf("\n");
+    }
+    else
+        ErrorPrintf(rc, "Failed to unpublish '%s'.\n", pszName);
+    return rc;
+}
+
+static int ImportSymbols(PSETTINGS pSettings, const char *pszFile)
+{
+    NOREF(pSettings);
+
+    uint32_t cImported = 0;
+    uint32_t cSkipped = 0;
+    int rc = EvaluatorImportSymbols(pszFile, &cImported, &cSkipped);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Imported:");
+        ColorPrintf(OUTPUT_COLOR, " %u symbols from '%s', %u skipped\n", (unsigned)cImported, pszFile, (unsigned)cSkipped);
+        Printf("\n");
+    }
+    else
+        ErrorPrintf(rc, "Failed to import '%s' after %u symbols.\n", pszFile, (unsigned)cImported);
+    return rc;
+}
+
+static int LoadDefinitions(PSETTINGS pSettings, const char *pszFile)
+{
+    NOREF(pSettings);
+
+    uint32_t cDeferred = 0;
+    uint32_t cParsed = 0;
+    uint32_t iLine = 0;
+    int rc = EvaluatorLoadDefinitions(pszFile, &cDeferred, &cParsed, &iLine);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Defined:");
+        ColorPrintf(OUTPUT_COLOR, " %u variables on first use and %u definitions now from '%s'\n", (unsigned)cDeferred,
+                    (unsigned)cParsed, pszFile);
+        Printf("\n");
+    }
+    else if (iLine)
+        ErrorPrintf(rc, "Failed to define line %u of '%s'.\n", (unsigned)iLine, pszFile);
+    else
+        ErrorPrintf(rc, "Failed to load '%s'.\n", pszFile);
+    return rc;
+}
+
+static int PrintSheetResult(void *pvUser, const char *pszVariable, int rc, PCCEVALRESULT pResult)
+{
+    NOREF(pvUser);
+
+    ColorPrintf(VARS_COLOR, "%24s", pszVariable);
+    if (RC_SUCCESS(rc))
+    {
+        Printf(" = ");
+        ColorPrintf(OUTPUT_COLOR, "0x%" FMT_U64_HEX "  %" FMT_U64_NAT "  %" FMT_FLT_NAT "\n", pResult->uValue,
+                    pResult->uValue, pResult->dValue);
+        return RINF_SUCCESS;
+    }
+
+    PCRCSTATUSMSG pStatusMsg = StatusMsgForRC(rc);
+    Printf(" : ");
+    ColorPrintf(enmTextColorRed, "%s", pStatusMsg ? pStatusMsg->pszName : "?");
+    if (StrCmp(pResult->pszVariable, pszVariable))
+        Printf(" (variable '%s')", pResult->pszVariable);
+    Printf("\n");
+    return RINF_SUCCESS;
+}
+
+/**
+ * Updates a worksheet from its file, printing the Variables whose results changed.
+ *
+ * @return  Status code.
+ * @param   pSheet      The worksheet.
+ * @param   pszFile     The file, for messages.
+ */
+static int UpdateWorksheet(PEVALSHEET pSheet, const char *pszFile)
+{
+    EVALSHEETSTATS Stats;
+    int rc = EvaluatorSheetUpdate(pSheet, PrintSheetResult, NULL /* pvUser */, &Stats);
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Worksheet:");
+        ColorPrintf(OUTPUT_COLOR, " %u variables from '%s', %u failed, %u changed, %u evaluated in %u levels on %u thread%s\n",
+                    (unsigned)Stats.cVars, pszFile, (unsigned)Stats.cFailed, (unsigned)Stats.cReported,
+                    (unsigned)Stats.cEvaluated, (unsigned)Stats.cLevels, (unsigned)Stats.cThreads,
+                    Stats.cThreads == 1 ? "" : "s");
+        Printf("\n");
+    }
+    else if (Stats.iLine)
+        ErrorPrintf(rc, "Failed to define line %u of '%s'.\n", (unsigned)Stats.iLine, pszFile);
+    else
+        ErrorPrintf(rc, "Failed to evaluate worksheet '%s'.\n", pszFile);
+    return rc;
+}
+
+static int EvaluateWorksheet(PSETTINGS pSettings, PEVALUATOR pEval, const char *pszFile)
+{
+    NOREF(pSettings);
+
+    PEVALSHEET pSheet;
+    int rc = EvaluatorSheetCreate(pEval, pszFile, 0 /* cThreads */, &pSheet);
+    if (RC_SUCCESS(rc))
+    {
+        UpdateWorksheet(pSheet, pszFile);
+        EvaluatorSheetDestroy(pSheet);
+    }
+    else
+        ErrorPrintf(rc, "Failed to evaluate worksheet '%s'.\n", pszFile);
+    return rc;
+}
+
+/**
+ * Signal handler for SIGINT while a worksheet is being watched.
+ *
+ * @param   iSignal     The signal number.
+ */
+static void WatchInterruptHandler(int iSignal)
+{
+    NOREF(iSignal);
+    g_fWatchInterrupted = 1;
+    EvaluatorCancel();
+}
+
+/**
+ * Evaluates a worksheet and then again each time its file changes, printing only
+ * what changed, until interrupted.
+ *
+ * @return  Status code.
+ * @param   pSettings   The program settings.
+ * @param   pEval       The Evaluator object.
+ * @param   pszFile     The file.
+ */
+static int WatchWorksheet(PSETTINGS pSettings, PEVALUATOR pEval, const char *pszFile)
+{
+    NOREF(pSettings);
+
+    PFILEWATCH pWatch = NULL;
+    PEVALSHEET pSheet = NULL;
+    int rc = FileWatchCreate(pszFile, &pWatch);
+    if (RC_SUCCESS(rc))
+        rc = EvaluatorSheetCreate(pEval, pszFile, 0 /* cThreads */, &pSheet);
+    if (RC_FAILURE(rc))
+    {
+        ErrorPrintf(rc, "Failed to watch worksheet '%s'.\n", pszFile);
+        FileWatchDestroy(pWatch);
+        return rc;
+    }
+
+    ColorPrintf(PREFIX_COLOR, "Watching:");
+    ColorPrintf(OUTPUT_COLOR, " '%s', interrupt to stop\n", pszFile);
+    Printf("\n");
+
+    /* Output may well be going to a pipe, show each update as it happens. */
+    g_fWatchInterrupted = 0;
+    signal(SIGINT, WatchInterruptHandler);
+    UpdateWorksheet(pSheet, pszFile);
+    fflush(stdout);
+    while (!g_fWatchInterrupted)
+    {
+        bool fChanged = false;
+        rc = FileWatchWait(pWatch, WATCH_WAIT_MILLISECS, &fChanged);
+        if (RC_FAILURE(rc))
+        {
+            ErrorPrintf(rc, "Failed to watch worksheet '%s'.\n", pszFile);
+            break;
+        }
+        if (   fChanged
+            && !g_fWatchInterrupted)
+        {
+            UpdateWorksheet(pSheet, pszFile);
+            fflush(stdout);
+        }
+    }
+    signal(SIGINT, SIG_DFL);
+
+    EvaluatorSheetDestroy(pSheet);
+    FileWatchDestroy(pWatch);
+    return rc;
+}
+
+/**
+ * Handles the commands nopf rather than the Evaluator deals with: listing the
+ * Variables, help, explain and the commands dealing with files, i.e. images,
+ * symbol imports, definitions and worksheets, evaluated once or watched.
+ *
+ * @return  true if @a pszLine was such a command, false otherwise.
+ * @param   pSettings   The program settings.
+ * @param   pEval       The Evaluator object.
+ * @param   pszLine     The input line.
+ * @param   prc         Where to store the status code of the command, optional.
+ */
+static bool ProcessCommand(PSETTINGS pSettings, PEVALUATOR pEval, const char *pszLine, int *prc)
+{
+    int rc = RINF_SUCCESS;
+    const char *pszArg;
+    if (!StrCmp(pszLine, CMD_VARS))
+        PrintVars(pSettings);
+    else if (!StrCmp(pszLine, CMD_HELP))
+        PrintHelp(pSettings);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_EXPLAIN)) != NULL)
+        rc = PrintExplain(pSettings, pEval, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_SAVE)) != NULL)
+        rc = SaveImage(pSettings, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_PUBLISH)) != NULL)
+        rc = PublishImage(pSettings, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_UNPUBLISH)) != NULL)
+        rc = UnpublishImage(pSettings, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_IMPORT)) != NULL)
+        rc = ImportSymbols(pSettings, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_DEFINE)) != NULL)
+        rc = LoadDefinitions(pSettings, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_SHEET)) != NULL)
+        rc = EvaluateWorksheet(pSettings, pEval, pszArg);
+    else if ((pszArg = GetCommandArg(pszLine, CMD_WATCH)) != NULL)
+        rc = WatchWorksheet(pSettings, pEval, pszArg);
+    else
+        return false;
+
+    if (prc)
+        *prc = rc;
+    return true;
+}
+
 static void PrintVarAssigned(PSETTINGS pSettings, PCEVALUATOR pEval)
 {
     ColorPrintf(PREFIX_COLOR, "Stored variable:");
-    ColorPrintf(OUTPUT_COLOR, " '%s'\n", pEval->Result.szVariable);
+    ColorPrintf(OUTPUT_COLOR, " '%s'\n", pEval->Result.pszVariable);
+    Printf("\n");
+}
+
+static void PrintFunctionDefined(PSETTINGS pSettings, PCEVALUATOR pEval)
+{
+    ColorPrintf(PREFIX_COLOR, "Stored function:");
+    ColorPrintf(OUTPUT_COLOR, " '%s'\n", pEval->Result.pszFunction);
     Printf("\n");
 }
 
 static void PrintCommandEvaluated(PSETTINGS pSettings, PCEVALUATOR pEval)
 {
-    ColorPrintf(PREFIX_COLOR, "%s:\n", pEval->Result.szCommand);
-    ColorPrintf(OUTPUT_COLOR, "%s\n",  pEval->Result.szCommandResult);
+    ColorPrintf(PREFIX_COLOR, "%s:\n", pEval->Result.pszCommand);
+    ColorPrintf(OUTPUT_COLOR, "%s\n",  pEval->Result.pszCommandResult ? pEval->Result.pszCommandResult : "");
+}
+
+static void PrintStats(PSETTINGS pSettings, PCEVALSTATS pStats)
+{
+    NOREF(pSettings);
+
+    ColorPrintf(PREFIX_COLOR, "Stats:");
+    Printf(" parse %.1fus  evaluate %.1fus (variables %.1fus)  output %.1fus  total %.1fus\n",
+           pStats->acNanoSecs[enmStatsPhaseParse] / 1000.0, pStats->acNanoSecs[enmStatsPhaseEvaluate] / 1000.0,
+           pStats->acNanoSecs[enmStatsPhaseVariables] / 1000.0, pStats->acNanoSecs[enmStatsPhaseOutput] / 1000.0,
+           StatsTotalNanoSecs(pStats) / 1000.0);
+    Printf("       tokens %" FMT_U64_NAT "  steps %" FMT_U64_NAT "  allocs %" FMT_U64_NAT
+           "  variables %" FMT_U64_NAT " (cache hits %" FMT_U64_NAT ", max depth %u)\n\n",
+           pStats->cTokens, pStats->cSteps, pStats->cAllocs, pStats->cVarResolved, pStats->cVarCacheHits,
+           (unsigned)pStats->cVarMaxDepth);
+}
+
+static void PrintProfile(PSETTINGS pSettings, PCEVALUATOR pEval)
+{
+    NOREF(pSettings);
+
+    char szProfile[2048];
+    int rc = EvaluatorFormatProfile(pEval, 20, szProfile, sizeof(szProfile));
+    if (RC_SUCCESS(rc))
+    {
+        ColorPrintf(PREFIX_COLOR, "Profile:\n");
+        Printf("%s", szProfile);
+    }
+    else
+        ErrorPrintf(rc, "Failed to format the profile.\n");
+}
+
+static void PrintHistRow(const char *pszName, PCSTATSHIST pHist, uint64_t uTotal)
+{
+    Printf("  %-10s %12.1f %10.1f %10.1f %10.1f %10.1f\n", pszName, uTotal / 1000.0,
+           pHist->cSamples ? (double)pHist->uSum / pHist->cSamples / 1000.0 : 0.0,
+           StatsHistPercentile(pHist, 50) / 1000.0, StatsHistPercentile(pHist, 99) / 1000.0,
+           pHist->cSamples ? pHist->uMax / 1000.0 : 0.0);
+}
+
+static void PrintBatchStats(PSETTINGS pSettings, PCSTATSBATCH pBatch)
+{
+    NOREF(pSettings);
+
+    ColorPrintf(PREFIX_COLOR, "Batch stats:");
+    Printf(" %" FMT_U64_NAT " expressions, %" FMT_U64_NAT " failed\n", pBatch->cExprs, pBatch->cFailed);
+    Printf("  %-10s %12s %10s %10s %10s %10s   (microseconds)\n", "phase", "total", "mean", "p50", "p99", "max");
+    for (unsigned i = 0; i < enmStatsPhaseMax; i++)
+        PrintHistRow(StatsPhaseName((STATSPHASE)i), &pBatch->aPhases[i], pBatch->Sums.acNanoSecs[i]);
+    PrintHistRow("total", &pBatch->Total, pBatch->Total.uSum);
+    Printf("  tokens %" FMT_U64_NAT "  steps %" FMT_U64_NAT "  allocs %" FMT_U64_NAT
+           "  variables %" FMT_U64_NAT " (cache hits %" FMT_U64_NAT ", max depth %u)\n",
+           pBatch->Sums.cTokens, pBatch->Sums.cSteps, pBatch->Sums.cAllocs, pBatch->Sums.cVarResolved,
+           pBatch->Sums.cVarCacheHits, (unsigned)pBatch->Sums.cVarMaxDepth);
 }
 
 
 static int ProcessExpression(PSETTINGS pSettings, PEVALUATOR pEval, const char *pszExpr)
 {
+    PEVALSTATS pStats = pEval->pStats;
+    uint64_t const cAllocsStart = g_cMemAllocs;
+
     bool fParsed = false;
     int rc = EvaluatorParse(pEval, pszExpr);
     if (RC_SUCCESS(rc))
@@ -370,16 +769,20 @@ static int ProcessExpression(PSETTINGS pSettings, PEVALUATOR pEval, const char *
 
         /*
          * For expression assignment we must not evaluate the expression. It's just
-         * an assignment, syntactically correct.
+         * an assignment, syntactically correct. Same goes for function definitions.
          */
-        if (pEval->Result.fVariableAssignment == false)
+        if (   pEval->Result.fVariableAssignment == false
+            && pEval->Result.fFunctionDefinition == false)
             rc = EvaluatorEvaluate(pEval);
     }
 
+    uint64_t const uOutputStart = pStats || pEval->pTrace ? TimestampNanoSecs() : 0;
     if (RC_SUCCESS(rc))
     {
         if (pEval->Result.fVariableAssignment)
             PrintVarAssigned(pSettings, pEval);
+        else if (pEval->Result.fFunctionDefinition)
+            PrintFunctionDefined(pSettings, pEval);
         else if (pEval->Result.fCommandEvaluated)
             PrintCommandEvaluated(pSettings, pEval);
         else
@@ -396,24 +799,568 @@ static int ProcessExpression(PSETTINGS pSettings, PEVALUATOR pEval, const char *
             case RERR_TOO_MANY_PARAMETERS:      ErrorPrintf(rc, "%s Too many parameters to operator/function.\n", szComponent); break;
             case RERR_NO_MEMORY:                ErrorPrintf(rc, "%s Out of memory.\n", szComponent); break;
             case RERR_UNDEFINED_BEHAVIOUR:      ErrorPrintf(rc, "%s Pesky overflow, calculation hindered.\n", szComponent); break;
-            case RERR_VARIABLE_UNDEFINED:       ErrorPrintf(rc, "%s Variable '%s' undefined.\n", szComponent, pEval->Result.szVariable); break;
-            case RERR_CIRCULAR_DEPENDENCY:      ErrorPrintf(rc, "%s Circular dependency for variable '%s'.\n", szComponent, pEval->Result.szVariable); break;
+            case RERR_VARIABLE_UNDEFINED:       ErrorPrintf(rc, "%s Variable '%s' undefined.\n", szComponent, pEval->Result.pszVariable); break;
+            case RERR_CIRCULAR_DEPENDENCY:      ErrorPrintf(rc, "%s Circular dependency for variable '%s'.\n", szComponent, pEval->Result.pszVariable); break;
+            case RERR_VARIABLE_INVALID_DEFINITION: ErrorPrintf(rc, "%s Invalid definition of variable '%s'.\n", szComponent, pEval->Result.pszVariable); break;
             case RERR_INVALID_ASSIGNMENT:       ErrorPrintf(rc, "%s Cannot assign expression to non-lvalue.\n", szComponent); break;
-            case RERR_VARIABLE_CANNOT_REASSIGN: ErrorPrintf(rc, "%s Cannot re-assign variable '%s'.\n", szComponent, pEval->Result.szVariable); break;
+            case RERR_VARIABLE_CANNOT_REASSIGN: ErrorPrintf(rc, "%s Cannot re-assign variable '%s'.\n", szComponent, pEval->Result.pszVariable); break;
+            case RERR_RANGE_UNEXPECTED:         ErrorPrintf(rc, "%s Range used where a single number is expected.\n", szComponent); break;
+            case RERR_DUPLICATE_FUNCTION:       ErrorPrintf(rc, "%s Cannot redefine built-in function '%s'.\n", szComponent, pEval->Result.pszFunction); break;
+            case RERR_INVALID_FUNCTION:         ErrorPrintf(rc, "%s Invalid definition of function '%s'.\n", szComponent, pEval->Result.pszFunction); break;
+            case RERR_FUNCTION_RECURSIVE:       ErrorPrintf(rc, "%s Function '%s' cannot call itself.\n", szComponent, pEval->Result.pszFunction); break;
+            case RERR_FUNCTION_NESTING_TOO_DEEP: ErrorPrintf(rc, "%s Function calls nested too deeply.\n", szComponent); break;
+            case RERR_RANGE_INVALID:            ErrorPrintf(rc, "%s Invalid or empty range.\n", szComponent); break;
+            case RERR_STEP_BUDGET_EXCEEDED:     ErrorPrintf(rc, "%s Step budget of %" FMT_U64_NAT " exceeded.\n", szComponent, pEval->cMaxSteps); break;
+            case RERR_DEADLINE_EXCEEDED:        ErrorPrintf(rc, "%s Time limit of %" FMT_U64_NAT " ms exceeded.\n", szComponent, pEval->cMaxMilliSecs); break;
+            case RERR_CANCELLED:                ErrorPrintf(rc, "%s Cancelled.\n", szComponent); break;
+            case RERR_SYMBOL_NOT_FOUND:         ErrorPrintf(rc, "%s No variable at or below %#" FMT_U64_HEX ".\n", szComponent, pEval->Result.uValue); break;
             default:                            ErrorPrintf(rc, "%s Undefined error.\n", szComponent); break;
         }
     }
 
+    if (   pStats
+        || pEval->pTrace)
+    {
+        uint64_t const uOutputEnd = TimestampNanoSecs();
+        if (pEval->pTrace)
+            TraceSpan(pEval->pTrace, "format", uOutputStart, uOutputEnd);
+        if (pStats)
+        {
+            pStats->acNanoSecs[enmStatsPhaseOutput] += uOutputEnd - uOutputStart;
+            pStats->cAllocs += g_cMemAllocs - cAllocsStart;
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Processes an expression typed in by the user, printing its stats if enabled.
+ *
+ * @return  Status code.
+ * @param   pSettings   The settings.
+ * @param   pEval       The Evaluator object.
+ * @param   pszExpr     The expression.
+ */
+static int ProcessInteractiveExpression(PSETTINGS pSettings, PEVALUATOR pEval, const char *pszExpr)
+{
+    if (pEval->pTrace)
+        ++pEval->pTrace->iExpr;
+
+    if (!pSettings->fStats)
+        return ProcessExpression(pSettings, pEval, pszExpr);
+
+    EVALSTATS Stats;
+    MemSet(&Stats, 0, sizeof(Stats));
+    pEval->pStats = &Stats;
+    int rc = ProcessExpression(pSettings, pEval, pszExpr);
+    pEval->pStats = NULL;
+    PrintStats(pSettings, &Stats);
     return rc;
 }
 
 
+/**
+ * Reads a line of any length.
+ *
+ * @return  Pointer to the line (in @a *ppszBuf), NULL at end of file.
+ * @param   pFile       The file to read from.
+ * @param   ppszBuf     The line buffer, grown as required. Free with StrFree().
+ * @param   pcbBuf      The size of the line buffer.
+ */
+static char *ReadLine(FILE *pFile, char **ppszBuf, size_t *pcbBuf)
+{
+    size_t offLine = 0;
+    for (;;)
+    {
+        if (*pcbBuf - offLine < 2)
+        {
+            size_t const cbBuf = R_MAX(*pcbBuf * 2, 256);
+            char *pszBuf = MemRealloc(*ppszBuf, cbBuf);
+            if (!pszBuf)
+                return NULL;
+            *ppszBuf = pszBuf;
+            *pcbBuf  = cbBuf;
+        }
+
+        if (!fgets(*ppszBuf + offLine, (int)(*pcbBuf - offLine), pFile))
+            return offLine ? *ppszBuf : NULL;
+
+        offLine += StrLen(*ppszBuf + offLine);
+        if ((*ppszBuf)[offLine - 1] == '\n')
+            return *ppszBuf;
+    }
+}
+
+
+/**
+ * Processes expressions from a file, one per line, without prompting. Blank lines
+ * and lines starting with '#' are skipped. Stats, if enabled, are aggregated over
+ * the batch and reported at the end.
+ *
+ * @return  Status code.
+ * @param   pSettings   The settings.
+ * @param   pEval       The Evaluator object.
+ * @param   pFile       The file to read expressions from.
+ */
+static int ProcessBatch(PSETTINGS pSettings, PEVALUATOR pEval, FILE *pFile)
+{
+    PSTATSBATCH pBatch = NULL;
+    if (pSettings->fStats)
+    {
+        pBatch = MemAlloc(sizeof(*pBatch));
+        if (!pBatch)
+            return RERR_NO_MEMORY;
+        StatsBatchInit(pBatch);
+    }
+
+    char  *pszBuf = NULL;
+    size_t cbBuf  = 0;
+    for (;;)
+    {
+        uint64_t const uReadStart = pEval->pTrace ? TimestampNanoSecs() : 0;
+        char *pszLine = ReadLine(pFile, &pszBuf, &cbBuf);
+        if (!pszLine)
+            break;
+        if (pEval->pTrace)
+        {
+            ++pEval->pTrace->iExpr;
+            TraceSpan(pEval->pTrace, "read", uReadStart, TimestampNanoSecs());
+        }
+
+        char *pszExpr = StrStrip(pszLine);
+        if (   !*pszExpr
+            || *pszExpr == '#')
+            continue;
+
+        if (   !StrCmp(pszExpr, CMD_QUIT)
+            || !StrCmp(pszExpr, CMD_QUIT_SHORT)
+            || !StrCmp(pszExpr, CMD_EXIT))
+            break;
+
+        if (ProcessCommand(pSettings, pEval, pszExpr, NULL /* prc */))
+            continue;
+
+        EVALSTATS Stats;
+        if (pBatch)
+        {
+            MemSet(&Stats, 0, sizeof(Stats));
+            pEval->pStats = &Stats;
+        }
+
+        int rc = ProcessExpression(pSettings, pEval, pszExpr);
+
+        if (pBatch)
+        {
+            pEval->pStats = NULL;
+            StatsBatchAdd(pBatch, &Stats, RC_FAILURE(rc));
+        }
+    }
+
+    if (pBatch)
+    {
+        PrintBatchStats(pSettings, pBatch);
+        MemFree(pBatch);
+    }
+    if (pSettings->fProfile)
+        PrintProfile(pSettings, pEval);
+    StrFree(pszBuf);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * SERVECTX: What requests of server clients are processed with.
+ */
+typedef struct SERVECTX
+{
+    PSETTINGS       pSettings;      /**< The settings. */
+    PEVALUATOR      pEval;          /**< The Evaluator object. */
+} SERVECTX;
+/** Pointer to the server request context. */
+typedef SERVECTX *PSERVECTX;
+
+
+/**
+ * Processes a request of a server client, the server sends back whatever is
+ * printed.
+ *
+ * @return  Status code.
+ * @param   pvUser      The server request context.
+ * @param   pszRequest  The request, an expression or command.
+ */
+static int ServeRequest(void *pvUser, char *pszRequest)
+{
+    PSERVECTX pCtx = (PSERVECTX)pvUser;
+    char *pszExpr = StrStrip(pszRequest);
+    if (   !*pszExpr
+        || *pszExpr == '#')
+        return RINF_SUCCESS;
+
+    if (!StrCmp(pszExpr, CMD_VARS))
+    {
+        PrintVars(pCtx->pSettings);
+        return RINF_SUCCESS;
+    }
+
+    if (!StrCmp(pszExpr, CMD_HELP))
+    {
+        PrintHelp(pCtx->pSettings);
+        return RINF_SUCCESS;
+    }
+
+    const char *pszExplainExpr = GetCommandArg(pszExpr, CMD_EXPLAIN);
+    if (pszExplainExpr)
+    {
+        PrintExplain(pCtx->pSettings, pCtx->pEval, pszExplainExpr);
+        return RINF_SUCCESS;
+    }
+
+    return ProcessExpression(pCtx->pSettings, pCtx->pEval, pszExpr);
+}
+
+
+/*
+ * Coprocess protocol: each request line gets exactly one response line of space separated
+ * "key=value" fields, always starting with "rc=<status code> kind=<kind>":
+ *
+ *   kind=value u64=<dec> s64=<signed dec> hex=0x<hex> oct=0<oct> bin=n<bin> float=<float>
+ *   kind=var name=<variable assigned>
+ *   kind=func name=<function defined>
+ *   kind=cmd name=<command> cb=<n>     followed by <n> bytes of command output and '\n'
+ *   kind=error index=<ErrorIndex> name=<offending variable or function, "" if none>
+ *
+ * The index of an error is the offset into the request where parsing stopped, -1 if the
+ * error isn't tied to a position (e.g. it happened while evaluating).
+ *
+ * Commands handled by nopf rather than the Evaluator (explain, vars, save, import, sheet
+ * etc.) answer with kind=cmd carrying what they print, messages of failures included,
+ * and their status code. Watching a worksheet prints until interrupted, which can't be
+ * a single response, so it fails with RERR_NOT_SUPPORTED and kind=error.
+ */
+
+/**
+ * Formats a value in binary without leading zeros or grouping.
+ *
+ * @return  @a pszBuf.
+ * @param   uValue      The value.
+ * @param   pszBuf      Where to store the digits, must hold at least 65 chars.
+ */
+static char *FormatBinary(uint64_t uValue, char *pszBuf)
+{
+    unsigned cDigits = 1;
+    while (   cDigits < 64
+           && (uValue >> cDigits))
+        ++cDigits;
+    for (unsigned i = 0; i < cDigits; i++)
+        pszBuf[i] = '0' + ((uValue >> (cDigits - i - 1)) & 1);
+    pszBuf[cDigits] = '\0';
+    return pszBuf;
+}
+
+
+/**
+ * Writes the response to a coprocess request and flushes it.
+ *
+ * @return  Status code.
+ * @param   pEval       The Evaluator object.
+ * @param   rc          Status code of the request.
+ * @param   pFile       The file to write the response to.
+ */
+static int WriteCoprocessResponse(PCEVALUATOR pEval, int rc, FILE *pFile)
+{
+    char szResponse[512];
+    const char *pszPayload = NULL;
+    if (RC_FAILURE(rc))
+    {
+        const char *pszName = *pEval->Result.pszVariable ? pEval->Result.pszVariable : pEval->Result.pszFunction;
+        StrNPrintf(szResponse, sizeof(szResponse), "rc=%d kind=error index=%d name=%s\n", rc, pEval->Result.ErrorIndex,
+                   pszName ? pszName : "");
+    }
+    else if (pEval->Result.fVariableAssignment)
+        StrNPrintf(szResponse, sizeof(szResponse), "rc=%d kind=var name=%s\n", rc, pEval->Result.pszVariable);
+    else if (pEval->Result.fFunctionDefinition)
+        StrNPrintf(szResponse, sizeof(szResponse), "rc=%d kind=func name=%s\n", rc, pEval->Result.pszFunction);
+    else if (pEval->Result.fCommandEvaluated)
+    {
+        pszPayload = pEval->Result.pszCommandResult ? pEval->Result.pszCommandResult : "";
+        StrNPrintf(szResponse, sizeof(szResponse), "rc=%d kind=cmd name=%s cb=%zu\n", rc, pEval->Result.pszCommand,
+                   StrLen(pszPayload));
+    }
+    else
+    {
+        uint64_t const uResult = pEval->Result.uValue;
+        char szBin[65];
+        StrNPrintf(szResponse, sizeof(szResponse), "rc=%d kind=value u64=%" FMT_U64_NAT " s64=%" FMT_S64_NAT
+                   " hex=0x%" FMT_U64_HEX " oct=0%" FMT_U64_OCT " bin=n%s float=%" FMT_FLT_NAT "\n",
+                   rc, uResult, (int64_t)uResult, uResult, uResult, FormatBinary(uResult, szBin), pEval->Result.dValue);
+    }
+
+    fputs(szResponse, pFile);
+    if (pszPayload)
+    {
+        fputs(pszPayload, pFile);
+        fputc('\n', pFile);
+    }
+    if (fflush(pFile))
+        return RERR_FILE_IO;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Writes the response to a coprocess request handled by ProcessCommand() and
+ * flushes it.
+ *
+ * @return  Status code.
+ * @param   pszRequest  The request, its first word being the command.
+ * @param   rc          Status code of the command.
+ * @param   pOutput     What the command printed, NULL if it wasn't run.
+ * @param   pFile       The file to write the response to.
+ */
+static int WriteCoprocessCommandResponse(const char *pszRequest, int rc, PCSTRBUF pOutput, FILE *pFile)
+{
+    int cchName = 0;
+    while (   pszRequest[cchName]
+           && !isspace((unsigned char)pszRequest[cchName]))
+        ++cchName;
+
+    if (pOutput)
+    {
+        const char *pszPayload = pOutput->pszBuf ? pOutput->pszBuf : "";
+        fprintf(pFile, "rc=%d kind=cmd name=%.*s cb=%zu\n", rc, cchName, pszRequest, StrLen(pszPayload));
+        fputs(pszPayload, pFile);
+        fputc('\n', pFile);
+    }
+    else
+        fprintf(pFile, "rc=%d kind=error index=-1 name=%.*s\n", rc, cchName, pszRequest);
+    if (fflush(pFile))
+        return RERR_FILE_IO;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Answers requests from a program driving nopf as a coprocess, one request per line,
+ * until end of file or a quit command. Nothing but the responses is written.
+ *
+ * @return  Status code.
+ * @param   pSettings   The settings.
+ * @param   pEval       The Evaluator object.
+ * @param   pIn         The file to read requests from.
+ * @param   pOut        The file to write responses to.
+ */
+static int ProcessCoprocess(PSETTINGS pSettings, PEVALUATOR pEval, FILE *pIn, FILE *pOut)
+{
+    int    rc     = RINF_SUCCESS;
+    char  *pszBuf = NULL;
+    size_t cbBuf  = 0;
+    STRBUF Output;
+    StrBufInit(&Output);
+    for (;;)
+    {
+        uint64_t const uReadStart = pEval->pTrace ? TimestampNanoSecs() : 0;
+        char *pszLine = ReadLine(pIn, &pszBuf, &cbBuf);
+        if (!pszLine)
+            break;
+        if (pEval->pTrace)
+        {
+            ++pEval->pTrace->iExpr;
+            TraceSpan(pEval->pTrace, "read", uReadStart, TimestampNanoSecs());
+        }
+
+        char *pszExpr = StrStrip(pszLine);
+        if (   !StrCmp(pszExpr, CMD_QUIT)
+            || !StrCmp(pszExpr, CMD_QUIT_SHORT)
+            || !StrCmp(pszExpr, CMD_EXIT))
+            break;
+
+        /*
+         * Commands nopf handles itself answer with what they print, see the protocol above.
+         */
+        int      rcExpr;
+        bool     fCommand = false;
+        PCSTRBUF pOutput  = &Output;
+        if (GetCommandArg(pszExpr, CMD_WATCH))
+        {
+            fCommand = true;
+            pOutput  = NULL;
+            rcExpr   = RERR_NOT_SUPPORTED;
+        }
+        else
+        {
+            StrBufReset(&Output);
+            PSTRBUF pOldCapture = TextOutputCapture(&Output);
+            fCommand = ProcessCommand(pSettings, pEval, pszExpr, &rcExpr);
+            TextOutputCapture(pOldCapture);
+            if (!fCommand)
+            {
+                rcExpr = EvaluatorParse(pEval, pszExpr);
+                if (   RC_SUCCESS(rcExpr)
+                    && !pEval->Result.fVariableAssignment
+                    && !pEval->Result.fFunctionDefinition)
+                    rcExpr = EvaluatorEvaluate(pEval);
+            }
+            else if (RC_FAILURE(Output.rc))
+                rcExpr = Output.rc;
+        }
+
+        uint64_t const uOutputStart = pEval->pTrace ? TimestampNanoSecs() : 0;
+        if (fCommand)
+            rc = WriteCoprocessCommandResponse(pszExpr, rcExpr, pOutput, pOut);
+        else
+            rc = WriteCoprocessResponse(pEval, rcExpr, pOut);
+        if (pEval->pTrace)
+            TraceSpan(pEval->pTrace, "format", uOutputStart, TimestampNanoSecs());
+        if (RC_FAILURE(rc))
+            break;
+    }
+
+    StrBufDelete(&Output);
+    StrFree(pszBuf);
+    return rc;
+}
+
+
+/**
+ * Signal handler for SIGINT while an expression is being evaluated interactively.
+ *
+ * @param   iSignal     The signal number.
+ */
+static void InterruptHandler(int iSignal)
+{
+    NOREF(iSignal);
+    EvaluatorCancel();
+}
+
+
+/**
+ * Parses a numeric option value.
+ *
+ * @return  Status code.
+ * @param   pszValue    The value string.
+ * @param   puValue     Where to store the value.
+ */
+static int ParseOptionValue(const char *pszValue, uint64_t *puValue)
+{
+    char *pszEnd = NULL;
+    *puValue = strtoull(pszValue, &pszEnd, 0);
+    if (   pszEnd == pszValue
+        || *pszEnd != '\0')
+        return RERR_INVALID_PARAMETER;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Parses the leading "--" options off the command line into the settings.
+ *
+ * @return  Status code.
+ * @param   pSettings   The settings to update.
+ * @param   cArgs       Number of command line arguments.
+ * @param   aszArgs     The command line arguments.
+ * @param   piArg       Where to store the index of the first non-option argument.
+ */
+static int ParseOptions(PSETTINGS pSettings, int cArgs, char *aszArgs[], int *piArg)
+{
+    /** @todo getopt .. sigh that's GNU again */
+    int iArg = 1;
+    for (; iArg < cArgs && !StrNCmp(aszArgs[iArg], "--", 2); iArg++)
+    {
+        const char *pszArg = aszArgs[iArg];
+        int rc;
+        if (!StrNCmp(pszArg, OPT_MAX_STEPS, sizeof(OPT_MAX_STEPS) - 1))
+            rc = ParseOptionValue(pszArg + sizeof(OPT_MAX_STEPS) - 1, &pSettings->cMaxSteps);
+        else if (!StrNCmp(pszArg, OPT_TIMEOUT, sizeof(OPT_TIMEOUT) - 1))
+        {
+            rc = ParseOptionValue(pszArg + sizeof(OPT_TIMEOUT) - 1, &pSettings->cMaxMilliSecs);
+            pSettings->fMaxMilliSecsSet = true;
+        }
+        else if (!StrCmp(pszArg, OPT_STATS))
+        {
+            pSettings->fStats = true;
+            rc = RINF_SUCCESS;
+        }
+        else if (!StrCmp(pszArg, OPT_BATCH))
+        {
+            pSettings->fBatch = true;
+            rc = RINF_SUCCESS;
+        }
+        else if (!StrNCmp(pszArg, OPT_LOAD, sizeof(OPT_LOAD) - 1))
+        {
+            StrFree(pSettings->pszLoadImage);
+            pSettings->pszLoadImage = StrDup(pszArg + sizeof(OPT_LOAD) - 1);
+            pSettings->fAttachImage = false;
+            rc = pSettings->pszLoadImage ? RINF_SUCCESS : RERR_NO_MEMORY;
+        }
+        else if (!StrNCmp(pszArg, OPT_ATTACH, sizeof(OPT_ATTACH) - 1))
+        {
+            StrFree(pSettings->pszLoadImage);
+            pSettings->pszLoadImage = StrDup(pszArg + sizeof(OPT_ATTACH) - 1);
+            pSettings->fAttachImage = true;
+            rc = pSettings->pszLoadImage ? RINF_SUCCESS : RERR_NO_MEMORY;
+        }
+        else if (!StrCmp(pszArg, OPT_COPROCESS))
+        {
+            pSettings->fCoprocess = true;
+            rc = RINF_SUCCESS;
+        }
+        else if (!StrCmp(pszArg, OPT_PROFILE))
+        {
+            pSettings->fProfile = true;
+            rc = RINF_SUCCESS;
+        }
+        else if (!StrNCmp(pszArg, OPT_TRACE, sizeof(OPT_TRACE) - 1))
+        {
+            StrFree(pSettings->pszTraceFile);
+            pSettings->pszTraceFile = StrDup(pszArg + sizeof(OPT_TRACE) - 1);
+            rc = pSettings->pszTraceFile ? RINF_SUCCESS : RERR_NO_MEMORY;
+        }
+        else if (!StrNCmp(pszArg, OPT_SERVER, sizeof(OPT_SERVER) - 1))
+        {
+            StrFree(pSettings->pszServerSocket);
+            pSettings->pszServerSocket = StrDup(pszArg + sizeof(OPT_SERVER) - 1);
+            rc = pSettings->pszServerSocket ? RINF_SUCCESS : RERR_NO_MEMORY;
+        }
+        else if (!StrNCmp(pszArg, OPT_CONNECT, sizeof(OPT_CONNECT) - 1))
+        {
+            StrFree(pSettings->pszConnectSocket);
+            pSettings->pszConnectSocket = StrDup(pszArg + sizeof(OPT_CONNECT) - 1);
+            rc = pSettings->pszConnectSocket ? RINF_SUCCESS : RERR_NO_MEMORY;
+        }
+        else if (!StrCmp(pszArg, OPT_MEM_ACCOUNTING))
+        {
+            /* Already acted upon by main(), the allocator must be picked before anything is allocated. */
+            rc = RINF_SUCCESS;
+        }
+        else
+            rc = RERR_INVALID_PARAMETER;
+
+        if (RC_FAILURE(rc))
+        {
+            ErrorPrintf(rc, "Invalid option '%s'\n", pszArg);
+            return rc;
+        }
+    }
+
+    *piArg = iArg;
+    return RINF_SUCCESS;
+}
+
+
 /**
  * And so it begins...
  */
 int main(int cArgs, char *aszArgs[])
 {
-    /** @todo getopt .. sigh that's GNU again */
+    /*
+     * Blocks must be freed by the allocator that handed them out, so pick it before anything is allocated.
+     */
+    for (int i = 1; i < cArgs && !StrNCmp(aszArgs[i], "--", 2); i++)
+    {
+        if (!StrCmp(aszArgs[i], OPT_MEM_ACCOUNTING))
+            MemSetAllocator(&g_MemAllocatorAccounting);
+    }
 
     PSETTINGS pSettings = NULL;
     int rc = SettingsCreate(&pSettings, &g_FactorySettings);
@@ -423,6 +1370,28 @@ int main(int cArgs, char *aszArgs[])
         return rc;
     }
 
+    int iArg;
+    rc = ParseOptions(pSettings, cArgs, aszArgs, &iArg);
+    if (RC_FAILURE(rc))
+    {
+        SettingsDestroy(pSettings);
+        return rc;
+    }
+
+    /*
+     * A client only forwards, it doesn't need an evaluator of its own.
+     */
+    if (pSettings->pszConnectSocket)
+    {
+        rc = ServerClientRun(pSettings->pszConnectSocket, iArg < cArgs ? aszArgs[iArg] : NULL /* stdin */);
+        if (   rc == RERR_SOCKET_IO
+            || rc == RERR_PROTOCOL_ERROR
+            || rc == RERR_NOT_SUPPORTED)
+            ErrorPrintf(rc, "Failed to talk to the server at '%s'\n", pSettings->pszConnectSocket);
+        SettingsDestroy(pSettings);
+        return rc;
+    }
+
     char szErrorBuf[1024];
     MemSet(szErrorBuf, 0, sizeof(szErrorBuf));
 
@@ -441,10 +1410,59 @@ int main(int cArgs, char *aszArgs[])
         return rc;
     }
 
+    EvaluatorSetBudget(&Eval, pSettings->cMaxSteps, pSettings->cMaxMilliSecs);
+    Eval.fProfile = pSettings->fProfile;
+
+    TRACE Trace;
+    TraceInit(&Trace, 0 /* idThread */, TRACE_MAX_EVENTS_DEFAULT);
+    if (pSettings->pszTraceFile)
+        Eval.pTrace = &Trace;
+
+    if (pSettings->pszLoadImage)
+    {
+        if (pSettings->fAttachImage)
+            rc = EvaluatorAttachImage(pSettings->pszLoadImage, NULL /* pcVars */, NULL /* pcFunctions */);
+        else
+            rc = EvaluatorLoadImage(pSettings->pszLoadImage, NULL /* pcVars */, NULL /* pcFunctions */);
+        if (RC_FAILURE(rc))
+        {
+            ErrorPrintf(rc, "Failed to %s '%s'\n", pSettings->fAttachImage ? "attach" : "load", pSettings->pszLoadImage);
+            goto the_end;
+        }
+    }
+
+    if (pSettings->fBatch)
+    {
+        rc = ProcessBatch(pSettings, &Eval, stdin);
+        goto the_end;
+    }
+
+    if (pSettings->fCoprocess)
+    {
+        TextOutputColors(false);
+        rc = ProcessCoprocess(pSettings, &Eval, stdin, stdout);
+        goto the_end;
+    }
+
+    if (pSettings->pszServerSocket)
+    {
+        /* One runaway request must not hold up every client, --timeout=0 lifts the limit. */
+        if (!pSettings->fMaxMilliSecsSet)
+            EvaluatorSetBudget(&Eval, pSettings->cMaxSteps, SERVER_DEFAULT_TIMEOUT_MS);
+
+        SERVECTX Ctx;
+        Ctx.pSettings = pSettings;
+        Ctx.pEval     = &Eval;
+        rc = ServerRun(pSettings->pszServerSocket, ServeRequest, &Ctx);
+        if (RC_FAILURE(rc))
+            ErrorPrintf(rc, "Failed to serve on '%s'\n", pSettings->pszServerSocket);
+        goto the_end;
+    }
+
     TextLineLibraryInit("~/." APP_EXECNAME);
-    if (cArgs > 1)
+    if (iArg < cArgs)
     {
-        ProcessExpression(pSettings, &Eval, aszArgs[1]);
+        ProcessInteractiveExpression(pSettings, &Eval, aszArgs[iArg]);
         goto the_end;
     }
 
@@ -469,19 +1487,16 @@ int main(int cArgs, char *aszArgs[])
                 break;
             }
 
-            if (!StrCmp(Line.pszData, CMD_VARS))
-            {
-                PrintVars(pSettings);
-                continue;
-            }
-
-            if (!StrCmp(Line.pszData, CMD_HELP))
-            {
-                PrintHelp(pSettings);
+            if (ProcessCommand(pSettings, &Eval, Line.pszData, NULL /* prc */))
                 continue;
-            }
 
-            ProcessExpression(pSettings, &Eval, Line.pszData);
+            /*
+             * Ctrl+C cancels a runaway evaluation instead of killing the session,
+             * at the prompt it keeps its usual meaning.
+             */
+            signal(SIGINT, InterruptHandler);
+            ProcessInteractiveExpression(pSettings, &Eval, Line.pszData);
+            signal(SIGINT, SIG_DFL);
         }
     }
 
@@ -489,6 +1504,13 @@ int main(int cArgs, char *aszArgs[])
     TextLineLibraryTerm();
 
 the_end:
+    if (Eval.pTrace)
+    {
+        int rc2 = TraceWriteChrome(&Trace, pSettings->pszTraceFile);
+        if (RC_FAILURE(rc2))
+            ErrorPrintf(rc2, "Failed to write trace '%s'\n", pSettings->pszTraceFile);
+    }
+    TraceDestroy(&Trace);
     EvaluatorDestroy(&Eval);
     EvaluatorDestroyGlobals();
     SettingsDestroy(pSettings);
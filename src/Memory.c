@@ -0,0 +1,261 @@
+/** @file
+ * Pluggable heap allocator with optional accounting.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*******************************************************************************
+ *   Header Files                                                              *
+ *******************************************************************************/
+#include "Memory.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "GenericDefs.h"
+#include "Magics.h"
+
+#include <stdlib.h>
+
+/**
+ * MEMHDR: Header in front of every block handed out by the accounting allocator.
+ */
+typedef union MEMHDR
+{
+    struct
+    {
+        size_t      cb;             /**< Size of the block excluding the header. */
+        uint32_t    enmTag;         /**< What the block is used for (MEMTAG). */
+        uint32_t    u32Magic;       /**< Magic (RMAG_MEMHDR). */
+    } s;
+    long double     lrdAlign;       /**< Keeps the block suitably aligned for any type. */
+} MEMHDR;
+/** Pointer to a block header. */
+typedef MEMHDR *PMEMHDR;
+
+/** Names of the allocation categories, indexed by MEMTAG. */
+static const char *const g_apszMemTagNames[] =
+{
+    "other",
+    "tokens",
+    "nodes",
+    "variables",
+    "functions",
+    "symbols",
+    "strings"
+};
+
+/** Accounting of the accounting allocator. */
+static MEMSTATS g_MemStats;
+
+R_THREAD_LOCAL uint64_t g_cMemAllocs = 0;
+
+
+static void *MemDefaultAlloc(size_t cb, MEMTAG enmTag)
+{
+    NOREF(enmTag);
+    return malloc(cb);
+}
+
+
+static void *MemDefaultRealloc(void *pv, size_t cb, MEMTAG enmTag)
+{
+    NOREF(enmTag);
+    return realloc(pv, cb);
+}
+
+
+static void MemDefaultFree(void *pv)
+{
+    free(pv);
+}
+
+
+/**
+ * Accounts bytes being allocated or freed.
+ *
+ * @param   pTagStats   The accounting to update.
+ * @param   cbAdd       Bytes allocated.
+ * @param   cbSub       Bytes freed.
+ */
+static inline void MemAccountBytes(PMEMTAGSTATS pTagStats, size_t cbAdd, size_t cbSub)
+{
+    pTagStats->cbLive += cbAdd;
+    pTagStats->cbLive -= cbSub;
+    if (pTagStats->cbLive > pTagStats->cbPeak)
+        pTagStats->cbPeak = pTagStats->cbLive;
+}
+
+
+/**
+ * Accounts a block being allocated or freed.
+ *
+ * @param   enmTag      What the block is used for.
+ * @param   cb          Size of the block.
+ * @param   fAlloc      Whether the block is being allocated or freed.
+ */
+static void MemAccountBlock(MEMTAG enmTag, size_t cb, bool fAlloc)
+{
+    PMEMTAGSTATS apTagStats[2] = { &g_MemStats.aTags[enmTag], &g_MemStats.Total };
+    for (unsigned i = 0; i < R_ARRAY_ELEMENTS(apTagStats); i++)
+    {
+        if (fAlloc)
+        {
+            ++apTagStats[i]->cAllocs;
+            ++apTagStats[i]->cLive;
+            MemAccountBytes(apTagStats[i], cb, 0);
+        }
+        else
+        {
+            --apTagStats[i]->cLive;
+            MemAccountBytes(apTagStats[i], 0, cb);
+        }
+    }
+}
+
+
+/**
+ * Gets the header of a block handed out by the accounting allocator.
+ *
+ * @return  Pointer to the header.
+ * @param   pv          The block.
+ */
+static inline PMEMHDR MemAccountingHdr(void *pv)
+{
+    PMEMHDR pHdr = (PMEMHDR)pv - 1;
+    Assert(pHdr->s.u32Magic == RMAG_MEMHDR);
+    Assert(pHdr->s.enmTag < enmMemTagMax);
+    return pHdr;
+}
+
+
+static void *MemAccountingAlloc(size_t cb, MEMTAG enmTag)
+{
+    AssertReturn(enmTag < enmMemTagMax, NULL);
+    PMEMHDR pHdr = malloc(sizeof(MEMHDR) + cb);
+    if (!pHdr)
+        return NULL;
+    pHdr->s.cb       = cb;
+    pHdr->s.enmTag   = enmTag;
+    pHdr->s.u32Magic = RMAG_MEMHDR;
+    MemAccountBlock(enmTag, cb, true /* fAlloc */);
+    return pHdr + 1;
+}
+
+
+static void *MemAccountingRealloc(void *pv, size_t cb, MEMTAG enmTag)
+{
+    if (!pv)
+        return MemAccountingAlloc(cb, enmTag);
+
+    /*
+     * The block stays in the category it was allocated for.
+     */
+    PMEMHDR pHdr = MemAccountingHdr(pv);
+    size_t const cbOld = pHdr->s.cb;
+    pHdr = realloc(pHdr, sizeof(MEMHDR) + cb);
+    if (!pHdr)
+        return NULL;
+    pHdr->s.cb = cb;
+    MemAccountBytes(&g_MemStats.aTags[pHdr->s.enmTag], cb, cbOld);
+    MemAccountBytes(&g_MemStats.Total, cb, cbOld);
+    return pHdr + 1;
+}
+
+
+static void MemAccountingFree(void *pv)
+{
+    if (!pv)
+        return;
+
+    PMEMHDR pHdr = MemAccountingHdr(pv);
+    MemAccountBlock((MEMTAG)pHdr->s.enmTag, pHdr->s.cb, false /* fAlloc */);
+    pHdr->s.u32Magic = RMAG_MEMHDR_DEAD;
+    free(pHdr);
+}
+
+
+const MEMALLOCATOR g_MemAllocatorDefault =
+{
+    /* .pszName = */        "default",
+    /* .pfnAlloc = */       MemDefaultAlloc,
+    /* .pfnRealloc = */     MemDefaultRealloc,
+    /* .pfnFree = */        MemDefaultFree,
+    /* .fThreadSafe = */    true
+};
+
+const MEMALLOCATOR g_MemAllocatorAccounting =
+{
+    /* .pszName = */        "accounting",
+    /* .pfnAlloc = */       MemAccountingAlloc,
+    /* .pfnRealloc = */     MemAccountingRealloc,
+    /* .pfnFree = */        MemAccountingFree,
+    /* .fThreadSafe = */    false
+};
+
+PCMEMALLOCATOR g_pMemAllocator = &g_MemAllocatorDefault;
+
+
+/**
+ * Sets the allocator to use. This must be done before anything is allocated
+ * as blocks must be freed by the allocator that handed them out.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pAllocator      The allocator.
+ */
+int MemSetAllocator(PCMEMALLOCATOR pAllocator)
+{
+    AssertReturn(pAllocator, RERR_INVALID_PARAMETER);
+    if (pAllocator == g_pMemAllocator)
+        return RINF_SUCCESS;
+    if (g_cMemAllocs)
+        return RERR_NOT_SUPPORTED;
+    g_pMemAllocator = pAllocator;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Gets the accounting of all allocations.
+ *
+ * @return  true if accounting is done by the allocator in use, otherwise false
+ *          and @a pStats is zeroed.
+ * @param   pStats      Where to store the accounting.
+ */
+bool MemGetStats(PMEMSTATS pStats)
+{
+    AssertReturn(pStats, false);
+    if (g_pMemAllocator != &g_MemAllocatorAccounting)
+    {
+        memset(pStats, 0, sizeof(*pStats));
+        return false;
+    }
+    *pStats = g_MemStats;
+    return true;
+}
+
+
+/**
+ * Gets the name of an allocation category.
+ *
+ * @return  The name.
+ * @param   enmTag      The allocation category.
+ */
+const char *MemTagName(MEMTAG enmTag)
+{
+    AssertReturn(enmTag < enmMemTagMax, "?");
+    return g_apszMemTagNames[enmTag];
+}
@@ -0,0 +1,149 @@
+/** @file
+ * Pluggable heap allocator with optional accounting, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_H___
+#define MEMORY_H___
+
+#include <stddef.h>
+#include <string.h>
+
+#include "Types.h"
+#include "GenericDefs.h"
+
+/**
+ * MEMTAG: What an allocation is used for, the categories the accounting
+ * allocator reports on.
+ */
+typedef enum MEMTAG
+{
+    enmMemTagOther = 0,         /**< Everything not tagged otherwise. */
+    enmMemTagToken,             /**< Tokens and arrays of Tokens (value stacks). */
+    enmMemTagNode,              /**< Queue, Stack and List nodes. */
+    enmMemTagVariable,          /**< Variables and their lookup structures. */
+    enmMemTagFunction,          /**< User-defined Functions and compiled programs. */
+    enmMemTagSymbol,            /**< The Symbol table. */
+    enmMemTagString,            /**< Strings. */
+    enmMemTagMax
+} MEMTAG;
+
+/**
+ * MEMALLOCATOR: A heap allocator implementation.
+ */
+typedef struct MEMALLOCATOR
+{
+    const char     *pszName;                                            /**< Name of the allocator. */
+    void         *(*pfnAlloc)(size_t cb, MEMTAG enmTag);                /**< Allocates memory. */
+    void         *(*pfnRealloc)(void *pv, size_t cb, MEMTAG enmTag);    /**< Resizes memory, @a pv can be NULL. */
+    void          (*pfnFree)(void *pv);                                 /**< Frees memory, @a pv can be NULL. */
+    bool            fThreadSafe;                                        /**< Whether several threads may allocate at once. */
+} MEMALLOCATOR;
+/** Pointer to an allocator. */
+typedef MEMALLOCATOR *PMEMALLOCATOR;
+/** Pointer to a const allocator. */
+typedef const MEMALLOCATOR *PCMEMALLOCATOR;
+
+/**
+ * MEMTAGSTATS: Accounting of one allocation category.
+ */
+typedef struct MEMTAGSTATS
+{
+    uint64_t        cAllocs;        /**< Number of allocations made. */
+    uint64_t        cLive;          /**< Number of allocations not yet freed. */
+    uint64_t        cbLive;         /**< Bytes not yet freed. */
+    uint64_t        cbPeak;         /**< Highest @a cbLive seen. */
+} MEMTAGSTATS;
+/** Pointer to the accounting of an allocation category. */
+typedef MEMTAGSTATS *PMEMTAGSTATS;
+/** Pointer to the const accounting of an allocation category. */
+typedef const MEMTAGSTATS *PCMEMTAGSTATS;
+
+/**
+ * MEMSTATS: Accounting of all allocations.
+ */
+typedef struct MEMSTATS
+{
+    MEMTAGSTATS     aTags[enmMemTagMax];    /**< Per category accounting. */
+    MEMTAGSTATS     Total;                  /**< Accounting over all categories. */
+} MEMSTATS;
+/** Pointer to the accounting of all allocations. */
+typedef MEMSTATS *PMEMSTATS;
+/** Pointer to the const accounting of all allocations. */
+typedef const MEMSTATS *PCMEMSTATS;
+
+/** The C library allocator, the default. */
+extern const MEMALLOCATOR g_MemAllocatorDefault;
+/** The allocator accounting bytes and allocations per category. */
+extern const MEMALLOCATOR g_MemAllocatorAccounting;
+/** The allocator in use. */
+extern PCMEMALLOCATOR g_pMemAllocator;
+/** Number of heap allocations made so far by the calling thread, for instrumentation. */
+extern R_THREAD_LOCAL uint64_t g_cMemAllocs;
+
+int         MemSetAllocator(PCMEMALLOCATOR pAllocator);
+bool        MemGetStats(PMEMSTATS pStats);
+const char *MemTagName(MEMTAG enmTag);
+
+/*
+ * Mostly for having capitalized names, everything goes through the allocator in use.
+ */
+static inline void *MemAllocTag(size_t cb, MEMTAG enmTag)
+{
+    ++g_cMemAllocs;
+    return g_pMemAllocator->pfnAlloc(cb, enmTag);
+}
+
+static inline void *MemAllocZTag(size_t cb, MEMTAG enmTag)
+{
+    void *pv = MemAllocTag(cb, enmTag);
+    if (pv)
+        memset(pv, 0, cb);
+    return pv;
+}
+
+static inline void *MemReallocTag(void *pv, size_t cb, MEMTAG enmTag)
+{
+    ++g_cMemAllocs;
+    return g_pMemAllocator->pfnRealloc(pv, cb, enmTag);
+}
+
+static inline void *MemAlloc(size_t cb)
+{
+    return MemAllocTag(cb, enmMemTagOther);
+}
+
+static inline void *MemRealloc(void *pv, size_t cb)
+{
+    return MemReallocTag(pv, cb, enmMemTagOther);
+}
+
+static inline void MemFree(void *pv)
+{
+    g_pMemAllocator->pfnFree(pv);
+}
+
+static inline void *StrAlloc(size_t cb)
+{
+    return MemAllocTag(cb, enmMemTagString);
+}
+
+#define StrFree             MemFree
+
+#endif /* MEMORY_H___ */
@@ -42,7 +42,7 @@ inline bool QueueIsEmpty(PQUEUE pQueue)
 
 int QueueAdd(PQUEUE pQueue, void *pvData)
 {
-    PQUEUEITEM pNode = MemAlloc(sizeof(QUEUEITEM));
+    PQUEUEITEM pNode = MemAllocTag(sizeof(QUEUEITEM), enmMemTagNode);
     if (pNode)
     {
         pNode->pvData = pvData;
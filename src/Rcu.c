@@ -0,0 +1,305 @@
+/** @file
+ * Read-copy-update, lock-free readers of data replaced by a writer.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Rcu.h"
+#include "Thread.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "Memory.h"
+#include "StringOps.h"
+#include "GenericDefs.h"
+
+/*
+ * Readers never lock: entering a read-side section announces the current epoch in the
+ * reader, leaving it announces 0. The writer replaces data by publishing the new version
+ * with RCU_STORE() and retiring the old one, which tags it with the epoch and advances
+ * the epoch. Retired data is freed once every reader in a section announces a later
+ * epoch, those entered after the data was replaced and can't have seen it. Announcing
+ * and publishing are sequentially consistent, a reader announcing a stale epoch after
+ * the writer checked it necessarily sees the new version.
+ */
+
+/**
+ * RCURETIRED: Data waiting for its readers to leave.
+ */
+typedef struct RCURETIRED
+{
+    void               *pv;             /**< The data. */
+    PFNRCUFREE          pfnFree;        /**< Frees the data. */
+    uint64_t            uEpoch;         /**< Epoch the data was retired in. */
+} RCURETIRED;
+/** Pointer to retired data. */
+typedef RCURETIRED *PRCURETIRED;
+
+/** Protects the list of readers, the retired data and advancing the epoch. */
+static PTHREADMUTEX g_pRcuMutex = NULL;
+/** Serializes writers. */
+static PTHREADMUTEX g_pRcuWriteMutex = NULL;
+/** The current epoch, never 0. */
+static uint64_t g_uRcuEpoch = 1;
+/** The registered readers. */
+static PRCUREADER g_pRcuReaders = NULL;
+/** Retired data, oldest first from @a g_iRcuRetiredFirst. */
+static PRCURETIRED g_paRcuRetired = NULL;
+/** Index of the oldest entry in @a g_paRcuRetired. */
+static uint32_t g_iRcuRetiredFirst = 0;
+/** Number of entries used in @a g_paRcuRetired, freed ones included. */
+static uint32_t g_cRcuRetired = 0;
+/** Number of entries allocated in @a g_paRcuRetired. */
+static uint32_t g_cRcuRetiredAlloc = 0;
+
+
+/**
+ * Initializes RCU. Until then there are no concurrent readers and RcuRetire() frees
+ * data right away.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ */
+int RcuInit(void)
+{
+    AssertReturn(!g_pRcuMutex, RERR_INVALID_PARAMETER);
+    int rc = ThreadMutexCreate(&g_pRcuMutex);
+    if (RC_SUCCESS(rc))
+    {
+        rc = ThreadMutexCreate(&g_pRcuWriteMutex);
+        if (RC_FAILURE(rc))
+        {
+            ThreadMutexDestroy(g_pRcuMutex);
+            g_pRcuMutex = NULL;
+        }
+    }
+    return rc;
+}
+
+
+/**
+ * Frees everything still retired and terminates RCU. There must be no readers in
+ * read-side sections anymore.
+ */
+void RcuTerm(void)
+{
+    for (uint32_t i = g_iRcuRetiredFirst; i < g_cRcuRetired; i++)
+        g_paRcuRetired[i].pfnFree(g_paRcuRetired[i].pv);
+    MemFree(g_paRcuRetired);
+    g_paRcuRetired      = NULL;
+    g_iRcuRetiredFirst  = 0;
+    g_cRcuRetired       = 0;
+    g_cRcuRetiredAlloc  = 0;
+
+    /* Readers outliving RCU simply register again should it be initialized again. */
+    while (g_pRcuReaders)
+    {
+        PRCUREADER pReader = g_pRcuReaders;
+        Assert(!pReader->cNesting);
+        g_pRcuReaders = pReader->pNext;
+        pReader->fRegistered = false;
+        pReader->pNext = NULL;
+        pReader->pPrev = NULL;
+    }
+
+    ThreadMutexDestroy(g_pRcuWriteMutex);
+    ThreadMutexDestroy(g_pRcuMutex);
+    g_pRcuWriteMutex = NULL;
+    g_pRcuMutex = NULL;
+}
+
+
+/**
+ * Initializes a reader, it's registered when it first enters a read-side section.
+ *
+ * @param   pReader     The reader.
+ */
+void RcuReaderInit(PRCUREADER pReader)
+{
+    pReader->uEpoch      = 0;
+    pReader->cNesting    = 0;
+    pReader->fRegistered = false;
+    pReader->pNext       = NULL;
+    pReader->pPrev       = NULL;
+}
+
+
+/**
+ * Destroys a reader, it must not be in a read-side section.
+ *
+ * @param   pReader     The reader.
+ */
+void RcuReaderDestroy(PRCUREADER pReader)
+{
+    Assert(!pReader->cNesting);
+    if (!pReader->fRegistered)
+        return;
+
+    ThreadMutexLock(g_pRcuMutex);
+    if (pReader->pPrev)
+        pReader->pPrev->pNext = pReader->pNext;
+    else
+        g_pRcuReaders = pReader->pNext;
+    if (pReader->pNext)
+        pReader->pNext->pPrev = pReader->pPrev;
+    ThreadMutexUnlock(g_pRcuMutex);
+    RcuReaderInit(pReader);
+}
+
+
+/**
+ * Enters a read-side section, data read through RCU_LOAD() stays valid until it's
+ * left. Sections nest, only the outermost one counts.
+ *
+ * @param   pReader     The reader, used by the calling thread only.
+ */
+void RcuReadLock(PRCUREADER pReader)
+{
+    if (pReader->cNesting++)
+        return;
+
+    if (   !pReader->fRegistered
+        && g_pRcuMutex)
+    {
+        ThreadMutexLock(g_pRcuMutex);
+        pReader->pPrev = NULL;
+        pReader->pNext = g_pRcuReaders;
+        if (g_pRcuReaders)
+            g_pRcuReaders->pPrev = pReader;
+        g_pRcuReaders = pReader;
+        pReader->fRegistered = true;
+        ThreadMutexUnlock(g_pRcuMutex);
+    }
+    RCU_STORE(&pReader->uEpoch, RCU_LOAD(&g_uRcuEpoch));
+}
+
+
+/**
+ * Leaves a read-side section.
+ *
+ * @param   pReader     The reader.
+ */
+void RcuReadUnlock(PRCUREADER pReader)
+{
+    Assert(pReader->cNesting);
+    if (!--pReader->cNesting)
+        RCU_STORE(&pReader->uEpoch, UINT64_C(0));
+}
+
+
+/**
+ * Takes the lock serializing writers, readers are never kept waiting by it.
+ */
+void RcuWriteLock(void)
+{
+    if (g_pRcuWriteMutex)
+        ThreadMutexLock(g_pRcuWriteMutex);
+}
+
+
+void RcuWriteUnlock(void)
+{
+    if (g_pRcuWriteMutex)
+        ThreadMutexUnlock(g_pRcuWriteMutex);
+}
+
+
+/**
+ * Retires data a writer replaced, it's freed by RcuReclaim() once no reader can see
+ * it anymore. The replacement must already be published.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code. On failure
+ *          the data is left alone, it's better leaked than freed under a reader.
+ * @param   pv          The data.
+ * @param   pfnFree     Frees the data, called with nothing locked but RCU itself so
+ *                      it must not retire anything.
+ */
+int RcuRetire(void *pv, PFNRCUFREE pfnFree)
+{
+    AssertReturn(pfnFree, RERR_INVALID_PARAMETER);
+    if (!g_pRcuMutex)
+    {
+        pfnFree(pv);
+        return RINF_SUCCESS;
+    }
+
+    ThreadMutexLock(g_pRcuMutex);
+    if (g_cRcuRetired == g_cRcuRetiredAlloc)
+    {
+        if (g_iRcuRetiredFirst)
+        {
+            g_cRcuRetired -= g_iRcuRetiredFirst;
+            MemMove(g_paRcuRetired, &g_paRcuRetired[g_iRcuRetiredFirst], g_cRcuRetired * sizeof(RCURETIRED));
+            g_iRcuRetiredFirst = 0;
+        }
+        if (g_cRcuRetired == g_cRcuRetiredAlloc)
+        {
+            uint32_t const cAlloc = R_MAX(g_cRcuRetiredAlloc * 2, 64);
+            PRCURETIRED paRetired = MemRealloc(g_paRcuRetired, cAlloc * sizeof(RCURETIRED));
+            if (!paRetired)
+            {
+                ThreadMutexUnlock(g_pRcuMutex);
+                return RERR_NO_MEMORY;
+            }
+            g_paRcuRetired     = paRetired;
+            g_cRcuRetiredAlloc = cAlloc;
+        }
+    }
+
+    uint64_t const uEpoch = RCU_LOAD(&g_uRcuEpoch);
+    PRCURETIRED pRetired = &g_paRcuRetired[g_cRcuRetired++];
+    pRetired->pv      = pv;
+    pRetired->pfnFree = pfnFree;
+    pRetired->uEpoch  = uEpoch;
+    RCU_STORE(&g_uRcuEpoch, uEpoch + 1);
+    ThreadMutexUnlock(g_pRcuMutex);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Frees the retired data no reader can see anymore, in the order it was retired.
+ * Never waits for readers, what they may still see is left for a later call.
+ */
+void RcuReclaim(void)
+{
+    if (!g_pRcuMutex)
+        return;
+
+    ThreadMutexLock(g_pRcuMutex);
+    uint64_t uOldest = UINT64_MAX;
+    for (PRCUREADER pReader = g_pRcuReaders; pReader; pReader = pReader->pNext)
+    {
+        uint64_t const uEpoch = RCU_LOAD(&pReader->uEpoch);
+        if (   uEpoch
+            && uEpoch < uOldest)
+            uOldest = uEpoch;
+    }
+
+    while (   g_iRcuRetiredFirst < g_cRcuRetired
+           && g_paRcuRetired[g_iRcuRetiredFirst].uEpoch < uOldest)
+    {
+        PRCURETIRED pRetired = &g_paRcuRetired[g_iRcuRetiredFirst++];
+        pRetired->pfnFree(pRetired->pv);
+    }
+    if (g_iRcuRetiredFirst == g_cRcuRetired)
+    {
+        g_iRcuRetiredFirst = 0;
+        g_cRcuRetired      = 0;
+    }
+    ThreadMutexUnlock(g_pRcuMutex);
+}
+
@@ -0,0 +1,79 @@
+/** @file
+ * Read-copy-update, lock-free readers of data replaced by a writer, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFRCU_H___
+#define NOPFRCU_H___
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/** @def RCU_LOAD
+ * Loads a variable shared between readers and the writer, pointers published with
+ * RCU_STORE() included. */
+/** @def RCU_STORE
+ * Stores a variable shared between readers and the writer, publishing everything the
+ * writer stored before it. */
+#if defined(__GNUC__)
+# define RCU_LOAD(pVar)                 __atomic_load_n((pVar), __ATOMIC_SEQ_CST)
+# define RCU_STORE(pVar, Value)         __atomic_store_n((pVar), (Value), __ATOMIC_SEQ_CST)
+#else
+# define RCU_LOAD(pVar)                 (*(pVar))
+# define RCU_STORE(pVar, Value)         (*(pVar) = (Value))
+#endif
+
+/**
+ * Frees data nobody reads anymore, see RcuRetire().
+ *
+ * @param   pv          The data.
+ */
+typedef void FNRCUFREE(void *pv);
+/** Pointer to a function freeing retired data. */
+typedef FNRCUFREE *PFNRCUFREE;
+
+/**
+ * RCUREADER: A reader of data protected by RCU, one per thread at a time.
+ */
+typedef struct RCUREADER
+{
+    uint64_t            uEpoch;         /**< Epoch the outermost read-side section started in, 0 outside of one. */
+    uint32_t            cNesting;       /**< Nesting depth of read-side sections. */
+    bool                fRegistered;    /**< Whether it's in the list of readers the writer checks. */
+    struct RCUREADER   *pNext;          /**< Next registered reader. */
+    struct RCUREADER   *pPrev;          /**< Previous registered reader. */
+} RCUREADER;
+/** Pointer to an RCU reader. */
+typedef RCUREADER *PRCUREADER;
+
+int         RcuInit(void);
+void        RcuTerm(void);
+
+void        RcuReaderInit(PRCUREADER pReader);
+void        RcuReaderDestroy(PRCUREADER pReader);
+void        RcuReadLock(PRCUREADER pReader);
+void        RcuReadUnlock(PRCUREADER pReader);
+
+void        RcuWriteLock(void);
+void        RcuWriteUnlock(void);
+int         RcuRetire(void *pv, PFNRCUFREE pfnFree);
+void        RcuReclaim(void);
+
+#endif /* NOPFRCU_H___ */
+
@@ -0,0 +1,861 @@
+/** @file
+ * Expression server over a Unix domain socket and its client.
+ *
+ * The server keeps one evaluator alive for many short-lived clients, each
+ * connection gets its own Variable scope layered over the global one. Requests
+ * are handled one at a time on a single thread, epoll multiplexes the
+ * connections. A watcher thread cancels the request being handled when its
+ * client hangs up.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*******************************************************************************
+ *   Header Files                                                              *
+ *******************************************************************************/
+#ifdef __linux__
+/* epoll, accept4() and getline() are Linux and POSIX, not C99. */
+# define _GNU_SOURCE
+#endif
+
+#include "Server.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "Evaluator.h"
+#include "GenericDefs.h"
+#include "InputOutput.h"
+#include "StringOps.h"
+#include "Thread.h"
+
+#ifdef __linux__
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <pthread.h>
+# include <signal.h>
+# include <sys/epoll.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <unistd.h>
+
+/** Maximum number of events handled per epoll_wait(). */
+#define SERVER_MAX_EVENTS           64
+/** Maximum number of pending connections. */
+#define SERVER_LISTEN_BACKLOG       128
+/** Size of the chunks connections are read in. */
+#define SERVER_READ_CHUNK           4096
+/** How often a request whose client hung up is cancelled again, in milliseconds. */
+#define SERVER_CANCEL_INTERVAL_MS   10
+
+/**
+ * SERVERCONN: A client connection.
+ */
+typedef struct SERVERCONN
+{
+    int             hSocket;        /**< The connected socket. */
+    PVARSCOPE       pScope;         /**< Variables and Functions defined by the client. */
+    char           *pbIn;           /**< Received bytes not yet handled, the start of a request line. */
+    size_t          cbIn;           /**< Number of bytes in @a pbIn. */
+    size_t          cbInAlloc;      /**< Size of @a pbIn. */
+    char           *pbOut;          /**< Responses not yet sent. */
+    size_t          offOut;         /**< How much of @a pbOut has been sent. */
+    size_t          cbOut;          /**< Number of bytes in @a pbOut. */
+    size_t          cbOutAlloc;     /**< Size of @a pbOut. */
+    bool            fWantWrite;     /**< Whether the socket is being polled for writing. */
+    bool            fEndOfInput;    /**< Whether the client is done sending requests. */
+    struct SERVERCONN *pNext;       /**< Next connection of the server. */
+    struct SERVERCONN *pPrev;       /**< Previous connection of the server. */
+} SERVERCONN;
+/** Pointer to a client connection. */
+typedef SERVERCONN *PSERVERCONN;
+
+/**
+ * SERVERWATCH: Watches the connection of the request being handled for hangups.
+ */
+typedef struct SERVERWATCH
+{
+    PTHREAD             pThread;        /**< The watcher thread, NULL if it couldn't be created. */
+    PTHREADMUTEX        pMutex;         /**< Protects the members below. */
+    PTHREADCOND         pCond;          /**< Signalled when there is a request to watch or the watcher is to quit. */
+    int                 ahWake[2];      /**< Pipe waking the watcher up from poll() when the request is done. */
+    int                 hSocket;        /**< Socket of the request being handled, -1 if none. */
+    bool                fPolling;       /**< Whether the watcher is polling @a hSocket. */
+    bool                fHungUp;        /**< Whether the client of the request hung up. */
+    bool                fStop;          /**< Whether the watcher is to quit. */
+} SERVERWATCH;
+/** Pointer to the hangup watcher. */
+typedef SERVERWATCH *PSERVERWATCH;
+
+/**
+ * SERVER: The server.
+ */
+typedef struct SERVER
+{
+    int                 hEpoll;         /**< The epoll instance. */
+    int                 hListen;        /**< The listening socket. */
+    PFNSERVERREQUEST    pfnRequest;     /**< The request handler. */
+    void               *pvUser;         /**< User argument to @a pfnRequest. */
+    STRBUF              Response;       /**< Output of the request being handled, reused for every request. */
+    PSERVERCONN         pConnHead;      /**< The open connections. */
+    SERVERWATCH         Watch;          /**< The hangup watcher. */
+} SERVER;
+/** Pointer to the server. */
+typedef SERVER *PSERVER;
+
+/** Set by SIGINT and SIGTERM to shut the server down. */
+static volatile sig_atomic_t g_fServerStop = 0;
+
+
+static void ServerStopHandler(int iSignal)
+{
+    NOREF(iSignal);
+    g_fServerStop = 1;
+}
+
+
+/**
+ * Makes sure a buffer can hold at least @a cbNeeded bytes.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   ppb         The buffer, reallocated as required.
+ * @param   pcbAlloc    The size of the buffer, updated.
+ * @param   cbNeeded    The number of bytes needed.
+ */
+static int ServerReserve(char **ppb, size_t *pcbAlloc, size_t cbNeeded)
+{
+    if (cbNeeded <= *pcbAlloc)
+        return RINF_SUCCESS;
+
+    size_t cbAlloc = R_MAX(*pcbAlloc, SERVER_READ_CHUNK);
+    while (cbAlloc < cbNeeded)
+        cbAlloc *= 2;
+    char *pb = MemRealloc(*ppb, cbAlloc);
+    if (!pb)
+        return RERR_NO_MEMORY;
+    *ppb      = pb;
+    *pcbAlloc = cbAlloc;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Watches the socket of each request being handled and cancels the evaluation
+ * when the client closes the connection. A client that merely shuts down its
+ * sending side still wants its responses, poll() only reports POLLHUP once the
+ * connection is closed both ways.
+ *
+ * @return  RINF_SUCCESS.
+ * @param   pvUser      The hangup watcher.
+ */
+static int ServerWatchThread(void *pvUser)
+{
+    PSERVERWATCH pWatch = (PSERVERWATCH)pvUser;
+    ThreadMutexLock(pWatch->pMutex);
+    for (;;)
+    {
+        while (   !pWatch->fStop
+               && pWatch->hSocket < 0)
+            ThreadCondWait(pWatch->pCond, pWatch->pMutex);
+        if (pWatch->fStop)
+            break;
+
+        int const hSocket = pWatch->hSocket;
+        pWatch->fPolling = true;
+        ThreadMutexUnlock(pWatch->pMutex);
+
+        struct pollfd aPoll[2];
+        MemSet(aPoll, 0, sizeof(aPoll));
+        aPoll[0].fd     = hSocket;
+        aPoll[0].events = 0;
+        aPoll[1].fd     = pWatch->ahWake[0];
+        aPoll[1].events = POLLIN;
+        int const cReady = poll(aPoll, R_ARRAY_ELEMENTS(aPoll), -1 /* infinite */);
+        bool const fHungUp = cReady > 0
+                          && (aPoll[0].revents & (POLLHUP | POLLERR));
+
+        /*
+         * An evaluation resets the cancellation when it starts, keep cancelling until the
+         * request is done so one starting after the hangup is cancelled as well.
+         */
+        ThreadMutexLock(pWatch->pMutex);
+        if (   fHungUp
+            && pWatch->hSocket == hSocket)
+        {
+            pWatch->fHungUp = true;
+            while (   pWatch->hSocket == hSocket
+                   && !pWatch->fStop)
+            {
+                EvaluatorCancel();
+                ThreadMutexUnlock(pWatch->pMutex);
+                poll(&aPoll[1], 1, SERVER_CANCEL_INTERVAL_MS);
+                ThreadMutexLock(pWatch->pMutex);
+            }
+        }
+        pWatch->fPolling = false;
+
+        char abDrain[64];
+        while (read(pWatch->ahWake[0], abDrain, sizeof(abDrain)) > 0)
+            ;
+    }
+    ThreadMutexUnlock(pWatch->pMutex);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Starts the hangup watcher. The server does without if it can't be started.
+ *
+ * @param   pWatch      The hangup watcher.
+ */
+static void ServerWatchStart(PSERVERWATCH pWatch)
+{
+    MemSet(pWatch, 0, sizeof(*pWatch));
+    pWatch->hSocket   = -1;
+    pWatch->ahWake[0] = -1;
+    pWatch->ahWake[1] = -1;
+    if (   pipe2(pWatch->ahWake, O_NONBLOCK | O_CLOEXEC) < 0
+        || RC_FAILURE(ThreadMutexCreate(&pWatch->pMutex))
+        || RC_FAILURE(ThreadCondCreate(&pWatch->pCond)))
+        return;
+
+    /* The stop signals must interrupt epoll_wait(), the watcher inherits them blocked. */
+    sigset_t StopSignals, OldSignals;
+    sigemptyset(&StopSignals);
+    sigaddset(&StopSignals, SIGINT);
+    sigaddset(&StopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &StopSignals, &OldSignals);
+    if (RC_FAILURE(ThreadCreate(&pWatch->pThread, ServerWatchThread, pWatch)))
+        pWatch->pThread = NULL;
+    pthread_sigmask(SIG_SETMASK, &OldSignals, NULL);
+}
+
+
+/**
+ * Stops the hangup watcher.
+ *
+ * @param   pWatch      The hangup watcher.
+ */
+static void ServerWatchStop(PSERVERWATCH pWatch)
+{
+    if (pWatch->pThread)
+    {
+        ThreadMutexLock(pWatch->pMutex);
+        pWatch->fStop = true;
+        ThreadCondBroadcast(pWatch->pCond);
+        ThreadMutexUnlock(pWatch->pMutex);
+        write(pWatch->ahWake[1], "", 1);
+        ThreadJoin(pWatch->pThread, NULL);
+    }
+    ThreadCondDestroy(pWatch->pCond);
+    ThreadMutexDestroy(pWatch->pMutex);
+    if (pWatch->ahWake[0] >= 0)
+        close(pWatch->ahWake[0]);
+    if (pWatch->ahWake[1] >= 0)
+        close(pWatch->ahWake[1]);
+}
+
+
+/**
+ * Has the hangup watcher watch the connection of the request about to be handled.
+ *
+ * @param   pWatch      The hangup watcher.
+ * @param   hSocket     Socket of the connection.
+ */
+static void ServerWatchBegin(PSERVERWATCH pWatch, int hSocket)
+{
+    if (!pWatch->pThread)
+        return;
+    ThreadMutexLock(pWatch->pMutex);
+    pWatch->hSocket = hSocket;
+    pWatch->fHungUp = false;
+    ThreadCondBroadcast(pWatch->pCond);
+    ThreadMutexUnlock(pWatch->pMutex);
+}
+
+
+/**
+ * Stops watching the connection of the request that was handled. The socket
+ * may be closed once this returns.
+ *
+ * @return  Whether the client hung up while the request was handled.
+ * @param   pWatch      The hangup watcher.
+ */
+static bool ServerWatchEnd(PSERVERWATCH pWatch)
+{
+    if (!pWatch->pThread)
+        return false;
+    ThreadMutexLock(pWatch->pMutex);
+    pWatch->hSocket = -1;
+    bool const fHungUp = pWatch->fHungUp;
+    bool const fWake   = pWatch->fPolling;
+    ThreadMutexUnlock(pWatch->pMutex);
+    if (fWake)
+        write(pWatch->ahWake[1], "", 1);
+    return fHungUp;
+}
+
+
+/**
+ * Closes a connection and destroys its Variable scope.
+ *
+ * @param   pServer     The server.
+ * @param   pConn       The connection.
+ */
+static void ServerCloseConn(PSERVER pServer, PSERVERCONN pConn)
+{
+    if (pConn->pPrev)
+        pConn->pPrev->pNext = pConn->pNext;
+    else
+        pServer->pConnHead = pConn->pNext;
+    if (pConn->pNext)
+        pConn->pNext->pPrev = pConn->pPrev;
+
+    epoll_ctl(pServer->hEpoll, EPOLL_CTL_DEL, pConn->hSocket, NULL);
+    close(pConn->hSocket);
+    EvaluatorDestroyScope(pConn->pScope);
+    MemFree(pConn->pbIn);
+    MemFree(pConn->pbOut);
+    MemFree(pConn);
+}
+
+
+/**
+ * Queues a framed response on a connection.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pConn       The connection.
+ * @param   rcRequest   Status code of the request.
+ * @param   pszOutput   Output of the request.
+ * @param   cchOutput   Length of @a pszOutput.
+ */
+static int ServerQueueResponse(PSERVERCONN pConn, int rcRequest, const char *pszOutput, size_t cchOutput)
+{
+    char szHdr[64];
+    size_t const cchHdr = StrNPrintf(szHdr, sizeof(szHdr), "%d %zu\n", rcRequest, cchOutput);
+    int rc = ServerReserve(&pConn->pbOut, &pConn->cbOutAlloc, pConn->cbOut + cchHdr + cchOutput);
+    if (RC_SUCCESS(rc))
+    {
+        MemCpy(pConn->pbOut + pConn->cbOut, szHdr, cchHdr);
+        MemCpy(pConn->pbOut + pConn->cbOut + cchHdr, pszOutput, cchOutput);
+        pConn->cbOut += cchHdr + cchOutput;
+    }
+    return rc;
+}
+
+
+/**
+ * Handles a request in the connection's Variable scope and queues its response.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pServer     The server.
+ * @param   pConn       The connection.
+ * @param   pszRequest  The request.
+ */
+static int ServerHandleRequest(PSERVER pServer, PSERVERCONN pConn, char *pszRequest)
+{
+    StrBufReset(&pServer->Response);
+    PSTRBUF pOldCapture = TextOutputCapture(&pServer->Response);
+    PVARSCOPE pOldScope = EvaluatorSetScope(pConn->pScope);
+    ServerWatchBegin(&pServer->Watch, pConn->hSocket);
+
+    int rcRequest = pServer->pfnRequest(pServer->pvUser, pszRequest);
+
+    bool const fHungUp = ServerWatchEnd(&pServer->Watch);
+    EvaluatorSetScope(pOldScope);
+    TextOutputCapture(pOldCapture);
+
+    /* Nobody is left to answer, drop the connection along with any requests still queued. */
+    if (fHungUp)
+        return RERR_SOCKET_IO;
+
+    if (RC_FAILURE(pServer->Response.rc))
+        return ServerQueueResponse(pConn, pServer->Response.rc, "", 0);
+    return ServerQueueResponse(pConn, rcRequest, pServer->Response.pszBuf ? pServer->Response.pszBuf : "",
+                               pServer->Response.cchBuf);
+}
+
+
+/**
+ * Sends as much of the queued responses as the socket takes, and polls for
+ * writing while some remain.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pServer     The server.
+ * @param   pConn       The connection.
+ */
+static int ServerFlushConn(PSERVER pServer, PSERVERCONN pConn)
+{
+    while (pConn->offOut < pConn->cbOut)
+    {
+        ssize_t cbSent = send(pConn->hSocket, pConn->pbOut + pConn->offOut, pConn->cbOut - pConn->offOut, MSG_NOSIGNAL);
+        if (cbSent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (   errno == EAGAIN
+                || errno == EWOULDBLOCK)
+                break;
+            return RERR_SOCKET_IO;
+        }
+        pConn->offOut += cbSent;
+    }
+
+    if (pConn->offOut == pConn->cbOut)
+        pConn->offOut = pConn->cbOut = 0;
+
+    bool const fWantWrite = pConn->cbOut > 0;
+    if (fWantWrite != pConn->fWantWrite)
+    {
+        struct epoll_event Event;
+        MemSet(&Event, 0, sizeof(Event));
+        Event.events   = EPOLLIN | (fWantWrite ? EPOLLOUT : 0);
+        Event.data.ptr = pConn;
+        if (epoll_ctl(pServer->hEpoll, EPOLL_CTL_MOD, pConn->hSocket, &Event) < 0)
+            return RERR_SOCKET_IO;
+        pConn->fWantWrite = fWantWrite;
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Reads what a client sent and handles every complete request line.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pServer     The server.
+ * @param   pConn       The connection.
+ */
+static int ServerReadConn(PSERVER pServer, PSERVERCONN pConn)
+{
+    while (!pConn->fEndOfInput)
+    {
+        int rc = ServerReserve(&pConn->pbIn, &pConn->cbInAlloc, pConn->cbIn + SERVER_READ_CHUNK);
+        if (RC_FAILURE(rc))
+            return rc;
+
+        ssize_t cbRead = recv(pConn->hSocket, pConn->pbIn + pConn->cbIn, pConn->cbInAlloc - pConn->cbIn - 1, 0);
+        if (cbRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (   errno == EAGAIN
+                || errno == EWOULDBLOCK)
+                break;
+            return RERR_SOCKET_IO;
+        }
+        if (cbRead == 0)
+        {
+            pConn->fEndOfInput = true;
+            break;
+        }
+
+        /*
+         * Handle every complete line, keeping a partial one for the next read.
+         */
+        size_t const offScan = pConn->cbIn;
+        pConn->cbIn += cbRead;
+        size_t offLine = 0;
+        for (size_t off = offScan; off < pConn->cbIn; off++)
+        {
+            if (pConn->pbIn[off] != '\n')
+                continue;
+
+            pConn->pbIn[off] = '\0';
+            if (off > offLine && pConn->pbIn[off - 1] == '\r')
+                pConn->pbIn[off - 1] = '\0';
+            rc = ServerHandleRequest(pServer, pConn, pConn->pbIn + offLine);
+            if (RC_FAILURE(rc))
+                return rc;
+            offLine = off + 1;
+        }
+        if (offLine)
+        {
+            MemMove(pConn->pbIn, pConn->pbIn + offLine, pConn->cbIn - offLine);
+            pConn->cbIn -= offLine;
+        }
+
+        if (pConn->cbIn >= SERVER_MAX_REQUEST_LENGTH)
+        {
+            ServerQueueResponse(pConn, RERR_BUFFER_OVERFLOW, "", 0);
+            pConn->cbIn = 0;
+            pConn->fEndOfInput = true;
+        }
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Accepts pending connections.
+ *
+ * @param   pServer     The server.
+ */
+static void ServerAccept(PSERVER pServer)
+{
+    for (;;)
+    {
+        int hSocket = accept4(pServer->hListen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (hSocket < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (   errno != EAGAIN
+                && errno != EWOULDBLOCK)
+                DEBUGPRINTF(("accept4 failed errno=%d\n", errno));
+            return;
+        }
+
+        PSERVERCONN pConn = MemAllocZ(sizeof(SERVERCONN));
+        int rc = pConn ? EvaluatorCreateScope(&pConn->pScope) : RERR_NO_MEMORY;
+        if (RC_SUCCESS(rc))
+        {
+            pConn->hSocket = hSocket;
+
+            struct epoll_event Event;
+            MemSet(&Event, 0, sizeof(Event));
+            Event.events   = EPOLLIN;
+            Event.data.ptr = pConn;
+            if (!epoll_ctl(pServer->hEpoll, EPOLL_CTL_ADD, hSocket, &Event))
+            {
+                pConn->pNext = pServer->pConnHead;
+                if (pConn->pNext)
+                    pConn->pNext->pPrev = pConn;
+                pServer->pConnHead = pConn;
+                continue;
+            }
+            EvaluatorDestroyScope(pConn->pScope);
+        }
+        MemFree(pConn);
+        close(hSocket);
+    }
+}
+
+
+/**
+ * Creates the listening socket, replacing a stale socket file left behind by a
+ * server that is no longer running.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszSocket   Path of the socket.
+ * @param   phSocket    Where to store the listening socket.
+ */
+static int ServerListen(const char *pszSocket, int *phSocket)
+{
+    struct sockaddr_un Addr;
+    MemSet(&Addr, 0, sizeof(Addr));
+    Addr.sun_family = AF_UNIX;
+    if (StrCopy(Addr.sun_path, sizeof(Addr.sun_path), pszSocket) != RINF_SUCCESS)
+        return RERR_BUFFER_OVERFLOW;
+
+    int hSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (hSocket < 0)
+        return RERR_SOCKET_IO;
+
+    if (bind(hSocket, (struct sockaddr *)&Addr, sizeof(Addr)) < 0)
+    {
+        if (errno != EADDRINUSE)
+        {
+            close(hSocket);
+            return RERR_SOCKET_IO;
+        }
+
+        int hProbe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool const fStale = hProbe >= 0
+                         && connect(hProbe, (struct sockaddr *)&Addr, sizeof(Addr)) < 0
+                         && errno == ECONNREFUSED;
+        if (hProbe >= 0)
+            close(hProbe);
+        if (   !fStale
+            || unlink(pszSocket) < 0
+            || bind(hSocket, (struct sockaddr *)&Addr, sizeof(Addr)) < 0)
+        {
+            close(hSocket);
+            return RERR_ADDRESS_IN_USE;
+        }
+    }
+
+    if (listen(hSocket, SERVER_LISTEN_BACKLOG) < 0)
+    {
+        close(hSocket);
+        unlink(pszSocket);
+        return RERR_SOCKET_IO;
+    }
+
+    *phSocket = hSocket;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Serves requests on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszSocket   Path of the socket to create.
+ * @param   pfnRequest  The request handler.
+ * @param   pvUser      User argument to @a pfnRequest.
+ */
+int ServerRun(const char *pszSocket, PFNSERVERREQUEST pfnRequest, void *pvUser)
+{
+    AssertReturn(pszSocket, RERR_INVALID_PARAMETER);
+    AssertReturn(pfnRequest, RERR_INVALID_PARAMETER);
+
+    SERVER Server;
+    MemSet(&Server, 0, sizeof(Server));
+    Server.pfnRequest = pfnRequest;
+    Server.pvUser     = pvUser;
+    StrBufInit(&Server.Response);
+
+    int rc = ServerListen(pszSocket, &Server.hListen);
+    if (RC_FAILURE(rc))
+        return rc;
+
+    Server.hEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (Server.hEpoll < 0)
+    {
+        close(Server.hListen);
+        unlink(pszSocket);
+        return RERR_SOCKET_IO;
+    }
+
+    struct epoll_event Event;
+    MemSet(&Event, 0, sizeof(Event));
+    Event.events   = EPOLLIN;
+    Event.data.ptr = NULL;      /* The listening socket. */
+    if (epoll_ctl(Server.hEpoll, EPOLL_CTL_ADD, Server.hListen, &Event) < 0)
+        rc = RERR_SOCKET_IO;
+
+    /*
+     * No SA_RESTART, epoll_wait() must return to notice the stop request.
+     */
+    struct sigaction StopAction, OldIntAction, OldTermAction;
+    MemSet(&StopAction, 0, sizeof(StopAction));
+    StopAction.sa_handler = ServerStopHandler;
+    sigemptyset(&StopAction.sa_mask);
+    g_fServerStop = 0;
+    sigaction(SIGINT,  &StopAction, &OldIntAction);
+    sigaction(SIGTERM, &StopAction, &OldTermAction);
+    ServerWatchStart(&Server.Watch);
+
+    while (   RC_SUCCESS(rc)
+           && !g_fServerStop)
+    {
+        struct epoll_event aEvents[SERVER_MAX_EVENTS];
+        int cEvents = epoll_wait(Server.hEpoll, aEvents, R_ARRAY_ELEMENTS(aEvents), -1 /* infinite */);
+        if (cEvents < 0)
+        {
+            if (errno != EINTR)
+                rc = RERR_SOCKET_IO;
+            continue;
+        }
+
+        for (int i = 0; i < cEvents; i++)
+        {
+            PSERVERCONN pConn = aEvents[i].data.ptr;
+            if (!pConn)
+            {
+                ServerAccept(&Server);
+                continue;
+            }
+
+            int rcConn = RINF_SUCCESS;
+            if (aEvents[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                rcConn = ServerReadConn(&Server, pConn);
+            if (RC_SUCCESS(rcConn))
+                rcConn = ServerFlushConn(&Server, pConn);
+            if (   RC_FAILURE(rcConn)
+                || (   pConn->fEndOfInput
+                    && !pConn->cbOut))
+                ServerCloseConn(&Server, pConn);
+        }
+    }
+
+    ServerWatchStop(&Server.Watch);
+    while (Server.pConnHead)
+        ServerCloseConn(&Server, Server.pConnHead);
+
+    sigaction(SIGINT,  &OldIntAction, NULL);
+    sigaction(SIGTERM, &OldTermAction, NULL);
+    close(Server.hEpoll);
+    close(Server.hListen);
+    unlink(pszSocket);
+    StrBufDelete(&Server.Response);
+    return rc;
+}
+
+
+/**
+ * Sends all of a buffer.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   hSocket     The connected socket.
+ * @param   pb          What to send.
+ * @param   cb          Number of bytes to send.
+ */
+static int ServerSendAll(int hSocket, const char *pb, size_t cb)
+{
+    while (cb)
+    {
+        ssize_t cbSent = send(hSocket, pb, cb, MSG_NOSIGNAL);
+        if (cbSent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return RERR_SOCKET_IO;
+        }
+        pb += cbSent;
+        cb -= cbSent;
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Sends a request and prints its response, to stdout if it succeeded and to
+ * stderr otherwise.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   hSocket     The connected socket.
+ * @param   pResponses  Stream reading from @a hSocket.
+ * @param   pszRequest  The request, a single line.
+ * @param   prcRequest  Where to store the status code of the request.
+ */
+static int ServerClientRequest(int hSocket, FILE *pResponses, const char *pszRequest, int *prcRequest)
+{
+    int rc = ServerSendAll(hSocket, pszRequest, StrLen(pszRequest));
+    if (RC_SUCCESS(rc))
+        rc = ServerSendAll(hSocket, "\n", 1);
+    if (RC_FAILURE(rc))
+        return rc;
+
+    char szHdr[64];
+    int rcRequest;
+    size_t cbOutput;
+    if (!fgets(szHdr, sizeof(szHdr), pResponses))
+        return RERR_SOCKET_IO;
+    if (sscanf(szHdr, "%d %zu", &rcRequest, &cbOutput) != 2)
+        return RERR_PROTOCOL_ERROR;
+
+    FILE *pOut = RC_SUCCESS(rcRequest) ? stdout : stderr;
+    while (cbOutput)
+    {
+        char abBuf[SERVER_READ_CHUNK];
+        size_t const cbRead = fread(abBuf, 1, R_MIN(cbOutput, sizeof(abBuf)), pResponses);
+        if (!cbRead)
+            return RERR_SOCKET_IO;
+        fwrite(abBuf, 1, cbRead, pOut);
+        cbOutput -= cbRead;
+    }
+    fflush(pOut);
+
+    *prcRequest = rcRequest;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Forwards requests to a server and prints the responses. The requests share a
+ * connection and thus a Variable scope.
+ *
+ * Like evaluating directly, a request failing to evaluate is reported on stderr
+ * but doesn't fail the client, so the exit status only reflects the connection.
+ *
+ * @return  RINF_SUCCESS unless talking to the server failed.
+ * @param   pszSocket   Path of the server's socket.
+ * @param   pszRequest  The request, NULL to forward every line read from stdin.
+ */
+int ServerClientRun(const char *pszSocket, const char *pszRequest)
+{
+    AssertReturn(pszSocket, RERR_INVALID_PARAMETER);
+    if (   pszRequest
+        && strchr(pszRequest, '\n'))
+        return RERR_INVALID_PARAMETER;
+
+    struct sockaddr_un Addr;
+    MemSet(&Addr, 0, sizeof(Addr));
+    Addr.sun_family = AF_UNIX;
+    if (StrCopy(Addr.sun_path, sizeof(Addr.sun_path), pszSocket) != RINF_SUCCESS)
+        return RERR_BUFFER_OVERFLOW;
+
+    int hSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (hSocket < 0)
+        return RERR_SOCKET_IO;
+    if (connect(hSocket, (struct sockaddr *)&Addr, sizeof(Addr)) < 0)
+    {
+        close(hSocket);
+        return RERR_SOCKET_IO;
+    }
+
+    FILE *pResponses = fdopen(hSocket, "r");
+    if (!pResponses)
+    {
+        close(hSocket);
+        return RERR_NO_MEMORY;
+    }
+
+    int rc;
+    if (pszRequest)
+    {
+        int rcRequest;
+        rc = ServerClientRequest(hSocket, pResponses, pszRequest, &rcRequest);
+    }
+    else
+    {
+        /* getline() allocates with malloc(), so free() it rather than StrFree(). */
+        char  *pszLine = NULL;
+        size_t cbLine  = 0;
+        rc = RINF_SUCCESS;
+        while (   RC_SUCCESS(rc)
+               && getline(&pszLine, &cbLine, stdin) >= 0)
+        {
+            char *pszStripped = StrStrip(pszLine);
+            if (!*pszStripped)
+                continue;
+            if (   !StrCmp(pszStripped, CMD_QUIT)
+                || !StrCmp(pszStripped, CMD_QUIT_SHORT)
+                || !StrCmp(pszStripped, CMD_EXIT))
+                break;
+
+            int rcRequest;
+            rc = ServerClientRequest(hSocket, pResponses, pszStripped, &rcRequest);
+        }
+        free(pszLine);
+    }
+
+    fclose(pResponses);
+    return rc;
+}
+
+#else  /* !__linux__ */
+
+int ServerRun(const char *pszSocket, PFNSERVERREQUEST pfnRequest, void *pvUser)
+{
+    NOREF(pszSocket);
+    NOREF(pfnRequest);
+    NOREF(pvUser);
+    return RERR_NOT_SUPPORTED;
+}
+
+
+int ServerClientRun(const char *pszSocket, const char *pszRequest)
+{
+    NOREF(pszSocket);
+    NOREF(pszRequest);
+    return RERR_NOT_SUPPORTED;
+}
+
+#endif /* !__linux__ */
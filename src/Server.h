@@ -0,0 +1,56 @@
+/** @file
+ * Expression server over a Unix domain socket and its client, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVER_H___
+#define SERVER_H___
+
+/*
+ * Protocol: a request is one line of text terminated by '\n'. Each request gets
+ * exactly one response, in order, framed as a header line "<rc> <cb>\n" followed
+ * by <cb> bytes of output, which is what nopf would have printed for the request.
+ */
+
+/** Maximum length of a request line including the newline. */
+#define SERVER_MAX_REQUEST_LENGTH       (1U << 20)
+/** Wall-clock budget of a request in milliseconds when none is given. */
+#define SERVER_DEFAULT_TIMEOUT_MS       5000
+
+/** Commands ending a session, handled by the client rather than forwarded. */
+#define CMD_QUIT                        "quit"
+#define CMD_QUIT_SHORT                  "q"
+#define CMD_EXIT                        "exit"
+
+/**
+ * Handles a request, everything printed with Printf(), ColorPrintf() and
+ * ErrorPrintf() while handling it is sent back as the response.
+ *
+ * @return  Status code sent along with the response.
+ * @param   pvUser      The user argument passed to ServerRun().
+ * @param   pszRequest  The request, a line without the newline, can be modified.
+ */
+typedef int FNSERVERREQUEST(void *pvUser, char *pszRequest);
+/** Pointer to a request handler. */
+typedef FNSERVERREQUEST *PFNSERVERREQUEST;
+
+int     ServerRun(const char *pszSocket, PFNSERVERREQUEST pfnRequest, void *pvUser);
+int     ServerClientRun(const char *pszSocket, const char *pszRequest);
+
+#endif /* SERVER_H___ */
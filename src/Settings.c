@@ -33,7 +33,19 @@ SETTINGS const g_FactorySettings =
     /* .fOutputBaseDec = */                     true,
     /* .fOutputBaseOct = */                     true,
     /* .fOutputBaseHex = */                     true,
-    /* .fOutputBaseBin = */                     true
+    /* .fOutputBaseBin = */                     true,
+    /* .cMaxSteps = */                          0,
+    /* .cMaxMilliSecs = */                      0,
+    /* .fMaxMilliSecsSet = */                   false,
+    /* .fStats = */                             false,
+    /* .fBatch = */                             false,
+    /* .fCoprocess = */                         false,
+    /* .fProfile = */                           false,
+    /* .pszTraceFile = */                       NULL,
+    /* .pszServerSocket = */                    NULL,
+    /* .pszConnectSocket = */                   NULL,
+    /* .pszLoadImage = */                       NULL,
+    /* .fAttachImage = */                       false
 };
 
 
@@ -67,6 +79,51 @@ int SettingsCreate(PSETTINGS *ppSettings, PCSETTINGS pSource)
     pSettings->fOutputBaseOct  = pSource->fOutputBaseOct;
     pSettings->fOutputBaseHex  = pSource->fOutputBaseHex;
     pSettings->fOutputBaseBin  = pSource->fOutputBaseBin;
+    pSettings->cMaxSteps       = pSource->cMaxSteps;
+    pSettings->cMaxMilliSecs   = pSource->cMaxMilliSecs;
+    pSettings->fMaxMilliSecsSet = pSource->fMaxMilliSecsSet;
+    pSettings->fStats          = pSource->fStats;
+    pSettings->fBatch          = pSource->fBatch;
+    pSettings->fCoprocess      = pSource->fCoprocess;
+    pSettings->fProfile        = pSource->fProfile;
+    pSettings->fAttachImage    = pSource->fAttachImage;
+    if (pSource->pszTraceFile)
+    {
+        pSettings->pszTraceFile = StrDup(pSource->pszTraceFile);
+        if (!pSettings->pszTraceFile)
+        {
+            StrFree(pSettings->pszPrompt);
+            StrFree(pSettings);
+            return RERR_NO_MEMORY;
+        }
+    }
+    if (pSource->pszServerSocket)
+    {
+        pSettings->pszServerSocket = StrDup(pSource->pszServerSocket);
+        if (!pSettings->pszServerSocket)
+        {
+            SettingsDestroy(pSettings);
+            return RERR_NO_MEMORY;
+        }
+    }
+    if (pSource->pszConnectSocket)
+    {
+        pSettings->pszConnectSocket = StrDup(pSource->pszConnectSocket);
+        if (!pSettings->pszConnectSocket)
+        {
+            SettingsDestroy(pSettings);
+            return RERR_NO_MEMORY;
+        }
+    }
+    if (pSource->pszLoadImage)
+    {
+        pSettings->pszLoadImage = StrDup(pSource->pszLoadImage);
+        if (!pSettings->pszLoadImage)
+        {
+            SettingsDestroy(pSettings);
+            return RERR_NO_MEMORY;
+        }
+    }
 
     *ppSettings = pSettings;
     return RINF_SUCCESS;
@@ -88,6 +145,30 @@ void SettingsDestroy(PSETTINGS pSettings)
         pSettings->pszPrompt = NULL;
     }
 
+    if (pSettings->pszTraceFile)
+    {
+        StrFree(pSettings->pszTraceFile);
+        pSettings->pszTraceFile = NULL;
+    }
+
+    if (pSettings->pszServerSocket)
+    {
+        StrFree(pSettings->pszServerSocket);
+        pSettings->pszServerSocket = NULL;
+    }
+
+    if (pSettings->pszConnectSocket)
+    {
+        StrFree(pSettings->pszConnectSocket);
+        pSettings->pszConnectSocket = NULL;
+    }
+
+    if (pSettings->pszLoadImage)
+    {
+        StrFree(pSettings->pszLoadImage);
+        pSettings->pszLoadImage = NULL;
+    }
+
     MemFree(pSettings);
 }
 
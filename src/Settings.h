@@ -23,6 +23,7 @@
 #define SETTINGS_H___
 
 #include <stdbool.h>
+#include <inttypes.h>
 
 /**
  * The settings object.
@@ -36,6 +37,18 @@ typedef struct SETTINGS
     bool            fOutputBaseOct;     /**< Whether to output Octal. */
     bool            fOutputBaseHex;     /**< Whether to output Hexadecimal. */
     bool            fOutputBaseBin;     /**< Whether to output Binary. */
+    uint64_t        cMaxSteps;          /**< Step budget of an evaluation, 0 for unlimited. */
+    uint64_t        cMaxMilliSecs;      /**< Wall-clock budget of an evaluation in milliseconds, 0 for unlimited. */
+    bool            fMaxMilliSecsSet;   /**< Whether @a cMaxMilliSecs was given rather than defaulted. */
+    bool            fStats;             /**< Whether to collect and report instrumentation. */
+    bool            fBatch;             /**< Whether to process expressions from stdin non-interactively. */
+    bool            fCoprocess;         /**< Whether to answer requests on stdin with machine-readable responses. */
+    bool            fProfile;           /**< Whether to time Operators, Functions and Commands. */
+    char           *pszTraceFile;       /**< Where to write the timeline trace on exit, NULL if not tracing. */
+    char           *pszServerSocket;    /**< Unix socket to serve expressions on, NULL if not a server. */
+    char           *pszConnectSocket;   /**< Unix socket of the server to forward expressions to, NULL if not a client. */
+    char           *pszLoadImage;       /**< Image of Variables and Functions to load on startup, NULL if none. */
+    bool            fAttachImage;       /**< Whether @a pszLoadImage is the name of a published image rather than a file. */
 } SETTINGS;
 typedef SETTINGS *PSETTINGS;
 typedef SETTINGS const *PCSETTINGS;
@@ -55,7 +55,7 @@ bool StackIsEmpty(PSTACK pStack)
  */
 int StackPush(PSTACK pStack, void *pvData)
 {
-    PSTACKITEM pNode = MemAlloc(sizeof(STACKITEM));
+    PSTACKITEM pNode = MemAllocTag(sizeof(STACKITEM), enmMemTagNode);
     if (pNode)
     {
         pNode->pvData = pvData;
@@ -0,0 +1,201 @@
+/** @file
+ * Instrumentation counters and latency histograms, implementation.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Stats.h"
+#include "StringOps.h"
+#include "GenericDefs.h"
+#include "Assert.h"
+
+/**
+ * Returns a short name for a phase, for reports.
+ *
+ * @return  The name.
+ * @param   enmPhase    The phase.
+ */
+const char *StatsPhaseName(STATSPHASE enmPhase)
+{
+    switch (enmPhase)
+    {
+        case enmStatsPhaseParse:        return "parse";
+        case enmStatsPhaseEvaluate:     return "evaluate";
+        case enmStatsPhaseVariables:    return "variables";
+        case enmStatsPhaseOutput:       return "output";
+        default:                        return "?";
+    }
+}
+
+
+/**
+ * Returns the total time spent on an expression. Variable resolution is part of
+ * evaluation so it isn't counted separately.
+ *
+ * @return  The total in nanoseconds.
+ * @param   pStats      The expression stats.
+ */
+uint64_t StatsTotalNanoSecs(PCEVALSTATS pStats)
+{
+    return   pStats->acNanoSecs[enmStatsPhaseParse]
+           + pStats->acNanoSecs[enmStatsPhaseEvaluate]
+           + pStats->acNanoSecs[enmStatsPhaseOutput];
+}
+
+
+/**
+ * Returns the histogram bucket of a value. Values below STATS_HIST_SUB_BUCKETS
+ * get a bucket each, above that every power of two is split into
+ * STATS_HIST_SUB_BUCKETS linear buckets.
+ *
+ * @return  The bucket index.
+ * @param   uValue      The value.
+ */
+static unsigned StatsHistBucket(uint64_t uValue)
+{
+    if (uValue < STATS_HIST_SUB_BUCKETS)
+        return (unsigned)uValue;
+
+    unsigned iBit = 63;
+    while (!(uValue >> iBit))
+        --iBit;
+    unsigned const iShift = iBit - 4;
+    return STATS_HIST_SUB_BUCKETS + iShift * STATS_HIST_SUB_BUCKETS + (unsigned)((uValue >> iShift) - STATS_HIST_SUB_BUCKETS);
+}
+
+
+/**
+ * Returns the largest value that falls into a histogram bucket.
+ *
+ * @return  The largest value of the bucket.
+ * @param   iBucket     The bucket index.
+ */
+static uint64_t StatsHistBucketMax(unsigned iBucket)
+{
+    if (iBucket < STATS_HIST_SUB_BUCKETS)
+        return iBucket;
+
+    unsigned const iShift = (iBucket - STATS_HIST_SUB_BUCKETS) / STATS_HIST_SUB_BUCKETS;
+    uint64_t const uSub   = STATS_HIST_SUB_BUCKETS + (iBucket - STATS_HIST_SUB_BUCKETS) % STATS_HIST_SUB_BUCKETS;
+    return ((uSub + 1) << iShift) - 1;      /* Wraps to UINT64_MAX for the last bucket. */
+}
+
+
+/**
+ * Initializes a histogram.
+ *
+ * @param   pHist       The histogram.
+ */
+void StatsHistInit(PSTATSHIST pHist)
+{
+    AssertReturnVoid(pHist);
+    MemSet(pHist, 0, sizeof(*pHist));
+    pHist->uMin = UINT64_MAX;
+}
+
+
+/**
+ * Records a value in a histogram.
+ *
+ * @param   pHist       The histogram.
+ * @param   uValue      The value to record.
+ */
+void StatsHistAdd(PSTATSHIST pHist, uint64_t uValue)
+{
+    ++pHist->cSamples;
+    pHist->uSum += uValue;
+    pHist->uMin = R_MIN(pHist->uMin, uValue);
+    pHist->uMax = R_MAX(pHist->uMax, uValue);
+    ++pHist->acBuckets[StatsHistBucket(uValue)];
+}
+
+
+/**
+ * Returns a percentile of the values recorded in a histogram, accurate to
+ * within the width of a bucket.
+ *
+ * @return  The percentile, 0 if nothing was recorded.
+ * @param   pHist       The histogram.
+ * @param   uPercent    The percentile to return, 0 to 100.
+ */
+uint64_t StatsHistPercentile(PCSTATSHIST pHist, unsigned uPercent)
+{
+    if (!pHist->cSamples)
+        return 0;
+
+    uint64_t cRank = (pHist->cSamples * uPercent + 99) / 100;
+    if (!cRank)
+        cRank = 1;
+
+    uint64_t cSeen = 0;
+    for (unsigned i = 0; i < STATS_HIST_BUCKETS; i++)
+    {
+        cSeen += pHist->acBuckets[i];
+        if (cSeen >= cRank)
+        {
+            uint64_t const uValue = StatsHistBucketMax(i);
+            return R_MAX(R_MIN(uValue, pHist->uMax), pHist->uMin);
+        }
+    }
+    return pHist->uMax;
+}
+
+
+/**
+ * Initializes batch stats.
+ *
+ * @param   pBatch      The batch stats.
+ */
+void StatsBatchInit(PSTATSBATCH pBatch)
+{
+    AssertReturnVoid(pBatch);
+    MemSet(pBatch, 0, sizeof(*pBatch));
+    for (unsigned i = 0; i < enmStatsPhaseMax; i++)
+        StatsHistInit(&pBatch->aPhases[i]);
+    StatsHistInit(&pBatch->Total);
+}
+
+
+/**
+ * Adds the stats of an expression to batch stats.
+ *
+ * @param   pBatch      The batch stats.
+ * @param   pStats      The expression stats.
+ * @param   fFailed     Whether the expression failed.
+ */
+void StatsBatchAdd(PSTATSBATCH pBatch, PCEVALSTATS pStats, bool fFailed)
+{
+    ++pBatch->cExprs;
+    if (fFailed)
+        ++pBatch->cFailed;
+
+    for (unsigned i = 0; i < enmStatsPhaseMax; i++)
+    {
+        StatsHistAdd(&pBatch->aPhases[i], pStats->acNanoSecs[i]);
+        pBatch->Sums.acNanoSecs[i] += pStats->acNanoSecs[i];
+    }
+    StatsHistAdd(&pBatch->Total, StatsTotalNanoSecs(pStats));
+
+    pBatch->Sums.cTokens       += pStats->cTokens;
+    pBatch->Sums.cSteps        += pStats->cSteps;
+    pBatch->Sums.cAllocs       += pStats->cAllocs;
+    pBatch->Sums.cVarResolved  += pStats->cVarResolved;
+    pBatch->Sums.cVarCacheHits += pStats->cVarCacheHits;
+    pBatch->Sums.cVarMaxDepth   = R_MAX(pBatch->Sums.cVarMaxDepth, pStats->cVarMaxDepth);
+}
+
@@ -0,0 +1,104 @@
+/** @file
+ * Instrumentation counters and latency histograms, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFSTATS_H___
+#define NOPFSTATS_H___
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+/**
+ * STATSPHASE: The timed phases of processing an expression.
+ */
+typedef enum STATSPHASE
+{
+    enmStatsPhaseParse = 0,         /**< Parsing into RPN. */
+    enmStatsPhaseEvaluate,          /**< Evaluating the RPN, includes resolving Variables. */
+    enmStatsPhaseVariables,         /**< Resolving Variables, a part of evaluation. */
+    enmStatsPhaseOutput,            /**< Formatting and printing the result. */
+    enmStatsPhaseMax
+} STATSPHASE;
+
+/**
+ * EVALSTATS: Instrumentation of a single expression.
+ */
+typedef struct EVALSTATS
+{
+    uint64_t        acNanoSecs[enmStatsPhaseMax];   /**< Time spent in each phase. */
+    uint64_t        cTokens;        /**< Number of RPN Tokens parsed. */
+    uint64_t        cSteps;         /**< Number of evaluation steps. */
+    uint64_t        cAllocs;        /**< Number of heap allocations. */
+    uint64_t        cVarResolved;   /**< Number of Variables resolved. */
+    uint64_t        cVarCacheHits;  /**< Number of Variable references satisfied by an already resolved Variable. */
+    uint32_t        cVarMaxDepth;   /**< Length of the longest Variable dependency chain resolved. */
+} EVALSTATS;
+/** Pointer to expression stats. */
+typedef EVALSTATS *PEVALSTATS;
+/** Pointer to const expression stats. */
+typedef const EVALSTATS *PCEVALSTATS;
+
+/** Number of linear sub-buckets per power of two in a histogram, bounds the relative error to 1/16. */
+#define STATS_HIST_SUB_BUCKETS      16
+/** Number of buckets in a histogram, enough for any 64-bit value. */
+#define STATS_HIST_BUCKETS          (STATS_HIST_SUB_BUCKETS + (64 - 4) * STATS_HIST_SUB_BUCKETS)
+
+/**
+ * STATSHIST: A log-linear histogram of 64-bit values.
+ */
+typedef struct STATSHIST
+{
+    uint64_t        cSamples;       /**< Number of values recorded. */
+    uint64_t        uSum;           /**< Sum of the values recorded. */
+    uint64_t        uMin;           /**< Smallest value recorded. */
+    uint64_t        uMax;           /**< Largest value recorded. */
+    uint64_t        acBuckets[STATS_HIST_BUCKETS];  /**< Number of values in each bucket. */
+} STATSHIST;
+/** Pointer to a histogram. */
+typedef STATSHIST *PSTATSHIST;
+/** Pointer to a const histogram. */
+typedef const STATSHIST *PCSTATSHIST;
+
+/**
+ * STATSBATCH: Instrumentation aggregated over a batch of expressions.
+ */
+typedef struct STATSBATCH
+{
+    uint64_t        cExprs;         /**< Number of expressions processed. */
+    uint64_t        cFailed;        /**< Number of expressions that failed. */
+    STATSHIST       aPhases[enmStatsPhaseMax];      /**< Latency of each phase. */
+    STATSHIST       Total;          /**< Total latency of an expression. */
+    EVALSTATS       Sums;           /**< Counters summed over all expressions, cVarMaxDepth is the maximum. */
+} STATSBATCH;
+/** Pointer to batch stats. */
+typedef STATSBATCH *PSTATSBATCH;
+/** Pointer to const batch stats. */
+typedef const STATSBATCH *PCSTATSBATCH;
+
+const char *StatsPhaseName(STATSPHASE enmPhase);
+uint64_t    StatsTotalNanoSecs(PCEVALSTATS pStats);
+void        StatsHistInit(PSTATSHIST pHist);
+void        StatsHistAdd(PSTATSHIST pHist, uint64_t uValue);
+uint64_t    StatsHistPercentile(PCSTATSHIST pHist, unsigned uPercent);
+void        StatsBatchInit(PSTATSBATCH pBatch);
+void        StatsBatchAdd(PSTATSBATCH pBatch, PCEVALSTATS pStats, bool fFailed);
+
+#endif /* NOPFSTATS_H___ */
+
@@ -22,10 +22,12 @@
 #include "StringOps.h"
 #include "Assert.h"
 #include "Errors.h"
+#include "GenericDefs.h"
 #include "InputOutput.h"
 #include "Types.h"
 
 #include <ctype.h>
+#include <stdarg.h>
 #include <math.h>
 #include <stdint.h>
 
@@ -46,10 +48,7 @@ typedef const uint64_t64 *PCuint64_t64;
  */
 void *MemAllocZ(uint32_t cb)
 {
-    void *pv = MemAlloc(cb);
-    if (pv)
-        MemSet(pv, 0, cb);
-    return pv;
+    return MemAllocZTag(cb, enmMemTagOther);
 }
 
 
@@ -79,6 +78,134 @@ int StrCopy(char *pszDst, uint32_t cbDst, const char *pszSrc)
 }
 
 
+/**
+ * Initializes a string buffer.
+ *
+ * @param   pStrBuf     The string buffer.
+ */
+void StrBufInit(PSTRBUF pStrBuf)
+{
+    pStrBuf->pszBuf  = NULL;
+    pStrBuf->cchBuf  = 0;
+    pStrBuf->cbAlloc = 0;
+    pStrBuf->rc      = RINF_SUCCESS;
+}
+
+
+/**
+ * Frees the string of a string buffer.
+ *
+ * @param   pStrBuf     The string buffer.
+ */
+void StrBufDelete(PSTRBUF pStrBuf)
+{
+    StrFree(pStrBuf->pszBuf);
+    StrBufInit(pStrBuf);
+}
+
+
+/**
+ * Empties a string buffer, keeping its allocation for reuse.
+ *
+ * @param   pStrBuf     The string buffer.
+ */
+void StrBufReset(PSTRBUF pStrBuf)
+{
+    pStrBuf->cchBuf = 0;
+    pStrBuf->rc     = RINF_SUCCESS;
+    if (pStrBuf->pszBuf)
+        pStrBuf->pszBuf[0] = '\0';
+}
+
+
+/**
+ * Appends formatted text to a string buffer. Once an append fails all further
+ * appends are ignored and the failure is returned by StrBufDetach().
+ *
+ * @param   pStrBuf     The string buffer.
+ * @param   pszFmt      The format string.
+ * @param   ...         Format arguments.
+ */
+void StrBufAppendF(PSTRBUF pStrBuf, const char *pszFmt, ...)
+{
+    va_list FmtArgs;
+    va_start(FmtArgs, pszFmt);
+    StrBufAppendV(pStrBuf, pszFmt, FmtArgs);
+    va_end(FmtArgs);
+}
+
+
+/**
+ * Appends formatted text to a string buffer, see StrBufAppendF().
+ *
+ * @param   pStrBuf     The string buffer.
+ * @param   pszFmt      The format string.
+ * @param   FmtArgs     Format arguments.
+ */
+void StrBufAppendV(PSTRBUF pStrBuf, const char *pszFmt, va_list FmtArgs)
+{
+    if (RC_FAILURE(pStrBuf->rc))
+        return;
+
+    va_list FmtArgsCopy;
+    va_copy(FmtArgsCopy, FmtArgs);
+    int cch = vsnprintf(NULL, 0, pszFmt, FmtArgsCopy);
+    va_end(FmtArgsCopy);
+    if (cch < 0)
+    {
+        pStrBuf->rc = RERR_INVALID_PARAMETER;
+        return;
+    }
+
+    size_t const cbNeeded = pStrBuf->cchBuf + cch + 1;
+    if (cbNeeded > pStrBuf->cbAlloc)
+    {
+        size_t cbAlloc = R_MAX(pStrBuf->cbAlloc, 256);
+        while (cbAlloc < cbNeeded)
+            cbAlloc *= 2;
+        char *pszBuf = MemReallocTag(pStrBuf->pszBuf, cbAlloc, enmMemTagString);
+        if (!pszBuf)
+        {
+            pStrBuf->rc = RERR_NO_MEMORY;
+            return;
+        }
+        pStrBuf->pszBuf  = pszBuf;
+        pStrBuf->cbAlloc = cbAlloc;
+    }
+
+    vsnprintf(pStrBuf->pszBuf + pStrBuf->cchBuf, pStrBuf->cbAlloc - pStrBuf->cchBuf, pszFmt, FmtArgs);
+    pStrBuf->cchBuf += cch;
+}
+
+
+/**
+ * Takes the string out of a string buffer, leaving it empty.
+ *
+ * @return  RINF_SUCCESS on success, otherwise the status of the first failed
+ *          append, in which case nothing is returned.
+ * @param   pStrBuf     The string buffer.
+ * @param   ppszStr     Where to store the string, caller frees with StrFree().
+ */
+int StrBufDetach(PSTRBUF pStrBuf, char **ppszStr)
+{
+    *ppszStr = NULL;
+    int rc = pStrBuf->rc;
+    if (RC_SUCCESS(rc))
+    {
+        if (!pStrBuf->pszBuf)
+            StrBufAppendF(pStrBuf, "%s", "");
+        rc = pStrBuf->rc;
+        if (RC_SUCCESS(rc))
+        {
+            *ppszStr = pStrBuf->pszBuf;
+            pStrBuf->pszBuf = NULL;
+        }
+    }
+    StrBufDelete(pStrBuf);
+    return rc;
+}
+
+
 /**
  * Convert a 32-bit number to its binary form returned in a string.
  *
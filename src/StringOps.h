@@ -26,24 +26,18 @@
 #ifndef _WIN32
 #include <strings.h>
 #endif
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 
 #include "Types.h"
-
-/*
- * Just for having capitalized names, replacing such allocs isn't
- * going to be really need for such a small app. Even if it's we can
- * use electric fence libraries.
- */
-#define MemAlloc            malloc
-#define MemFree             free
-#define StrAlloc            malloc
-#define StrFree             free
+#include "Memory.h"
 
 #define MemCpy              memcpy
+#define MemMove             memmove
 #define MemCmp              memcmp
+#define MemChr              memchr
 #define MemSet              memset
 #define StrCmp              strcmp
 #define StrNCmp             strncmp
@@ -58,11 +52,32 @@
 #define StrLen              strlen
 #define MemZero(s)          (memset((s), 0, sizeof((s))))
 
+/**
+ * STRBUF: A string built up piece by piece, growing as required.
+ */
+typedef struct STRBUF
+{
+    char           *pszBuf;         /**< The string, NULL until something is appended. */
+    size_t          cchBuf;         /**< Length of the string. */
+    size_t          cbAlloc;        /**< Size of @a pszBuf. */
+    int             rc;             /**< Status of the first failed append, the string is left untouched. */
+} STRBUF;
+/** Pointer to a string buffer. */
+typedef STRBUF *PSTRBUF;
+/** Pointer to a const string buffer. */
+typedef const STRBUF *PCSTRBUF;
+
 void   *MemAllocZ(uint32_t cb);
 char   *StrDup(const char *pszSrc);
 int     StrCopy(char *pszDst, uint32_t cbDst, const char *pszSrc);
 char   *StrStrip(char *pszBuf);
 char   *StrStripLF(char *pszBuf, bool *pfStripped);
+void    StrBufInit(PSTRBUF pStrBuf);
+void    StrBufDelete(PSTRBUF pStrBuf);
+void    StrBufReset(PSTRBUF pStrBuf);
+void    StrBufAppendF(PSTRBUF pStrBuf, const char *pszFmt, ...);
+void    StrBufAppendV(PSTRBUF pStrBuf, const char *pszFmt, va_list FmtArgs);
+int     StrBufDetach(PSTRBUF pStrBuf, char **ppszStr);
 char   *StrValue32AsBinary(uint64_t uValue, bool fNegative, bool fDoubleSpace, bool fFullLength, uint32_t *pcDigits);
 
 /*
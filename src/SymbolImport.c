@@ -0,0 +1,343 @@
+/** @file
+ * Symbol import from ELF symbol tables, System.map and nm output.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+
+#include "SymbolImport.h"
+#include "FileMap.h"
+#include "Errors.h"
+#include "StringOps.h"
+#include "GenericDefs.h"
+
+/*
+ * The bits of the ELF specification needed to walk symbol tables. Fields are read
+ * byte by byte so files of either class and byte order work on any host.
+ */
+#define ELF_CLASS_32                1
+#define ELF_CLASS_64                2
+#define ELF_DATA_LSB                1
+#define ELF_DATA_MSB                2
+#define ELF_SHT_SYMTAB              2
+#define ELF_SHT_DYNSYM              11
+#define ELF_SHN_UNDEF               0
+#define ELF_STT_SECTION             3
+#define ELF_STT_FILE                4
+
+/**
+ * ELFFILE: An ELF file being read.
+ */
+typedef struct ELFFILE
+{
+    const uint8_t  *pbFile;         /**< The file contents. */
+    size_t          cbFile;         /**< Size of the file. */
+    bool            f64Bit;         /**< Whether this is an ELFCLASS64 file. */
+    bool            fBigEndian;     /**< Whether this is an ELFDATA2MSB file. */
+} ELFFILE;
+/** Pointer to an ELF file. */
+typedef ELFFILE *PELFFILE;
+/** Pointer to a const ELF file. */
+typedef const ELFFILE *PCELFFILE;
+
+
+/**
+ * Reads an unsigned field of an ELF file.
+ *
+ * @return  The field.
+ * @param   pElf        The ELF file.
+ * @param   off         Offset of the field, the caller has checked it's in bounds.
+ * @param   cb          Size of the field, 1, 2, 4 or 8.
+ */
+static uint64_t ElfRead(PCELFFILE pElf, uint64_t off, unsigned cb)
+{
+    const uint8_t *pb = pElf->pbFile + off;
+    uint64_t uValue = 0;
+    for (unsigned i = 0; i < cb; i++)
+    {
+        if (pElf->fBigEndian)
+            uValue = (uValue << 8) | pb[i];
+        else
+            uValue |= (uint64_t)pb[i] << (i * 8);
+    }
+    return uValue;
+}
+
+
+/**
+ * Checks that a range lies within an ELF file.
+ *
+ * @return  true if it does, false otherwise.
+ * @param   pElf        The ELF file.
+ * @param   off         Offset of the range.
+ * @param   cb          Size of the range.
+ */
+static bool ElfIsRangeValid(PCELFFILE pElf, uint64_t off, uint64_t cb)
+{
+    return off <= pElf->cbFile
+        && cb <= pElf->cbFile - off;
+}
+
+
+/**
+ * Imports the symbols of one symbol table section of an ELF file. Undefined,
+ * section and file symbols are left out.
+ *
+ * @return  Status code.
+ * @param   pElf        The ELF file.
+ * @param   offShdr     Offset of the section header of the symbol table.
+ * @param   offShdrs    Offset of the section header table.
+ * @param   cbShdr      Size of a section header.
+ * @param   cShdrs      Number of section headers.
+ * @param   pfnSymbol   Called for each symbol.
+ * @param   pvUser      The user argument for @a pfnSymbol.
+ */
+static int ElfImportSymTab(PCELFFILE pElf, uint64_t offShdr, uint64_t offShdrs, unsigned cbShdr, unsigned cShdrs,
+                           PFNSYMIMPORT pfnSymbol, void *pvUser)
+{
+    bool const f64Bit = pElf->f64Bit;
+    uint64_t const offSyms  = ElfRead(pElf, offShdr + (f64Bit ? 24 : 16), f64Bit ? 8 : 4);
+    uint64_t const cbSyms   = ElfRead(pElf, offShdr + (f64Bit ? 32 : 20), f64Bit ? 8 : 4);
+    uint32_t const iStrTab  = (uint32_t)ElfRead(pElf, offShdr + (f64Bit ? 40 : 24), 4);
+    unsigned const cbSym    = f64Bit ? 24 : 16;
+    if (   !ElfIsRangeValid(pElf, offSyms, cbSyms)
+        || iStrTab >= cShdrs)
+        return RERR_SYMBOL_FILE_INVALID;
+
+    uint64_t const offStrShdr = offShdrs + (uint64_t)iStrTab * cbShdr;
+    uint64_t const offStrs    = ElfRead(pElf, offStrShdr + (f64Bit ? 24 : 16), f64Bit ? 8 : 4);
+    uint64_t const cbStrs     = ElfRead(pElf, offStrShdr + (f64Bit ? 32 : 20), f64Bit ? 8 : 4);
+    if (!ElfIsRangeValid(pElf, offStrs, cbStrs))
+        return RERR_SYMBOL_FILE_INVALID;
+    const char *pchStrs = (const char *)pElf->pbFile + offStrs;
+
+    uint64_t const cSyms = cbSyms / cbSym;
+    for (uint64_t i = 1; i < cSyms; i++)    /* Symbol 0 is always the undefined symbol. */
+    {
+        uint64_t const offSym  = offSyms + i * cbSym;
+        uint32_t const offName = (uint32_t)ElfRead(pElf, offSym, 4);
+        uint8_t const  bInfo   = (uint8_t)ElfRead(pElf, offSym + (f64Bit ? 4 : 12), 1);
+        uint16_t const iShndx  = (uint16_t)ElfRead(pElf, offSym + (f64Bit ? 6 : 14), 2);
+        uint64_t const uValue  = ElfRead(pElf, offSym + (f64Bit ? 8 : 4), f64Bit ? 8 : 4);
+        if (   !offName
+            || iShndx == ELF_SHN_UNDEF
+            || (bInfo & 0xf) == ELF_STT_SECTION
+            || (bInfo & 0xf) == ELF_STT_FILE
+            || offName >= cbStrs)
+            continue;
+
+        const char *pchName = pchStrs + offName;
+        const char *pchEnd  = MemChr(pchName, '\0', (size_t)(cbStrs - offName));
+        if (!pchEnd)
+            return RERR_SYMBOL_FILE_INVALID;
+
+        int rc = pfnSymbol(pvUser, pchName, (size_t)(pchEnd - pchName), uValue);
+        if (RC_FAILURE(rc))
+            return rc;
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Imports the symbols of an ELF file from .symtab, or from .dynsym when the file
+ * is stripped (.dynsym only holds a subset of .symtab).
+ *
+ * @return  Status code.
+ * @param   pbFile      The file contents.
+ * @param   cbFile      Size of the file.
+ * @param   pfnSymbol   Called for each symbol.
+ * @param   pvUser      The user argument for @a pfnSymbol.
+ */
+static int ElfImport(const uint8_t *pbFile, size_t cbFile, PFNSYMIMPORT pfnSymbol, void *pvUser)
+{
+    if (   cbFile < 0x34
+        || (pbFile[4] != ELF_CLASS_32 && pbFile[4] != ELF_CLASS_64)
+        || (pbFile[5] != ELF_DATA_LSB && pbFile[5] != ELF_DATA_MSB))
+        return RERR_SYMBOL_FILE_INVALID;
+
+    ELFFILE Elf;
+    Elf.pbFile     = pbFile;
+    Elf.cbFile     = cbFile;
+    Elf.f64Bit     = pbFile[4] == ELF_CLASS_64;
+    Elf.fBigEndian = pbFile[5] == ELF_DATA_MSB;
+    if (   Elf.f64Bit
+        && cbFile < 0x40)
+        return RERR_SYMBOL_FILE_INVALID;
+
+    uint64_t const offShdrs = ElfRead(&Elf, Elf.f64Bit ? 0x28 : 0x20, Elf.f64Bit ? 8 : 4);
+    unsigned const cbShdr   = (unsigned)ElfRead(&Elf, Elf.f64Bit ? 0x3a : 0x2e, 2);
+    unsigned const cShdrs   = (unsigned)ElfRead(&Elf, Elf.f64Bit ? 0x3c : 0x30, 2);
+    if (   cbShdr < (Elf.f64Bit ? 64U : 40U)
+        || !ElfIsRangeValid(&Elf, offShdrs, (uint64_t)cbShdr * cShdrs))
+        return RERR_SYMBOL_FILE_INVALID;
+
+    uint64_t offSymTab = 0;
+    uint64_t offDynSym = 0;
+    for (unsigned i = 0; i < cShdrs; i++)
+    {
+        uint64_t const offShdr = offShdrs + (uint64_t)i * cbShdr;
+        uint32_t const uType   = (uint32_t)ElfRead(&Elf, offShdr + 4, 4);
+        if (uType == ELF_SHT_SYMTAB)
+            offSymTab = offShdr;
+        else if (uType == ELF_SHT_DYNSYM)
+            offDynSym = offShdr;
+    }
+
+    uint64_t const offShdr = offSymTab ? offSymTab : offDynSym;
+    if (!offShdr)
+        return RERR_SYMBOL_FILE_INVALID;
+    return ElfImportSymTab(&Elf, offShdr, offShdrs, cbShdr, cShdrs, pfnSymbol, pvUser);
+}
+
+
+/**
+ * Parses a hexadecimal field of a symbol listing.
+ *
+ * @return  true if the field is a hexadecimal number, false otherwise.
+ * @param   pchField    The field.
+ * @param   cchField    Length of the field.
+ * @param   puValue     Where to store the value.
+ */
+static bool TextParseHex(const char *pchField, size_t cchField, uint64_t *puValue)
+{
+    if (   !cchField
+        || cchField > 16)
+        return false;
+
+    uint64_t uValue = 0;
+    for (size_t i = 0; i < cchField; i++)
+    {
+        char const ch = pchField[i];
+        unsigned uDigit;
+        if (ch >= '0' && ch <= '9')
+            uDigit = ch - '0';
+        else if (ch >= 'a' && ch <= 'f')
+            uDigit = ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F')
+            uDigit = ch - 'A' + 10;
+        else
+            return false;
+        uValue = (uValue << 4) | uDigit;
+    }
+    *puValue = uValue;
+    return true;
+}
+
+
+/**
+ * Imports the symbols of a System.map, /proc/kallsyms or nm listing, i.e. lines
+ * of "<address> [<size>] <type> <name>". Lines without an address, such as
+ * undefined symbols and file headers of nm, are left out and counted.
+ *
+ * @return  Status code, RERR_SYMBOL_FILE_INVALID if no line is a symbol.
+ * @param   pchFile     The file contents.
+ * @param   cchFile     Size of the file.
+ * @param   pfnSymbol   Called for each symbol.
+ * @param   pvUser      The user argument for @a pfnSymbol.
+ * @param   pcSkipped   Where to store the number of non-blank lines left out.
+ */
+static int TextImport(const char *pchFile, size_t cchFile, PFNSYMIMPORT pfnSymbol, void *pvUser, uint32_t *pcSkipped)
+{
+    uint32_t    cSymbols = 0;
+    const char *pch    = pchFile;
+    const char *pchEnd = pchFile + cchFile;
+    while (pch < pchEnd)
+    {
+        const char *pchEol = MemChr(pch, '\n', (size_t)(pchEnd - pch));
+        if (!pchEol)
+            pchEol = pchEnd;
+
+        /*
+         * Split up to four whitespace separated fields, anything after them (like
+         * the module of kallsyms) is ignored.
+         */
+        const char *apchFields[4];
+        size_t      acchFields[4];
+        unsigned    cFields = 0;
+        const char *pchField = pch;
+        while (cFields < R_ARRAY_ELEMENTS(apchFields))
+        {
+            while (pchField < pchEol && (*pchField == ' ' || *pchField == '\t' || *pchField == '\r'))
+                pchField++;
+            if (pchField == pchEol)
+                break;
+            apchFields[cFields] = pchField;
+            while (pchField < pchEol && *pchField != ' ' && *pchField != '\t' && *pchField != '\r')
+                pchField++;
+            acchFields[cFields] = pchField - apchFields[cFields];
+            cFields++;
+        }
+
+        uint64_t uValue;
+        uint64_t uSize;
+        unsigned iType = 1;
+        if (   cFields == 4
+            && acchFields[2] == 1
+            && TextParseHex(apchFields[1], acchFields[1], &uSize))
+            iType = 2;
+        if (   cFields >= iType + 2
+            && acchFields[iType] == 1
+            && TextParseHex(apchFields[0], acchFields[0], &uValue))
+        {
+            int rc = pfnSymbol(pvUser, apchFields[iType + 1], acchFields[iType + 1], uValue);
+            if (RC_FAILURE(rc))
+                return rc;
+            ++cSymbols;
+        }
+        else if (cFields)
+            ++*pcSkipped;
+
+        pch = pchEol + 1;
+    }
+    return cSymbols ? RINF_SUCCESS : RERR_SYMBOL_FILE_INVALID;
+}
+
+
+/**
+ * Imports the symbols of a file, which is either an ELF file whose symbol table
+ * is read directly, or a System.map or nm listing.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszFile     The file.
+ * @param   pfnSymbol   Called for each symbol.
+ * @param   pvUser      The user argument for @a pfnSymbol.
+ * @param   pcSkipped   Where to store the number of lines of a listing that
+ *                      aren't symbols, optional.
+ */
+int SymImportFile(const char *pszFile, PFNSYMIMPORT pfnSymbol, void *pvUser, uint32_t *pcSkipped)
+{
+    uint32_t cSkipped = 0;
+    FILEMAP FileMap;
+    int rc = FileMapOpen(&FileMap, pszFile);
+    if (RC_FAILURE(rc))
+        return rc;
+
+    const uint8_t *pbFile = FileMap.pvData;
+    if (   FileMap.cbData >= 4
+        && !MemCmp(pbFile, "\177ELF", 4))
+        rc = ElfImport(pbFile, FileMap.cbData, pfnSymbol, pvUser);
+    else
+        rc = TextImport((const char *)pbFile, FileMap.cbData, pfnSymbol, pvUser, &cSkipped);
+
+    FileMapClose(&FileMap);
+    if (pcSkipped)
+        *pcSkipped = cSkipped;
+    return rc;
+}
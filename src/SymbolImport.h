@@ -0,0 +1,44 @@
+/** @file
+ * Symbol import from ELF symbol tables, System.map and nm output, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFSYMBOLIMPORT_H___
+#define NOPFSYMBOLIMPORT_H___
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/**
+ * Called for each symbol found.
+ *
+ * @return  Status code, a failure stops the import and is returned by
+ *          SymImportFile().
+ * @param   pvUser      The user argument passed to SymImportFile().
+ * @param   pchName     The name of the symbol, not terminated.
+ * @param   cchName     Length of the name.
+ * @param   uValue      The value (address) of the symbol.
+ */
+typedef int FNSYMIMPORT(void *pvUser, const char *pchName, size_t cchName, uint64_t uValue);
+/** Pointer to a symbol import callback. */
+typedef FNSYMIMPORT *PFNSYMIMPORT;
+
+int     SymImportFile(const char *pszFile, PFNSYMIMPORT pfnSymbol, void *pvUser, uint32_t *pcSkipped);
+
+#endif /* NOPFSYMBOLIMPORT_H___ */
@@ -0,0 +1,290 @@
+/** @file
+ * Generic symbol table (string interning) implementation.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SymbolTable.h"
+#include "Errors.h"
+#include "Rcu.h"
+#include "StringOps.h"
+#include "GenericDefs.h"
+
+/** Size of a string storage block (64K). */
+#define SYMBLOCK_SIZE           0x10000
+/** Initial number of hash buckets, must be a power of two. */
+#define SYMTABLE_INIT_BUCKETS   256
+
+
+/**
+ * Hashes a name (FNV-1a).
+ *
+ * @return  The 32-bit hash.
+ * @param   pszName     The name, need not be terminated.
+ * @param   cchName     Length of the name.
+ */
+static inline uint32_t SymTableHash(const char *pszName, size_t cchName)
+{
+    uint32_t uHash = UINT32_C(2166136261);
+    for (size_t i = 0; i < cchName; i++)
+    {
+        uHash ^= (unsigned char)pszName[i];
+        uHash *= UINT32_C(16777619);
+    }
+    return uHash;
+}
+
+
+/**
+ * Initializes a symbol table object.
+ *
+ * @param   pSymTable   The symbol table.
+ */
+void SymTableInit(PSYMTABLE pSymTable)
+{
+    pSymTable->papszNames    = NULL;
+    pSymTable->pauHashes     = NULL;
+    pSymTable->cSymbols      = 1;   /* NIL_SYMBOL */
+    pSymTable->cSymbolsAlloc = 0;
+    pSymTable->pauBuckets    = NULL;
+    pSymTable->cBuckets      = 0;
+    pSymTable->pBlocks       = NULL;
+}
+
+
+/**
+ * Destroys a symbol table object, invalidating all names returned by it.
+ *
+ * @param   pSymTable   The symbol table.
+ */
+void SymTableDestroy(PSYMTABLE pSymTable)
+{
+    PSYMBLOCK pBlock = pSymTable->pBlocks;
+    while (pBlock)
+    {
+        PSYMBLOCK pNext = pBlock->pNext;
+        MemFree(pBlock);
+        pBlock = pNext;
+    }
+    MemFree((void *)pSymTable->papszNames);
+    MemFree(pSymTable->pauHashes);
+    MemFree(pSymTable->pauBuckets);
+    SymTableInit(pSymTable);
+}
+
+
+/**
+ * Finds the bucket for a name.
+ *
+ * @return  Pointer to the bucket holding the name's Id, or the empty bucket
+ *          where it should be inserted.
+ * @param   pSymTable   The symbol table, must have buckets.
+ * @param   pszName     The name, need not be terminated.
+ * @param   cchName     Length of the name.
+ * @param   uHash       The hash of the name.
+ */
+static uint32_t *SymTableFindBucket(PCSYMTABLE pSymTable, const char *pszName, size_t cchName, uint32_t uHash)
+{
+    uint32_t const fMask = pSymTable->cBuckets - 1;
+    uint32_t i = uHash & fMask;
+    for (;;)
+    {
+        uint32_t const uSymbol = pSymTable->pauBuckets[i];
+        if (uSymbol == NIL_SYMBOL)
+            return &pSymTable->pauBuckets[i];
+
+        const char *pszCur = pSymTable->papszNames[uSymbol];
+        if (   pSymTable->pauHashes[uSymbol] == uHash
+            && !StrNCmp(pszCur, pszName, cchName)
+            && pszCur[cchName] == '\0')
+            return &pSymTable->pauBuckets[i];
+
+        i = (i + 1) & fMask;
+    }
+}
+
+
+/**
+ * Grows the hash buckets and rehashes all names.
+ *
+ * @return  RINF_SUCCESS on success, otherwise an appropriate status code.
+ * @param   pSymTable   The symbol table.
+ */
+static int SymTableGrowBuckets(PSYMTABLE pSymTable)
+{
+    uint32_t const cBuckets = pSymTable->cBuckets ? pSymTable->cBuckets * 2 : SYMTABLE_INIT_BUCKETS;
+    uint32_t *pauBuckets = MemAllocZTag(cBuckets * sizeof(uint32_t), enmMemTagSymbol);
+    if (!pauBuckets)
+        return RERR_NO_MEMORY;
+
+    MemFree(pSymTable->pauBuckets);
+    pSymTable->pauBuckets = pauBuckets;
+    pSymTable->cBuckets   = cBuckets;
+
+    uint32_t const fMask = cBuckets - 1;
+    for (uint32_t uSymbol = 1; uSymbol < pSymTable->cSymbols; uSymbol++)
+    {
+        uint32_t i = pSymTable->pauHashes[uSymbol] & fMask;
+        while (pauBuckets[i] != NIL_SYMBOL)
+            i = (i + 1) & fMask;
+        pauBuckets[i] = uSymbol;
+    }
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Copies a name into the string storage blocks.
+ *
+ * @return  Pointer to the terminated copy or NULL if out of memory.
+ * @param   pSymTable   The symbol table.
+ * @param   pszName     The name, need not be terminated.
+ * @param   cchName     Length of the name.
+ */
+static const char *SymTableStoreName(PSYMTABLE pSymTable, const char *pszName, size_t cchName)
+{
+    PSYMBLOCK pBlock = pSymTable->pBlocks;
+    if (   !pBlock
+        || pBlock->cbSize - pBlock->cbUsed < cchName + 1)
+    {
+        size_t const cbData = R_MAX((size_t)SYMBLOCK_SIZE, cchName + 1);
+        pBlock = MemAllocTag(sizeof(SYMBLOCK) + cbData, enmMemTagSymbol);
+        if (!pBlock)
+            return NULL;
+        pBlock->cbUsed = 0;
+        pBlock->cbSize = cbData;
+        pBlock->pNext  = pSymTable->pBlocks;
+        pSymTable->pBlocks = pBlock;
+    }
+
+    char *pszDst = &pBlock->achData[pBlock->cbUsed];
+    MemCpy(pszDst, pszName, cchName);
+    pszDst[cchName] = '\0';
+    pBlock->cbUsed += cchName + 1;
+    return pszDst;
+}
+
+
+/**
+ * Interns a name, returning its symbol Id.
+ *
+ * @return  RINF_SUCCESS on success, otherwise an appropriate status code.
+ * @param   pSymTable   The symbol table.
+ * @param   pszName     The name, need not be terminated.
+ * @param   cchName     Length of the name.
+ * @param   puSymbol    Where to store the symbol Id.
+ */
+int SymTableIntern(PSYMTABLE pSymTable, const char *pszName, size_t cchName, uint32_t *puSymbol)
+{
+    /*
+     * Keep the load factor under a half so probe sequences stay short.
+     */
+    if (pSymTable->cSymbols * 2 >= pSymTable->cBuckets)
+    {
+        int rc = SymTableGrowBuckets(pSymTable);
+        if (RC_FAILURE(rc))
+            return rc;
+    }
+
+    uint32_t const uHash = SymTableHash(pszName, cchName);
+    uint32_t *puBucket = SymTableFindBucket(pSymTable, pszName, cchName, uHash);
+    if (*puBucket != NIL_SYMBOL)
+    {
+        *puSymbol = *puBucket;
+        return RINF_SUCCESS;
+    }
+
+    if (pSymTable->cSymbols >= pSymTable->cSymbolsAlloc)
+    {
+        uint32_t const cAlloc = pSymTable->cSymbolsAlloc ? pSymTable->cSymbolsAlloc * 2 : SYMTABLE_INIT_BUCKETS;
+        /* Readers may be looking up names concurrently, the old array is retired rather than freed. */
+        const char **papszNames = MemAllocTag(cAlloc * sizeof(char *), enmMemTagSymbol);
+        if (!papszNames)
+            return RERR_NO_MEMORY;
+        const char **papszOldNames = pSymTable->papszNames;
+        if (papszOldNames)
+            MemCpy((void *)papszNames, papszOldNames, pSymTable->cSymbols * sizeof(char *));
+        RCU_STORE(&pSymTable->papszNames, papszNames);
+        if (papszOldNames)
+            RcuRetire((void *)papszOldNames, MemFree);
+
+        uint32_t *pauHashes = MemReallocTag(pSymTable->pauHashes, cAlloc * sizeof(uint32_t), enmMemTagSymbol);
+        if (!pauHashes)
+            return RERR_NO_MEMORY;
+        pSymTable->pauHashes = pauHashes;
+        pSymTable->cSymbolsAlloc = cAlloc;
+    }
+
+    const char *pszStored = SymTableStoreName(pSymTable, pszName, cchName);
+    if (!pszStored)
+        return RERR_NO_MEMORY;
+
+    uint32_t const uSymbol = pSymTable->cSymbols;
+    pSymTable->papszNames[uSymbol] = pszStored;
+    pSymTable->pauHashes[uSymbol]  = uHash;
+    RCU_STORE(&pSymTable->cSymbols, uSymbol + 1);
+    *puBucket = uSymbol;
+    *puSymbol = uSymbol;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Looks up a name without interning it.
+ *
+ * @return  The symbol Id, or NIL_SYMBOL if the name was never interned.
+ * @param   pSymTable   The symbol table.
+ * @param   pszName     The name, need not be terminated.
+ * @param   cchName     Length of the name.
+ */
+uint32_t SymTableLookup(PCSYMTABLE pSymTable, const char *pszName, size_t cchName)
+{
+    if (!pSymTable->cBuckets)
+        return NIL_SYMBOL;
+    return *SymTableFindBucket(pSymTable, pszName, cchName, SymTableHash(pszName, cchName));
+}
+
+
+/**
+ * Returns the name of a symbol.
+ *
+ * @return  The terminated name, or an empty string for NIL_SYMBOL or invalid Ids.
+ * @param   pSymTable   The symbol table.
+ * @param   uSymbol     The symbol Id.
+ */
+const char *SymTableName(PCSYMTABLE pSymTable, uint32_t uSymbol)
+{
+    if (   uSymbol == NIL_SYMBOL
+        || uSymbol >= RCU_LOAD(&pSymTable->cSymbols))
+        return "";
+    return RCU_LOAD(&pSymTable->papszNames)[uSymbol];
+}
+
+
+/**
+ * Returns the number of symbol Ids in use, including the nil Id. Valid Ids are
+ * thus in the range [1, count).
+ *
+ * @return  The number of symbol Ids.
+ * @param   pSymTable   The symbol table.
+ */
+uint32_t SymTableCount(PCSYMTABLE pSymTable)
+{
+    return RCU_LOAD(&pSymTable->cSymbols);
+}
+
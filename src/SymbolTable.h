@@ -0,0 +1,74 @@
+/** @file
+ * Generic symbol table (string interning) header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFSYMBOLTABLE_H___
+#define NOPFSYMBOLTABLE_H___
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+/** The nil symbol Id, never returned for an interned name. */
+#define NIL_SYMBOL              UINT32_C(0)
+
+/**
+ * SYMBLOCK: A block of string storage for interned names.
+ */
+typedef struct SYMBLOCK
+{
+    struct SYMBLOCK     *pNext;     /**< Pointer to the next (older) block. */
+    size_t               cbUsed;    /**< Number of bytes used in this block. */
+    size_t               cbSize;    /**< Size of the achData buffer. */
+    char                 achData[1];/**< The string data (variable sized). */
+} SYMBLOCK;
+/** Pointer to a symbol storage block. */
+typedef SYMBLOCK *PSYMBLOCK;
+
+/**
+ * SYMTABLE: A symbol table object.
+ * Maps names to dense 32-bit Ids and back. Names are never removed and their
+ * storage is stable for the lifetime of the table. Names are interned by one
+ * thread at a time, others may get names by Id and the count meanwhile.
+ */
+typedef struct SYMTABLE
+{
+    const char         **papszNames;    /**< Names indexed by symbol Id (index 0 is unused). */
+    uint32_t            *pauHashes;     /**< Hashes indexed by symbol Id. */
+    uint32_t             cSymbols;      /**< Number of symbol Ids in use including the nil Id. */
+    uint32_t             cSymbolsAlloc; /**< Number of entries allocated in the arrays above. */
+    uint32_t            *pauBuckets;    /**< Open addressed hash buckets holding symbol Ids. */
+    uint32_t             cBuckets;      /**< Number of hash buckets (power of two). */
+    PSYMBLOCK            pBlocks;       /**< Head of the string storage blocks. */
+} SYMTABLE;
+/** Pointer to a symbol table. */
+typedef SYMTABLE *PSYMTABLE;
+/** Pointer to a const symbol table. */
+typedef const SYMTABLE *PCSYMTABLE;
+
+void        SymTableInit(PSYMTABLE pSymTable);
+void        SymTableDestroy(PSYMTABLE pSymTable);
+int         SymTableIntern(PSYMTABLE pSymTable, const char *pszName, size_t cchName, uint32_t *puSymbol);
+uint32_t    SymTableLookup(PCSYMTABLE pSymTable, const char *pszName, size_t cchName);
+const char *SymTableName(PCSYMTABLE pSymTable, uint32_t uSymbol);
+uint32_t    SymTableCount(PCSYMTABLE pSymTable);
+
+#endif /* NOPFSYMBOLTABLE_H___ */
+
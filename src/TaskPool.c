@@ -0,0 +1,292 @@
+/** @file
+ * Work-stealing pool of threads running independent tasks.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+
+#include "TaskPool.h"
+#include "Thread.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "Memory.h"
+#include "GenericDefs.h"
+
+/*
+ * Each run hands every worker a contiguous share of the tasks. A worker takes its
+ * tasks from the front of its share and, once it runs out, steals the back half of
+ * what another worker has left. Tasks are never created while running so a worker
+ * finding nothing left anywhere is done; the caller waits for all of them.
+ */
+
+/**
+ * TASKWORKER: A worker of a pool.
+ */
+typedef struct TASKWORKER
+{
+    struct TASKPOOL    *pPool;          /**< The pool. */
+    uint32_t            iWorker;        /**< Index of the worker. */
+    PTHREAD             pThread;        /**< The thread, NULL for the caller of TaskPoolRun(). */
+    PTHREADMUTEX        pMutex;         /**< Protects the share of tasks. */
+    uint32_t            iNext;          /**< Next task of the share. */
+    uint32_t            iEnd;           /**< End of the share. */
+} TASKWORKER;
+/** Pointer to a worker. */
+typedef TASKWORKER *PTASKWORKER;
+
+/**
+ * TASKPOOL: A pool of threads.
+ */
+struct TASKPOOL
+{
+    PTHREADMUTEX        pMutex;         /**< Protects handing out runs. */
+    PTHREADCOND         pWorkCond;      /**< Signalled when there is a run or the pool shuts down. */
+    PTHREADCOND         pDoneCond;      /**< Signalled when the last thread is done with a run. */
+    uint32_t            uGeneration;    /**< Bumped for each run. */
+    uint32_t            cBusy;          /**< Number of threads still busy with the run. */
+    bool                fShutdown;      /**< Whether the threads are to quit. */
+    PFNTASK             pfnTask;        /**< The task function of the run. */
+    void               *pvUser;         /**< The user argument of the run. */
+    uint32_t            cWorkers;       /**< Number of workers, the caller of TaskPoolRun() included. */
+    PTASKWORKER         paWorkers;      /**< The workers. */
+};
+
+
+/**
+ * Gets the next task for a worker, stealing one if its own share is done.
+ *
+ * @return  true if there is a task, false if there's nothing left to run.
+ * @param   pPool       The pool.
+ * @param   pWorker     The worker.
+ * @param   piTask      Where to store the index of the task.
+ */
+static bool TaskPoolTake(PTASKPOOL pPool, PTASKWORKER pWorker, uint32_t *piTask)
+{
+    ThreadMutexLock(pWorker->pMutex);
+    bool const fOwn = pWorker->iNext < pWorker->iEnd;
+    if (fOwn)
+        *piTask = pWorker->iNext++;
+    ThreadMutexUnlock(pWorker->pMutex);
+    if (fOwn)
+        return true;
+
+    for (uint32_t i = 1; i < pPool->cWorkers; i++)
+    {
+        PTASKWORKER pVictim = &pPool->paWorkers[(pWorker->iWorker + i) % pPool->cWorkers];
+        ThreadMutexLock(pVictim->pMutex);
+        uint32_t const iEnd = pVictim->iEnd;
+        uint32_t const cLeft = iEnd - pVictim->iNext;
+        uint32_t const iFirst = iEnd - (cLeft + 1) / 2;
+        pVictim->iEnd = iFirst;
+        ThreadMutexUnlock(pVictim->pMutex);
+        if (cLeft)
+        {
+            ThreadMutexLock(pWorker->pMutex);
+            pWorker->iNext = iFirst + 1;
+            pWorker->iEnd  = iEnd;
+            ThreadMutexUnlock(pWorker->pMutex);
+            *piTask = iFirst;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Runs tasks until there are none left.
+ *
+ * @param   pPool       The pool.
+ * @param   pWorker     The worker of the calling thread.
+ */
+static void TaskPoolWork(PTASKPOOL pPool, PTASKWORKER pWorker)
+{
+    uint32_t iTask;
+    while (TaskPoolTake(pPool, pWorker, &iTask))
+        pPool->pfnTask(pPool->pvUser, pWorker->iWorker, iTask);
+}
+
+
+static int TaskPoolThread(void *pvUser)
+{
+    PTASKWORKER pWorker = pvUser;
+    PTASKPOOL pPool = pWorker->pPool;
+    uint32_t uGeneration = 0;
+
+    ThreadMutexLock(pPool->pMutex);
+    for (;;)
+    {
+        while (   !pPool->fShutdown
+               && pPool->uGeneration == uGeneration)
+            ThreadCondWait(pPool->pWorkCond, pPool->pMutex);
+        if (pPool->fShutdown)
+            break;
+        uGeneration = pPool->uGeneration;
+        ThreadMutexUnlock(pPool->pMutex);
+
+        TaskPoolWork(pPool, pWorker);
+
+        ThreadMutexLock(pPool->pMutex);
+        if (!--pPool->cBusy)
+            ThreadCondBroadcast(pPool->pDoneCond);
+    }
+    ThreadMutexUnlock(pPool->pMutex);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Creates a pool of threads. Threads that can't be created are done without, at
+ * worst the caller of TaskPoolRun() runs every task itself.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   cWorkers    Number of workers wanted, the caller of TaskPoolRun() included.
+ * @param   ppPool      Where to store the pool, free it with TaskPoolDestroy().
+ */
+int TaskPoolCreate(uint32_t cWorkers, PTASKPOOL *ppPool)
+{
+    AssertReturn(cWorkers, RERR_INVALID_PARAMETER);
+    AssertReturn(ppPool, RERR_INVALID_PARAMETER);
+    *ppPool = NULL;
+
+    PTASKPOOL pPool = MemAllocZTag(sizeof(*pPool), enmMemTagOther);
+    if (!pPool)
+        return RERR_NO_MEMORY;
+    pPool->paWorkers = MemAllocZTag(cWorkers * sizeof(TASKWORKER), enmMemTagOther);
+    int rc = pPool->paWorkers ? ThreadMutexCreate(&pPool->pMutex) : RERR_NO_MEMORY;
+    if (RC_SUCCESS(rc))
+        rc = ThreadCondCreate(&pPool->pWorkCond);
+    if (RC_SUCCESS(rc))
+        rc = ThreadCondCreate(&pPool->pDoneCond);
+    for (uint32_t i = 0; i < cWorkers && RC_SUCCESS(rc); i++)
+    {
+        pPool->paWorkers[i].pPool   = pPool;
+        pPool->paWorkers[i].iWorker = i;
+        rc = ThreadMutexCreate(&pPool->paWorkers[i].pMutex);
+        if (RC_SUCCESS(rc))
+            ++pPool->cWorkers;
+    }
+    if (RC_FAILURE(rc))
+    {
+        TaskPoolDestroy(pPool);
+        return rc;
+    }
+
+    /* The workers are all set up before any thread looks at them. */
+    uint32_t cStarted = 1;
+    while (   cStarted < cWorkers
+           && RC_SUCCESS(ThreadCreate(&pPool->paWorkers[cStarted].pThread, TaskPoolThread, &pPool->paWorkers[cStarted])))
+        cStarted++;
+    for (uint32_t i = cStarted; i < cWorkers; i++)
+        ThreadMutexDestroy(pPool->paWorkers[i].pMutex);
+    pPool->cWorkers = cStarted;
+    *ppPool = pPool;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a pool, waiting for its threads to quit. It must not be running tasks.
+ *
+ * @param   pPool       The pool, can be NULL.
+ */
+void TaskPoolDestroy(PTASKPOOL pPool)
+{
+    if (!pPool)
+        return;
+
+    if (pPool->pMutex)
+    {
+        ThreadMutexLock(pPool->pMutex);
+        pPool->fShutdown = true;
+        if (pPool->pWorkCond)
+            ThreadCondBroadcast(pPool->pWorkCond);
+        ThreadMutexUnlock(pPool->pMutex);
+    }
+    for (uint32_t i = 0; i < pPool->cWorkers; i++)
+    {
+        if (pPool->paWorkers[i].pThread)
+            ThreadJoin(pPool->paWorkers[i].pThread, NULL);
+        ThreadMutexDestroy(pPool->paWorkers[i].pMutex);
+    }
+    ThreadCondDestroy(pPool->pDoneCond);
+    ThreadCondDestroy(pPool->pWorkCond);
+    ThreadMutexDestroy(pPool->pMutex);
+    MemFree(pPool->paWorkers);
+    MemFree(pPool);
+}
+
+
+/**
+ * Gets the number of workers of a pool.
+ *
+ * @return  Number of workers, the caller of TaskPoolRun() included.
+ * @param   pPool       The pool.
+ */
+uint32_t TaskPoolWorkers(PTASKPOOL pPool)
+{
+    AssertReturn(pPool, 1);
+    return pPool->cWorkers;
+}
+
+
+/**
+ * Runs tasks on a pool and waits for all of them to be done. The calling thread
+ * runs tasks too. Tasks run in no particular order, tasks wanting a deterministic
+ * result store what they compute by their index and leave combining it to the
+ * caller.
+ *
+ * @param   pPool       The pool, used by one thread at a time.
+ * @param   cTasks      Number of tasks.
+ * @param   pfnTask     The task function, called once for each index below @a cTasks.
+ * @param   pvUser      The user argument to @a pfnTask.
+ */
+void TaskPoolRun(PTASKPOOL pPool, uint32_t cTasks, PFNTASK pfnTask, void *pvUser)
+{
+    AssertReturnVoid(pPool);
+    AssertReturnVoid(pfnTask);
+    uint32_t const cWorkers = pPool->cWorkers;
+
+    ThreadMutexLock(pPool->pMutex);
+    for (uint32_t i = 0; i < cWorkers; i++)
+    {
+        PTASKWORKER pWorker = &pPool->paWorkers[i];
+        ThreadMutexLock(pWorker->pMutex);
+        pWorker->iNext = (uint32_t)((uint64_t)cTasks * i / cWorkers);
+        pWorker->iEnd  = (uint32_t)((uint64_t)cTasks * (i + 1) / cWorkers);
+        ThreadMutexUnlock(pWorker->pMutex);
+    }
+    pPool->pfnTask = pfnTask;
+    pPool->pvUser  = pvUser;
+    pPool->cBusy   = cWorkers - 1;
+    if (pPool->cBusy)
+    {
+        ++pPool->uGeneration;
+        ThreadCondBroadcast(pPool->pWorkCond);
+    }
+    ThreadMutexUnlock(pPool->pMutex);
+
+    TaskPoolWork(pPool, &pPool->paWorkers[0]);
+
+    ThreadMutexLock(pPool->pMutex);
+    while (pPool->cBusy)
+        ThreadCondWait(pPool->pDoneCond, pPool->pMutex);
+    ThreadMutexUnlock(pPool->pMutex);
+}
+
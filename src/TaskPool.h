@@ -0,0 +1,48 @@
+/** @file
+ * Work-stealing pool of threads running independent tasks, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFTASKPOOL_H___
+#define NOPFTASKPOOL_H___
+
+#include <inttypes.h>
+
+/**
+ * Runs a task of a pool, see TaskPoolRun().
+ *
+ * @param   pvUser      The user argument passed to TaskPoolRun().
+ * @param   iWorker     Index of the worker running the task, 0 being the thread
+ *                      that called TaskPoolRun(). A worker runs one task at a time.
+ * @param   iTask       Index of the task.
+ */
+typedef void FNTASK(void *pvUser, uint32_t iWorker, uint32_t iTask);
+/** Pointer to a task function. */
+typedef FNTASK *PFNTASK;
+
+/** A pool of threads, opaque. */
+typedef struct TASKPOOL *PTASKPOOL;
+
+int         TaskPoolCreate(uint32_t cWorkers, PTASKPOOL *ppPool);
+void        TaskPoolDestroy(PTASKPOOL pPool);
+uint32_t    TaskPoolWorkers(PTASKPOOL pPool);
+void        TaskPoolRun(PTASKPOOL pPool, uint32_t cTasks, PFNTASK pfnTask, void *pvUser);
+
+#endif /* NOPFTASKPOOL_H___ */
+
@@ -0,0 +1,295 @@
+/** @file
+ * Threads and their synchronization.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WIN32
+/* pthreads and sysconf() are POSIX, not C99. */
+# define _POSIX_C_SOURCE 200112L
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#include "Thread.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "Memory.h"
+#include "GenericDefs.h"
+
+/*
+ * Without threads (Windows builds for now) creating a thread fails and there is a single
+ * CPU, callers then do the work themselves and locking never has to wait for anyone.
+ */
+
+/**
+ * THREAD: A thread.
+ */
+struct THREAD
+{
+#ifndef _WIN32
+    pthread_t       hThread;        /**< The pthread. */
+#endif
+    PFNTHREAD       pfnThread;      /**< The function the thread runs. */
+    void           *pvUser;         /**< The argument to @a pfnThread. */
+    int             rc;             /**< What @a pfnThread returned. */
+};
+
+/**
+ * THREADMUTEX: A mutual exclusion lock.
+ */
+struct THREADMUTEX
+{
+#ifndef _WIN32
+    pthread_mutex_t Mutex;          /**< The pthread mutex. */
+#else
+    int             iDummy;         /**< Nothing to lock. */
+#endif
+};
+
+/**
+ * THREADCOND: A condition variable.
+ */
+struct THREADCOND
+{
+#ifndef _WIN32
+    pthread_cond_t  Cond;           /**< The pthread condition variable. */
+#else
+    int             iDummy;         /**< Nothing to wait for. */
+#endif
+};
+
+
+#ifndef _WIN32
+static void *ThreadTrampoline(void *pvThread)
+{
+    PTHREAD pThread = pvThread;
+    pThread->rc = pThread->pfnThread(pThread->pvUser);
+    return NULL;
+}
+#endif
+
+
+/**
+ * Creates a thread running a function.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   ppThread    Where to store the thread, wait for it with ThreadJoin().
+ * @param   pfnThread   The function to run.
+ * @param   pvUser      The argument to @a pfnThread.
+ */
+int ThreadCreate(PTHREAD *ppThread, PFNTHREAD pfnThread, void *pvUser)
+{
+    AssertReturn(ppThread, RERR_INVALID_PARAMETER);
+    AssertReturn(pfnThread, RERR_INVALID_PARAMETER);
+    *ppThread = NULL;
+
+#ifndef _WIN32
+    PTHREAD pThread = MemAlloc(sizeof(*pThread));
+    if (!pThread)
+        return RERR_NO_MEMORY;
+    pThread->pfnThread = pfnThread;
+    pThread->pvUser    = pvUser;
+    pThread->rc        = RINF_SUCCESS;
+    if (pthread_create(&pThread->hThread, NULL, ThreadTrampoline, pThread))
+    {
+        MemFree(pThread);
+        return RERR_THREAD_FAILED;
+    }
+    *ppThread = pThread;
+    return RINF_SUCCESS;
+#else
+    NOREF(pvUser);
+    return RERR_NOT_SUPPORTED;
+#endif
+}
+
+
+/**
+ * Waits for a thread to finish and frees it.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pThread     The thread.
+ * @param   prcThread   Where to store what the thread function returned, optional.
+ */
+int ThreadJoin(PTHREAD pThread, int *prcThread)
+{
+    AssertReturn(pThread, RERR_INVALID_PARAMETER);
+#ifndef _WIN32
+    if (pthread_join(pThread->hThread, NULL))
+        return RERR_THREAD_FAILED;
+#endif
+    if (prcThread)
+        *prcThread = pThread->rc;
+    MemFree(pThread);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Gets the number of CPUs available to run threads on.
+ *
+ * @return  The number of online CPUs, at least 1.
+ */
+uint32_t ThreadCpuCount(void)
+{
+#if !defined(_WIN32) && defined(_SC_NPROCESSORS_ONLN)
+    long const cCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cCpus > 1)
+        return (uint32_t)R_MIN(cCpus, 1024);
+#endif
+    return 1;
+}
+
+
+/**
+ * Creates a mutual exclusion lock.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   ppMutex     Where to store the lock, free it with ThreadMutexDestroy().
+ */
+int ThreadMutexCreate(PTHREADMUTEX *ppMutex)
+{
+    AssertReturn(ppMutex, RERR_INVALID_PARAMETER);
+    PTHREADMUTEX pMutex = MemAlloc(sizeof(*pMutex));
+    if (!pMutex)
+        return RERR_NO_MEMORY;
+#ifndef _WIN32
+    if (pthread_mutex_init(&pMutex->Mutex, NULL))
+    {
+        MemFree(pMutex);
+        return RERR_THREAD_FAILED;
+    }
+#endif
+    *ppMutex = pMutex;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a mutual exclusion lock, nobody may hold it.
+ *
+ * @param   pMutex      The lock, can be NULL.
+ */
+void ThreadMutexDestroy(PTHREADMUTEX pMutex)
+{
+    if (!pMutex)
+        return;
+#ifndef _WIN32
+    pthread_mutex_destroy(&pMutex->Mutex);
+#endif
+    MemFree(pMutex);
+}
+
+
+void ThreadMutexLock(PTHREADMUTEX pMutex)
+{
+#ifndef _WIN32
+    int rc = pthread_mutex_lock(&pMutex->Mutex);
+    Assert(!rc);
+    NOREF(rc);
+#else
+    NOREF(pMutex);
+#endif
+}
+
+
+void ThreadMutexUnlock(PTHREADMUTEX pMutex)
+{
+#ifndef _WIN32
+    int rc = pthread_mutex_unlock(&pMutex->Mutex);
+    Assert(!rc);
+    NOREF(rc);
+#else
+    NOREF(pMutex);
+#endif
+}
+
+
+/**
+ * Creates a condition variable.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   ppCond      Where to store the condition variable, free it with
+ *                      ThreadCondDestroy().
+ */
+int ThreadCondCreate(PTHREADCOND *ppCond)
+{
+    AssertReturn(ppCond, RERR_INVALID_PARAMETER);
+    PTHREADCOND pCond = MemAlloc(sizeof(*pCond));
+    if (!pCond)
+        return RERR_NO_MEMORY;
+#ifndef _WIN32
+    if (pthread_cond_init(&pCond->Cond, NULL))
+    {
+        MemFree(pCond);
+        return RERR_THREAD_FAILED;
+    }
+#endif
+    *ppCond = pCond;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Destroys a condition variable, nobody may wait on it.
+ *
+ * @param   pCond       The condition variable, can be NULL.
+ */
+void ThreadCondDestroy(PTHREADCOND pCond)
+{
+    if (!pCond)
+        return;
+#ifndef _WIN32
+    pthread_cond_destroy(&pCond->Cond);
+#endif
+    MemFree(pCond);
+}
+
+
+/**
+ * Releases a lock, waits for the condition variable to be signalled and takes
+ * the lock again. Wakeups can be spurious, callers check their condition in a
+ * loop.
+ *
+ * @param   pCond       The condition variable.
+ * @param   pMutex      The lock, held by the caller.
+ */
+void ThreadCondWait(PTHREADCOND pCond, PTHREADMUTEX pMutex)
+{
+#ifndef _WIN32
+    int rc = pthread_cond_wait(&pCond->Cond, &pMutex->Mutex);
+    Assert(!rc);
+    NOREF(rc);
+#else
+    NOREF(pCond);
+    NOREF(pMutex);
+#endif
+}
+
+
+void ThreadCondBroadcast(PTHREADCOND pCond)
+{
+#ifndef _WIN32
+    int rc = pthread_cond_broadcast(&pCond->Cond);
+    Assert(!rc);
+    NOREF(rc);
+#else
+    NOREF(pCond);
+#endif
+}
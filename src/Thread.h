@@ -0,0 +1,58 @@
+/** @file
+ * Threads and their synchronization, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFTHREAD_H___
+#define NOPFTHREAD_H___
+
+#include <inttypes.h>
+
+/**
+ * The function a thread runs.
+ *
+ * @return  Status code, returned by ThreadJoin().
+ * @param   pvUser      The user argument passed to ThreadCreate().
+ */
+typedef int FNTHREAD(void *pvUser);
+/** Pointer to a thread function. */
+typedef FNTHREAD *PFNTHREAD;
+
+/** A thread, opaque. */
+typedef struct THREAD *PTHREAD;
+/** A mutual exclusion lock, opaque. */
+typedef struct THREADMUTEX *PTHREADMUTEX;
+/** A condition variable, opaque. */
+typedef struct THREADCOND *PTHREADCOND;
+
+int         ThreadCreate(PTHREAD *ppThread, PFNTHREAD pfnThread, void *pvUser);
+int         ThreadJoin(PTHREAD pThread, int *prcThread);
+uint32_t    ThreadCpuCount(void);
+
+int         ThreadMutexCreate(PTHREADMUTEX *ppMutex);
+void        ThreadMutexDestroy(PTHREADMUTEX pMutex);
+void        ThreadMutexLock(PTHREADMUTEX pMutex);
+void        ThreadMutexUnlock(PTHREADMUTEX pMutex);
+
+int         ThreadCondCreate(PTHREADCOND *ppCond);
+void        ThreadCondDestroy(PTHREADCOND pCond);
+void        ThreadCondWait(PTHREADCOND pCond, PTHREADMUTEX pMutex);
+void        ThreadCondBroadcast(PTHREADCOND pCond);
+
+#endif /* NOPFTHREAD_H___ */
@@ -0,0 +1,53 @@
+/** @file
+ * Monotonic timestamps, implementation.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _WIN32
+/* clock_gettime() is POSIX, not C99. */
+# define _POSIX_C_SOURCE 200112L
+# include <time.h>
+#else
+# include <Windows.h>
+#endif
+
+#include "Timestamp.h"
+
+/**
+ * Returns a monotonic timestamp. Only differences between timestamps are
+ * meaningful, the epoch is unspecified.
+ *
+ * @return  The timestamp in nanoseconds.
+ */
+uint64_t TimestampNanoSecs(void)
+{
+#ifndef _WIN32
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * NANOSECS_PER_SEC + (uint64_t)Ts.tv_nsec;
+#else
+    static LARGE_INTEGER s_Freq;
+    LARGE_INTEGER Now;
+    if (!s_Freq.QuadPart)
+        QueryPerformanceFrequency(&s_Freq);
+    QueryPerformanceCounter(&Now);
+    return (uint64_t)((long double)Now.QuadPart * NANOSECS_PER_SEC / s_Freq.QuadPart);
+#endif
+}
+
@@ -0,0 +1,35 @@
+/** @file
+ * Monotonic timestamps, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFTIMESTAMP_H___
+#define NOPFTIMESTAMP_H___
+
+#include <inttypes.h>
+
+/** Nanoseconds in a millisecond. */
+#define NANOSECS_PER_MILLISEC       UINT64_C(1000000)
+/** Nanoseconds in a second. */
+#define NANOSECS_PER_SEC            UINT64_C(1000000000)
+
+uint64_t    TimestampNanoSecs(void);
+
+#endif /* NOPFTIMESTAMP_H___ */
+
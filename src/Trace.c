@@ -0,0 +1,243 @@
+/** @file
+ * Timeline tracing of expression processing.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*******************************************************************************
+ *   Header Files                                                              *
+ *******************************************************************************/
+#include "Trace.h"
+#include "Assert.h"
+#include "Errors.h"
+#include "GenericDefs.h"
+#include "Memory.h"
+#include "StringOps.h"
+#include "Types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Number of events allocated initially. */
+#define TRACE_EVENTS_INITIAL            1024U
+
+
+/**
+ * Initializes a trace.
+ *
+ * @param   pTrace          The trace.
+ * @param   idThread        Thread the events are recorded on.
+ * @param   cMaxEvents      Maximum number of events kept, the oldest are
+ *                          overwritten beyond it.
+ */
+void TraceInit(PTRACE pTrace, uint32_t idThread, uint32_t cMaxEvents)
+{
+    AssertReturnVoid(pTrace);
+    pTrace->paEvents   = NULL;
+    pTrace->cAlloc     = 0;
+    pTrace->cMaxEvents = R_MAX(cMaxEvents, 1);
+    pTrace->cEvents    = 0;
+    pTrace->idThread   = idThread;
+    pTrace->iExpr      = 0;
+    pTrace->pThreads   = NULL;
+    pTrace->pNext      = NULL;
+}
+
+
+/**
+ * Destroys a trace.
+ *
+ * @param   pTrace          The trace.
+ */
+void TraceDestroy(PTRACE pTrace)
+{
+    AssertReturnVoid(pTrace);
+    while (pTrace->pThreads)
+    {
+        PTRACE pThread = pTrace->pThreads;
+        pTrace->pThreads = pThread->pNext;
+        TraceDestroy(pThread);
+        MemFree(pThread);
+    }
+    MemFree(pTrace->paEvents);
+    pTrace->paEvents = NULL;
+    pTrace->cAlloc   = 0;
+    pTrace->cEvents  = 0;
+}
+
+
+/**
+ * Gets the trace of another thread, written along with @a pTrace, creating it the
+ * first time. Only the thread recording @a pTrace calls this, before the other
+ * thread records anything. The trace lives until @a pTrace is destroyed so threads
+ * started over and over again can keep using the same one.
+ *
+ * @return  The trace of the thread, NULL if there's no memory for it.
+ * @param   pTrace          The trace.
+ * @param   idThread        The other thread, not the one of @a pTrace.
+ */
+PTRACE TraceThread(PTRACE pTrace, uint32_t idThread)
+{
+    AssertReturn(pTrace, NULL);
+    AssertReturn(idThread != pTrace->idThread, NULL);
+
+    PTRACE pThread = pTrace->pThreads;
+    while (   pThread
+           && pThread->idThread != idThread)
+        pThread = pThread->pNext;
+    if (!pThread)
+    {
+        pThread = MemAllocZTag(sizeof(*pThread), enmMemTagOther);
+        if (!pThread)
+            return NULL;
+        TraceInit(pThread, idThread, pTrace->cMaxEvents);
+        pThread->pNext   = pTrace->pThreads;
+        pTrace->pThreads = pThread;
+    }
+    pThread->iExpr = pTrace->iExpr;
+    return pThread;
+}
+
+
+/**
+ * Records a span of work.
+ *
+ * The buffer grows until it holds @a cMaxEvents, or until growing fails, after
+ * which it wraps around overwriting the oldest events.
+ *
+ * @param   pTrace          The trace.
+ * @param   pszName         Name of the span, must be a string constant.
+ * @param   uStart          When the span started (TimestampNanoSecs).
+ * @param   uEnd            When the span ended (TimestampNanoSecs).
+ */
+void TraceSpan(PTRACE pTrace, const char *pszName, uint64_t uStart, uint64_t uEnd)
+{
+    if (   pTrace->cEvents == pTrace->cAlloc
+        && pTrace->cAlloc < pTrace->cMaxEvents)
+    {
+        uint32_t const cAlloc = R_MIN(R_MAX(pTrace->cAlloc * 2, TRACE_EVENTS_INITIAL), pTrace->cMaxEvents);
+        PTRACEEVENT paEvents = MemRealloc(pTrace->paEvents, cAlloc * sizeof(TRACEEVENT));
+        if (paEvents)
+        {
+            pTrace->paEvents = paEvents;
+            pTrace->cAlloc   = cAlloc;
+        }
+        else if (!pTrace->cAlloc)
+            return;
+    }
+
+    PTRACEEVENT pEvent = &pTrace->paEvents[pTrace->cEvents % pTrace->cAlloc];
+    pEvent->pszName   = pszName;
+    pEvent->uStart    = uStart;
+    pEvent->cNanoSecs = uEnd - uStart;
+    pEvent->iExpr     = pTrace->iExpr;
+    ++pTrace->cEvents;
+}
+
+
+/**
+ * TRACEREF: An event kept by one of the traces being written.
+ */
+typedef struct TRACEREF
+{
+    PCTRACEEVENT    pEvent;         /**< The event. */
+    uint32_t        idThread;       /**< Thread the event was recorded on. */
+} TRACEREF;
+/** Pointer to an event reference. */
+typedef TRACEREF *PTRACEREF;
+/** Pointer to a const event reference. */
+typedef const TRACEREF *PCTRACEREF;
+
+
+/**
+ * Orders events by when they started, qsort() callback.
+ */
+static int TraceRefCompare(const void *pvRef1, const void *pvRef2)
+{
+    PCTRACEREF pRef1 = pvRef1;
+    PCTRACEREF pRef2 = pvRef2;
+    if (pRef1->pEvent->uStart != pRef2->pEvent->uStart)
+        return pRef1->pEvent->uStart < pRef2->pEvent->uStart ? -1 : 1;
+    if (pRef1->idThread != pRef2->idThread)
+        return pRef1->idThread < pRef2->idThread ? -1 : 1;
+    return 0;
+}
+
+
+/**
+ * Writes a trace, and those of the other threads, as Chrome trace event JSON,
+ * viewable in chrome://tracing or Perfetto. The events of all threads are merged
+ * in the order they started and timestamps are relative to the earliest one kept.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pTrace          The trace.
+ * @param   pszFile         Name of the file to write.
+ */
+int TraceWriteChrome(PCTRACE pTrace, const char *pszFile)
+{
+    AssertReturn(pTrace, RERR_INVALID_PARAMETER);
+    AssertReturn(pszFile, RERR_INVALID_PARAMETER);
+
+    size_t cRefs = R_MIN(pTrace->cEvents, pTrace->cAlloc);
+    for (PCTRACE pThread = pTrace->pThreads; pThread; pThread = pThread->pNext)
+        cRefs += R_MIN(pThread->cEvents, pThread->cAlloc);
+    PTRACEREF paRefs = MemAllocTag(R_MAX(cRefs, 1) * sizeof(TRACEREF), enmMemTagOther);
+    if (!paRefs)
+        return RERR_NO_MEMORY;
+
+    /*
+     * Each trace holds its events in the order the spans ended, starting anywhere once
+     * its buffer has wrapped, so they are sorted by when they started.
+     */
+    cRefs = 0;
+    for (PCTRACE pCur = pTrace; pCur; pCur = pCur == pTrace ? pTrace->pThreads : pCur->pNext)
+    {
+        uint32_t const cKept = (uint32_t)R_MIN(pCur->cEvents, pCur->cAlloc);
+        for (uint32_t i = 0; i < cKept; i++)
+        {
+            paRefs[cRefs].pEvent   = &pCur->paEvents[i];
+            paRefs[cRefs].idThread = pCur->idThread;
+            ++cRefs;
+        }
+    }
+    qsort(paRefs, cRefs, sizeof(TRACEREF), TraceRefCompare);
+
+    FILE *pFile = fopen(pszFile, "w");
+    if (!pFile)
+    {
+        MemFree(paRefs);
+        return RERR_FILE_IO;
+    }
+
+    uint64_t const uEpoch = cRefs ? paRefs[0].pEvent->uStart : 0;
+    fprintf(pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < cRefs; i++)
+    {
+        PCTRACEEVENT pEvent = paRefs[i].pEvent;
+        fprintf(pFile, "{\"name\":\"%s\",\"cat\":\"nopf\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%" FMT_U32_NAT
+                ",\"args\":{\"expr\":%" FMT_U32_NAT "}}%s\n", pEvent->pszName, (pEvent->uStart - uEpoch) / 1000.0,
+                pEvent->cNanoSecs / 1000.0, paRefs[i].idThread, pEvent->iExpr, i + 1 < cRefs ? "," : "");
+    }
+    fprintf(pFile, "]}\n");
+
+    int rc = ferror(pFile) ? RERR_FILE_IO : RINF_SUCCESS;
+    if (fclose(pFile))
+        rc = RERR_FILE_IO;
+    MemFree(paRefs);
+    return rc;
+}
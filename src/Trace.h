@@ -0,0 +1,71 @@
+/** @file
+ * Timeline tracing of expression processing, header.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NOPFTRACE_H___
+#define NOPFTRACE_H___
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+/** Default maximum number of events kept, the oldest are overwritten beyond it. */
+#define TRACE_MAX_EVENTS_DEFAULT        (1U << 20)
+
+/**
+ * TRACEEVENT: A completed span of work.
+ */
+typedef struct TRACEEVENT
+{
+    const char     *pszName;        /**< Name of the span, a string constant. */
+    uint64_t        uStart;         /**< When the span started (TimestampNanoSecs). */
+    uint64_t        cNanoSecs;      /**< Duration of the span. */
+    uint32_t        iExpr;          /**< Expression being processed. */
+} TRACEEVENT;
+/** Pointer to a trace event. */
+typedef TRACEEVENT *PTRACEEVENT;
+/** Pointer to a const trace event. */
+typedef const TRACEEVENT *PCTRACEEVENT;
+
+/**
+ * TRACE: Ring buffer of the trace events of one thread.
+ */
+typedef struct TRACE
+{
+    PTRACEEVENT     paEvents;       /**< The events, grown on demand up to @a cMaxEvents. */
+    uint32_t        cAlloc;         /**< Number of events allocated. */
+    uint32_t        cMaxEvents;     /**< Maximum number of events kept. */
+    uint64_t        cEvents;        /**< Number of events recorded, including overwritten ones. */
+    uint32_t        idThread;       /**< Thread the events were recorded on. */
+    uint32_t        iExpr;          /**< Expression being processed, recorded with the events. */
+    struct TRACE   *pThreads;       /**< Traces of other threads written along with this one, see TraceThread(). */
+    struct TRACE   *pNext;          /**< Next trace in the list of the traces of other threads. */
+} TRACE;
+/** Pointer to a trace. */
+typedef TRACE *PTRACE;
+/** Pointer to a const trace. */
+typedef const TRACE *PCTRACE;
+
+void        TraceInit(PTRACE pTrace, uint32_t idThread, uint32_t cMaxEvents);
+void        TraceDestroy(PTRACE pTrace);
+PTRACE      TraceThread(PTRACE pTrace, uint32_t idThread);
+void        TraceSpan(PTRACE pTrace, const char *pszName, uint64_t uStart, uint64_t uEnd);
+int         TraceWriteChrome(PCTRACE pTrace, const char *pszFile);
+
+#endif /* NOPFTRACE_H___ */
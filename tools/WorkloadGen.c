@@ -0,0 +1,783 @@
+/** @file
+ * Synthetic expression workload generator.
+ *
+ * Writes a reproducible stream of expressions, one per line, suitable for
+ * "nopf --batch". The same options (most importantly the seed) always produce
+ * the same stream, so timings of different nopf versions can be compared on
+ * identical inputs.
+ */
+
+/*
+ * Copyright (C) 2011 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*******************************************************************************
+ *   Header Files                                                              *
+ *******************************************************************************/
+#include "EvaluatorInternal.h"
+#include "EvaluatorFunctions.h"
+#include "Errors.h"
+#include "GenericDefs.h"
+#include "StringOps.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Name of the generator executable. */
+#define GEN_EXECNAME                "nopfgen"
+/** Maximum nesting depth of generated expressions. */
+#define GEN_MAX_DEPTH               64
+/** Maximum number of arguments generated for a Function call. */
+#define GEN_MAX_WIDTH               256
+
+/**
+ * GENRADIX: Radix numbers are written in.
+ */
+typedef enum GENRADIX
+{
+    enmGenRadixDec = 0,
+    enmGenRadixHex,
+    enmGenRadixOct,
+    enmGenRadixBin,
+    enmGenRadixMax
+} GENRADIX;
+
+/**
+ * GENOPTS: What to generate.
+ */
+typedef struct GENOPTS
+{
+    uint64_t        uSeed;                          /**< Seed of the random number generator. */
+    uint64_t        cExprs;                         /**< Number of expressions to generate. */
+    uint64_t        cMaxDepth;                      /**< Maximum nesting depth of an expression. */
+    uint64_t        cMaxWidth;                      /**< Maximum number of arguments to variadic Functions. */
+    uint64_t        cArgs;                          /**< Number of arguments to variadic Functions, 0 for random. */
+    uint64_t        cVarChains;                     /**< Number of Variable definition chains. */
+    uint64_t        cChainLength;                   /**< Number of Variables in each chain. */
+    uint64_t        auRadixWeights[enmGenRadixMax]; /**< Relative frequency of each radix. */
+    const char     *pszOps;                         /**< Comma separated Operators to use, NULL for all. */
+    const char     *pszFuncs;                       /**< Comma separated Functions to use, NULL for all. */
+} GENOPTS;
+/** Pointer to generator options. */
+typedef GENOPTS *PGENOPTS;
+/** Pointer to const generator options. */
+typedef const GENOPTS *PCGENOPTS;
+
+/**
+ * GENERATOR: Generator state.
+ */
+typedef struct GENERATOR
+{
+    GENOPTS         Opts;               /**< What to generate. */
+    uint64_t        uState;             /**< State of the random number generator. */
+    PCOPERATOR     *papBinary;          /**< Binary Operators to use. */
+    uint32_t        cBinary;            /**< Number of entries in @a papBinary. */
+    PCOPERATOR     *papUnary;           /**< Prefix Operators to use. */
+    uint32_t        cUnary;             /**< Number of entries in @a papUnary. */
+    PCFUNCTION     *papFunctions;       /**< Functions to use. */
+    uint32_t        cFunctions;         /**< Number of entries in @a papFunctions. */
+    PCFUNCTION     *papRangeFunctions;  /**< Functions producing Ranges, only passed to reductions. */
+    uint32_t        cRangeFunctions;    /**< Number of entries in @a papRangeFunctions. */
+    uint64_t        cVarsDefined;       /**< Number of Variables defined so far. */
+    STRBUF          StrBuf;             /**< The expression being generated. */
+} GENERATOR;
+/** Pointer to a generator. */
+typedef GENERATOR *PGENERATOR;
+
+/** Functions that produce Ranges, which are only valid as arguments to reductions. */
+static const char *const g_apszRangeFunctions[] = { "range", "seq" };
+
+/** Operators whose right operand gets a non-zero constant, nopf traps integer division by zero. */
+static const char *const g_apszDivideOperators[] = { "/", "%" };
+
+/** Operators whose right operand gets a bit count, nopf traps shifting by 64 or more. */
+static const char *const g_apszShiftOperators[] = { "<<", ">>" };
+
+/** Operators whose right operand gets a small constant, nopf traps products that overflow. */
+static const char *const g_apszMultiplyOperators[] = { "*" };
+
+/** Functions only used when asked for with --funcs, they fail without symbols loaded. */
+static const char *const g_apszSymbolFunctions[] = { "symaddr", "symoff" };
+
+/**
+ * GENARG: What an argument of a Function is drawn from.
+ */
+typedef enum GENARG
+{
+    enmGenArgExpr = 0,          /**< Any expression. */
+    enmGenArgNumber,            /**< A constant, see GenNumber(). */
+    enmGenArgSmall,             /**< A constant below 16. */
+    enmGenArgBit32,             /**< A bit number below 32. */
+    enmGenArgBit64,             /**< A bit number below 64. */
+    enmGenArgAlign              /**< A power of 2 up to 4K. */
+} GENARG;
+
+/**
+ * GENARGDOMAIN: The arguments a Function fails for are left out of its domain,
+ * so the workload measures evaluating rather than bailing out on overflows.
+ */
+typedef struct GENARGDOMAIN
+{
+    const char     *pszFunction;        /**< Name of the Function. */
+    GENARG          enmFirst;           /**< Domain of the first argument. */
+    GENARG          enmRest;            /**< Domain of the other arguments. */
+    bool            fRanges;            /**< Whether it is passed Ranges at all. */
+    bool            fAllParams;         /**< Whether it is always passed its maximum number of arguments. */
+} GENARGDOMAIN;
+/** Pointer to a const argument domain. */
+typedef const GENARGDOMAIN *PCGENARGDOMAIN;
+
+/** Argument domains of Functions that don't take any expression. Unit conversions, named
+ *  <from>2<to>, take constants as their factors overflow larger values. */
+static const GENARGDOMAIN g_aArgDomains[] =
+{
+    { "fact",           enmGenArgSmall,     enmGenArgSmall,     false, false },
+    { "lcm",            enmGenArgSmall,     enmGenArgSmall,     false, false },
+    { "pow",            enmGenArgSmall,     enmGenArgSmall,     false, false },
+    { "root",           enmGenArgNumber,    enmGenArgSmall,     false, false },
+    { "RT_BIT",         enmGenArgBit32,     enmGenArgBit32,     false, false },
+    { "RT_BIT_32",      enmGenArgBit32,     enmGenArgBit32,     false, false },
+    { "RT_BIT_64",      enmGenArgBit64,     enmGenArgBit64,     false, false },
+    { "RT_BITS",        enmGenArgBit32,     enmGenArgBit32,     false, true  },
+    { "RT_BITS_32",     enmGenArgBit32,     enmGenArgBit32,     false, true  },
+    { "RT_BITS_64",     enmGenArgBit64,     enmGenArgBit64,     false, true  },
+    { "RT_ALIGN",       enmGenArgNumber,    enmGenArgAlign,     false, false },
+    { "RT_ALIGN_32",    enmGenArgNumber,    enmGenArgAlign,     false, false },
+    { "RT_ALIGN_64",    enmGenArgNumber,    enmGenArgAlign,     false, false }
+};
+/** Domain of unit conversions. */
+static const GENARGDOMAIN g_ConversionDomain = { "", enmGenArgNumber, enmGenArgNumber, false, false };
+/** Domain of everything else. */
+static const GENARGDOMAIN g_DefaultDomain = { "", enmGenArgExpr, enmGenArgExpr, true, false };
+
+
+/**
+ * Returns the next pseudo-random number (xorshift64*).
+ *
+ * @return  The random number.
+ * @param   pGen        The generator.
+ */
+static uint64_t GenRandom(PGENERATOR pGen)
+{
+    pGen->uState ^= pGen->uState >> 12;
+    pGen->uState ^= pGen->uState << 25;
+    pGen->uState ^= pGen->uState >> 27;
+    return pGen->uState * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+
+/**
+ * Returns a pseudo-random number below @a uLimit.
+ *
+ * @return  The random number.
+ * @param   pGen        The generator.
+ * @param   uLimit      The exclusive upper bound, must not be 0.
+ */
+static uint64_t GenRandomBelow(PGENERATOR pGen, uint64_t uLimit)
+{
+    return GenRandom(pGen) % uLimit;
+}
+
+
+/**
+ * Checks if a name is in a comma separated list.
+ *
+ * @return  true if @a pszList is NULL or contains @a pszName, otherwise false.
+ * @param   pszList     The comma separated list, NULL for everything.
+ * @param   pszName     The name.
+ */
+static bool GenIsInList(const char *pszList, const char *pszName)
+{
+    if (!pszList)
+        return true;
+
+    size_t const cchName = StrLen(pszName);
+    const char *pszItem = pszList;
+    for (;;)
+    {
+        const char *pszComma = strchr(pszItem, ',');
+        size_t const cchItem = pszComma ? (size_t)(pszComma - pszItem) : StrLen(pszItem);
+        if (   cchItem == cchName
+            && !StrNCmp(pszItem, pszName, cchName))
+            return true;
+        if (!pszComma)
+            return false;
+        pszItem = pszComma + 1;
+    }
+}
+
+
+/**
+ * Checks if an Operator divides by its right operand.
+ *
+ * @return  true if it does, otherwise false.
+ * @param   pOperator   The Operator.
+ */
+static bool GenIsDivideOperator(PCOPERATOR pOperator)
+{
+    for (unsigned i = 0; i < R_ARRAY_ELEMENTS(g_apszDivideOperators); i++)
+        if (!StrCmp(pOperator->pszOperator, g_apszDivideOperators[i]))
+            return true;
+    return false;
+}
+
+
+/**
+ * Checks if an Operator shifts by its right operand.
+ *
+ * @return  true if it does, otherwise false.
+ * @param   pOperator   The Operator.
+ */
+static bool GenIsShiftOperator(PCOPERATOR pOperator)
+{
+    for (unsigned i = 0; i < R_ARRAY_ELEMENTS(g_apszShiftOperators); i++)
+        if (!StrCmp(pOperator->pszOperator, g_apszShiftOperators[i]))
+            return true;
+    return false;
+}
+
+
+/**
+ * Checks if an Operator multiplies by its right operand.
+ *
+ * @return  true if it does, otherwise false.
+ * @param   pOperator   The Operator.
+ */
+static bool GenIsMultiplyOperator(PCOPERATOR pOperator)
+{
+    for (unsigned i = 0; i < R_ARRAY_ELEMENTS(g_apszMultiplyOperators); i++)
+        if (!StrCmp(pOperator->pszOperator, g_apszMultiplyOperators[i]))
+            return true;
+    return false;
+}
+
+
+/**
+ * Gets the domain of the arguments of a Function.
+ *
+ * @return  The domain.
+ * @param   pFunction   The Function.
+ */
+static PCGENARGDOMAIN GenArgDomain(PCFUNCTION pFunction)
+{
+    for (unsigned i = 0; i < R_ARRAY_ELEMENTS(g_aArgDomains); i++)
+        if (!StrCmp(pFunction->pszFunction, g_aArgDomains[i].pszFunction))
+            return &g_aArgDomains[i];
+
+    const char *pszTo = strchr(pFunction->pszFunction, '2');
+    if (   pszTo
+        && pszTo != pFunction->pszFunction
+        && isalpha(pszTo[1]))
+        return &g_ConversionDomain;
+    return &g_DefaultDomain;
+}
+
+
+static void GenExpr(PGENERATOR pGen, uint64_t cDepth);
+
+
+/**
+ * Writes a number in one of the radixes, weighted as requested.
+ *
+ * @param   pGen        The generator.
+ * @param   uValue      The number.
+ */
+static void GenWriteNumber(PGENERATOR pGen, uint64_t uValue)
+{
+    uint64_t cTotalWeight = 0;
+    for (unsigned i = 0; i < enmGenRadixMax; i++)
+        cTotalWeight += pGen->Opts.auRadixWeights[i];
+    uint64_t uPick = GenRandomBelow(pGen, cTotalWeight);
+    GENRADIX enmRadix = enmGenRadixDec;
+    for (unsigned i = 0; i < enmGenRadixMax; i++)
+    {
+        if (uPick < pGen->Opts.auRadixWeights[i])
+        {
+            enmRadix = (GENRADIX)i;
+            break;
+        }
+        uPick -= pGen->Opts.auRadixWeights[i];
+    }
+
+    switch (enmRadix)
+    {
+        case enmGenRadixHex:    StrBufAppendF(&pGen->StrBuf, "0x%" FMT_U64_HEX, uValue); break;
+        case enmGenRadixOct:    StrBufAppendF(&pGen->StrBuf, "0%" FMT_U64_OCT, uValue); break;
+        case enmGenRadixBin:
+        {
+            StrBufAppendF(&pGen->StrBuf, "n");
+            int iBit = 63;
+            while (iBit > 0 && !(uValue & (UINT64_C(1) << iBit)))
+                --iBit;
+            for (; iBit >= 0; iBit--)
+                StrBufAppendF(&pGen->StrBuf, "%c", (uValue & (UINT64_C(1) << iBit)) ? '1' : '0');
+            break;
+        }
+        default:                StrBufAppendF(&pGen->StrBuf, "%" FMT_U64_NAT, uValue); break;
+    }
+}
+
+
+/**
+ * Generates a number, mostly a small one.
+ *
+ * @param   pGen        The generator.
+ * @param   fNonZero    Whether the number must not be 0.
+ */
+static void GenNumber(PGENERATOR pGen, bool fNonZero)
+{
+    GenWriteNumber(pGen, (GenRandomBelow(pGen, 8) ? GenRandomBelow(pGen, 256) : GenRandomBelow(pGen, 65536)) + fNonZero);
+}
+
+
+/**
+ * Generates an argument of a Function from its domain.
+ *
+ * @param   pGen        The generator.
+ * @param   enmArg      The domain.
+ * @param   cDepth      Nesting depth left for expressions.
+ */
+static void GenArg(PGENERATOR pGen, GENARG enmArg, uint64_t cDepth)
+{
+    switch (enmArg)
+    {
+        case enmGenArgNumber:   GenNumber(pGen, false /* fNonZero */); break;
+        case enmGenArgSmall:    GenWriteNumber(pGen, GenRandomBelow(pGen, 16)); break;
+        case enmGenArgBit32:    GenWriteNumber(pGen, GenRandomBelow(pGen, 32)); break;
+        case enmGenArgBit64:    GenWriteNumber(pGen, GenRandomBelow(pGen, 64)); break;
+        case enmGenArgAlign:    GenWriteNumber(pGen, UINT64_C(2) << GenRandomBelow(pGen, 12)); break;
+        default:                GenExpr(pGen, cDepth); break;
+    }
+}
+
+
+/**
+ * Generates a reference to one of the Variables defined so far.
+ *
+ * @param   pGen        The generator.
+ */
+static void GenVariable(PGENERATOR pGen)
+{
+    uint64_t const iVar = GenRandomBelow(pGen, pGen->cVarsDefined);
+    StrBufAppendF(&pGen->StrBuf, "_w%" FMT_U64_NAT "_%" FMT_U64_NAT, iVar / pGen->Opts.cChainLength,
+                  iVar % pGen->Opts.cChainLength);
+}
+
+
+/**
+ * Generates a Function call.
+ *
+ * @param   pGen        The generator.
+ * @param   pFunction   The Function.
+ * @param   cDepth      Nesting depth left for the arguments.
+ */
+static void GenFunctionCall(PGENERATOR pGen, PCFUNCTION pFunction, uint64_t cDepth)
+{
+    PCGENARGDOMAIN pDomain = GenArgDomain(pFunction);
+    uint64_t cArgs;
+    if (pDomain->fAllParams)
+        cArgs = pFunction->cMaxParams;
+    else if (pGen->Opts.cArgs)
+        cArgs = R_MAX(R_MIN(pGen->Opts.cArgs, pFunction->cMaxParams), pFunction->cMinParams);
+    else
+    {
+        uint64_t const cMaxArgs = R_MAX(R_MIN(pGen->Opts.cMaxWidth, pFunction->cMaxParams), pFunction->cMinParams);
+        cArgs = pFunction->cMinParams + GenRandomBelow(pGen, cMaxArgs - pFunction->cMinParams + 1);
+    }
+
+    StrBufAppendF(&pGen->StrBuf, "%s(", pFunction->pszFunction);
+    for (uint64_t i = 0; i < cArgs; i++)
+    {
+        if (i)
+            StrBufAppendF(&pGen->StrBuf, ", ");
+
+        if (   pFunction->fRangeParams
+            && pDomain->fRanges
+            && pGen->cRangeFunctions
+            && !GenRandomBelow(pGen, 4))
+        {
+            PCFUNCTION pRange = pGen->papRangeFunctions[GenRandomBelow(pGen, pGen->cRangeFunctions)];
+            uint64_t const uFirst = GenRandomBelow(pGen, 100);
+            StrBufAppendF(&pGen->StrBuf, "%s(%" FMT_U64_NAT ", %" FMT_U64_NAT ")", pRange->pszFunction, uFirst,
+                          uFirst + GenRandomBelow(pGen, 100));
+        }
+        else
+            GenArg(pGen, i ? pDomain->enmRest : pDomain->enmFirst, cDepth);
+    }
+    StrBufAppendF(&pGen->StrBuf, ")");
+}
+
+
+/**
+ * Generates an expression.
+ *
+ * @param   pGen        The generator.
+ * @param   cDepth      Nesting depth left.
+ */
+static void GenExpr(PGENERATOR pGen, uint64_t cDepth)
+{
+    if (   cDepth
+        && GenRandomBelow(pGen, 4))
+    {
+        uint64_t const uPick = GenRandomBelow(pGen, 8);
+        if (   uPick < 4
+            && pGen->cBinary)
+        {
+            PCOPERATOR pOperator = pGen->papBinary[GenRandomBelow(pGen, pGen->cBinary)];
+            StrBufAppendF(&pGen->StrBuf, "(");
+            GenExpr(pGen, cDepth - 1);
+            StrBufAppendF(&pGen->StrBuf, " %s ", pOperator->pszOperator);
+            if (GenIsDivideOperator(pOperator))
+                GenNumber(pGen, true /* fNonZero */);
+            else if (GenIsShiftOperator(pOperator))
+                GenArg(pGen, enmGenArgBit64, cDepth - 1);
+            else if (GenIsMultiplyOperator(pOperator))
+                GenArg(pGen, enmGenArgSmall, cDepth - 1);
+            else
+                GenExpr(pGen, cDepth - 1);
+            StrBufAppendF(&pGen->StrBuf, ")");
+            return;
+        }
+        if (   uPick == 4
+            && pGen->cUnary)
+        {
+            PCOPERATOR pOperator = pGen->papUnary[GenRandomBelow(pGen, pGen->cUnary)];
+            StrBufAppendF(&pGen->StrBuf, "%s(", pOperator->pszOperator);
+            GenExpr(pGen, cDepth - 1);
+            StrBufAppendF(&pGen->StrBuf, ")");
+            return;
+        }
+        if (   uPick > 4
+            && pGen->cFunctions)
+        {
+            GenFunctionCall(pGen, pGen->papFunctions[GenRandomBelow(pGen, pGen->cFunctions)], cDepth - 1);
+            return;
+        }
+    }
+
+    if (   pGen->cVarsDefined
+        && !GenRandomBelow(pGen, 4))
+        GenVariable(pGen);
+    else
+        GenNumber(pGen, false /* fNonZero */);
+}
+
+
+/**
+ * Writes the expression generated so far as a line of output.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pGen        The generator.
+ */
+static int GenFlushLine(PGENERATOR pGen)
+{
+    char *pszLine = NULL;
+    int rc = StrBufDetach(&pGen->StrBuf, &pszLine);
+    if (RC_SUCCESS(rc))
+    {
+        if (puts(pszLine) == EOF)
+            rc = RERR_FILE_IO;
+        StrFree(pszLine);
+    }
+    return rc;
+}
+
+
+/**
+ * Picks the Operators and Functions to draw from.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pGen        The generator.
+ */
+static int GenInit(PGENERATOR pGen)
+{
+    pGen->papBinary         = MemAlloc(g_cOperators * sizeof(PCOPERATOR));
+    pGen->papUnary          = MemAlloc(g_cOperators * sizeof(PCOPERATOR));
+    pGen->papFunctions      = MemAlloc(g_cFunctions * sizeof(PCFUNCTION));
+    pGen->papRangeFunctions = MemAlloc(g_cFunctions * sizeof(PCFUNCTION));
+    if (   !pGen->papBinary
+        || !pGen->papUnary
+        || !pGen->papFunctions
+        || !pGen->papRangeFunctions)
+        return RERR_NO_MEMORY;
+
+    /*
+     * Parentheses, separators and assignments are structure, not Operators to draw from.
+     * Postfix Operators are left out, prefix ones apply to a parenthesized operand.
+     */
+    for (unsigned i = 0; i < g_cOperators; i++)
+    {
+        PCOPERATOR pOperator = &g_aOperators[i];
+        if (   pOperator->OperatorId == OPEN_PAREN_ID
+            || pOperator->OperatorId == CLOSE_PAREN_ID
+            || pOperator->OperatorId == PARAM_SEP_ID
+            || pOperator->OperatorId == VAR_ASSIGN_ID
+            || !GenIsInList(pGen->Opts.pszOps, pOperator->pszOperator))
+            continue;
+        if (pOperator->cParams == 2)
+            pGen->papBinary[pGen->cBinary++] = pOperator;
+        else if (   pOperator->cParams == 1
+                 && pOperator->Direction == enmDirRight)
+            pGen->papUnary[pGen->cUnary++] = pOperator;
+    }
+
+    /*
+     * Functions without an evaluator are interactive commands in disguise. Symbol lookups
+     * are only used when asked for, without symbols loaded they just fail.
+     */
+    for (unsigned i = 0; i < g_cFunctions; i++)
+    {
+        PCFUNCTION pFunction = &g_aFunctions[i];
+        if (!pFunction->pfnFunction)
+            continue;
+
+        bool fRange = false;
+        for (unsigned k = 0; k < R_ARRAY_ELEMENTS(g_apszRangeFunctions); k++)
+            fRange |= !StrCmp(pFunction->pszFunction, g_apszRangeFunctions[k]);
+        bool fSymbol = false;
+        for (unsigned k = 0; k < R_ARRAY_ELEMENTS(g_apszSymbolFunctions); k++)
+            fSymbol |= !StrCmp(pFunction->pszFunction, g_apszSymbolFunctions[k]);
+
+        if (fRange)
+            pGen->papRangeFunctions[pGen->cRangeFunctions++] = pFunction;
+        else if (   GenIsInList(pGen->Opts.pszFuncs, pFunction->pszFunction)
+                 && (!fSymbol || pGen->Opts.pszFuncs))
+            pGen->papFunctions[pGen->cFunctions++] = pFunction;
+    }
+
+    /*
+     * Seed through splitmix64 so that small and similar seeds still give unrelated streams,
+     * and the xorshift state is never 0.
+     */
+    uint64_t uSeed = pGen->Opts.uSeed + UINT64_C(0x9e3779b97f4a7c15);
+    uSeed = (uSeed ^ (uSeed >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    uSeed = (uSeed ^ (uSeed >> 27)) * UINT64_C(0x94d049bb133111eb);
+    uSeed ^= uSeed >> 31;
+    pGen->uState = uSeed ? uSeed : 1;
+
+    StrBufInit(&pGen->StrBuf);
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Generates the workload.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pGen        The generator.
+ */
+static int GenRun(PGENERATOR pGen)
+{
+    PCGENOPTS pOpts = &pGen->Opts;
+    printf("# " GEN_EXECNAME " --seed=%" FMT_U64_NAT " --count=%" FMT_U64_NAT " --depth=%" FMT_U64_NAT
+           " --width=%" FMT_U64_NAT " --args=%" FMT_U64_NAT " --vars=%" FMT_U64_NAT " --chain=%" FMT_U64_NAT
+           " --radix=%" FMT_U64_NAT ":%" FMT_U64_NAT ":%" FMT_U64_NAT ":%" FMT_U64_NAT "%s%s%s%s\n",
+           pOpts->uSeed, pOpts->cExprs, pOpts->cMaxDepth, pOpts->cMaxWidth, pOpts->cArgs, pOpts->cVarChains,
+           pOpts->cChainLength, pOpts->auRadixWeights[0], pOpts->auRadixWeights[1], pOpts->auRadixWeights[2],
+           pOpts->auRadixWeights[3], pOpts->pszOps ? " --ops=" : "", pOpts->pszOps ? pOpts->pszOps : "",
+           pOpts->pszFuncs ? " --funcs=" : "", pOpts->pszFuncs ? pOpts->pszFuncs : "");
+
+    /*
+     * Variable chains first, each link building on the previous one and on any Variable
+     * defined before it.
+     */
+    int rc = RINF_SUCCESS;
+    for (uint64_t iChain = 0; iChain < pOpts->cVarChains && RC_SUCCESS(rc); iChain++)
+    {
+        for (uint64_t iLink = 0; iLink < pOpts->cChainLength && RC_SUCCESS(rc); iLink++)
+        {
+            StrBufAppendF(&pGen->StrBuf, "_w%" FMT_U64_NAT "_%" FMT_U64_NAT " = ", iChain, iLink);
+            PCOPERATOR pOperator = NULL;
+            if (   iLink
+                && pGen->cBinary)
+            {
+                pOperator = pGen->papBinary[GenRandomBelow(pGen, pGen->cBinary)];
+                StrBufAppendF(&pGen->StrBuf, "_w%" FMT_U64_NAT "_%" FMT_U64_NAT " %s ", iChain, iLink - 1,
+                              pOperator->pszOperator);
+            }
+            if (   pOperator
+                && GenIsDivideOperator(pOperator))
+                GenNumber(pGen, true /* fNonZero */);
+            else if (   pOperator
+                     && GenIsShiftOperator(pOperator))
+                GenArg(pGen, enmGenArgBit64, 0 /* cDepth */);
+            else if (   pOperator
+                     && GenIsMultiplyOperator(pOperator))
+                GenArg(pGen, enmGenArgSmall, 0 /* cDepth */);
+            else
+                GenExpr(pGen, R_MIN(pOpts->cMaxDepth, 2));
+            rc = GenFlushLine(pGen);
+            ++pGen->cVarsDefined;
+        }
+    }
+
+    for (uint64_t i = 0; i < pOpts->cExprs && RC_SUCCESS(rc); i++)
+    {
+        GenExpr(pGen, pOpts->cMaxDepth);
+        rc = GenFlushLine(pGen);
+    }
+    return rc;
+}
+
+
+/**
+ * Parses a numeric option value.
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszValue    The value.
+ * @param   uMax        The largest acceptable value.
+ * @param   puValue     Where to store the value.
+ */
+static int GenParseValue(const char *pszValue, uint64_t uMax, uint64_t *puValue)
+{
+    char *pszEnd = NULL;
+    errno = 0;
+    unsigned long long uValue = strtoull(pszValue, &pszEnd, 0);
+    if (   errno
+        || pszEnd == pszValue
+        || *pszEnd
+        || uValue > uMax)
+        return RERR_INVALID_PARAMETER;
+    *puValue = uValue;
+    return RINF_SUCCESS;
+}
+
+
+/**
+ * Parses the radix weights, "<dec>:<hex>:<oct>:<bin>".
+ *
+ * @return  RINF_SUCCESS on success, otherwise appropriate status code.
+ * @param   pszValue    The value.
+ * @param   pOpts       The options to update.
+ */
+static int GenParseRadixWeights(const char *pszValue, PGENOPTS pOpts)
+{
+    uint64_t cTotalWeight = 0;
+    for (unsigned i = 0; i < enmGenRadixMax; i++)
+    {
+        char *pszEnd = NULL;
+        errno = 0;
+        unsigned long long uWeight = strtoull(pszValue, &pszEnd, 10);
+        if (   errno
+            || pszEnd == pszValue
+            || uWeight > UINT32_MAX
+            || *pszEnd != (i + 1 < enmGenRadixMax ? ':' : '\0'))
+            return RERR_INVALID_PARAMETER;
+        pOpts->auRadixWeights[i] = uWeight;
+        cTotalWeight += uWeight;
+        pszValue = pszEnd + 1;
+    }
+    return cTotalWeight ? RINF_SUCCESS : RERR_INVALID_PARAMETER;
+}
+
+
+static void GenPrintUsage(void)
+{
+    fprintf(stderr,
+            "Usage: " GEN_EXECNAME " [options]\n"
+            "Writes a reproducible stream of expressions for \"nopf --batch\".\n"
+            "  --seed=<n>          Random seed (1).\n"
+            "  --count=<n>         Number of expressions (10000).\n"
+            "  --depth=<n>         Maximum nesting depth, up to %d (4).\n"
+            "  --width=<n>         Maximum arguments to variadic functions, up to %d (4).\n"
+            "  --args=<n>          Arguments to every variadic function call, 0 for random (0).\n"
+            "  --vars=<n>          Number of variable definition chains (0).\n"
+            "  --chain=<n>         Variables in each chain (1).\n"
+            "  --radix=<d:h:o:b>   Relative frequency of decimal, hex, octal and binary numbers (4:2:1:1).\n"
+            "  --ops=<a,b,...>     Operators to use (all).\n"
+            "  --funcs=<a,b,...>   Functions to use (all but symaddr and symoff).\n",
+            GEN_MAX_DEPTH, GEN_MAX_WIDTH);
+}
+
+
+int main(int cArgs, char *aszArgs[])
+{
+    GENERATOR Gen;
+    MemSet(&Gen, 0, sizeof(Gen));
+    PGENOPTS pOpts = &Gen.Opts;
+    pOpts->uSeed        = 1;
+    pOpts->cExprs       = 10000;
+    pOpts->cMaxDepth    = 4;
+    pOpts->cMaxWidth    = 4;
+    pOpts->cChainLength = 1;
+    pOpts->auRadixWeights[enmGenRadixDec] = 4;
+    pOpts->auRadixWeights[enmGenRadixHex] = 2;
+    pOpts->auRadixWeights[enmGenRadixOct] = 1;
+    pOpts->auRadixWeights[enmGenRadixBin] = 1;
+
+    int rc = RINF_SUCCESS;
+    for (int iArg = 1; iArg < cArgs && RC_SUCCESS(rc); iArg++)
+    {
+        const char *pszArg = aszArgs[iArg];
+        const char *pszValue = strchr(pszArg, '=');
+        pszValue = pszValue ? pszValue + 1 : "";
+        if (   !StrCmp(pszArg, "--help")
+            || !StrCmp(pszArg, "-h"))
+        {
+            GenPrintUsage();
+            return EXIT_SUCCESS;
+        }
+        if (!StrNCmp(pszArg, "--seed=", 7))
+            rc = GenParseValue(pszValue, UINT64_MAX, &pOpts->uSeed);
+        else if (!StrNCmp(pszArg, "--count=", 8))
+            rc = GenParseValue(pszValue, UINT64_MAX, &pOpts->cExprs);
+        else if (!StrNCmp(pszArg, "--depth=", 8))
+            rc = GenParseValue(pszValue, GEN_MAX_DEPTH, &pOpts->cMaxDepth);
+        else if (!StrNCmp(pszArg, "--width=", 8))
+            rc = GenParseValue(pszValue, GEN_MAX_WIDTH, &pOpts->cMaxWidth);
+        else if (!StrNCmp(pszArg, "--args=", 7))
+            rc = GenParseValue(pszValue, GEN_MAX_WIDTH, &pOpts->cArgs);
+        else if (!StrNCmp(pszArg, "--vars=", 7))
+            rc = GenParseValue(pszValue, UINT32_MAX, &pOpts->cVarChains);
+        else if (!StrNCmp(pszArg, "--chain=", 8))
+            rc = GenParseValue(pszValue, UINT32_MAX, &pOpts->cChainLength);
+        else if (!StrNCmp(pszArg, "--radix=", 8))
+            rc = GenParseRadixWeights(pszValue, pOpts);
+        else if (!StrNCmp(pszArg, "--ops=", 6))
+            pOpts->pszOps = pszValue;
+        else if (!StrNCmp(pszArg, "--funcs=", 8))
+            pOpts->pszFuncs = pszValue;
+        else
+            rc = RERR_INVALID_PARAMETER;
+
+        if (RC_FAILURE(rc))
+            fprintf(stderr, GEN_EXECNAME ": invalid option '%s'\n", pszArg);
+    }
+
+    if (   RC_SUCCESS(rc)
+        && !pOpts->cChainLength)
+        rc = RERR_INVALID_PARAMETER;
+    if (RC_FAILURE(rc))
+    {
+        GenPrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    rc = GenInit(&Gen);
+    if (RC_SUCCESS(rc))
+        rc = GenRun(&Gen);
+    if (RC_FAILURE(rc))
+        fprintf(stderr, GEN_EXECNAME ": failed to generate the workload, rc=%d\n", rc);
+
+    StrBufDelete(&Gen.StrBuf);
+    MemFree(Gen.papBinary);
+    MemFree(Gen.papUnary);
+    MemFree(Gen.papFunctions);
+    MemFree(Gen.papRangeFunctions);
+    return RC_SUCCESS(rc) ? EXIT_SUCCESS : EXIT_FAILURE;
+}